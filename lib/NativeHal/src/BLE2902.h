@@ -0,0 +1,11 @@
+/**
+ * @file BLE2902.h
+ * @brief Fake ESP32 BLE descriptor API for the Linux shim (declared in BLEDevice.h).
+ */
+
+#ifndef NATIVE_BLE2902_H
+#define NATIVE_BLE2902_H
+
+#include "BLEDevice.h"
+
+#endif // !NATIVE_BLE2902_H
@@ -0,0 +1,116 @@
+/**
+ * @file BLEDevice.cpp
+ * @brief Fake ESP32 BLE server for the Linux shim.
+ */
+
+#include "BLEDevice.h"
+
+namespace {
+
+BLEServer *lastServer = NULL;
+BLEAdvertising advertising;
+uint16_t localMtu = 23;
+
+} // namespace
+
+BLECharacteristic::~BLECharacteristic() {
+    for (size_t i = 0; i < descriptors.size(); i++) delete descriptors[i];
+}
+
+void BLECharacteristic::notify() {
+    for (size_t i = 0; i < descriptors.size(); i++) {
+        BLE2902 *cccd = dynamic_cast<BLE2902 *>(descriptors[i]);
+        if (cccd && cccd->getNotifications() && notified) {
+            notified(value);
+        }
+    }
+}
+
+void BLECharacteristic::fakeWrite(const std::string &data) {
+    value = data;
+    if (callbacks) callbacks->onWrite(this);
+}
+
+void BLECharacteristic::fakeSubscribe(bool enable) {
+    for (size_t i = 0; i < descriptors.size(); i++) {
+        BLE2902 *cccd = dynamic_cast<BLE2902 *>(descriptors[i]);
+        if (cccd) cccd->setNotifications(enable);
+    }
+}
+
+BLEService::~BLEService() {
+    for (size_t i = 0; i < characteristics.size(); i++) delete characteristics[i];
+}
+
+BLECharacteristic *BLEService::createCharacteristic(const char *characteristicUuid, uint32_t properties) {
+    characteristics.push_back(new BLECharacteristic(characteristicUuid, properties));
+    return characteristics.back();
+}
+
+BLECharacteristic *BLEService::getCharacteristic(const char *characteristicUuid) {
+    for (size_t i = 0; i < characteristics.size(); i++) {
+        if (characteristics[i]->uuid == characteristicUuid) return characteristics[i];
+    }
+    return NULL;
+}
+
+BLEServer::~BLEServer() {
+    for (size_t i = 0; i < services.size(); i++) delete services[i];
+}
+
+BLEService *BLEServer::createService(const char *uuid) {
+    services.push_back(new BLEService(uuid));
+    return services.back();
+}
+
+void BLEServer::updateConnParams(esp_bd_addr_t remoteBda, uint16_t minInt, uint16_t maxInt, uint16_t slaveLatency,
+                                 uint16_t supervisionTimeout) {
+    (void)remoteBda;
+    minInterval = minInt;
+    maxInterval = maxInt;
+    latency = slaveLatency;
+    timeout = supervisionTimeout;
+}
+
+void BLEServer::fakeConnect(uint16_t mtu) {
+    if (!callbacks) return;
+    esp_ble_gatts_cb_param_t param = {};
+    callbacks->onConnect(this);
+    callbacks->onConnect(this, &param);
+    if (mtu != 23) {
+        param.mtu.mtu = mtu < localMtu ? mtu : localMtu;
+        callbacks->onMtuChanged(this, &param);
+    }
+}
+
+BLEService *BLEServer::getServiceByUUID(const char *uuid) {
+    for (size_t i = 0; i < services.size(); i++) {
+        if (services[i]->uuid == uuid) return services[i];
+    }
+    return NULL;
+}
+
+void BLEDevice::init(const std::string &deviceName) {
+    (void)deviceName;
+}
+
+BLEServer *BLEDevice::createServer() {
+    lastServer = new BLEServer();
+    return lastServer;
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() {
+    return &advertising;
+}
+
+void BLEDevice::setMTU(uint16_t mtu) {
+    localMtu = mtu;
+}
+
+uint16_t BLEDevice::getMTU() {
+    return localMtu;
+}
+
+BLEServer *BLEDevice::server() {
+    return lastServer;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file BLEDevice.h
+ * @brief Fake ESP32 BLE server API for the Linux shim.
+ *
+ * A host program plays the central: `BLEServer::fakeConnect()`/`fakeDisconnect()` drive the
+ * server callbacks (with an MTU exchange), `BLECharacteristic::fakeWrite()` delivers a write to the
+ * characteristic, and `BLECharacteristic::fakeOnNotify()` receives what the server notifies.
+ */
+
+#ifndef NATIVE_BLE_DEVICE_H
+#define NATIVE_BLE_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class BLEServer;
+class BLECharacteristic;
+
+/** @brief Bluetooth device address (esp_bt_defs.h on the device). */
+typedef uint8_t esp_bd_addr_t[6];
+
+/** @brief The GATT server event parameters the sketches read (esp_gatts_api.h on the device). */
+typedef union {
+    struct {
+        uint16_t conn_id;
+        uint8_t link_role;
+        esp_bd_addr_t remote_bda;
+    } connect;
+    struct {
+        uint16_t conn_id;
+        uint16_t mtu;
+    } mtu;
+} esp_ble_gatts_cb_param_t;
+
+class BLEServerCallbacks {
+    public:
+        virtual ~BLEServerCallbacks() {}
+        virtual void onConnect(BLEServer *pServer) { (void)pServer; }
+        virtual void onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) { (void)pServer; (void)param; }
+        virtual void onDisconnect(BLEServer *pServer) { (void)pServer; }
+        virtual void onMtuChanged(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) { (void)pServer; (void)param; }
+};
+
+class BLECharacteristicCallbacks {
+    public:
+        virtual ~BLECharacteristicCallbacks() {}
+        virtual void onRead(BLECharacteristic *pCharacteristic) { (void)pCharacteristic; }
+        virtual void onWrite(BLECharacteristic *pCharacteristic) { (void)pCharacteristic; }
+};
+
+class BLEDescriptor {
+    public:
+        virtual ~BLEDescriptor() {}
+};
+
+/** @brief Client Characteristic Configuration descriptor; the central enables notifications in it. */
+class BLE2902 : public BLEDescriptor {
+    public:
+        BLE2902() : notifications(false) {}
+        bool getNotifications() const { return notifications; }
+        void setNotifications(bool enable) { notifications = enable; }
+
+    private:
+        bool notifications;
+};
+
+class BLECharacteristic {
+    public:
+        static const uint32_t PROPERTY_READ = 1 << 0;
+        static const uint32_t PROPERTY_WRITE = 1 << 1;
+        static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+        static const uint32_t PROPERTY_INDICATE = 1 << 3;
+        static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+        BLECharacteristic(const char *uuid, uint32_t properties) : uuid(uuid), properties(properties), callbacks(NULL) {}
+        ~BLECharacteristic();
+
+        void setCallbacks(BLECharacteristicCallbacks *pCallbacks) { callbacks = pCallbacks; }
+        void setValue(const std::string &newValue) { value = newValue; }
+        void setValue(const char *newValue) { value = newValue; }
+        void setValue(const uint8_t *data, size_t length) { value.assign((const char *)data, length); }
+        std::string getValue() const { return value; }
+        void addDescriptor(BLEDescriptor *descriptor) { descriptors.push_back(descriptor); }
+
+        /** @brief Sends the value to the central, if it enabled notifications in a BLE2902 descriptor. */
+        void notify();
+
+        /** @brief Central side: writes `data` and runs the `onWrite` callback. */
+        void fakeWrite(const std::string &data);
+
+        /** @brief Central side: enables or disables notifications in the BLE2902 descriptor. */
+        void fakeSubscribe(bool enable);
+
+        /** @brief Central side: receives every notification. */
+        void fakeOnNotify(std::function<void(const std::string &)> handler) { notified = handler; }
+
+        const std::string uuid;
+        const uint32_t properties;
+
+    private:
+        std::string value;
+        BLECharacteristicCallbacks *callbacks;
+        std::vector<BLEDescriptor *> descriptors;
+        std::function<void(const std::string &)> notified;
+};
+
+class BLEService {
+    public:
+        explicit BLEService(const char *uuid) : uuid(uuid) {}
+        ~BLEService();
+        BLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties);
+        BLECharacteristic *getCharacteristic(const char *uuid);
+        void start() {}
+
+        const std::string uuid;
+
+    private:
+        std::vector<BLECharacteristic *> characteristics;
+};
+
+class BLEServer {
+    public:
+        BLEServer() : callbacks(NULL), minInterval(0), maxInterval(0), latency(0), timeout(0) {}
+        ~BLEServer();
+        void setCallbacks(BLEServerCallbacks *pCallbacks) { callbacks = pCallbacks; }
+        BLEService *createService(const char *uuid);
+        BLEService *getServiceByUUID(const char *uuid);
+
+        /** @brief Asks the central for connection parameters; intervals in 1.25 ms, timeout in 10 ms. */
+        void updateConnParams(esp_bd_addr_t remoteBda, uint16_t minInt, uint16_t maxInt, uint16_t latency,
+                              uint16_t timeout);
+
+        /**
+         * @brief Central side: connects, runs the `onConnect` callbacks, then exchanges the MTU.
+         *
+         * @param mtu The central's MTU; the result is the smaller of it and `BLEDevice::setMTU()`'s.
+         */
+        void fakeConnect(uint16_t mtu = 23);
+
+        /** @brief Connection parameters last requested with `updateConnParams()`. */
+        void fakeConnParams(uint16_t &minInt, uint16_t &maxInt, uint16_t &slaveLatency, uint16_t &supervisionTimeout) const {
+            minInt = minInterval; maxInt = maxInterval; slaveLatency = latency; supervisionTimeout = timeout;
+        }
+
+        /** @brief Central side: disconnects and runs the `onDisconnect` callback. */
+        void fakeDisconnect() { if (callbacks) callbacks->onDisconnect(this); }
+
+    private:
+        BLEServerCallbacks *callbacks;
+        std::vector<BLEService *> services;
+        uint16_t minInterval;
+        uint16_t maxInterval;
+        uint16_t latency;
+        uint16_t timeout;
+};
+
+class BLEAdvertising {
+    public:
+        void addServiceUUID(const char *uuid) { (void)uuid; }
+        void setScanResponse(bool enable) { (void)enable; }
+        void setMinPreferred(uint16_t interval) { (void)interval; }
+        void setMaxPreferred(uint16_t interval) { (void)interval; }
+};
+
+class BLEDevice {
+    public:
+        static void init(const std::string &deviceName);
+        static BLEServer *createServer();
+        static BLEAdvertising *getAdvertising();
+        static void startAdvertising() {}
+        static void setMTU(uint16_t mtu);
+        static uint16_t getMTU();
+
+        /** @brief Returns the most recently created server, for the fake central. */
+        static BLEServer *server();
+};
+
+#endif // !NATIVE_BLE_DEVICE_H
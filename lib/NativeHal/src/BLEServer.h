@@ -0,0 +1,11 @@
+/**
+ * @file BLEServer.h
+ * @brief Fake ESP32 BLE server API for the Linux shim (declared in BLEDevice.h).
+ */
+
+#ifndef NATIVE_BLE_SERVER_H
+#define NATIVE_BLE_SERVER_H
+
+#include "BLEDevice.h"
+
+#endif // !NATIVE_BLE_SERVER_H
@@ -0,0 +1,14 @@
+/**
+ * @file DHT.h
+ * @brief DHT sensor type constants for the Linux shim.
+ */
+
+#ifndef NATIVE_DHT_H
+#define NATIVE_DHT_H
+
+#define DHT11 11
+#define DHT12 12
+#define DHT21 21
+#define DHT22 22
+
+#endif // !NATIVE_DHT_H
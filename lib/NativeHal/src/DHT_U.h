@@ -0,0 +1,46 @@
+/**
+ * @file DHT_U.h
+ * @brief Fake `DHT_Unified` for the Linux shim, reporting the values set with `hal::setDhtReading()`.
+ */
+
+#ifndef NATIVE_DHT_U_H
+#define NATIVE_DHT_U_H
+
+#include <stdint.h>
+
+#include "Adafruit_Sensor.h"
+#include "DHT.h"
+#include "NativeHal.h"
+
+class DHT_Unified {
+    public:
+        DHT_Unified(uint8_t pin, uint8_t type) { (void)pin; (void)type; }
+        void begin() {}
+
+        class Temperature {
+            public:
+                bool getEvent(sensors_event_t *event) {
+                    float temperature, humidity;
+                    hal::dhtTransfer();
+                    hal::dhtReading(temperature, humidity);
+                    event->temperature = temperature;
+                    return true;
+                }
+        };
+
+        class Humidity {
+            public:
+                bool getEvent(sensors_event_t *event) {
+                    float temperature, humidity;
+                    hal::dhtTransfer();
+                    hal::dhtReading(temperature, humidity);
+                    event->relative_humidity = humidity;
+                    return true;
+                }
+        };
+
+        Temperature temperature() { return Temperature(); }
+        Humidity humidity() { return Humidity(); }
+};
+
+#endif // !NATIVE_DHT_U_H
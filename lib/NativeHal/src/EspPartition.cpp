@@ -0,0 +1,191 @@
+/**
+ * @file EspPartition.cpp
+ * @brief File-backed flash partitions of the Linux shim.
+ */
+
+#include "esp_partition.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Partition {
+    esp_partition_t info;
+    FILE *file;
+};
+
+std::mutex flashLock;
+std::vector<Partition *> partitions;
+bool loaded = false;
+
+std::string trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    size_t end = text.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+/** @brief Parses a partition table number: decimal, 0x hex, or with a K/M suffix. */
+uint32_t parseSize(const std::string &text) {
+    char *end = NULL;
+    unsigned long value = strtoul(text.c_str(), &end, 0);
+    if (end && (*end == 'K' || *end == 'k')) value *= 1024;
+    if (end && (*end == 'M' || *end == 'm')) value *= 1024 * 1024;
+    return (uint32_t)value;
+}
+
+int parseSubtype(const std::string &text) {
+    static const char *const names[] = {"ota", "phy", "nvs", "coredump", "nvs_keys", "efuse", "undefined", "esphttpd", "fat", "spiffs"};
+    static const int values[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x80, 0x81, 0x82};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        if (text == names[i]) return values[i];
+    }
+    return (int)parseSize(text);
+}
+
+/** @brief `HAL_FLASH_DIR`, or a fresh temporary directory made once per process. */
+std::string backingDir() {
+    static std::string dir;
+    if (dir.empty()) {
+        const char *named = getenv("HAL_FLASH_DIR");
+        if (named) {
+            dir = named;
+        } else {
+            const char *tmp = getenv("TMPDIR");
+            std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/halflash.XXXXXX";
+            std::vector<char> path(pattern.begin(), pattern.end());
+            path.push_back('\0');
+            dir = mkdtemp(path.data()) ? path.data() : ".";
+        }
+    }
+    return dir;
+}
+
+FILE *openBacking(const char *label, uint32_t size) {
+    std::string path = backingDir() + "/" + label + ".flash";
+    FILE *file = fopen(path.c_str(), "r+b");
+    if (!file) {
+        file = fopen(path.c_str(), "w+b");
+        if (!file) return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long have = ftell(file);
+    if (have < (long)size) {
+        std::vector<uint8_t> erased(size - have, 0xFF);
+        fwrite(erased.data(), 1, erased.size(), file);
+        fflush(file);
+    }
+    return file;
+}
+
+/** @brief Loads the data partitions of the partition table, once. */
+void load() {
+    if (loaded) return;
+    loaded = true;
+
+    const char *table = getenv("HAL_PARTITIONS");
+    FILE *csv = fopen(table ? table : "partitions.csv", "r");
+    if (!csv) return;
+
+    char line[256];
+    while (fgets(line, sizeof(line), csv)) {
+        std::string text = trim(line);
+        if (text.empty() || text[0] == '#') continue;
+
+        std::vector<std::string> fields;
+        size_t start = 0;
+        for (;;) {
+            size_t comma = text.find(',', start);
+            fields.push_back(trim(text.substr(start, comma == std::string::npos ? std::string::npos : comma - start)));
+            if (comma == std::string::npos) break;
+            start = comma + 1;
+        }
+        if (fields.size() < 5 || fields[1] != "data" || fields[0].size() > 16) continue;
+
+        Partition *partition = new Partition();
+        memset(&partition->info, 0, sizeof(partition->info));
+        partition->info.type = ESP_PARTITION_TYPE_DATA;
+        partition->info.subtype = (esp_partition_subtype_t)parseSubtype(fields[2]);
+        partition->info.address = parseSize(fields[3]);
+        partition->info.size = parseSize(fields[4]);
+        strncpy(partition->info.label, fields[0].c_str(), sizeof(partition->info.label) - 1);
+        partition->file = NULL;
+        partitions.push_back(partition);
+    }
+    fclose(csv);
+}
+
+Partition *lookup(const esp_partition_t *info) {
+    for (size_t i = 0; i < partitions.size(); i++) {
+        if (&partitions[i]->info == info) {
+            Partition *partition = partitions[i];
+            if (!partition->file) partition->file = openBacking(info->label, info->size);
+            return partition->file ? partition : NULL;
+        }
+    }
+    return NULL;
+}
+
+bool inRange(const esp_partition_t *info, size_t offset, size_t size) {
+    return offset <= info->size && size <= info->size - offset;
+}
+
+} // namespace
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) {
+    std::lock_guard<std::mutex> guard(flashLock);
+    load();
+    for (size_t i = 0; i < partitions.size(); i++) {
+        const esp_partition_t &info = partitions[i]->info;
+        if (info.type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || info.subtype == subtype) &&
+            (label == NULL || strcmp(label, info.label) == 0)) {
+            return &info;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *info, size_t offset, void *dst, size_t size) {
+    std::lock_guard<std::mutex> guard(flashLock);
+    Partition *partition = lookup(info);
+    if (!partition || !inRange(info, offset, size)) return ESP_ERR_INVALID_ARG;
+    fseek(partition->file, (long)offset, SEEK_SET);
+    return fread(dst, 1, size, partition->file) == size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *info, size_t offset, const void *src, size_t size) {
+    std::lock_guard<std::mutex> guard(flashLock);
+    Partition *partition = lookup(info);
+    if (!partition || !inRange(info, offset, size)) return ESP_ERR_INVALID_ARG;
+
+    // NOR flash: programming can only clear bits.
+    std::vector<uint8_t> cells(size);
+    fseek(partition->file, (long)offset, SEEK_SET);
+    if (fread(cells.data(), 1, size, partition->file) != size) return ESP_FAIL;
+    for (size_t i = 0; i < size; i++) {
+        cells[i] &= ((const uint8_t *)src)[i];
+    }
+    fseek(partition->file, (long)offset, SEEK_SET);
+    bool ok = fwrite(cells.data(), 1, size, partition->file) == size;
+    fflush(partition->file);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *info, size_t offset, size_t size) {
+    std::lock_guard<std::mutex> guard(flashLock);
+    Partition *partition = lookup(info);
+    if (!partition || !inRange(info, offset, size)) return ESP_ERR_INVALID_ARG;
+    if (offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0) return ESP_ERR_INVALID_SIZE;
+
+    std::vector<uint8_t> erased(size, 0xFF);
+    fseek(partition->file, (long)offset, SEEK_SET);
+    bool ok = fwrite(erased.data(), 1, size, partition->file) == size;
+    fflush(partition->file);
+    return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file FakeAdc.cpp
+ * @brief Continuous ADC and ADC calibration of the Linux shim.
+ */
+
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
+#include "Arduino.h"
+#include "NativeHal.h"
+
+#include <mutex>
+
+namespace {
+
+const uint8_t kChannelPins[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
+const uint32_t kMaxPattern = 8;
+
+std::mutex adcLock;
+bool initialized = false;
+bool started = false;
+uint32_t poolSize = 0;      // In conversions.
+uint32_t sampleHz = 0;
+uint8_t pattern[kMaxPattern];
+uint32_t patternLength = 0;
+uint32_t startedAt = 0;     // micros() at adc_digi_start().
+uint64_t consumed = 0;      // Conversions read or lost since adc_digi_start().
+
+uint64_t produced() {
+    return (uint64_t)(uint32_t)(hal::micros() - startedAt) * sampleHz / 1000000u;
+}
+
+} // namespace
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config) {
+    std::lock_guard<std::mutex> guard(adcLock);
+    if (init_config == NULL || init_config->max_store_buf_size < SOC_ADC_DIGI_RESULT_BYTES || init_config->adc2_chan_mask) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    poolSize = init_config->max_store_buf_size / SOC_ADC_DIGI_RESULT_BYTES;
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config) {
+    std::lock_guard<std::mutex> guard(adcLock);
+    if (!initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config == NULL || config->pattern_num == 0 || config->pattern_num > kMaxPattern ||
+        config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint32_t i = 0; i < config->pattern_num; i++) {
+        if (config->adc_pattern[i].unit != 0 || config->adc_pattern[i].channel >= ADC1_CHANNEL_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        pattern[i] = config->adc_pattern[i].channel;
+    }
+    patternLength = config->pattern_num;
+    sampleHz = config->sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start(void) {
+    std::lock_guard<std::mutex> guard(adcLock);
+    if (!initialized || patternLength == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    started = true;
+    startedAt = hal::micros();
+    consumed = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop(void) {
+    std::lock_guard<std::mutex> guard(adcLock);
+    started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t timeout_ms) {
+    uint32_t deadline = hal::millis() + timeout_ms;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(adcLock);
+            if (!initialized) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            uint64_t total = started ? produced() : consumed;
+            bool overflow = total - consumed > poolSize;
+            if (overflow) {
+                consumed = total - poolSize;    // The driver drops what does not fit its pool.
+            }
+            uint64_t available = total - consumed;
+            if (available > 0) {
+                uint32_t count = length_max / SOC_ADC_DIGI_RESULT_BYTES;
+                if (count > available) {
+                    count = (uint32_t)available;
+                }
+                for (uint32_t i = 0; i < count; i++) {
+                    uint8_t channel = pattern[(consumed + i) % patternLength];
+                    adc_digi_output_data_t result;
+                    result.type1.channel = channel;
+                    result.type1.data = analogRead(kChannelPins[channel]) & 0xFFF;
+                    buf[i * 2] = (uint8_t)(result.val & 0xFF);
+                    buf[i * 2 + 1] = (uint8_t)(result.val >> 8);
+                }
+                consumed += count;
+                *out_length = count * SOC_ADC_DIGI_RESULT_BYTES;
+                return overflow ? ESP_ERR_INVALID_STATE : ESP_OK;
+            }
+        }
+        if ((int32_t)(hal::millis() - deadline) >= 0) {
+            *out_length = 0;
+            return ESP_ERR_TIMEOUT;
+        }
+        hal::sleepMs(1);
+    }
+}
+
+esp_err_t adc_digi_deinitialize(void) {
+    std::lock_guard<std::mutex> guard(adcLock);
+    initialized = false;
+    started = false;
+    return ESP_OK;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+                                             uint32_t default_vref, esp_adc_cal_characteristics_t *chars) {
+    chars->adc_num = adc_num;
+    chars->atten = atten;
+    chars->bit_width = bit_width;
+    chars->coeff_a = 3300;
+    chars->coeff_b = 0;
+    chars->vref = default_vref;
+    return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars) {
+    return adc_reading * chars->coeff_a / 4095 + chars->coeff_b;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file FakePms5003.cpp
+ * @brief PMS5003 model of the Linux shim, attached to `Serial2`.
+ *
+ * The model answers the sensor's command frames written to `Serial2` (sleep/wake, active/passive,
+ * passive read) and, while awake in active mode, injects a 32-byte data frame every second built
+ * from the values set with `hal::setPmsReading()`.
+ */
+
+#include "NativeHal.h"
+#include "HardwareSerial.h"
+#include "VirtualTime.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+const uint32_t kFramePeriodMs = 1000;
+
+std::atomic<bool> awake(true);
+std::atomic<bool> active(true);
+std::atomic<uint32_t> corruptFrames(0);
+
+std::mutex commandLock;
+uint8_t command[7];
+size_t commandSize = 0;
+
+void putWord(uint8_t *frame, size_t index, uint16_t value) {
+    frame[4 + 2 * index] = (uint8_t)(value >> 8);
+    frame[5 + 2 * index] = (uint8_t)(value & 0xFF);
+}
+
+void sendFrame() {
+    uint16_t pm1_0, pm2_5, pm10;
+    hal::pmsReading(pm1_0, pm2_5, pm10);
+
+    uint8_t frame[32] = {0x42, 0x4D, 0x00, 28};
+    const uint16_t words[13] = {
+        pm1_0, pm2_5, pm10,     // CF=1 equals atmospheric below ~30 µg/m³
+        pm1_0, pm2_5, pm10,
+        (uint16_t)(pm2_5 * 60), (uint16_t)(pm2_5 * 18), (uint16_t)(pm1_0 * 3),
+        (uint16_t)(pm2_5 / 2), (uint16_t)(pm10 / 8), (uint16_t)(pm10 / 16),
+        0x9700,
+    };
+    for (size_t i = 0; i < 13; i++) {
+        putWord(frame, i, words[i]);
+    }
+    uint16_t sum = 0;
+    for (size_t i = 0; i < 30; i++) {
+        sum += frame[i];
+    }
+    frame[30] = (uint8_t)(sum >> 8);
+    frame[31] = (uint8_t)(sum & 0xFF);
+
+    uint32_t corrupt = corruptFrames.load();
+    while (corrupt > 0 && !corruptFrames.compare_exchange_weak(corrupt, corrupt - 1)) {
+    }
+    if (corrupt > 0) {
+        frame[10] ^= 0x01;
+    }
+    Serial2.inject(frame, sizeof(frame));
+}
+
+void runCommand(const uint8_t *frame) {
+    uint16_t sum = 0;
+    for (size_t i = 0; i < 5; i++) {
+        sum += frame[i];
+    }
+    if (frame[5] != (uint8_t)(sum >> 8) || frame[6] != (uint8_t)(sum & 0xFF)) {
+        return;
+    }
+    switch (frame[2]) {
+        case 0xE1: active = frame[4] != 0; break;
+        case 0xE4: awake = frame[4] != 0; break;
+        case 0xE2: if (awake && !active) sendFrame(); break;
+        default: break;
+    }
+}
+
+/** @brief Receives the bytes the firmware writes to `Serial2` and runs complete command frames. */
+void onTransmit(const uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> guard(commandLock);
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        if ((commandSize == 0 && byte != 0x42) || (commandSize == 1 && byte != 0x4D)) {
+            commandSize = byte == 0x42 ? 1 : 0;
+            command[0] = byte;
+            continue;
+        }
+        command[commandSize++] = byte;
+        if (commandSize == sizeof(command)) {
+            runCommand(command);
+            commandSize = 0;
+        }
+    }
+}
+
+} // namespace
+
+namespace hal {
+
+void corruptPmsFrames(uint32_t count) {
+    corruptFrames = count;
+}
+
+bool pmsAwake() {
+    return awake;
+}
+
+void startPms5003() {
+    Serial2.setTxSink(onTransmit);
+    addEvent(kFramePeriodMs, kFramePeriodMs, [] {
+        if (awake && active && Serial2.baudRate() != 0) {
+            sendFrame();
+        }
+    });
+}
+
+} // namespace hal
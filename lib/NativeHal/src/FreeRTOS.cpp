@@ -0,0 +1,220 @@
+/**
+ * @file FreeRTOS.cpp
+ * @brief FreeRTOS tasks and semaphores of the Linux shim.
+ *
+ * In virtual time (see VirtualTime.h) every wait goes through the virtual scheduler, which also
+ * decides when a created task's thread runs.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "NativeHal.h"
+#include "VirtualTime.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct NativeTask {
+    std::string name;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t stackDepth;
+    std::mutex notifyLock;
+    std::condition_variable notified;
+    uint32_t notifyCount;
+};
+
+struct NativeSemaphore {
+    const char *kind;       ///< "mutex", "binary semaphore" or "counting semaphore", for reports
+    std::mutex lock;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+namespace {
+
+const char kMutex[] = "mutex";
+
+NativeTask mainTask = {"loopTask", 1, 1, 8192, {}, {}, 0};
+thread_local NativeTask *currentTask = &mainTask;
+
+/** @brief Timeout of a wait of `ticks`, in microseconds. */
+uint64_t waitUs(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? hal::kWaitForever : (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+SemaphoreHandle_t createSemaphore(const char *kind, UBaseType_t maxCount, UBaseType_t initialCount) {
+    NativeSemaphore *semaphore = new NativeSemaphore;
+    semaphore->kind = kind;
+    semaphore->count = initialCount;
+    semaphore->maxCount = maxCount;
+    return semaphore;
+}
+
+} // namespace
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId) {
+    NativeTask *task = new NativeTask{name ? name : "", priority, coreId == tskNO_AFFINITY ? 0 : coreId, stackDepth, {}, {}, 0};
+    if (createdTask) {
+        *createdTask = task;
+    }
+    if (!hal::virtualTime()) {
+        std::thread([task, code, parameters] {
+            currentTask = task;
+            code(parameters);
+        }).detach();
+        return pdPASS;
+    }
+    void *scheduled = hal::createTask(task->name.c_str(), priority);
+    std::thread([task, code, parameters, scheduled] {
+        hal::enterTask(scheduled);
+        currentTask = task;
+        code(parameters);
+        hal::exitTask();
+    }).detach();
+    hal::startTask(scheduled);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *createdTask) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        hal::yieldTask();
+    } else {
+        hal::sleepMs(ticks * portTICK_PERIOD_MS);
+    }
+}
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment) {
+    TickType_t wake = *previousWakeTime + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(wake - now) > 0) {
+        vTaskDelay(wake - now);
+    }
+    *previousWakeTime = wake;
+}
+
+TickType_t xTaskGetTickCount() {
+    return hal::millis() / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return currentTask;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : currentTask)->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task ? task : currentTask)->stackDepth;
+}
+
+BaseType_t xPortGetCoreID() {
+    return currentTask->core;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    NativeTask *task = currentTask;
+    auto pending = [task] { return task->notifyCount > 0; };
+    std::unique_lock<std::mutex> guard(task->notifyLock);
+    if (hal::virtualTime()) {
+        guard.unlock();
+        hal::blockTask("notify", task, waitUs(ticksToWait), [task, &pending] {
+            std::lock_guard<std::mutex> check(task->notifyLock);
+            return pending();
+        });
+        guard.lock();
+    } else if (ticksToWait == portMAX_DELAY) {
+        task->notified.wait(guard, pending);
+    } else {
+        task->notified.wait_for(guard, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), pending);
+    }
+    uint32_t count = task->notifyCount;
+    if (count > 0) {
+        task->notifyCount = clearCountOnExit ? 0 : count - 1;
+    }
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->notifyLock);
+        task->notifyCount++;
+    }
+    task->notified.notify_one();
+    hal::wakeTasks(task);
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return createSemaphore("counting semaphore", maxCount, initialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return createSemaphore(kMutex, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return createSemaphore("binary semaphore", 1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    auto available = [semaphore] { return semaphore->count > 0; };
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    if (hal::virtualTime()) {
+        guard.unlock();
+        hal::blockTask(semaphore->kind, semaphore, waitUs(ticksToWait), [semaphore, &available] {
+            std::lock_guard<std::mutex> check(semaphore->lock);
+            return available();
+        });
+        guard.lock();
+        if (!available()) {
+            return pdFALSE;
+        }
+    } else if (ticksToWait == portMAX_DELAY) {
+        semaphore->changed.wait(guard, available);
+    } else if (!semaphore->changed.wait_for(guard, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), available)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    if (semaphore->kind == kMutex) {
+        hal::holdObject(semaphore, true);
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count >= semaphore->maxCount) {
+            return pdFALSE;
+        }
+        semaphore->count++;
+    }
+    if (semaphore->kind == kMutex) {
+        hal::holdObject(semaphore, false);
+    }
+    semaphore->changed.notify_one();
+    hal::wakeTasks(semaphore);
+    return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> guard(semaphore->lock);
+    return semaphore->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file HardwareSerial.cpp
+ * @brief Fake UARTs of the Linux shim.
+ */
+
+#include "HardwareSerial.h"
+
+#include <stdio.h>
+
+#include <chrono>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        buffer[n++] = (uint8_t)c;
+    }
+    return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String result;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        result += (char)c;
+        c = timedRead();
+    }
+    return result;
+}
+
+HardwareSerial::HardwareSerial(int uartNum) : uart(uartNum), baud(0) {
+    if (uart == 0) {
+        sink = [](const uint8_t *data, size_t length) {
+            fwrite(data, 1, length, stdout);
+            fflush(stdout);
+        };
+    }
+}
+
+void HardwareSerial::begin(unsigned long baudRate, uint32_t config, int8_t rxPin, int8_t txPin) {
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+    baud = baudRate;
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(lock);
+    return (int)rx.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (rx.empty()) return -1;
+    uint8_t c = rx.front();
+    rx.pop_front();
+    return c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> guard(lock);
+    return rx.empty() ? -1 : rx.front();
+}
+
+int HardwareSerial::timedRead() {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!rxReady.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this] { return !rx.empty(); })) {
+        return -1;
+    }
+    uint8_t c = rx.front();
+    rx.pop_front();
+    return c;
+}
+
+size_t HardwareSerial::write(uint8_t byte) {
+    return write(&byte, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    Sink out;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        out = sink;
+    }
+    if (out) out(buffer, size);
+    return size;
+}
+
+void HardwareSerial::inject(const uint8_t *data, size_t length) {
+    OnReceiveCb callback;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        rx.insert(rx.end(), data, data + length);
+        callback = receiveCallback;
+    }
+    rxReady.notify_all();
+    if (callback) callback();
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) {
+    (void)onlyOnTimeout;
+    std::lock_guard<std::mutex> guard(lock);
+    receiveCallback = function;
+}
+
+void HardwareSerial::setTxSink(Sink newSink) {
+    std::lock_guard<std::mutex> guard(lock);
+    sink = newSink;
+}
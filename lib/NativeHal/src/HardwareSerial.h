@@ -0,0 +1,131 @@
+/**
+ * @file HardwareSerial.h
+ * @brief Arduino `Print`/`Stream`/`HardwareSerial` for the Linux shim.
+ *
+ * Each port has an RX queue that a host program fills with `inject()` (which also raises the
+ * `onReceive()` event) and a TX sink that receives everything the firmware writes. `Serial` prints to stdout by default; `Serial1`
+ * and `Serial2` discard their output until a sink is installed.
+ */
+
+#ifndef NATIVE_HARDWARE_SERIAL_H
+#define NATIVE_HARDWARE_SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "WString.h"
+
+#define SERIAL_8N1 0x800001c
+#define SERIAL_8E1 0x800001e
+
+/**
+ * @class Print
+ * @brief Text and binary output helpers on top of `write()`.
+ */
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t byte) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t write(const char *text) { return text ? write((const uint8_t *)text, strlen(text)) : 0; }
+
+        size_t print(const char *text) { return write(text); }
+        size_t print(const String &text) { return write(text.c_str()); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(int value, int base = 10) { return print(String((long)value, (unsigned char)base)); }
+        size_t print(unsigned int value, int base = 10) { return print(String((unsigned long)value, (unsigned char)base)); }
+        size_t print(long value, int base = 10) { return print(String(value, (unsigned char)base)); }
+        size_t print(unsigned long value, int base = 10) { return print(String(value, (unsigned char)base)); }
+        size_t print(double value, int digits = 2) { return print(String(value, (unsigned int)digits)); }
+
+        size_t println() { return write((const uint8_t *)"\r\n", 2); }
+        template <typename T> size_t println(const T &value) { size_t n = print(value); return n + println(); }
+        template <typename T> size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+/**
+ * @class Stream
+ * @brief Input side of a serial port.
+ */
+class Stream : public Print {
+    public:
+        Stream() : timeoutMs(1000) {}
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+        virtual void flush() {}
+
+        void setTimeout(unsigned long ms) { timeoutMs = ms; }
+        size_t readBytes(uint8_t *buffer, size_t length);
+        String readStringUntil(char terminator);
+
+    protected:
+        /** @brief Reads one byte, waiting up to the stream timeout. Returns -1 on timeout. */
+        virtual int timedRead() = 0;
+
+        unsigned long timeoutMs;
+};
+
+/**
+ * @class HardwareSerial
+ * @brief Fake UART with an injectable RX queue and a TX sink.
+ */
+class HardwareSerial : public Stream {
+    public:
+        typedef std::function<void(const uint8_t *data, size_t length)> Sink;
+        typedef std::function<void(void)> OnReceiveCb;
+
+        explicit HardwareSerial(int uartNum);
+
+        void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+        void end() {}
+        operator bool() const { return true; }
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        void flush() override {}
+        size_t write(uint8_t byte) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+
+        /** @brief Appends bytes to the RX queue as if the peer had sent them. */
+        void inject(const uint8_t *data, size_t length);
+
+        /** @brief Installs the function receiving everything written to the port (NULL discards). */
+        void setTxSink(Sink sink);
+
+        unsigned long baudRate() const { return baud; }
+
+        /** @brief Installs the RX event callback, run on the injecting thread after every `inject()`. */
+        void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+        bool setRxFIFOFull(uint8_t fifoBytes) { (void)fifoBytes; return true; }
+        size_t setTxBufferSize(size_t size) { return size; }
+        int availableForWrite() { return 1024; }   ///< Writes never block: the TX sink takes everything.
+        size_t setRxBufferSize(size_t size) { return size; }
+        bool setRxTimeout(uint8_t symbolsTimeout) { (void)symbolsTimeout; return true; }
+
+    protected:
+        int timedRead() override;
+
+    private:
+        int uart;
+        unsigned long baud;
+        std::mutex lock;
+        std::condition_variable rxReady;
+        std::deque<uint8_t> rx;
+        Sink sink;
+        OnReceiveCb receiveCallback;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif // !NATIVE_HARDWARE_SERIAL_H
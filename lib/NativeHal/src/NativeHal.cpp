@@ -0,0 +1,246 @@
+/**
+ * @file NativeHal.cpp
+ * @brief Time, GPIO, ADC, LEDC and fake sensor state of the Linux shim.
+ */
+
+#include "NativeHal.h"
+#include "VirtualTime.h"
+#include "Arduino.h"
+#include "esp_cpu.h"
+#include "driver/ledc.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const std::chrono::steady_clock::time_point kStart = std::chrono::steady_clock::now();
+
+std::atomic<int> digitalIn[HAL_PIN_COUNT];
+std::atomic<int> digitalOut[HAL_PIN_COUNT];
+std::atomic<uint16_t> analogIn[HAL_PIN_COUNT];
+std::atomic<uint32_t> analogOut[HAL_PIN_COUNT];
+
+/** @brief A LEDC channel: a fade is running while `now` is before `start + length`. */
+struct LedcChannel {
+    uint32_t from;      ///< Duty when the fade started
+    uint32_t to;        ///< Duty written, or the fade's target
+    uint32_t start;     ///< millis() at the fade start
+    uint32_t length;    ///< Fade time, 0 for a plain write
+};
+
+std::mutex ledcLock;
+LedcChannel ledc[HAL_LEDC_CHANNELS];
+bool fadeInstalled = false;
+std::atomic<uint32_t> cpuMhz(HAL_CPU_MHZ);
+
+std::mutex sensorLock;
+float dhtTemperature = 22.5f;
+float dhtHumidity = 45.0f;
+bool dhtTransferred = false;
+uint32_t dhtTransferAt = 0;     ///< millis() of the last DHT11 transfer
+uint16_t pm1_0 = 5, pm2_5 = 8, pm10 = 10;
+
+bool validPin(uint8_t pin) { return pin < HAL_PIN_COUNT; }
+
+/** @brief Duty of a channel at `now`; ledcLock must be held. */
+uint32_t dutyAt(const LedcChannel &channel, uint32_t now) {
+    uint32_t elapsed = now - channel.start;
+    if (elapsed >= channel.length) {
+        return channel.to;
+    }
+    int64_t span = (int64_t)channel.to - channel.from;
+    return (uint32_t)(channel.from + span * elapsed / channel.length);
+}
+
+/** @brief Arduino channel number of an IDF speed mode and channel, or -1. */
+int ledcIndex(ledc_mode_t mode, ledc_channel_t channel) {
+    if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) {
+        return -1;
+    }
+    return mode * LEDC_CHANNEL_MAX + channel;
+}
+
+} // namespace
+
+namespace hal {
+
+uint32_t millis() {
+    if (virtualTime()) {
+        return (uint32_t)(deviceTimeUs() / 1000);
+    }
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - kStart).count();
+}
+
+uint32_t micros() {
+    if (virtualTime()) {
+        return (uint32_t)deviceTimeUs();
+    }
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - kStart).count();
+}
+
+void sleepMs(uint32_t ms) {
+    if (virtualTime()) {
+        blockTask("delay", nullptr, ms * 1000ull, nullptr);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void setDigitalInput(uint8_t pin, int level) { if (validPin(pin)) digitalIn[pin] = level; }
+int digitalOutput(uint8_t pin) { return validPin(pin) ? digitalOut[pin].load() : 0; }
+void setAnalogInput(uint8_t pin, uint16_t value) { if (validPin(pin)) analogIn[pin] = value; }
+uint32_t ledcDuty(uint8_t channel) {
+    if (channel >= HAL_LEDC_CHANNELS) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(ledcLock);
+    return dutyAt(ledc[channel], millis());
+}
+uint32_t analogOutput(uint8_t pin) { return validPin(pin) ? analogOut[pin].load() : 0; }
+
+void setDhtReading(float temperature, float humidity) {
+    std::lock_guard<std::mutex> lock(sensorLock);
+    dhtTemperature = temperature;
+    dhtHumidity = humidity;
+}
+
+void dhtReading(float &temperature, float &humidity) {
+    std::lock_guard<std::mutex> lock(sensorLock);
+    temperature = dhtTemperature;
+    humidity = dhtHumidity;
+}
+
+void dhtTransfer() {
+    const uint32_t kCacheMs = 2000;
+    const uint32_t kStartSignalMs = 20;
+    const uint32_t kBitsUs = 4000;
+    uint32_t now = millis();
+    {
+        std::lock_guard<std::mutex> lock(sensorLock);
+        if (dhtTransferred && now - dhtTransferAt < kCacheMs) {
+            return;
+        }
+        dhtTransferred = true;
+        dhtTransferAt = now;
+    }
+    sleepMs(kStartSignalMs);
+    busyUs(kBitsUs);
+}
+
+void setPmsReading(uint16_t pm1, uint16_t pm25, uint16_t pm100) {
+    std::lock_guard<std::mutex> lock(sensorLock);
+    pm1_0 = pm1;
+    pm2_5 = pm25;
+    pm10 = pm100;
+}
+
+void pmsReading(uint16_t &pm1, uint16_t &pm25, uint16_t &pm100) {
+    std::lock_guard<std::mutex> lock(sensorLock);
+    pm1 = pm1_0;
+    pm25 = pm2_5;
+    pm100 = pm10;
+}
+
+} // namespace hal
+
+unsigned long millis() { return hal::millis(); }
+unsigned long micros() { return hal::micros(); }
+void delay(uint32_t ms) { hal::sleepMs(ms); }
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t level) { if (validPin(pin)) digitalOut[pin] = level; }
+int digitalRead(uint8_t pin) { return validPin(pin) ? digitalIn[pin].load() : 0; }
+uint16_t analogRead(uint8_t pin) { return validPin(pin) ? analogIn[pin].load() : 0; }
+void analogWrite(uint8_t pin, int value) { if (validPin(pin)) analogOut[pin] = (uint32_t)value; }
+
+uint32_t getCpuFrequencyMhz() { return cpuMhz.load(); }
+
+bool setCpuFrequencyMhz(uint32_t cpu_freq_mhz) {
+    if (cpu_freq_mhz != 240 && cpu_freq_mhz != 160 && cpu_freq_mhz != 80) {
+        return false;
+    }
+    cpuMhz = cpu_freq_mhz;
+    return true;
+}
+
+uint32_t esp_cpu_get_ccount(void) {
+    if (hal::virtualTime()) {
+        return (uint32_t)(hal::deviceTimeUs() * cpuMhz.load());
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kStart).count();
+    return (uint32_t)((uint64_t)elapsed * cpuMhz.load() / 1000);
+}
+
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolution) {
+    (void)channel;
+    (void)resolution;
+    return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) { (void)pin; (void)channel; }
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+    if (channel < HAL_LEDC_CHANNELS) {
+        std::lock_guard<std::mutex> lock(ledcLock);
+        ledc[channel] = {duty, duty, 0, 0};
+    }
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    std::lock_guard<std::mutex> lock(ledcLock);
+    if (fadeInstalled) {
+        return ESP_FAIL;
+    }
+    fadeInstalled = true;
+    return ESP_OK;
+}
+
+void ledc_fade_func_uninstall(void) {
+    std::lock_guard<std::mutex> lock(ledcLock);
+    fadeInstalled = false;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms) {
+    int index = ledcIndex(speed_mode, channel);
+    if (index < 0 || max_fade_time_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(ledcLock);
+    if (!fadeInstalled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The fade is only armed here; ledc_fade_start() sets its start time
+    LedcChannel &state = ledc[index];
+    uint32_t now = hal::millis();
+    state = {dutyAt(state, now), target_duty, now, (uint32_t)max_fade_time_ms};
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode) {
+    int index = ledcIndex(speed_mode, channel);
+    if (index < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t length;
+    {
+        std::lock_guard<std::mutex> lock(ledcLock);
+        if (!fadeInstalled) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        ledc[index].start = hal::millis();
+        length = ledc[index].length;
+    }
+    if (fade_mode == LEDC_FADE_WAIT_DONE) {
+        hal::sleepMs(length);
+    }
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+    int index = ledcIndex(speed_mode, channel);
+    return index < 0 ? 0 : hal::ledcDuty((uint8_t)index);
+}
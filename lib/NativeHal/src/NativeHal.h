@@ -0,0 +1,91 @@
+/**
+ * @file NativeHal.h
+ * @brief Control surface of the Linux hardware abstraction shim.
+ *
+ * On the native build the Arduino, FreeRTOS, Preferences and sensor library APIs used by the
+ * firmware are implemented on top of the C++ standard library. This header exposes the state of
+ * the fake hardware so that a host program can drive sensor inputs and observe actuator outputs.
+ */
+
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stdint.h>
+
+/** @brief Number of GPIO pins modelled by the shim (ESP32 has GPIO 0-39). */
+#define HAL_PIN_COUNT 40
+
+/** @brief CPU clock at reset; `setCpuFrequencyMhz()` changes the one reported and used by the fake cycle counter. */
+#define HAL_CPU_MHZ 240
+
+/** @brief Number of LEDC channels modelled by the shim. */
+#define HAL_LEDC_CHANNELS 16
+
+namespace hal {
+
+/** @brief Milliseconds since the shim started, of device time in virtual time (see VirtualTime.h). */
+uint32_t millis();
+
+/** @brief Microseconds since the shim started, of device time in virtual time. */
+uint32_t micros();
+
+/** @brief Sleeps the calling thread for `ms` milliseconds; in virtual time, blocks the calling task. */
+void sleepMs(uint32_t ms);
+
+/** @brief Sets the level returned by `digitalRead()` on an input pin. */
+void setDigitalInput(uint8_t pin, int level);
+
+/** @brief Returns the level last written with `digitalWrite()`. */
+int digitalOutput(uint8_t pin);
+
+/** @brief Sets the raw 12-bit value returned by `analogRead()`. */
+void setAnalogInput(uint8_t pin, uint16_t value);
+
+/** @brief Returns the current duty of a LEDC channel, part way through a running fade. */
+uint32_t ledcDuty(uint8_t channel);
+
+/** @brief Returns the duty last written with `analogWrite()` on a pin. */
+uint32_t analogOutput(uint8_t pin);
+
+/** @brief Sets the temperature (°C) and relative humidity (%) reported by the fake DHT11. */
+void setDhtReading(float temperature, float humidity);
+
+/** @brief Reads the current fake DHT11 temperature and humidity. */
+void dhtReading(float &temperature, float &humidity);
+
+/**
+ * @brief Spends the time of a DHT11 transfer, as the Adafruit library does.
+ *
+ * The caller sleeps through the 20 ms start signal, then spends 4 ms reading the bits with
+ * interrupts off (see `busyUs()`). Like the library, a transfer less than 2 s after the last one is
+ * served from its cache and takes no time.
+ */
+void dhtTransfer();
+
+/** @brief Sets the atmospheric PM1.0, PM2.5 and PM10 (µg/m³) reported by the fake PMS5003. */
+void setPmsReading(uint16_t pm1_0, uint16_t pm2_5, uint16_t pm10);
+
+/** @brief Reads the current fake PMS5003 concentrations. */
+void pmsReading(uint16_t &pm1_0, uint16_t &pm2_5, uint16_t &pm10);
+
+/** @brief Makes the fake PMS5003 send its next `count` frames with a bad checksum. */
+void corruptPmsFrames(uint32_t count);
+
+/** @brief Returns false while the fake PMS5003 is asleep. */
+bool pmsAwake();
+
+/** @brief Attaches the fake PMS5003 to `Serial2`; it streams frames once the port is opened. */
+void startPms5003();
+
+/**
+ * @brief If `HAL_SERIAL1_PTY` is set, connects `Serial1` to a new pseudo-terminal and prints its path.
+ *
+ * Host tools can then open the path like the cloud-ESP's serial port.
+ *
+ * @return true if the bridge was started.
+ */
+bool startSerialBridge();
+
+} // namespace hal
+
+#endif // !NATIVE_HAL_H
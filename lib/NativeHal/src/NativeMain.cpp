@@ -0,0 +1,30 @@
+/**
+ * @file NativeMain.cpp
+ * @brief Entry point of the native build: runs the firmware's `setup()` and `loop()` like the Arduino core.
+ *
+ * `HAL_SERIAL1_PTY=1` exposes Serial1 on a pseudo-terminal, and `HAL_ROOM=<speedup>` closes the
+ * fan loop through the room model. Unit tests (`pio test -e native`) bring their own `main()`.
+ */
+
+#include "Arduino.h"
+#include "NativeHal.h"
+#include "RoomModel.h"
+
+#include <stdlib.h>
+
+#ifndef PIO_UNIT_TESTING
+int main() {
+    hal::startPms5003();
+    hal::startSerialBridge();
+    // HAL_ROOM=<speedup> feeds the fake PMS5003 from a room purified by the motor's fan (LEDC channel 0)
+    if (const char *speedup = getenv("HAL_ROOM")) {
+        float scale = (float)atof(speedup);
+        hal::startRoomModel(hal::defaultRoom(), 0, 1023, scale > 0.0f ? scale : 1.0f);
+    }
+    setup();
+    for (;;) {
+        loop();
+        vTaskDelay(1);
+    }
+}
+#endif
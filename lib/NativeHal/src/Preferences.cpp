@@ -0,0 +1,98 @@
+/**
+ * @file Preferences.cpp
+ * @brief In-memory NVS for the Linux shim.
+ */
+
+#include "Preferences.h"
+
+#include <string.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+std::mutex storeLock;
+std::map<std::string, Namespace> store;
+
+} // namespace
+
+bool Preferences::begin(const char *name, bool ro, const char *partitionLabel) {
+    (void)partitionLabel;
+    if (name == NULL || strlen(name) > 15) {
+        return false;
+    }
+    space = name;
+    readOnly = ro;
+    started = true;
+    return true;
+}
+
+bool Preferences::clear() {
+    if (!started || readOnly) return false;
+    std::lock_guard<std::mutex> guard(storeLock);
+    store[space].clear();
+    return true;
+}
+
+bool Preferences::remove(const char *key) {
+    if (!started || readOnly) return false;
+    std::lock_guard<std::mutex> guard(storeLock);
+    return store[space].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+    if (!started) return false;
+    std::lock_guard<std::mutex> guard(storeLock);
+    return store[space].count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length) {
+    if (!started || readOnly || key == NULL) return 0;
+    std::lock_guard<std::mutex> guard(storeLock);
+    const uint8_t *bytes = (const uint8_t *)value;
+    store[space][key].assign(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    if (!started) return 0;
+    std::lock_guard<std::mutex> guard(storeLock);
+    Namespace &ns = store[space];
+    Namespace::iterator it = ns.find(key);
+    return it == ns.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength) {
+    if (!started) return 0;
+    std::lock_guard<std::mutex> guard(storeLock);
+    Namespace &ns = store[space];
+    Namespace::iterator it = ns.find(key);
+    if (it == ns.end() || it->second.size() > maxLength) return 0;
+    memcpy(buffer, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+    return putBytes(key, value, strlen(value) + 1) ? strlen(value) : 0;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue) {
+    size_t length = getBytesLength(key);
+    if (length == 0) return defaultValue;
+    std::vector<char> text(length);
+    getBytes(key, text.data(), length);
+    text.back() = '\0';
+    return String(text.data());
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+    uint32_t value = defaultValue;
+    if (getBytesLength(key) == sizeof(value)) {
+        getBytes(key, &value, sizeof(value));
+    }
+    return value;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file Preferences.h
+ * @brief ESP32 `Preferences` (NVS) for the Linux shim, kept in process memory.
+ *
+ * Namespaces survive `end()`/`begin()` cycles within one run, like NVS survives a task restart.
+ */
+
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "WString.h"
+
+class Preferences {
+    public:
+        Preferences() : started(false), readOnly(false) {}
+
+        bool begin(const char *name, bool readOnly = false, const char *partitionLabel = NULL);
+        void end() { started = false; }
+
+        bool clear();
+        bool remove(const char *key);
+        bool isKey(const char *key);
+
+        size_t putString(const char *key, const char *value);
+        size_t putString(const char *key, const String &value) { return putString(key, value.c_str()); }
+        String getString(const char *key, const String &defaultValue = String());
+
+        size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+        uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+
+        size_t putBytes(const char *key, const void *value, size_t length);
+        size_t getBytesLength(const char *key);
+        size_t getBytes(const char *key, void *buffer, size_t maxLength);
+
+    private:
+        std::string space;
+        bool started;
+        bool readOnly;
+};
+
+#endif // !NATIVE_PREFERENCES_H
@@ -0,0 +1,71 @@
+/**
+ * @file RoomModel.cpp
+ * @brief Room air-quality model of the Linux shim.
+ */
+
+#include "RoomModel.h"
+#include "NativeHal.h"
+#include "VirtualTime.h"
+
+#include <math.h>
+
+#include <mutex>
+
+namespace hal {
+
+namespace {
+
+std::mutex roomLock;
+RoomModel running;
+
+} // namespace
+
+RoomModel defaultRoom() {
+    RoomModel room;
+    room.volume = 30.0f;
+    room.exchangeRate = 0.5f;
+    room.outdoor = 8.0f;
+    room.source = 2000.0f;
+    room.cadr = 250.0f;
+    room.concentration = 8.0f;
+    return room;
+}
+
+float stepRoom(RoomModel &room, float fanFraction, float seconds) {
+    if (fanFraction < 0.0f) fanFraction = 0.0f;
+    if (fanFraction > 1.0f) fanFraction = 1.0f;
+    // Linear in C: integrate exactly over the step
+    float removal = room.exchangeRate + room.cadr * fanFraction / room.volume;    // 1/h
+    float equilibrium = (room.source / room.volume + room.exchangeRate * room.outdoor) / removal;
+    room.concentration = equilibrium + (room.concentration - equilibrium) * expf(-removal * seconds / 3600.0f);
+    return room.concentration;
+}
+
+void startRoomModel(const RoomModel &room, uint8_t fanChannel, uint32_t fanFullDuty, float speedup) {
+    {
+        std::lock_guard<std::mutex> guard(roomLock);
+        running = room;
+    }
+    const uint32_t periodMs = 100;
+    addEvent(0, periodMs, [=] {
+        float c;
+        {
+            std::lock_guard<std::mutex> guard(roomLock);
+            c = stepRoom(running, (float)ledcDuty(fanChannel) / fanFullDuty, periodMs / 1000.0f * speedup);
+        }
+        long pm2_5 = lroundf(c);
+        setPmsReading((uint16_t)lroundf(c * 0.7f), (uint16_t)pm2_5, (uint16_t)lroundf(c * 1.3f));
+    });
+}
+
+RoomModel roomState() {
+    std::lock_guard<std::mutex> guard(roomLock);
+    return running;
+}
+
+void setRoomSource(float source) {
+    std::lock_guard<std::mutex> guard(roomLock);
+    running.source = source;
+}
+
+} // namespace hal
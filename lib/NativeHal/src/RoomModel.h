@@ -0,0 +1,62 @@
+/**
+ * @file RoomModel.h
+ * @brief Well-mixed room air-quality model closing the loop between the fan and the fake PMS5003.
+ *
+ * The PM2.5 concentration C of a room of volume V changes as
+ *
+ *     dC/dt = S / V + a (C_out - C) - (CADR u / V) C
+ *
+ * with an indoor source S (µg/h), an air exchange rate a (1/h) with outdoor air at C_out, and a
+ * purifier of clean air delivery rate CADR (m³/h) running at the fraction u of full speed. The
+ * fan speed is read from the duty of the motor's LEDC channel.
+ */
+
+#ifndef NATIVE_ROOM_MODEL_H
+#define NATIVE_ROOM_MODEL_H
+
+#include <stdint.h>
+
+namespace hal {
+
+/**
+ * @struct RoomModel
+ * @brief Parameters and state of the room.
+ */
+struct RoomModel {
+    float volume;           ///< Room volume, m³.
+    float exchangeRate;     ///< Air changes with outdoor air per hour.
+    float outdoor;          ///< Outdoor PM2.5, µg/m³.
+    float source;           ///< Indoor emission, µg/h.
+    float cadr;             ///< Clean air delivery rate at full fan speed, m³/h.
+    float concentration;    ///< Current indoor PM2.5, µg/m³.
+};
+
+/** @brief A 30 m³ room with a 250 m³/h purifier, an indoor source that takes it to about 140 µg/m³ with the fan off, and a clean start. */
+RoomModel defaultRoom();
+
+/**
+ * @brief Advances the room by `seconds` with the fan at `fanFraction` (0-1) of full speed.
+ *
+ * @return The new concentration.
+ */
+float stepRoom(RoomModel &room, float fanFraction, float seconds);
+
+/**
+ * @brief Runs `room` in the background: every 100 ms it is stepped with the fan speed read from
+ * LEDC channel `fanChannel` (`fanFullDuty` is full speed), and the fake PMS5003 reports it.
+ *
+ * Time is scaled by `speedup`, so one second of the shim is `speedup` seconds in the room. The
+ * firmware still runs at the shim's pace, so a speedup above 1 makes its controller look slower to
+ * the room; in virtual time, 1 is the right value.
+ */
+void startRoomModel(const RoomModel &room, uint8_t fanChannel, uint32_t fanFullDuty, float speedup);
+
+/** @brief Current state of the room started with `startRoomModel()`. */
+RoomModel roomState();
+
+/** @brief Changes the indoor source of the running room, in µg/h. */
+void setRoomSource(float source);
+
+} // namespace hal
+
+#endif // !NATIVE_ROOM_MODEL_H
@@ -0,0 +1,61 @@
+/**
+ * @file SerialBridge.cpp
+ * @brief Connects the fake `Serial1` to a pseudo-terminal, so host tools can talk to the native firmware.
+ */
+
+#include "HardwareSerial.h"
+#include "NativeHal.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <thread>
+
+namespace hal {
+
+bool startSerialBridge() {
+    if (!getenv("HAL_SERIAL1_PTY")) {
+        return false;
+    }
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("HAL_SERIAL1_PTY");
+        return false;
+    }
+    const char *path = ptsname(master);
+
+    // Raw bytes both ways; keeping the slave open stops reads failing while no client is connected
+    int slave = open(path, O_RDWR | O_NOCTTY);
+    struct termios mode;
+    if (slave >= 0 && tcgetattr(slave, &mode) == 0) {
+        cfmakeraw(&mode);
+        tcsetattr(slave, TCSANOW, &mode);
+    }
+    fprintf(stderr, "Serial1 on %s\n", path);
+
+    Serial1.setTxSink([master](const uint8_t *data, size_t length) {
+        while (length > 0) {
+            ssize_t n = write(master, data, length);
+            if (n <= 0) return;
+            data += n;
+            length -= (size_t)n;
+        }
+    });
+    std::thread([master] {
+        uint8_t buffer[256];
+        for (;;) {
+            ssize_t n = read(master, buffer, sizeof(buffer));
+            if (n > 0) {
+                Serial1.inject(buffer, (size_t)n);
+            } else {
+                sleepMs(10);
+            }
+        }
+    }).detach();
+    return true;
+}
+
+} // namespace hal
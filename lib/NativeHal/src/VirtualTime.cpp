@@ -0,0 +1,378 @@
+/**
+ * @file VirtualTime.cpp
+ * @brief Virtual clock, device events and one-task-at-a-time scheduling of the Linux shim.
+ *
+ * Every task keeps its own thread, but only the task in `running` executes; the others wait on
+ * `dispatched` until they are picked. The thread of a task that blocks picks the next one, and
+ * when none is ready it moves the clock itself and runs the events due, with the kernel lock
+ * released, as the device's interrupts and peripherals would.
+ */
+
+#include "VirtualTime.h"
+#include "NativeHal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace {
+
+enum TaskState { TASK_NEW, TASK_READY, TASK_RUNNING, TASK_BLOCKED, TASK_DONE };
+
+struct VirtualTask {
+    hal::TaskStats stats;
+    TaskState state;
+    uint64_t wakeAt;        ///< Timeout of the current wait.
+    uint64_t readySince;
+    uint64_t readyOrder;    ///< First come first served among equal priorities.
+};
+
+/** @brief A device event; a periodic one is queued again before it runs. */
+struct Event {
+    uint32_t periodMs;
+    std::shared_ptr<std::function<void()>> run;
+};
+
+std::atomic<bool> enabled(false);
+std::atomic<uint64_t> nowUs(0);
+
+std::mutex kernelLock;
+std::condition_variable dispatched;
+std::vector<VirtualTask *> tasks;
+VirtualTask *running = nullptr;
+uint64_t order = 0;
+std::map<std::pair<uint64_t, uint64_t>, Event> events;     ///< By time, then order of addition.
+std::map<const void *, VirtualTask *> holders;              ///< Task holding each mutex taken.
+std::function<void()> deadlockHandler;
+
+thread_local VirtualTask *self = nullptr;
+
+/** @brief Runs the deadlock handler, prints the tasks and exits. */
+[[noreturn]] void deadlock(std::unique_lock<std::mutex> &guard, const char *reason) {
+    std::function<void()> handler = deadlockHandler;
+    guard.unlock();
+    if (handler) {
+        handler();
+    }
+    fprintf(stderr, "deadlock at %.3f s: %s\n", nowUs.load() / 1e6, reason);
+    for (const hal::TaskStats &task : hal::taskStats()) {
+        if (task.waitingFor) {
+            char object[24] = "";
+            if (task.object) {
+                snprintf(object, sizeof(object), " %p", task.object);
+            }
+            fprintf(stderr, "  %-16s prio %2u  blocked on %s%s%s since %.3f s\n", task.name.c_str(), (unsigned)task.priority,
+                    task.waitingFor, object, task.forever ? " with no timeout" : "", task.blockedSinceUs / 1e6);
+        } else {
+            fprintf(stderr, "  %-16s prio %2u  not blocked\n", task.name.c_str(), (unsigned)task.priority);
+        }
+    }
+    fflush(nullptr);
+    _Exit(2);
+}
+
+/** @brief True if `task` waiting for `object` forever closes a cycle of mutex holders doing the same. */
+bool closesCycle(const VirtualTask *task, const void *object) {
+    for (size_t hops = 0; hops <= tasks.size(); hops++) {
+        auto holder = holders.find(object);
+        if (holder == holders.end()) {
+            return false;
+        }
+        if (holder->second == task) {
+            return true;
+        }
+        if (holder->second->state != TASK_BLOCKED || !holder->second->stats.forever) {
+            return false;
+        }
+        object = holder->second->stats.object;
+    }
+    return false;
+}
+
+/** @brief The calling task; a wait on any other thread, or from a device event, has no meaning in virtual time. */
+VirtualTask *current() {
+    if (!self || running != self) {
+        fprintf(stderr, "virtual time: blocking call %s\n", self ? "from a device event" : "from a thread that is not a task");
+        abort();
+    }
+    return self;
+}
+
+void makeReady(VirtualTask *task, uint64_t since) {
+    if (task->state == TASK_BLOCKED) {
+        task->stats.blockedUs += since - task->stats.blockedSinceUs;
+        task->stats.wakeups++;
+    }
+    task->state = TASK_READY;
+    task->stats.waitingFor = nullptr;
+    task->stats.object = nullptr;
+    task->stats.forever = false;
+    task->readySince = since;
+    task->readyOrder = order++;
+}
+
+VirtualTask *highestReady() {
+    VirtualTask *best = nullptr;
+    for (VirtualTask *task : tasks) {
+        if (task->state == TASK_READY &&
+            (!best || task->stats.priority > best->stats.priority ||
+             (task->stats.priority == best->stats.priority && task->readyOrder < best->readyOrder))) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+/** @brief Readies the tasks whose wait timed out at or before `time`. */
+void wakeTimedOut(uint64_t time) {
+    for (VirtualTask *task : tasks) {
+        if (task->state == TASK_BLOCKED && task->wakeAt <= time) {
+            makeReady(task, task->wakeAt);
+        }
+    }
+}
+
+/** @brief Moves the clock to `time`, running the events due on the way. */
+void advanceTo(std::unique_lock<std::mutex> &guard, uint64_t time) {
+    while (!events.empty() && events.begin()->first.first <= time) {
+        auto next = events.begin();
+        uint64_t at = next->first.first;
+        Event event = next->second;
+        events.erase(next);
+        if (at > nowUs) {
+            nowUs = at;
+        }
+        wakeTimedOut(nowUs);
+        if (event.periodMs > 0) {
+            events.emplace(std::make_pair(at + event.periodMs * 1000ull, order++), event);
+        }
+        guard.unlock();
+        (*event.run)();
+        guard.lock();
+    }
+    if (time > nowUs) {
+        nowUs = time;
+    }
+    wakeTimedOut(nowUs);
+}
+
+/** @brief Moves the clock to the earliest timeout or event; false if there is none. */
+bool advance(std::unique_lock<std::mutex> &guard) {
+    uint64_t next = hal::kWaitForever;
+    for (VirtualTask *task : tasks) {
+        if (task->state == TASK_BLOCKED && task->wakeAt < next) {
+            next = task->wakeAt;
+        }
+    }
+    if (!events.empty() && events.begin()->first.first < next) {
+        next = events.begin()->first.first;
+    }
+    if (next == hal::kWaitForever) {
+        return false;
+    }
+    advanceTo(guard, next);
+    return true;
+}
+
+/**
+ * @brief Gives the CPU to the highest priority ready task, which may be `task` again.
+ *
+ * `task` has already left the running state. Returns once it runs again, or at once if it ended.
+ */
+void switchFrom(std::unique_lock<std::mutex> &guard, VirtualTask *task) {
+    running = nullptr;
+    VirtualTask *next;
+    while (!(next = highestReady())) {
+        if (!advance(guard)) {
+            deadlock(guard, "no task can run and no event is pending");
+        }
+    }
+    uint64_t latency = nowUs - next->readySince;
+    next->stats.readyLatencyUs += latency;
+    if (latency > next->stats.maxReadyLatencyUs) {
+        next->stats.maxReadyLatencyUs = latency;
+    }
+    next->state = TASK_RUNNING;
+    running = next;
+    dispatched.notify_all();
+    if (task->state != TASK_DONE) {
+        dispatched.wait(guard, [task] { return running == task; });
+    }
+}
+
+/** @brief Hands the CPU over if a ready task has a higher priority than the caller. */
+void preemptIfNeeded(std::unique_lock<std::mutex> &guard) {
+    VirtualTask *next = highestReady();
+    if (!self || running != self || !next || next->stats.priority <= self->stats.priority) {
+        return;
+    }
+    self->stats.preemptions++;
+    makeReady(self, nowUs);
+    switchFrom(guard, self);
+}
+
+} // namespace
+
+namespace hal {
+
+void startVirtualTime() {
+    std::lock_guard<std::mutex> guard(kernelLock);
+    VirtualTask *loop = new VirtualTask{};
+    loop->stats.name = "loopTask";
+    loop->stats.priority = 1;
+    loop->state = TASK_RUNNING;
+    tasks.push_back(loop);
+    running = loop;
+    self = loop;
+    enabled = true;
+}
+
+bool virtualTime() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t deviceTimeUs() {
+    return nowUs.load(std::memory_order_relaxed);
+}
+
+void addEvent(uint32_t firstMs, uint32_t periodMs, std::function<void()> event) {
+    if (!virtualTime()) {
+        std::thread([firstMs, periodMs, event] {
+            sleepMs(firstMs);
+            event();
+            while (periodMs > 0) {
+                sleepMs(periodMs);
+                event();
+            }
+        }).detach();
+        return;
+    }
+    std::lock_guard<std::mutex> guard(kernelLock);
+    events.emplace(std::make_pair(nowUs + firstMs * 1000ull, order++),
+                   Event{periodMs, std::make_shared<std::function<void()>>(std::move(event))});
+}
+
+void busyUs(uint32_t us) {
+    if (!virtualTime()) {
+        return;
+    }
+    std::unique_lock<std::mutex> guard(kernelLock);
+    if (!self || running != self) {
+        return;
+    }
+    self->stats.busyUs += us;
+    advanceTo(guard, nowUs + us);
+    preemptIfNeeded(guard);
+}
+
+std::vector<TaskStats> taskStats() {
+    std::lock_guard<std::mutex> guard(kernelLock);
+    std::vector<TaskStats> stats;
+    for (const VirtualTask *task : tasks) {
+        stats.push_back(task->stats);
+    }
+    return stats;
+}
+
+void onDeadlock(std::function<void()> handler) {
+    std::lock_guard<std::mutex> guard(kernelLock);
+    deadlockHandler = std::move(handler);
+}
+
+void *createTask(const char *name, uint32_t priority) {
+    std::lock_guard<std::mutex> guard(kernelLock);
+    VirtualTask *task = new VirtualTask{};
+    task->stats.name = name ? name : "";
+    task->stats.priority = priority;
+    task->state = TASK_NEW;
+    tasks.push_back(task);
+    return task;
+}
+
+void startTask(void *task) {
+    std::unique_lock<std::mutex> guard(kernelLock);
+    makeReady((VirtualTask *)task, nowUs);
+    preemptIfNeeded(guard);
+}
+
+void enterTask(void *task) {
+    std::unique_lock<std::mutex> guard(kernelLock);
+    self = (VirtualTask *)task;
+    dispatched.wait(guard, [] { return running == self; });
+}
+
+void exitTask() {
+    std::unique_lock<std::mutex> guard(kernelLock);
+    VirtualTask *task = current();
+    task->state = TASK_DONE;
+    switchFrom(guard, task);
+}
+
+bool blockTask(const char *what, const void *object, uint64_t timeoutUs, const std::function<bool()> &ready) {
+    std::unique_lock<std::mutex> guard(kernelLock);
+    VirtualTask *task = current();
+    uint64_t deadline = timeoutUs == kWaitForever ? kWaitForever : nowUs + timeoutUs;
+    for (;;) {
+        if (ready && ready()) {
+            return true;
+        }
+        if (nowUs >= deadline) {
+            return false;
+        }
+        task->state = TASK_BLOCKED;
+        task->wakeAt = deadline;
+        task->stats.waitingFor = what;
+        task->stats.object = object;
+        task->stats.forever = deadline == kWaitForever;
+        task->stats.blockedSinceUs = nowUs;
+        if (task->stats.forever && closesCycle(task, object)) {
+            deadlock(guard, "tasks wait for each other's mutexes");
+        }
+        switchFrom(guard, task);
+    }
+}
+
+void holdObject(const void *object, bool held) {
+    if (!virtualTime()) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(kernelLock);
+    if (held) {
+        holders[object] = self;
+    } else {
+        holders.erase(object);
+    }
+}
+
+void wakeTasks(const void *object) {
+    if (!virtualTime() || !object) {
+        return;
+    }
+    std::unique_lock<std::mutex> guard(kernelLock);
+    for (VirtualTask *task : tasks) {
+        if (task->state == TASK_BLOCKED && task->stats.object == object) {
+            makeReady(task, nowUs);
+        }
+    }
+    preemptIfNeeded(guard);
+}
+
+void yieldTask() {
+    if (!virtualTime()) {
+        std::this_thread::yield();
+        return;
+    }
+    std::unique_lock<std::mutex> guard(kernelLock);
+    VirtualTask *task = current();
+    makeReady(task, nowUs);
+    switchFrom(guard, task);
+}
+
+} // namespace hal
@@ -0,0 +1,133 @@
+/**
+ * @file VirtualTime.h
+ * @brief Deterministic virtual clock and task scheduler of the Linux shim.
+ *
+ * By default the shim runs in real time: tasks are threads running concurrently, and the fake
+ * devices are driven by threads sleeping on the steady clock. After `startVirtualTime()` the
+ * device clock is a counter that only moves when nothing can run:
+ *
+ * - One task runs at a time. It keeps the CPU until it blocks (`vTaskDelay()`, `delay()`,
+ *   `ulTaskNotifyTake()`, `xSemaphoreTake()`), yields, or wakes a task of higher priority; the
+ *   highest priority ready task runs next, first come first served among equals.
+ * - When every task is blocked, the clock jumps to the earliest timeout or device event, which
+ *   then runs. Code takes no device time, apart from what `busyUs()` charges.
+ *
+ * A run is then a function of the firmware and of the program driving it only, and takes as long
+ * as the firmware's own work: days of device time pass in seconds. If every task is blocked with
+ * no timeout and no event is pending, or tasks wait for each other's mutexes with no timeout,
+ * the deadlock handler is called.
+ */
+
+#ifndef NATIVE_VIRTUAL_TIME_H
+#define NATIVE_VIRTUAL_TIME_H
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+/** @brief Timeout of a wait that only ends when it is woken. */
+const uint64_t kWaitForever = UINT64_MAX;
+
+/**
+ * @brief Switches the shim to virtual time.
+ *
+ * Call it first in `main()`, before starting the fake devices, from the thread that runs `setup()`
+ * and `loop()`: that thread becomes the loop task. The serial bridge has no place in virtual time.
+ */
+void startVirtualTime();
+
+/** @brief Returns true once `startVirtualTime()` was called. */
+bool virtualTime();
+
+/** @brief Device time in microseconds; 64 bits, so unlike `micros()` it does not wrap. */
+uint64_t deviceTimeUs();
+
+/**
+ * @brief Runs `event` `firstMs` from now, then every `periodMs` (0: once).
+ *
+ * In virtual time the event runs between tasks, at its exact device time; events due at the same
+ * time run in the order they were added. In real time it runs on a thread of its own.
+ */
+void addEvent(uint32_t firstMs, uint32_t periodMs, std::function<void()> event);
+
+/** @brief Charges `us` of CPU time to the calling task: the clock moves on and the events due run. Nothing in real time. */
+void busyUs(uint32_t us);
+
+/**
+ * @struct TaskStats
+ * @brief What the virtual scheduler saw of one task, device times in microseconds.
+ */
+struct TaskStats {
+    std::string name;
+    uint32_t priority;
+    uint64_t wakeups;           ///< Times it was made ready after blocking.
+    uint64_t preemptions;       ///< Times a task of higher priority took the CPU from it.
+    uint64_t maxReadyLatencyUs; ///< Longest time from ready to running.
+    uint64_t readyLatencyUs;    ///< Total time from ready to running.
+    uint64_t busyUs;            ///< CPU time charged with `busyUs()`.
+    uint64_t blockedUs;         ///< Time spent blocked, up to its last wake-up.
+    const char *waitingFor;     ///< What it is blocked on ("delay", "notify", "mutex"...), or nullptr.
+    const void *object;         ///< The task or semaphore it waits for.
+    bool forever;               ///< The current wait has no timeout.
+    uint64_t blockedSinceUs;    ///< When the current wait started.
+};
+
+/** @brief Statistics of every task, in creation order: the loop task first. */
+std::vector<TaskStats> taskStats();
+
+/**
+ * @brief Adds to what happens on a deadlock: `handler` runs first, on a blocked task's thread, then
+ * the tasks are printed and the program exits with status 2.
+ */
+void onDeadlock(std::function<void()> handler);
+
+/**
+ * @brief Hooks of the FreeRTOS shim into the virtual scheduler.
+ *
+ * They are only called in virtual time, except `wakeTasks()` which does nothing in real time.
+ */
+
+/** @brief Adds a task; its thread must call `enterTask()` with the result before anything else. */
+void *createTask(const char *name, uint32_t priority);
+
+/** @brief Makes `task` ready once its thread was started; it takes the CPU if its priority is higher than the caller's. */
+void startTask(void *task);
+
+/** @brief Makes the calling thread the task `task` and waits for its first turn. */
+void enterTask(void *task);
+
+/** @brief Ends the calling task; its thread may exit once this returns. */
+void exitTask();
+
+/**
+ * @brief Blocks the calling task until `ready()` is true, or `timeoutUs` has passed.
+ *
+ * `ready` is checked first and whenever the task is woken with `wakeTasks(object)`; a null `ready`
+ * waits for the whole timeout.
+ *
+ * @param what What the wait is reported as.
+ * @return The last value of `ready()`.
+ */
+bool blockTask(const char *what, const void *object, uint64_t timeoutUs, const std::function<bool()> &ready);
+
+/**
+ * @brief Records that the calling task took (`held`) or gave back the mutex `object`.
+ *
+ * A wait with no timeout for a mutex whose holder waits the same way, directly or through other
+ * holders, for one the caller holds can never end: it is reported as a deadlock at once.
+ */
+void holdObject(const void *object, bool held);
+
+/** @brief Readies the tasks blocked on `object`; one of higher priority than the caller takes the CPU. */
+void wakeTasks(const void *object);
+
+/** @brief Lets the other ready tasks of the same or higher priority run first. */
+void yieldTask();
+
+} // namespace hal
+
+#endif // !NATIVE_VIRTUAL_TIME_H
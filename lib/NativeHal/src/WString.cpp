@@ -0,0 +1,156 @@
+/**
+ * @file WString.cpp
+ * @brief Arduino `String` and `dtostrf` for the Linux shim.
+ */
+
+#include "WString.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+std::string formatInteger(unsigned long long magnitude, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char digits[66];
+    size_t n = 0;
+    do {
+        unsigned d = (unsigned)(magnitude % base);
+        digits[sizeof(digits) - 1 - n++] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+        magnitude /= base;
+    } while (magnitude != 0);
+    if (negative) digits[sizeof(digits) - 1 - n++] = '-';
+    return std::string(digits + sizeof(digits) - n, n);
+}
+
+std::string formatSigned(long long value, unsigned char base) {
+    // Like itoa/ltoa, only base 10 prints a sign; other bases print the two's complement.
+    if (base == 10 && value < 0) return formatInteger(0ull - (unsigned long long)value, true, base);
+    return formatInteger((unsigned long)value, false, base);
+}
+
+} // namespace
+
+String::String(int value, unsigned char base) : s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : s(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : s(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned int decimalPlaces) {
+    char buf[64];
+    s = dtostrf(value, decimalPlaces + 2, decimalPlaces, buf);
+}
+
+String::String(double value, unsigned int decimalPlaces) {
+    char buf[64];
+    s = dtostrf(value, decimalPlaces + 2, decimalPlaces, buf);
+}
+
+bool String::endsWith(const String &suffix) const {
+    return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t at = s.find(c, from);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+int String::indexOf(const String &text, unsigned int from) const {
+    size_t at = s.find(text.s, from);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t at = s.rfind(c);
+    return at == std::string::npos ? -1 : (int)at;
+}
+
+String String::substring(unsigned int from) const {
+    return from >= s.size() ? String() : String(s.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= s.size()) return String();
+    return String(s.substr(from, to - from));
+}
+
+void String::remove(unsigned int index) {
+    if (index < s.size()) s.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index < s.size()) s.erase(index, count);
+}
+
+void String::trim() {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    size_t end = s.find_last_not_of(" \t\r\n");
+    s = begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+}
+
+/*
+ * Same algorithm as the Arduino-ESP32 core, so host output matches the device digit for digit.
+ */
+char *dtostrf(double number, signed int width, unsigned int prec, char *s) {
+    bool negative = false;
+
+    if (isnan(number)) {
+        strcpy(s, "nan");
+        return s;
+    }
+    if (isinf(number)) {
+        strcpy(s, "inf");
+        return s;
+    }
+
+    char *out = s;
+    int fillme = width;
+    if (prec > 0) {
+        fillme -= (prec + 1);
+    }
+    if (number < 0.0) {
+        negative = true;
+        fillme--;
+        number = -number;
+    }
+
+    double rounding = 2.0;
+    for (unsigned int i = 0; i < prec; ++i) {
+        rounding *= 10.0;
+    }
+    rounding = 1.0 / rounding;
+    number += rounding;
+
+    double tenpow = 1.0;
+    unsigned int digitcount = 1;
+    while (number >= 10.0 * tenpow) {
+        tenpow *= 10.0;
+        digitcount++;
+    }
+    number /= tenpow;
+    fillme -= digitcount;
+
+    while (fillme-- > 0) {
+        *out++ = ' ';
+    }
+    if (negative) {
+        *out++ = '-';
+    }
+
+    digitcount += prec;
+    int8_t digit = 0;
+    while (digitcount-- > 0) {
+        digit = (int8_t)number;
+        if (digit > 9) digit = 9;
+        *out++ = (char)('0' | digit);
+        if ((digitcount == prec) && (prec > 0)) {
+            *out++ = '.';
+        }
+        number -= digit;
+        number *= 10.0;
+    }
+    *out = 0;
+    return s;
+}
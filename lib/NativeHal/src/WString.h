@@ -0,0 +1,62 @@
+/**
+ * @file WString.h
+ * @brief Arduino `String` for the Linux shim, backed by `std::string`.
+ *
+ * Number formatting follows the Arduino-ESP32 core (`String(float)` prints two decimals
+ * through `dtostrf`).
+ */
+
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/** @brief Formats `number` with `prec` decimals, right-aligned in `width` characters. */
+char *dtostrf(double number, signed int width, unsigned int prec, char *s);
+
+class String {
+    public:
+        String(const char *text = "") : s(text ? text : "") {}
+        String(const std::string &text) : s(text) {}
+        explicit String(char c) : s(1, c) {}
+        explicit String(int value, unsigned char base = 10);
+        explicit String(unsigned int value, unsigned char base = 10);
+        explicit String(long value, unsigned char base = 10);
+        explicit String(unsigned long value, unsigned char base = 10);
+        explicit String(float value, unsigned int decimalPlaces = 2);
+        explicit String(double value, unsigned int decimalPlaces = 2);
+
+        unsigned int length() const { return (unsigned int)s.size(); }
+        const char *c_str() const { return s.c_str(); }
+
+        String &operator+=(const String &rhs) { s += rhs.s; return *this; }
+        String &operator+=(const char *rhs) { s += rhs; return *this; }
+        String &operator+=(char c) { s += c; return *this; }
+        bool operator==(const String &rhs) const { return s == rhs.s; }
+        bool operator==(const char *rhs) const { return s == rhs; }
+        char operator[](unsigned int index) const { return index < s.size() ? s[index] : '\0'; }
+
+        bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+        bool endsWith(const String &suffix) const;
+        int indexOf(char c, unsigned int from = 0) const;
+        int indexOf(const String &text, unsigned int from = 0) const;
+        int lastIndexOf(char c) const;
+        String substring(unsigned int from) const;
+        String substring(unsigned int from, unsigned int to) const;
+        void remove(unsigned int index);
+        void remove(unsigned int index, unsigned int count);
+        void trim();
+        long toInt() const { return strtol(s.c_str(), NULL, 10); }
+        float toFloat() const { return strtof(s.c_str(), NULL); }
+
+    private:
+        std::string s;
+};
+
+inline String operator+(const String &lhs, const String &rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, const char *rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const char *lhs, const String &rhs) { String r(lhs); r += rhs; return r; }
+
+#endif // !NATIVE_WSTRING_H
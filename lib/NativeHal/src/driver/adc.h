@@ -0,0 +1,113 @@
+/**
+ * @file adc.h
+ * @brief ESP-IDF 4.4 continuous (DMA) ADC API for the Linux shim.
+ *
+ * The fake converter produces one conversion per pattern entry at `sample_freq_hz` while it is
+ * started, taking each value from the raw level set with `hal::setAnalogInput()` on the GPIO of
+ * the ADC1 channel. Conversions accumulate in a pool of `max_store_buf_size` bytes, like the DMA
+ * ring buffer of the driver; when the pool is full new conversions are lost.
+ */
+
+#ifndef NATIVE_DRIVER_ADC_H
+#define NATIVE_DRIVER_ADC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifndef BIT
+#define BIT(nr) (1UL << (nr))
+#endif
+
+/** @brief Resolution of the continuous-mode conversions on the ESP32. */
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+
+/** @brief Slowest continuous-mode sample rate supported on the ESP32. */
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW 20000
+
+/** @brief Size of one conversion result. */
+#define SOC_ADC_DIGI_RESULT_BYTES 2
+
+typedef enum {
+    ADC_UNIT_1 = 1,
+    ADC_UNIT_2 = 2,
+} adc_unit_t;
+
+typedef enum {
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5 = 1,
+    ADC_ATTEN_DB_6 = 2,
+    ADC_ATTEN_DB_11 = 3,
+} adc_atten_t;
+
+typedef enum {
+    ADC_WIDTH_BIT_9 = 0,
+    ADC_WIDTH_BIT_10 = 1,
+    ADC_WIDTH_BIT_11 = 2,
+    ADC_WIDTH_BIT_12 = 3,
+} adc_bits_width_t;
+
+typedef enum {
+    ADC1_CHANNEL_0 = 0, ///< GPIO 36
+    ADC1_CHANNEL_1,     ///< GPIO 37
+    ADC1_CHANNEL_2,     ///< GPIO 38
+    ADC1_CHANNEL_3,     ///< GPIO 39
+    ADC1_CHANNEL_4,     ///< GPIO 32
+    ADC1_CHANNEL_5,     ///< GPIO 33
+    ADC1_CHANNEL_6,     ///< GPIO 34
+    ADC1_CHANNEL_7,     ///< GPIO 35
+    ADC1_CHANNEL_MAX,
+} adc1_channel_t;
+
+typedef enum {
+    ADC_CONV_SINGLE_UNIT_1 = 1,
+} adc_digi_convert_mode_t;
+
+typedef enum {
+    ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+} adc_digi_output_format_t;
+
+typedef struct {
+    uint32_t max_store_buf_size;    ///< Bytes of conversions buffered by the driver.
+    uint32_t conv_num_each_intr;    ///< Bytes of conversions per DMA interrupt.
+    uint32_t adc1_chan_mask;        ///< ADC1 channels used.
+    uint32_t adc2_chan_mask;        ///< ADC2 channels used (unsupported on the ESP32).
+} adc_digi_init_config_t;
+
+typedef struct {
+    uint8_t atten;
+    uint8_t channel;
+    uint8_t unit;
+    uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+    bool conv_limit_en;
+    uint32_t conv_limit_num;
+    uint32_t pattern_num;
+    adc_digi_pattern_config_t *adc_pattern;
+    uint32_t sample_freq_hz;
+    adc_digi_convert_mode_t conv_mode;
+    adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+/** @brief One conversion result in `ADC_DIGI_OUTPUT_FORMAT_TYPE1`. */
+typedef struct {
+    union {
+        struct {
+            uint16_t data : 12;
+            uint16_t channel : 4;
+        } type1;
+        uint16_t val;
+    };
+} adc_digi_output_data_t;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config);
+esp_err_t adc_digi_start(void);
+esp_err_t adc_digi_stop(void);
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t timeout_ms);
+esp_err_t adc_digi_deinitialize(void);
+
+#endif // !NATIVE_DRIVER_ADC_H
@@ -0,0 +1,14 @@
+/**
+ * @file esp_cpu.h
+ * @brief ESP-IDF CPU cycle counter for the Linux shim.
+ */
+
+#ifndef NATIVE_ESP_CPU_H
+#define NATIVE_ESP_CPU_H
+
+#include <stdint.h>
+
+/** @brief Cycles of a `HAL_CPU_MHZ` clock since the shim started; wraps like the CCOUNT register. */
+uint32_t esp_cpu_get_ccount(void);
+
+#endif // !NATIVE_ESP_CPU_H
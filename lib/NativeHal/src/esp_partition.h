@@ -0,0 +1,48 @@
+/**
+ * @file esp_partition.h
+ * @brief ESP-IDF partition API for the Linux shim, backed by one file per partition.
+ *
+ * The data partitions are read from the project's `partitions.csv` (or the file named by the
+ * `HAL_PARTITIONS` environment variable). Each partition is stored in `<label>.flash`, created
+ * erased on first use, in the directory named by `HAL_FLASH_DIR`; its content then survives
+ * restarts of the native firmware like real flash. Without it, every run starts on blank flash in
+ * a new temporary directory. Writes can only clear bits and erases work on whole 4 KB sectors,
+ * as on NOR flash.
+ */
+
+#ifndef NATIVE_ESP_PARTITION_H
+#define NATIVE_ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief Flash sector size: the erase granularity. */
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+    void *flash_chip;
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+#endif // !NATIVE_ESP_PARTITION_H
@@ -0,0 +1,38 @@
+/**
+ * @file task.h
+ * @brief FreeRTOS task API for the Linux shim, mapped onto `std::thread`.
+ *
+ * Priorities are only enforced in virtual time (see VirtualTime.h), where one task runs at a
+ * time. Core affinity is recorded but not enforced; `xPortGetCoreID()` returns the
+ * core a task was pinned to so log output matches the device. Stack use is not measured:
+ * `uxTaskGetStackHighWaterMark()` reports the whole stack as unused.
+ */
+
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+struct NativeTask;
+typedef NativeTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *createdTask);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+#define taskYIELD() vTaskDelay(0)
+
+#endif // !NATIVE_FREERTOS_TASK_H
@@ -0,0 +1,62 @@
+/**
+ * @file Actuators.cpp
+ * @brief Implementation of the actuator mailbox.
+ */
+
+#include "Actuators.h"
+
+#include <LedcFade.h>
+
+Actuators::Actuators(LedControl &led, BLDC &motor)
+    : led(led), motor(motor), current(), ledDoneAt(0), motorDoneAt(0), postCount(0), writeCount(0) {}
+
+void Actuators::begin(const ActuatorCommand &initial) {
+    ledcFadeBegin();
+    current = initial;
+    mailbox.write(initial);
+}
+
+void Actuators::post(const ActuatorCommand &targets) {
+    mailbox.write(targets);
+    postCount++;
+}
+
+uint32_t Actuators::apply(uint32_t now) {
+    ActuatorCommand target;
+    if (mailbox.read(target) == 0) {
+        return 0;
+    }
+    uint32_t wait = 0;
+
+    if (target.red != current.red || target.green != current.green || target.blue != current.blue) {
+        int32_t busy = (int32_t)(ledDoneAt - now);
+        if (busy > 0) {
+            wait = (uint32_t)busy;
+        } else {
+            led.fadecolor(target.red, target.green, target.blue, LED_FADE_MS);
+            current.red = target.red;
+            current.green = target.green;
+            current.blue = target.blue;
+            ledDoneAt = now + LED_FADE_MS;
+            writeCount++;
+        }
+    }
+
+    if (target.dutyCycle != current.dutyCycle) {
+        int32_t busy = (int32_t)(motorDoneAt - now);
+        if (busy > 0) {
+            if (wait == 0 || (uint32_t)busy < wait) {
+                wait = (uint32_t)busy;
+            }
+        } else {
+            uint32_t step = target.dutyCycle > current.dutyCycle ? target.dutyCycle - current.dutyCycle
+                                                                 : current.dutyCycle - target.dutyCycle;
+            uint32_t ms = step * MOTOR_RAMP_MS / MOTOR_RAMP_RANGE;
+            motor.ramp(target.dutyCycle, ms);
+            current.dutyCycle = target.dutyCycle;
+            motorDoneAt = now + ms;
+            writeCount++;
+        }
+    }
+    return wait;
+}
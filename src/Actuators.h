@@ -0,0 +1,83 @@
+/**
+ * @file Actuators.h
+ * @brief Latest-value mailbox between the command handlers and the LED and motor.
+ *
+ * Command handlers post the complete actuator state they want and return; nothing touches the
+ * hardware on the receive path. The actuator job later takes the newest posted state, so a burst
+ * of commands costs one hardware update, and only the actuators whose value changed are written.
+ * Each change is a fade run by the LEDC hardware: a fixed-time fade for the LED and, for the
+ * motor, a ramp whose time grows with the speed step (a soft start from standstill).
+ *
+ * The fade engine cannot retarget a running fade, so a change posted during a fade waits for
+ * it to end; the newest value posted by then is the one applied.
+ */
+
+#ifndef ACTUATORS_H
+#define ACTUATORS_H
+
+#include <stdint.h>
+
+#include <BLDC.h>
+#include <CommandParser.h>
+#include <LedControl.h>
+#include <SeqLock.h>
+
+/** @brief LED color fade time, ms. */
+#ifndef LED_FADE_MS
+#define LED_FADE_MS 300
+#endif
+
+/** @brief Motor ramp time over the whole duty range, ms; smaller steps ramp in proportion. */
+#ifndef MOTOR_RAMP_MS
+#define MOTOR_RAMP_MS 2000
+#endif
+
+/** @brief Duty range the motor ramp time refers to (10-bit PWM). */
+#define MOTOR_RAMP_RANGE 1024
+
+/**
+ * @class Actuators
+ * @brief Coalesces actuator targets and applies them with hardware fades.
+ *
+ * `post()` may be called by one task at a time; `apply()` by one task, normally a scheduler job.
+ */
+class Actuators {
+    public:
+        Actuators(LedControl &led, BLDC &motor);
+
+        /**
+         * @brief Installs the fade service and records the state the hardware is in.
+         *
+         * @param initial Colors and duty cycle the LED and motor were set to.
+         */
+        void begin(const ActuatorCommand &initial);
+
+        /**
+         * @brief Posts the wanted state of every actuator; replaces any state not applied yet. Never blocks.
+         */
+        void post(const ActuatorCommand &targets);
+
+        /**
+         * @brief Starts the fades that take the hardware to the newest posted state.
+         *
+         * @param now `millis()` time.
+         * @return Milliseconds until a running fade ends and a change waiting for it can start,
+         *         or 0 if the hardware has every posted value.
+         */
+        uint32_t apply(uint32_t now);
+
+        uint32_t posts() const { return postCount; }    ///< States posted.
+        uint32_t writes() const { return writeCount; }  ///< Fades started (LED and motor counted apart).
+
+    private:
+        LedControl &led;
+        BLDC &motor;
+        SeqLock<ActuatorCommand> mailbox;
+        ActuatorCommand current;    ///< State the hardware is in or fading to
+        uint32_t ledDoneAt;         ///< `millis()` when the LED fade ends
+        uint32_t motorDoneAt;       ///< `millis()` when the motor ramp ends
+        uint32_t postCount;
+        uint32_t writeCount;
+};
+
+#endif // !ACTUATORS_H
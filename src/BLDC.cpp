@@ -7,6 +7,8 @@
  */
 
 #include "BLDC.h"
+#include "DeferredLog.h"
+#include "LedcFade.h"
 
 /**
  * @brief Constructs a BLDC object and initializes the PWM channel.
@@ -40,5 +42,10 @@ void BLDC::motor_init(){
 
 void BLDC::speedcontrol(uint16_t motorspeed) {
     ledcWrite(PWMChannel, motorspeed);   ///< Write the speed value to the PWM channel to control the motor speed.
-    Serial.println("Motor speed changed"); ///< Print a message to the serial monitor indicating that the motor speed has been changed.
+    LOG(MOTOR_SPEED_CHANGED, motorspeed); ///< Log a message indicating that the motor speed has been changed.
+}
+
+void BLDC::ramp(uint16_t motorspeed, uint32_t ms) {
+    ledcFadeTo(PWMChannel, motorspeed, ms); ///< The LEDC peripheral steps the duty to the target.
+    LOG(MOTOR_SPEED_CHANGED, motorspeed);
 }
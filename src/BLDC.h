@@ -48,6 +48,14 @@ public:
      */
     void speedcontrol(uint16_t motorspeed);
 
+    /**
+     * @brief Ramps the motor to a speed with the LEDC fade engine and returns at once.
+     * 
+     * @param motorspeed The target PWM duty cycle.
+     * @param ms Ramp time; no other ramp may be started before it has passed.
+     */
+    void ramp(uint16_t motorspeed, uint32_t ms);
+
 private:
     /** @brief PWM frequency for motor control in Hz. */
     const int PWMFreq = 20000;  ///< 20 kHz frequency.
@@ -1,18 +1,53 @@
 #include "BLE.h"
 #include <Arduino.h>
+#include <BLE2902.h>
+
+#include <atomic>
+
+#include <DeferredLog.h>
+
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+#define STREAM_CHARACTERISTIC_UUID "beb5483f-36e1-4688-b7f5-ea07361b26a8"
 
 BLECharacteristic *pCharacteristic;
+BLECharacteristic *pStreamCharacteristic;   ///< Notifies the sensor stream
+BLE2902 *pStreamCccd;                       ///< Where the client enables the stream's notifications
 bool deviceConnected = false;
-bool newData = false;
-const char* receivedData = "";
+
+namespace {
+
+BleReassembler reassembler;     ///< Messages written by the client, owned here
+std::atomic<uint16_t> peerMtu(BLE_DEFAULT_MTU);
+
+/**
+ * @brief The stream characteristic behind the `GattLink` interface.
+ */
+class StreamLink : public GattLink {
+    public:
+        uint16_t mtu() const override { return peerMtu.load(std::memory_order_relaxed); }
+
+        bool subscribed() const override {
+            return deviceConnected && pStreamCccd != nullptr && pStreamCccd->getNotifications();
+        }
+
+        bool notify(const uint8_t *data, size_t length) override {
+            pStreamCharacteristic->setValue((uint8_t *)data, length);
+            pStreamCharacteristic->notify();
+            return true;
+        }
+};
+
+StreamLink streamLink;
+
+} // namespace
 
 void setupBLE() {
     // Initialize BLE
     BLEDevice::init("ISAAC");   // BLE device created
+    BLEDevice::setMTU(BLE_MTU); // Offered to the client in the MTU exchange
     BLEServer *pServer = BLEDevice::createServer();   // BLE Server created
-    
+
     // Set a callback function to handle events triggered on the BLE Server
     pServer->setCallbacks(new MyServerCallbacks());
 
@@ -20,13 +55,22 @@ void setupBLE() {
     pCharacteristic = pService->createCharacteristic(
                         CHARACTERISTIC_UUID,
                         BLECharacteristic::PROPERTY_READ |
-                        BLECharacteristic::PROPERTY_WRITE
+                        BLECharacteristic::PROPERTY_WRITE |
+                        BLECharacteristic::PROPERTY_WRITE_NR
                       );
 
     // Assign a callback function to handle events related to BLE Characteristic
     pCharacteristic->setCallbacks(new MyCallbacks());
     pCharacteristic->setValue("Hello World");
 
+    // Sensor stream: the client subscribes through the CCCD
+    pStreamCharacteristic = pService->createCharacteristic(
+                              STREAM_CHARACTERISTIC_UUID,
+                              BLECharacteristic::PROPERTY_NOTIFY
+                            );
+    pStreamCccd = new BLE2902();
+    pStreamCharacteristic->addDescriptor(pStreamCccd);
+
     pService->start();
 
     // Manage advertising settings of BLE device
@@ -34,22 +78,51 @@ void setupBLE() {
     pAdvertising->addServiceUUID(SERVICE_UUID);
     pAdvertising->setScanResponse(true);
 
-    // Sets the advertising interval in hexadecimal format
-    pAdvertising->setMinPreferred(0x06);  // 3.75 ms
-    pAdvertising->setMinPreferred(0x12);  // 11.25 ms
+    // Preferred connection interval range, advertised in the scan response
+    pAdvertising->setMinPreferred(BLE_CONN_MIN_INTERVAL);
+    pAdvertising->setMaxPreferred(BLE_CONN_MAX_INTERVAL);
     BLEDevice::startAdvertising();
 }
 
-void MyServerCallbacks::onConnect(BLEServer* pServer) {
+size_t takeBleMessage(char *out, size_t capacity) {
+    if (capacity == 0) {
+        return 0;
+    }
+    size_t length = reassembler.take((uint8_t *)out, capacity - 1);
+    out[length] = '\0';
+    return length;
+}
+
+GattLink &bleStreamLink() {
+    return streamLink;
+}
+
+void MyServerCallbacks::onConnect(BLEServer* /*pServer*/) {
+    peerMtu.store(BLE_DEFAULT_MTU, std::memory_order_relaxed);
     deviceConnected = true;
 }
 
-void MyServerCallbacks::onDisconnect(BLEServer* pServer) {
+void MyServerCallbacks::onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
+    pServer->updateConnParams(param->connect.remote_bda, BLE_CONN_MIN_INTERVAL, BLE_CONN_MAX_INTERVAL,
+                              BLE_CONN_LATENCY, BLE_CONN_TIMEOUT);
+}
+
+void MyServerCallbacks::onDisconnect(BLEServer* /*pServer*/) {
     deviceConnected = false;
+    peerMtu.store(BLE_DEFAULT_MTU, std::memory_order_relaxed);
+    BLEDevice::startAdvertising();
+}
+
+void MyServerCallbacks::onMtuChanged(BLEServer* /*pServer*/, esp_ble_gatts_cb_param_t *param) {
+    peerMtu.store(param->mtu.mtu, std::memory_order_relaxed);
+    LOG(BLE_MTU_CHANGED, param->mtu.mtu, bleRecordsPerNotification(param->mtu.mtu));
 }
 
 void MyCallbacks::onWrite(BLECharacteristic *pCharacteristic) {
-    receivedData = pCharacteristic->getValue().c_str(); // Convert to const char*
-    Serial.println(receivedData);
-    newData = true;
+    // The stack's value is copied into the reassembler's own buffer before this returns
+    std::string chunk = pCharacteristic->getValue();
+    BleReassembler::Result result = reassembler.write((const uint8_t *)chunk.data(), chunk.length());
+    if (result == BleReassembler::BLE_CHUNK_DROPPED) {
+        LOG(BLE_CHUNK_DROPPED, reassembler.dropped());
+    }
 }
@@ -1,10 +1,15 @@
 /**
  * @file BLE.h
  * @brief Header file for BLE functionality.
- * 
+ *
  * This header file declares the BLE-related functions and classes used for Bluetooth
  * Low Energy (BLE) communication. It includes external variables, function declarations,
  * and class definitions for BLE server and characteristic callbacks.
+ *
+ * The server has two characteristics: one the client writes messages to, in chunks that are
+ * reassembled on the device, and one that notifies the sensor stream. The largest ATT MTU and a
+ * short connection interval are negotiated on every connection, so a notification carries many
+ * snapshots and the link sends them without waiting for the next connection event.
  */
 
 #ifndef BLE_H
@@ -13,75 +18,116 @@
 #include <BLEDevice.h>
 #include <BLEServer.h>
 
+#include <BleStream.h>
+
+/** @brief ATT MTU offered to the central: a notification of 244 bytes fits one data-length-extended packet. */
+#define BLE_MTU 247
+
+/**
+ * @brief Connection parameters asked of the central on connection.
+ *
+ * Intervals are in 1.25 ms units and the supervision timeout in 10 ms units. 15-30 ms with no
+ * slave latency is within what both Android and iOS grant to an accessory.
+ */
+#define BLE_CONN_MIN_INTERVAL 12   ///< 15 ms
+#define BLE_CONN_MAX_INTERVAL 24   ///< 30 ms
+#define BLE_CONN_LATENCY 0
+#define BLE_CONN_TIMEOUT 400       ///< 4 s
+
 /**
  * @brief Indicates whether a BLE device is connected.
- * 
+ *
  * This external variable is set to `true` when a BLE device is connected and `false` otherwise.
  */
 extern bool deviceConnected;
 
 /**
- * @brief Indicates whether new data has been received via BLE.
- * 
- * This external variable is set to `true` when new data is received from a BLE client.
+ * @brief Initializes BLE functionality.
+ *
+ * This function sets up BLE, including configuring services, characteristics, and starting
+ * the BLE server.
  */
-extern bool newData;
+void setupBLE();
 
 /**
- * @brief Contains the received data from a BLE client.
- * 
- * This external variable holds the data received from a BLE client as a C-style string.
+ * @brief Copies out the last message received from a BLE client.
+ *
+ * The message is reassembled from the client's chunked writes into a buffer owned by this module,
+ * and copied into `out` NUL terminated, so it stays valid for as long as the caller needs it.
+ *
+ * @param out Destination of the message.
+ * @param capacity Size of `out`, including the terminating NUL.
+ * @return Message length, or 0 if no new message was received.
  */
-extern const char* receivedData;
+size_t takeBleMessage(char *out, size_t capacity);
 
 /**
- * @brief Initializes BLE functionality.
- * 
- * This function sets up BLE, including configuring services, characteristics, and starting
- * the BLE server.
+ * @brief Returns the notify characteristic, as the link the sensor stream is sent through.
+ *
+ * It is only subscribed while a client is connected and has enabled notifications.
  */
-void setupBLE();
+GattLink &bleStreamLink();
 
 /**
  * @class MyServerCallbacks
  * @brief Callback class for handling BLE server events.
- * 
+ *
  * This class derives from `BLEServerCallbacks` and provides methods to handle BLE
  * server connection and disconnection events.
  */
 class MyServerCallbacks: public BLEServerCallbacks {
     /**
      * @brief Called when a BLE device connects to the server.
-     * 
+     *
      * This method is invoked when a BLE client establishes a connection with the BLE server.
-     * 
+     *
      * @param pServer Pointer to the BLE server instance.
      */
     void onConnect(BLEServer* pServer);
 
+    /**
+     * @brief Called with the connection's parameters when a BLE device connects.
+     *
+     * Asks the client for the `BLE_CONN_*` connection parameters.
+     *
+     * @param pServer Pointer to the BLE server instance.
+     * @param param Connection event parameters.
+     */
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param);
+
     /**
      * @brief Called when a BLE device disconnects from the server.
-     * 
-     * This method is invoked when a BLE client disconnects from the BLE server.
-     * 
+     *
+     * This method is invoked when a BLE client disconnects from the BLE server. Advertising
+     * restarts, so the client can connect again.
+     *
      * @param pServer Pointer to the BLE server instance.
      */
     void onDisconnect(BLEServer* pServer);
+
+    /**
+     * @brief Called when the client and the server have exchanged their MTUs.
+     *
+     * @param pServer Pointer to the BLE server instance.
+     * @param param MTU event parameters, with the negotiated MTU.
+     */
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t *param);
 };
 
 /**
  * @class MyCallbacks
  * @brief Callback class for handling BLE characteristic events.
- * 
+ *
  * This class derives from `BLECharacteristicCallbacks` and provides a method to handle
  * write events on BLE characteristics.
  */
 class MyCallbacks: public BLECharacteristicCallbacks {
     /**
      * @brief Called when a BLE client writes to a characteristic.
-     * 
+     *
      * This method is invoked when a BLE client writes data to a characteristic on the server.
-     * 
+     * The write is one chunk of a message (see BleStream.h).
+     *
      * @param pCharacteristic Pointer to the BLE characteristic that was written to.
      */
     void onWrite(BLECharacteristic *pCharacteristic);
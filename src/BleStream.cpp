@@ -0,0 +1,117 @@
+/**
+ * @file BleStream.cpp
+ * @brief Implementation of the BLE message reassembly and snapshot notifications.
+ */
+
+#include "BleStream.h"
+
+#include <string.h>
+
+#include <ReadingPayload.h>
+
+namespace {
+
+void putU32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static_assert(BLE_RECORD_SIZE == 4 + SNAPSHOT_SIZE, "A BLE record is a time and a snapshot");
+
+} // namespace
+
+uint8_t bleRecordsPerNotification(uint16_t mtu) {
+    int room = (int)mtu - BLE_ATT_OVERHEAD - BLE_NOTIFY_HEADER;
+    int records = room / BLE_RECORD_SIZE;
+    if (records < 1) return 1;
+    return records > BLE_STREAM_RECORDS ? BLE_STREAM_RECORDS : (uint8_t)records;
+}
+
+BleReassembler::BleReassembler() : length(0), nextIndex(0), sequence(0), assembling(false), complete(false), drops(0) {}
+
+BleReassembler::Result BleReassembler::write(const uint8_t *chunk, size_t chunkLength) {
+    if (chunkLength < 1 || complete.load(std::memory_order_acquire)) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return BLE_CHUNK_DROPPED;
+    }
+    uint8_t index = chunk[0] & BLE_CHUNK_INDEX;
+    if (index == 0) {
+        // A first chunk always starts over, whatever was in progress
+        length = 0;
+        sequence = chunk[0] & BLE_CHUNK_SEQUENCE;
+        assembling = true;
+    } else if (!assembling || index != nextIndex || (chunk[0] & BLE_CHUNK_SEQUENCE) != sequence) {
+        assembling = false;
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return BLE_CHUNK_DROPPED;
+    }
+
+    size_t data = chunkLength - 1;
+    if (length + data > sizeof(buffer)) {
+        assembling = false;
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return BLE_CHUNK_DROPPED;
+    }
+    memcpy(buffer + length, chunk + 1, data);
+    length += data;
+    nextIndex = (uint8_t)(index + 1);  // 32 after the last index: no chunk can follow
+
+    if (!(chunk[0] & BLE_CHUNK_FINAL)) {
+        return BLE_CHUNK_ACCEPTED;
+    }
+    assembling = false;
+    complete.store(true, std::memory_order_release);
+    return BLE_MESSAGE_COMPLETE;
+}
+
+size_t BleReassembler::take(uint8_t *out, size_t capacity) {
+    if (!complete.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    size_t n = length < capacity ? length : capacity;
+    memcpy(out, buffer, n);
+    complete.store(false, std::memory_order_release);
+    return n;
+}
+
+BleNotifier::BleNotifier() : head(0), count(0), sentRecords(0), drops(0) {}
+
+void BleNotifier::push(uint32_t time, const SensorData &data) {
+    if (count == BLE_STREAM_RECORDS) {
+        head = (head + 1) % BLE_STREAM_RECORDS;
+        count--;
+        drops++;
+    }
+    uint8_t *record = records[(head + count) % BLE_STREAM_RECORDS];
+    putU32(record, time);
+    encodeSnapshot(data, record + 4);
+    count++;
+}
+
+uint32_t BleNotifier::flush(GattLink &link, uint8_t batch) {
+    uint8_t fit = bleRecordsPerNotification(link.mtu());
+    if (batch < 1) batch = 1;
+    if (batch > fit) batch = fit;
+
+    uint32_t notifications = 0;
+    uint8_t value[BLE_NOTIFY_HEADER + BLE_STREAM_RECORDS * BLE_RECORD_SIZE];
+    while (count >= batch) {
+        uint8_t n = count < fit ? (uint8_t)count : fit;
+        value[0] = BLE_NOTIFY_VERSION;
+        value[1] = n;
+        for (uint8_t i = 0; i < n; i++) {
+            memcpy(value + BLE_NOTIFY_HEADER + i * BLE_RECORD_SIZE, records[(head + i) % BLE_STREAM_RECORDS],
+                   BLE_RECORD_SIZE);
+        }
+        if (!link.notify(value, BLE_NOTIFY_HEADER + n * BLE_RECORD_SIZE)) {
+            break;  // Kept for the next flush
+        }
+        head = (head + n) % BLE_STREAM_RECORDS;
+        count -= n;
+        sentRecords += n;
+        notifications++;
+    }
+    return notifications;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file BleStream.h
+ * @brief BLE message reassembly and batched sensor notifications, independent of the BLE stack.
+ *
+ * A central writes a message longer than one ATT write as chunks, each with a one-byte header:
+ *
+ *     | final (bit 7) | sequence (bits 5-6) | index (bits 0-4) | data |
+ *
+ * Chunk indexes count from 0, so a message has at most 32 chunks, at least 8 data bytes each for
+ * the longest message. The central counts the sequence up from one message to the next and
+ * keeps it for all chunks of a message. `BleReassembler`
+ * copies the chunks into a buffer of its own and hands the message over once its final chunk
+ * arrived; a chunk out of order, or of another message, drops the message being reassembled.
+ *
+ * Sensor snapshots are streamed to a subscribed central as notifications carrying as many
+ * records as the negotiated ATT MTU allows:
+ *
+ *     | version (1) | count (1) | count records |
+ *     record: | time ms u32 | PM2.5 u16 | temperature i16 | humidity i16 | CO ppm i16 |
+ *
+ * After the time comes the snapshot of ReadingPayload.h (temperature and humidity in hundredths),
+ * little-endian. The BLE stack is only reached through `GattLink`, so a host program can play
+ * the central (see tools/blebench.cpp).
+ */
+
+#ifndef BLE_STREAM_H
+#define BLE_STREAM_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SensorSnapshot.h>
+
+/** @brief Largest reassembled message. */
+#define BLE_MAX_MESSAGE 256
+
+/** @brief Chunk header bit marking the last chunk of a message. */
+#define BLE_CHUNK_FINAL 0x80
+
+/** @brief Chunk header bits holding the message sequence, telling consecutive messages apart. */
+#define BLE_CHUNK_SEQUENCE 0x60
+
+/** @brief Chunk header bits holding the chunk index. */
+#define BLE_CHUNK_INDEX 0x1F
+
+/** @brief Version byte of every notification. */
+#define BLE_NOTIFY_VERSION 1
+
+/** @brief Notification header: version and record count. */
+#define BLE_NOTIFY_HEADER 2
+
+/** @brief Size of one snapshot record. */
+#define BLE_RECORD_SIZE 12
+
+/** @brief ATT opcode and handle, sent in front of every notification value. */
+#define BLE_ATT_OVERHEAD 3
+
+/** @brief ATT MTU before any exchange. */
+#define BLE_DEFAULT_MTU 23
+
+/** @brief Records queued while the link is busy; the oldest are dropped beyond this. */
+#ifndef BLE_STREAM_RECORDS
+#define BLE_STREAM_RECORDS 48
+#endif
+
+/**
+ * @class GattLink
+ * @brief What the stream needs from a GATT server: the MTU and a notify characteristic.
+ */
+class GattLink {
+    public:
+        virtual ~GattLink() {}
+
+        /** @brief Negotiated ATT MTU. */
+        virtual uint16_t mtu() const = 0;
+
+        /** @brief True while a central is connected and has enabled notifications. */
+        virtual bool subscribed() const = 0;
+
+        /**
+         * @brief Sends one notification of at most `mtu() - BLE_ATT_OVERHEAD` bytes.
+         *
+         * @return false if the stack has no buffer for it; the caller tries again later.
+         */
+        virtual bool notify(const uint8_t *data, size_t length) = 0;
+};
+
+/**
+ * @brief Records a notification of `mtu` can carry, at least 1.
+ */
+uint8_t bleRecordsPerNotification(uint16_t mtu);
+
+/**
+ * @class BleReassembler
+ * @brief Joins chunked writes into whole messages in an owned buffer.
+ *
+ * `write()` is called from the BLE stack's task and `take()` from the consumer's; the buffer
+ * is handed over between them without a lock. Chunks arriving while a complete message waits
+ * to be taken are dropped.
+ */
+class BleReassembler {
+    public:
+        /** @brief What a chunk did. */
+        enum Result {
+            BLE_CHUNK_ACCEPTED,     ///< Added to the message in progress.
+            BLE_MESSAGE_COMPLETE,   ///< Completed a message, see `take()`.
+            BLE_CHUNK_DROPPED,      ///< Out of order, too long, or the previous message was not taken yet.
+        };
+
+        BleReassembler();
+
+        /** @brief Adds a chunk (header byte and data). */
+        Result write(const uint8_t *chunk, size_t length);
+
+        /**
+         * @brief Copies out the complete message, if any, and frees the buffer for the next one.
+         *
+         * @return Message length, or 0 if no message is complete. A longer message is truncated to `capacity`.
+         */
+        size_t take(uint8_t *out, size_t capacity);
+
+        /** @brief Chunks dropped since start. */
+        uint32_t dropped() const { return drops.load(std::memory_order_relaxed); }
+
+    private:
+        uint8_t buffer[BLE_MAX_MESSAGE];
+        size_t length;
+        uint8_t nextIndex;                  ///< Index the next chunk must have.
+        uint8_t sequence;                   ///< Sequence bits of the message in progress.
+        bool assembling;                    ///< A message is in progress.
+        std::atomic<bool> complete;         ///< The buffer holds a message for `take()`.
+        std::atomic<uint32_t> drops;
+};
+
+/**
+ * @class BleNotifier
+ * @brief Queue of snapshot records sent as MTU-sized notifications. Used from one task.
+ */
+class BleNotifier {
+    public:
+        BleNotifier();
+
+        /** @brief Queues a snapshot taken at `time`; drops the oldest record when the queue is full. */
+        void push(uint32_t time, const SensorData &data);
+
+        /**
+         * @brief Sends the queued records while a notification can carry `batch` of them.
+         *
+         * @param link The GATT server.
+         * @param batch Records to wait for before notifying, capped to what one notification carries.
+         * @return Notifications sent.
+         */
+        uint32_t flush(GattLink &link, uint8_t batch);
+
+        /** @brief Drops every queued record. */
+        void clear() { head = 0; count = 0; }
+
+        uint32_t pending() const { return count; }      ///< Records queued.
+        uint32_t sent() const { return sentRecords; }   ///< Records notified since start.
+        uint32_t dropped() const { return drops; }      ///< Records dropped from a full queue since start.
+
+    private:
+        uint8_t records[BLE_STREAM_RECORDS][BLE_RECORD_SIZE];
+        uint32_t head;      ///< Oldest record.
+        uint32_t count;
+        uint32_t sentRecords;
+        uint32_t drops;
+};
+
+#endif // !BLE_STREAM_H
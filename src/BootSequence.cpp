@@ -0,0 +1,48 @@
+/**
+ * @file BootSequence.cpp
+ * @brief Implementation of the boot readiness states.
+ */
+
+#include "BootSequence.h"
+
+BootSequence::BootSequence() : linksTime(0) {
+    for (uint8_t i = 0; i < BOOT_CHANNEL_COUNT; i++) {
+        channels[i] = {CHANNEL_OFF, 0, 0};
+    }
+}
+
+void BootSequence::warmUp(BootChannel channel, uint32_t now, uint32_t warmUpMs) {
+    Channel &c = channels[channel];
+    c.readyAt = now + warmUpMs;
+    c.state = warmUpMs == 0 ? CHANNEL_READY : CHANNEL_WARMING;
+    if (c.firstSample != 0 && c.state == CHANNEL_READY) {
+        c.state = CHANNEL_STREAMING;
+    }
+}
+
+bool BootSequence::ready(BootChannel channel, uint32_t now) {
+    Channel &c = channels[channel];
+    if (c.state == CHANNEL_WARMING && (int32_t)(now - c.readyAt) >= 0) {
+        c.state = c.firstSample != 0 ? CHANNEL_STREAMING : CHANNEL_READY;
+    }
+    return c.state >= CHANNEL_READY;
+}
+
+bool BootSequence::published(BootChannel channel, uint32_t now) {
+    Channel &c = channels[channel];
+    c.state = CHANNEL_STREAMING;
+    if (c.firstSample != 0) {
+        return false;
+    }
+    c.firstSample = now != 0 ? now : 1;
+    return true;
+}
+
+bool BootSequence::complete() const {
+    for (uint8_t i = 0; i < BOOT_CHANNEL_COUNT; i++) {
+        if (channels[i].firstSample == 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file BootSequence.h
+ * @brief Readiness of each sensor channel during boot and the time to its first sample.
+ *
+ * Boot no longer waits for the slowest sensor. The links and actuators come up first, then each
+ * sensor channel goes through its own states while the scheduler runs:
+ *
+ *     CHANNEL_WARMING --(warm-up time elapsed)--> CHANNEL_READY --(first sample published)--> CHANNEL_STREAMING
+ *
+ * A warming channel's samples are discarded (the PMS5003's fan has not reached a stable flow
+ * yet); a ready channel publishes and is streamed on its own, without waiting for the others.
+ * The time of each transition is kept from reset (`millis()`) for the boot trace.
+ */
+
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Sensor channels followed through boot.
+ */
+enum BootChannel : uint8_t {
+    BOOT_DHT11 = 0,
+    BOOT_PMS5003,
+    BOOT_MQ7,
+    BOOT_CHANNEL_COUNT,
+};
+
+/**
+ * @brief Readiness of a channel.
+ */
+enum ChannelState : uint8_t {
+    CHANNEL_OFF = 0,        ///< Not started.
+    CHANNEL_WARMING,        ///< Started; samples are not valid yet.
+    CHANNEL_READY,          ///< Samples are valid; none published yet.
+    CHANNEL_STREAMING,      ///< At least one sample published.
+};
+
+/**
+ * @class BootSequence
+ * @brief Per-channel readiness states and the boot trace. Used from the scheduler's task only.
+ */
+class BootSequence {
+    public:
+        BootSequence();
+
+        /** @brief Records that the links and actuators are up. */
+        void linksUp(uint32_t now) { linksTime = now; }
+
+        /** @brief `millis()` when the links and actuators came up. */
+        uint32_t linksUpTime() const { return linksTime; }
+
+        /**
+         * @brief Starts a channel's warm-up; its samples become valid `warmUpMs` after `now`.
+         *
+         * Also used when a sensor is woken again later. A streaming channel keeps its first sample time.
+         */
+        void warmUp(BootChannel channel, uint32_t now, uint32_t warmUpMs);
+
+        /**
+         * @brief Returns true if a channel's samples are valid at `now`, ending its warm-up when it has elapsed.
+         */
+        bool ready(BootChannel channel, uint32_t now);
+
+        /**
+         * @brief Records that a channel published a sample.
+         *
+         * @return true for the channel's first sample since boot.
+         */
+        bool published(BootChannel channel, uint32_t now);
+
+        ChannelState state(BootChannel channel) const { return channels[channel].state; }  ///< State of a channel.
+
+        /** @brief `millis()` of a channel's first published sample, 0 before it. */
+        uint32_t firstSampleTime(BootChannel channel) const { return channels[channel].firstSample; }
+
+        /** @brief Returns true once every channel has published. */
+        bool complete() const;
+
+    private:
+        struct Channel {
+            ChannelState state;
+            uint32_t readyAt;       ///< `millis()` when the warm-up ends
+            uint32_t firstSample;   ///< `millis()` of the first published sample, 0 before it
+        };
+
+        Channel channels[BOOT_CHANNEL_COUNT];
+        uint32_t linksTime;
+};
+
+#endif // !BOOT_SEQUENCE_H
@@ -0,0 +1,269 @@
+/**
+ * @file CommandParser.cpp
+ * @brief Implementation of the incremental actuator command parser.
+ */
+
+#include "CommandParser.h"
+
+#include <string.h>
+
+namespace {
+
+/** @brief Recognised keys, in `CommandField` bit order. */
+const char *const kKeys[] = {"RED", "GREEN", "BLUE", "DutyCycle"};
+const int kKeyCount = sizeof(kKeys) / sizeof(kKeys[0]);
+
+bool isSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isDigit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+} // namespace
+
+CommandParser::CommandParser(bool lineMode) : crcErrors(0), syntaxErrors(0), lineMode(lineMode) {
+    memset(&current, 0, sizeof(current));
+    reset();
+}
+
+void CommandParser::reset() {
+    state = IDLE;
+    negative = false;
+    fraction = false;
+    keyEscape = false;
+    field = -1;
+    keyLength = 0;
+    nesting = 0;
+    number = 0;
+    receivedCrc = 0;
+    crcDigits = 0;
+    crc.reset();
+    memset(&pending, 0, sizeof(pending));
+}
+
+CommandParser::Result CommandParser::fail(bool crcFailure, uint8_t byte) {
+    if (crcFailure) {
+        crcErrors++;
+    } else {
+        syntaxErrors++;
+    }
+    bool atLineEnd = byte == '\n';
+    reset();
+    if (lineMode && !atLineEnd) {
+        state = SKIP_LINE;
+    }
+    return PARSE_ERROR;
+}
+
+CommandParser::Result CommandParser::closeObject() {
+    if (lineMode) {
+        state = CRC;
+        return PARSE_PENDING;
+    }
+    current = pending;
+    reset();
+    return PARSE_COMMAND;
+}
+
+void CommandParser::storeValue() {
+    if (field < 0) {
+        return;
+    }
+    uint32_t value = negative ? 0 : number;
+    switch (1 << field) {
+        case COMMAND_RED:   pending.red = value <= 0xFF ? (uint8_t)value : 0; break;
+        case COMMAND_GREEN: pending.green = value <= 0xFF ? (uint8_t)value : 0; break;
+        case COMMAND_BLUE:  pending.blue = value <= 0xFF ? (uint8_t)value : 0; break;
+        case COMMAND_DUTY:  pending.dutyCycle = value <= 0xFFFF ? (uint16_t)value : 0; break;
+    }
+    pending.present |= (uint8_t)(1 << field);
+}
+
+CommandParser::Result CommandParser::feed(uint8_t byte) {
+    switch (state) {
+        case IDLE:
+            if (byte == '{') {
+                reset();
+                if (lineMode) crc.update(byte);
+                state = KEY_OR_END;
+            }
+            return PARSE_PENDING;
+
+        case SKIP_LINE:
+            if (byte == '\n') {
+                state = IDLE;
+            }
+            return PARSE_PENDING;
+
+        case CRC:
+            if (isDigit(byte) && crcDigits < 10) {
+                receivedCrc = receivedCrc * 10 + (byte - '0');
+                crcDigits++;
+                return PARSE_PENDING;
+            }
+            if (byte == '\r') {
+                return PARSE_PENDING;
+            }
+            if (byte == '\n' && crcDigits > 0 && receivedCrc == crc.value()) {
+                current = pending;
+                reset();
+                return PARSE_COMMAND;
+            }
+            return fail(byte == '\n', byte);
+
+        default:
+            break;
+    }
+
+    // Inside the object.
+    if (lineMode) {
+        if (byte == '\n') {
+            return fail(false, byte);
+        }
+        crc.update(byte);
+    }
+
+    switch (state) {
+        case KEY_OR_END:
+            if (isSpace(byte)) return PARSE_PENDING;
+            if (byte == '"') {
+                keyLength = 0;
+                keyEscape = false;
+                state = KEY;
+                return PARSE_PENDING;
+            }
+            if (byte == '}') return closeObject();
+            return fail(false, byte);
+
+        case KEY:
+            if (!keyEscape && byte == '\\') {
+                keyEscape = true;
+                return PARSE_PENDING;
+            }
+            if (!keyEscape && byte == '"') {
+                field = -1;
+                if (keyLength < sizeof(key)) {
+                    for (int i = 0; i < kKeyCount; i++) {
+                        if (strlen(kKeys[i]) == keyLength && memcmp(kKeys[i], key, keyLength) == 0) {
+                            field = (int8_t)i;
+                        }
+                    }
+                }
+                state = COLON;
+                return PARSE_PENDING;
+            }
+            keyEscape = false;
+            if (keyLength < sizeof(key)) {
+                key[keyLength] = (char)byte;
+                keyLength++;    // A key of sizeof(key) characters or more is never recognised.
+            }
+            return PARSE_PENDING;
+
+        case COLON:
+            if (isSpace(byte)) return PARSE_PENDING;
+            if (byte == ':') {
+                state = VALUE;
+                return PARSE_PENDING;
+            }
+            return fail(false, byte);
+
+        case VALUE:
+            if (isSpace(byte)) return PARSE_PENDING;
+            negative = false;
+            fraction = false;
+            number = 0;
+            if (byte == '-' || isDigit(byte)) {
+                negative = byte == '-';
+                number = negative ? 0 : (uint32_t)(byte - '0');
+                state = NUMBER;
+            } else if (byte == '"') {
+                state = STRING_VALUE;
+            } else if (byte == '{' || byte == '[') {
+                nesting = 1;
+                state = NESTED;
+            } else if (byte == 't' || byte == 'f' || byte == 'n') {
+                state = LITERAL;
+            } else {
+                return fail(false, byte);
+            }
+            return PARSE_PENDING;
+
+        case NUMBER:
+            if (isDigit(byte)) {
+                if (!fraction) {
+                    number = number > 0x0FFFFFFF ? 0xFFFFFFFF : number * 10 + (byte - '0');
+                }
+                return PARSE_PENDING;
+            }
+            if (byte == '.' || byte == 'e' || byte == 'E' || (fraction && (byte == '+' || byte == '-'))) {
+                fraction = true;    // Fractions are truncated, like as<int>() did.
+                return PARSE_PENDING;
+            }
+            storeValue();
+            state = COMMA_OR_END;
+            return feedSeparator(byte);
+
+        case LITERAL:
+            if (byte >= 'a' && byte <= 'z') return PARSE_PENDING;
+            state = COMMA_OR_END;
+            return feedSeparator(byte);
+
+        case STRING_VALUE:
+            if (byte == '\\') state = STRING_ESCAPE;
+            else if (byte == '"') state = COMMA_OR_END;
+            return PARSE_PENDING;
+
+        case STRING_ESCAPE:
+            state = STRING_VALUE;
+            return PARSE_PENDING;
+
+        case NESTED:
+            if (byte == '"') {
+                state = NESTED_STRING;
+            } else if (byte == '{' || byte == '[') {
+                if (++nesting == 0) return fail(false, byte);
+            } else if (byte == '}' || byte == ']') {
+                if (--nesting == 0) state = COMMA_OR_END;
+            }
+            return PARSE_PENDING;
+
+        case NESTED_STRING:
+            if (byte == '\\') state = NESTED_ESCAPE;
+            else if (byte == '"') state = NESTED;
+            return PARSE_PENDING;
+
+        case NESTED_ESCAPE:
+            state = NESTED_STRING;
+            return PARSE_PENDING;
+
+        case COMMA_OR_END:
+            return feedSeparator(byte);
+
+        default:
+            return fail(false, byte);
+    }
+}
+
+CommandParser::Result CommandParser::feedSeparator(uint8_t byte) {
+    if (isSpace(byte)) return PARSE_PENDING;
+    if (byte == ',') {
+        state = KEY_OR_END;
+        return PARSE_PENDING;
+    }
+    if (byte == '}') return closeObject();
+    return fail(false, byte);
+}
+
+bool CommandParser::parse(const uint8_t *data, size_t length) {
+    reset();
+    for (size_t i = 0; i < length; i++) {
+        Result result = feed(data[i]);
+        if (result == PARSE_COMMAND) return true;
+        if (result == PARSE_ERROR) return false;
+    }
+    syntaxErrors++;
+    reset();
+    return false;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file CommandParser.h
+ * @brief Incremental parser for actuator commands received from the cloud-ESP.
+ *
+ * Commands are flat JSON objects such as `{"RED":255,"GREEN":0,"BLUE":0,"DutyCycle":512}`.
+ * The parser consumes one byte at a time, keeps no copy of the text and extracts the known
+ * keys as integers; unknown keys and nested values are skipped.
+ *
+ * In line mode (legacy link) the object is followed by its CRC32 in decimal and a '\n'. The
+ * CRC is computed while the object streams in and is checked when the newline arrives.
+ * In document mode (payload of a `FRAME_COMMAND` frame) the command is complete at the
+ * closing brace.
+ */
+
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <StreamCrc32.h>
+
+/**
+ * @brief Bits of `ActuatorCommand::present`, one per recognised key.
+ */
+enum CommandField : uint8_t {
+    COMMAND_RED = 1 << 0,   ///< "RED"
+    COMMAND_GREEN = 1 << 1, ///< "GREEN"
+    COMMAND_BLUE = 1 << 2,  ///< "BLUE"
+    COMMAND_DUTY = 1 << 3,  ///< "DutyCycle"
+};
+
+/**
+ * @struct ActuatorCommand
+ * @brief Values carried by one command. Fields whose bit is not set in `present` are 0.
+ */
+struct ActuatorCommand {
+    uint8_t red;        ///< Red LED intensity (0-255).
+    uint8_t green;      ///< Green LED intensity (0-255).
+    uint8_t blue;       ///< Blue LED intensity (0-255).
+    uint16_t dutyCycle; ///< Motor PWM duty cycle.
+    uint8_t present;    ///< `CommandField` bits of the keys found in the command.
+};
+
+/**
+ * @class CommandParser
+ * @brief Byte-at-a-time JSON command state machine.
+ */
+class CommandParser {
+    public:
+        /**
+         * @brief Result of feeding one byte.
+         */
+        enum Result {
+            PARSE_PENDING, ///< More bytes are needed.
+            PARSE_COMMAND, ///< A complete, valid command is available through `command()`.
+            PARSE_ERROR,   ///< The command was malformed or failed its CRC and was discarded.
+        };
+
+        /**
+         * @brief Constructs a parser.
+         *
+         * @param lineMode true for the legacy line format (object, decimal CRC32, '\n'),
+         *                 false for a bare JSON object.
+         */
+        explicit CommandParser(bool lineMode);
+
+        /** @brief Discards any partially parsed command. */
+        void reset();
+
+        /**
+         * @brief Feeds one received byte.
+         *
+         * After an error in line mode the parser skips to the next '\n' before looking for a new object.
+         */
+        Result feed(uint8_t byte);
+
+        /**
+         * @brief Parses a complete bare JSON object (document mode).
+         *
+         * @return true if `data` held exactly one valid command.
+         */
+        bool parse(const uint8_t *data, size_t length);
+
+        /** @brief Returns the last completed command. */
+        const ActuatorCommand &command() const { return current; }
+
+        uint32_t crcErrors;    ///< Commands dropped because of a CRC mismatch.
+        uint32_t syntaxErrors; ///< Commands dropped because of malformed text.
+
+    private:
+        enum State {
+            IDLE, KEY_OR_END, KEY, COLON, VALUE, NUMBER, STRING_VALUE, STRING_ESCAPE,
+            LITERAL, NESTED, NESTED_STRING, NESTED_ESCAPE, COMMA_OR_END, CRC, SKIP_LINE,
+        };
+
+        Result fail(bool crcFailure, uint8_t byte);
+        Result closeObject();
+        Result feedSeparator(uint8_t byte);
+        void storeValue();
+
+        const bool lineMode;
+        State state;
+        bool negative;
+        bool fraction;       ///< Inside the fraction or exponent of a number.
+        bool keyEscape;      ///< Previous key character was a backslash.
+        int8_t field;        ///< Index of the recognised key whose value is being read, or -1.
+        uint8_t keyLength;
+        uint8_t nesting;     ///< Depth inside a skipped nested value.
+        uint32_t number;     ///< Magnitude of the integer being read.
+        uint32_t receivedCrc;
+        uint8_t crcDigits;
+        char key[12];        ///< Key being read (truncated; long keys are never recognised).
+        StreamCrc32 crc;     ///< CRC of the object text, line mode only.
+        ActuatorCommand pending;
+        ActuatorCommand current;
+};
+
+#endif // !COMMAND_PARSER_H
@@ -0,0 +1,231 @@
+/**
+ * @file CommandProtocol.cpp
+ * @brief Encoding and decoding of the binary commands and their acknowledgements.
+ */
+
+#include "CommandProtocol.h"
+
+#include <string.h>
+
+namespace {
+
+const uint8_t kLedBits[3] = {COMMAND_RED, COMMAND_GREEN, COMMAND_BLUE};
+
+uint16_t getU16(const uint8_t *data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+void putU16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+}
+
+uint32_t getU32(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void putU32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+/** @brief Argument length of a fixed-size opcode, or -1. */
+int argumentLength(uint8_t opcode) {
+    switch (opcode) {
+        case CONTROL_SET_DUTY: return 2;
+        case CONTROL_SET_PERIOD: return 5;
+        case CONTROL_REQUEST_TELEMETRY: return 0;
+        case CONTROL_SET_REPORT_MODE: return 1;
+        case CONTROL_SET_BATCH: return 5;
+        case CONTROL_SET_FAN_MODE: return 1;
+        case CONTROL_SET_FAN_TARGET: return 6;
+        case CONTROL_SET_DEVICE_ID: return 1 + CONTROL_DEVICE_ID_LENGTH;
+        default: return -1;
+    }
+}
+
+} // namespace
+
+ControlStatus decodeControl(const uint8_t *payload, size_t length, ControlCommand &command) {
+    memset(&command, 0, sizeof(command));
+    if (length < 2) {
+        return length == 1 && payload[0] != CONTROL_VERSION ? CONTROL_BAD_VERSION : CONTROL_BAD_LENGTH;
+    }
+    if (payload[0] != CONTROL_VERSION) {
+        return CONTROL_BAD_VERSION;
+    }
+    command.opcode = payload[1];
+    const uint8_t *args = payload + 2;
+    size_t argc = length - 2;
+
+    if (command.opcode == CONTROL_SET_LED) {
+        if (argc < 1 || (args[0] & ~(COMMAND_RED | COMMAND_GREEN | COMMAND_BLUE))) {
+            return argc < 1 ? CONTROL_BAD_LENGTH : CONTROL_OUT_OF_RANGE;
+        }
+        uint8_t mask = args[0];
+        size_t used = 1;
+        uint8_t *values[3] = {&command.actuators.red, &command.actuators.green, &command.actuators.blue};
+        for (int i = 0; i < 3; i++) {
+            if (mask & kLedBits[i]) {
+                if (used >= argc) {
+                    return CONTROL_BAD_LENGTH;
+                }
+                *values[i] = args[used++];
+            }
+        }
+        if (used != argc) {
+            return CONTROL_BAD_LENGTH;
+        }
+        command.actuators.present = mask;
+        return CONTROL_OK;
+    }
+
+    if (command.opcode == CONTROL_SET_CONFIG) {
+        if (argc < 1 + 5 || (argc - 1) % 5 != 0 || (argc - 1) / 5 > CONTROL_MAX_CONFIG_ITEMS) {
+            return CONTROL_BAD_LENGTH;
+        }
+        command.configFlags = args[0];
+        command.configCount = (uint8_t)((argc - 1) / 5);
+        for (uint8_t i = 0; i < command.configCount; i++) {
+            command.configKeys[i] = args[1 + 5 * i];
+            command.configValues[i] = getU32(args + 2 + 5 * i);
+        }
+        return CONTROL_OK;
+    }
+
+    int expected = argumentLength(command.opcode);
+    if (expected < 0) {
+        return CONTROL_BAD_OPCODE;
+    }
+    if (argc != (size_t)expected) {
+        return CONTROL_BAD_LENGTH;
+    }
+    switch (command.opcode) {
+        case CONTROL_SET_DUTY:
+            command.actuators.dutyCycle = getU16(args);
+            command.actuators.present = COMMAND_DUTY;
+            break;
+        case CONTROL_SET_PERIOD:
+            command.job = args[0];
+            command.periodMs = getU32(args + 1);
+            break;
+        case CONTROL_SET_REPORT_MODE:
+            command.reportMode = args[0];
+            break;
+        case CONTROL_SET_BATCH:
+            command.batchSize = args[0];
+            command.batchFlushMs = getU32(args + 1);
+            break;
+        case CONTROL_SET_FAN_MODE:
+            command.fanMode = args[0];
+            break;
+        case CONTROL_SET_FAN_TARGET:
+            command.fanSetpoint = getU16(args);
+            command.fanMinDuty = getU16(args + 2);
+            command.fanMaxDuty = getU16(args + 4);
+            break;
+        case CONTROL_SET_DEVICE_ID:
+            command.configFlags = args[0];
+            memcpy(command.deviceId, args + 1, CONTROL_DEVICE_ID_LENGTH);
+            break;
+        default:
+            break;
+    }
+    return CONTROL_OK;
+}
+
+size_t encodeControl(const ControlCommand &command, uint8_t *out, size_t capacity) {
+    uint8_t payload[CONTROL_MAX_PAYLOAD];
+    size_t length = 2;
+    payload[0] = CONTROL_VERSION;
+    payload[1] = command.opcode;
+
+    switch (command.opcode) {
+        case CONTROL_SET_LED: {
+            uint8_t mask = command.actuators.present & (COMMAND_RED | COMMAND_GREEN | COMMAND_BLUE);
+            const uint8_t values[3] = {command.actuators.red, command.actuators.green, command.actuators.blue};
+            payload[length++] = mask;
+            for (int i = 0; i < 3; i++) {
+                if (mask & kLedBits[i]) {
+                    payload[length++] = values[i];
+                }
+            }
+            break;
+        }
+        case CONTROL_SET_DUTY:
+            putU16(payload + length, command.actuators.dutyCycle);
+            length += 2;
+            break;
+        case CONTROL_SET_PERIOD:
+            payload[length++] = command.job;
+            putU32(payload + length, command.periodMs);
+            length += 4;
+            break;
+        case CONTROL_REQUEST_TELEMETRY:
+            break;
+        case CONTROL_SET_REPORT_MODE:
+            payload[length++] = command.reportMode;
+            break;
+        case CONTROL_SET_BATCH:
+            payload[length++] = command.batchSize;
+            putU32(payload + length, command.batchFlushMs);
+            length += 4;
+            break;
+        case CONTROL_SET_FAN_MODE:
+            payload[length++] = command.fanMode;
+            break;
+        case CONTROL_SET_FAN_TARGET:
+            putU16(payload + length, command.fanSetpoint);
+            putU16(payload + length + 2, command.fanMinDuty);
+            putU16(payload + length + 4, command.fanMaxDuty);
+            length += 6;
+            break;
+        case CONTROL_SET_CONFIG:
+            if (command.configCount < 1 || command.configCount > CONTROL_MAX_CONFIG_ITEMS) {
+                return 0;
+            }
+            payload[length++] = command.configFlags;
+            for (uint8_t i = 0; i < command.configCount; i++) {
+                payload[length++] = command.configKeys[i];
+                putU32(payload + length, command.configValues[i]);
+                length += 4;
+            }
+            break;
+        case CONTROL_SET_DEVICE_ID:
+            if (strlen(command.deviceId) != CONTROL_DEVICE_ID_LENGTH) {
+                return 0;
+            }
+            payload[length++] = command.configFlags;
+            memcpy(payload + length, command.deviceId, CONTROL_DEVICE_ID_LENGTH);
+            length += CONTROL_DEVICE_ID_LENGTH;
+            break;
+        default:
+            return 0;
+    }
+
+    if (length > capacity) {
+        return 0;
+    }
+    memcpy(out, payload, length);
+    return length;
+}
+
+size_t encodeControlAck(const ControlAck &ack, uint8_t *out) {
+    out[0] = CONTROL_VERSION;
+    out[1] = ack.status;
+    out[2] = ack.opcode;
+    putU32(out + 3, ack.applyTime);
+    return CONTROL_ACK_LENGTH;
+}
+
+bool decodeControlAck(const uint8_t *payload, size_t length, ControlAck &ack) {
+    if (length != CONTROL_ACK_LENGTH || payload[0] != CONTROL_VERSION) {
+        return false;
+    }
+    ack.status = payload[1];
+    ack.opcode = payload[2];
+    ack.applyTime = getU32(payload + 3);
+    return true;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file CommandProtocol.h
+ * @brief Versioned binary command set between the cloud-ESP and the sensor-ESP.
+ *
+ * A command travels as the payload of a `FRAME_CONTROL` frame whose seq is the command's
+ * sequence number. Every command is answered by a `FRAME_CONTROL_ACK` frame with the same seq,
+ * so the sender can pipeline commands and match each answer to its command. A command that
+ * arrives again with the seq of the last applied command is acknowledged without being applied
+ * twice, which makes retransmission safe.
+ *
+ * Command payload:
+ *
+ *     | version (1) | opcode (1) | arguments |
+ *
+ * | Opcode                      | Arguments                                                             |
+ * |-----------------------------|-----------------------------------------------------------------------|
+ * | `CONTROL_SET_LED`           | mask (1, `COMMAND_RED/GREEN/BLUE`) then one byte per set bit, R, G, B  |
+ * | `CONTROL_SET_DUTY`          | duty cycle u16                                                        |
+ * | `CONTROL_SET_PERIOD`        | job (1, `ControlJob`) then period ms u32                              |
+ * | `CONTROL_REQUEST_TELEMETRY` | none; a `FRAME_TELEMETRY` frame with the same seq precedes the ack     |
+ * | `CONTROL_SET_REPORT_MODE`   | mode (1, `ReportMode`)                                                |
+ * | `CONTROL_SET_BATCH`         | samples per batch (1), flush ms u32; 0 leaves a value unchanged        |
+ * | `CONTROL_SET_FAN_MODE`      | mode (1, `ControlFanMode`)                                            |
+ * | `CONTROL_SET_FAN_TARGET`    | PM2.5 setpoint in 0.1 µg/m³ u16, lowest duty u16, highest duty u16     |
+ * | `CONTROL_SET_CONFIG`        | flags (1, `CONTROL_CONFIG_SAVE`) then 1-6 times key (1) value u32      |
+ * | `CONTROL_SET_DEVICE_ID`     | flags (1) then the ISAAC ID as 18 hex characters                       |
+ *
+ * Acknowledgement payload:
+ *
+ *     | version (1) | status (1) | opcode (1) | apply time ms u32 |
+ *
+ * Multi-byte values are little-endian. Only LED channels that are in the mask change, so a
+ * command can update one actuator without repeating the others. The keys of `CONTROL_SET_CONFIG`
+ * are the device's `ConfigKey`s; its values are applied together or not at all. Nothing here
+ * depends on the Arduino core: the host tools link this file too.
+ */
+
+#ifndef COMMAND_PROTOCOL_H
+#define COMMAND_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <CommandParser.h>
+
+/** @brief Version written in the first byte of every command and acknowledgement. */
+#define CONTROL_VERSION 1
+
+/** @brief Most key/value pairs in one `CONTROL_SET_CONFIG` command. */
+#define CONTROL_MAX_CONFIG_ITEMS 6
+
+/** @brief Hex characters of the ISAAC ID in `CONTROL_SET_DEVICE_ID`. */
+#define CONTROL_DEVICE_ID_LENGTH 18
+
+/** @brief `CONTROL_SET_CONFIG` and `CONTROL_SET_DEVICE_ID` flag: also write the configuration to NVS. */
+#define CONTROL_CONFIG_SAVE 0x01
+
+/** @brief Largest command payload. */
+#define CONTROL_MAX_PAYLOAD (3 + 5 * CONTROL_MAX_CONFIG_ITEMS)
+
+/** @brief Acknowledgement payload length. */
+#define CONTROL_ACK_LENGTH 7
+
+/**
+ * @brief Command opcodes.
+ */
+enum ControlOpcode : uint8_t {
+    CONTROL_SET_LED = 0x01,             ///< Set some of the LED channels.
+    CONTROL_SET_DUTY = 0x02,            ///< Set the motor PWM duty cycle.
+    CONTROL_SET_PERIOD = 0x03,          ///< Set the period of a job.
+    CONTROL_REQUEST_TELEMETRY = 0x04,   ///< Send a telemetry frame.
+    CONTROL_SET_REPORT_MODE = 0x05,     ///< Set the report-by-exception mode.
+    CONTROL_SET_BATCH = 0x06,           ///< Set the batch size and flush age.
+    CONTROL_SET_FAN_MODE = 0x07,        ///< Choose between the cloud's duty cycle and local PM2.5 control.
+    CONTROL_SET_FAN_TARGET = 0x08,      ///< Set the PM2.5 setpoint and duty limits of local control.
+    CONTROL_SET_CONFIG = 0x09,          ///< Set runtime configuration values, optionally persistently.
+    CONTROL_SET_DEVICE_ID = 0x0A,       ///< Set the ISAAC ID, optionally persistently.
+};
+
+/**
+ * @brief Fan modes of `CONTROL_SET_FAN_MODE`.
+ */
+enum ControlFanMode : uint8_t {
+    CONTROL_FAN_MANUAL = 0x00,  ///< The duty cycle is set by commands.
+    CONTROL_FAN_AUTO = 0x01,    ///< The duty cycle is set by the on-device PM2.5 controller.
+};
+
+/**
+ * @brief Jobs whose period `CONTROL_SET_PERIOD` can change.
+ */
+enum ControlJob : uint8_t {
+    CONTROL_JOB_DHT11 = 0x01,   ///< DHT11 reads.
+    CONTROL_JOB_PMS5003 = 0x02, ///< PMS5003 polling when no frame triggered the job.
+    CONTROL_JOB_MQ7 = 0x03,     ///< MQ7 heater cycle steps outside the sampling window.
+    CONTROL_JOB_SEND = 0x04,    ///< Sending to the cloud-ESP.
+};
+
+/**
+ * @brief Status of an acknowledgement. Values from 0x80 are negative acknowledgements.
+ */
+enum ControlStatus : uint8_t {
+    CONTROL_OK = 0x00,              ///< Applied.
+    CONTROL_DUPLICATE = 0x01,       ///< Same seq as the last applied command; not applied again.
+    CONTROL_BAD_VERSION = 0x80,     ///< Unknown protocol version.
+    CONTROL_BAD_OPCODE = 0x81,      ///< Unknown opcode.
+    CONTROL_BAD_LENGTH = 0x82,      ///< Arguments too short or too long for the opcode.
+    CONTROL_OUT_OF_RANGE = 0x83,    ///< An argument is outside the range the device accepts.
+    CONTROL_UNAVAILABLE = 0x84,     ///< Not supported by this build, or applied but not written to NVS.
+};
+
+/**
+ * @struct ControlCommand
+ * @brief A decoded command. Only the members of its opcode are meaningful.
+ */
+struct ControlCommand {
+    uint8_t opcode;             ///< A `ControlOpcode`.
+    ActuatorCommand actuators;  ///< `CONTROL_SET_LED` (`present` holds the mask) and `CONTROL_SET_DUTY`.
+    uint8_t job;                ///< `CONTROL_SET_PERIOD`: a `ControlJob`.
+    uint32_t periodMs;          ///< `CONTROL_SET_PERIOD`.
+    uint8_t reportMode;         ///< `CONTROL_SET_REPORT_MODE`.
+    uint8_t batchSize;          ///< `CONTROL_SET_BATCH`, 0 for unchanged.
+    uint32_t batchFlushMs;      ///< `CONTROL_SET_BATCH`, 0 for unchanged.
+    uint8_t fanMode;            ///< `CONTROL_SET_FAN_MODE`: a `ControlFanMode`.
+    uint16_t fanSetpoint;       ///< `CONTROL_SET_FAN_TARGET`: PM2.5 in 0.1 µg/m³.
+    uint16_t fanMinDuty;        ///< `CONTROL_SET_FAN_TARGET`.
+    uint16_t fanMaxDuty;        ///< `CONTROL_SET_FAN_TARGET`.
+    uint8_t configFlags;        ///< `CONTROL_SET_CONFIG` and `CONTROL_SET_DEVICE_ID`.
+    uint8_t configCount;        ///< `CONTROL_SET_CONFIG`: number of pairs.
+    uint8_t configKeys[CONTROL_MAX_CONFIG_ITEMS];       ///< `CONTROL_SET_CONFIG`.
+    uint32_t configValues[CONTROL_MAX_CONFIG_ITEMS];    ///< `CONTROL_SET_CONFIG`.
+    char deviceId[CONTROL_DEVICE_ID_LENGTH + 1];        ///< `CONTROL_SET_DEVICE_ID`, NUL terminated.
+};
+
+/**
+ * @struct ControlAck
+ * @brief A decoded acknowledgement.
+ */
+struct ControlAck {
+    uint8_t status;     ///< A `ControlStatus`.
+    uint8_t opcode;     ///< Opcode of the acknowledged command, 0 if it could not be read.
+    uint32_t applyTime; ///< `millis()` of the device when the command was applied or rejected.
+};
+
+/**
+ * @brief Decodes a command payload.
+ *
+ * @return `CONTROL_OK`, or the negative status to answer with.
+ */
+ControlStatus decodeControl(const uint8_t *payload, size_t length, ControlCommand &command);
+
+/**
+ * @brief Encodes a command payload.
+ *
+ * @return Payload length, or 0 for an unknown opcode or a too small buffer.
+ */
+size_t encodeControl(const ControlCommand &command, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Encodes an acknowledgement payload into `out`, which must hold `CONTROL_ACK_LENGTH` bytes.
+ */
+size_t encodeControlAck(const ControlAck &ack, uint8_t *out);
+
+/**
+ * @brief Decodes an acknowledgement payload.
+ *
+ * @return false if the payload is not a version `CONTROL_VERSION` acknowledgement.
+ */
+bool decodeControlAck(const uint8_t *payload, size_t length, ControlAck &ack);
+
+#endif // !COMMAND_PROTOCOL_H
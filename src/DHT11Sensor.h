@@ -14,6 +14,11 @@
 #include <DHT.h>
 #include <DHT_U.h>
 
+/** @brief Time after power-up before the DHT11 may be read, in milliseconds. */
+#ifndef DHT11_WARMUP_MS
+#define DHT11_WARMUP_MS 1000
+#endif
+
 /**
  * @struct DHT11Data
  * @brief Structure to hold temperature and humidity data from the DHT11 sensor.
@@ -0,0 +1,120 @@
+/**
+ * @file DeferredLog.cpp
+ * @brief Implementation of the deferred log ring and its drainer.
+ *
+ * The ring is a bounded multi-producer queue: a producer claims a position with a compare-and-swap
+ * on `head`, fills the slot and publishes it by advancing the slot's sequence number. The drainer
+ * reads the slots in order and frees each one for the next lap by advancing its sequence again.
+ */
+
+#include "DeferredLog.h"
+
+#include <Arduino.h>
+
+DeferredLog deferredLog;
+
+DeferredLog::DeferredLog() : head(0), tail(0), drops(0), reportedDrops(0), pendingLength(0), frameSequence(0) {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool DeferredLog::push(LogId id, const uint32_t *args, uint8_t argc) {
+    uint32_t position = head.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots[position & (LOG_RING_SIZE - 1)];
+        int32_t lap = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+        if (lap == 0) {
+            if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (lap < 0) {
+            // The drainer has not freed this slot yet: the ring is full
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record.id = id;
+    slot->record.argc = argc;
+    slot->record.time = millis();
+    memcpy(slot->record.args, args, argc * sizeof(uint32_t));
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool DeferredLog::pop(LogRecord &record) {
+    Slot &slot = slots[tail & (LOG_RING_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+        return false;
+    }
+    record = slot.record;
+    slot.sequence.store(tail + LOG_RING_SIZE, std::memory_order_release);
+    tail++;
+    return true;
+}
+
+/**
+ * Returns the next record to print. Drops are reported before the records that follow them.
+ */
+bool DeferredLog::next(LogRecord &record) {
+    uint32_t lost = dropped() - reportedDrops;
+    if (lost == 0) {
+        return pop(record);
+    }
+    reportedDrops += lost;
+    record.id = LOG_DROPPED;
+    record.argc = 1;
+    record.time = millis();
+    record.args[0] = lost;
+    return true;
+}
+
+/**
+ * Formats the next output into `pending`: one text line, or with `LOG_BINARY` one frame holding as
+ * many records as fit.
+ */
+bool DeferredLog::fill() {
+    LogRecord record;
+#if LOG_BINARY
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    size_t payloadLength = 0;
+    while (payloadLength + LOG_RECORD_MAX_ENCODED <= sizeof(payload) && next(record)) {
+        payloadLength += encodeLogRecord(record, payload + payloadLength, sizeof(payload) - payloadLength);
+    }
+    if (payloadLength == 0) {
+        return false;
+    }
+    // A leading delimiter too, so a frame that follows plain text on the console decodes
+    pending[0] = 0;
+    pendingLength = encodeFrame(FRAME_LOG, frameSequence++, payload, payloadLength, pending + 1, sizeof(pending) - 1);
+    pendingLength = pendingLength ? pendingLength + 1 : 0;
+#else
+    if (!next(record)) {
+        return false;
+    }
+    size_t length = formatLogRecord(record, (char *)pending, LOG_LINE_MAX + 1);
+    pending[length++] = '\r';
+    pending[length++] = '\n';
+    pendingLength = length;
+#endif
+    return pendingLength > 0;
+}
+
+size_t DeferredLog::drain(HardwareSerial &port) {
+    size_t written = 0;
+    for (;;) {
+        if (pendingLength == 0 && !fill()) {
+            break;
+        }
+        if ((size_t)port.availableForWrite() < pendingLength) {
+            break;  // Finish the line once the UART has sent enough
+        }
+        written += port.write(pending, pendingLength);
+        pendingLength = 0;
+    }
+    return written;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file DeferredLog.h
+ * @brief Deferred logging: call sites queue a message id and raw arguments, a low-priority job prints them.
+ *
+ * `Serial.println()` on the 9600-baud console blocks the caller for about a millisecond per character.
+ * `LOG(name, args...)` instead copies the id of a catalog message (see LogCatalog.h), the time and up
+ * to `LOG_MAX_ARGS` arguments into a lock-free ring, which takes well under a microsecond. The ring
+ * is drained by `DeferredLog::drain()` from a low-priority job, only as fast as the UART can take
+ * the output without blocking.
+ *
+ * Messages above `LOG_LEVEL` compile to nothing, arguments included. With `LOG_BINARY=1` the
+ * drainer sends the raw records in `FRAME_LOG` frames instead of text, which `tools/logdecode.cpp`
+ * turns back into text on a PC.
+ */
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include <HardwareSerial.h>
+#include <LogCatalog.h>
+#include <SerialFrame.h>
+
+/** @brief Most verbose level compiled in, one of the `LOG_LEVEL_` values. */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+/** @brief 1 to send binary `FRAME_LOG` frames instead of text lines. */
+#ifndef LOG_BINARY
+#define LOG_BINARY 0
+#endif
+
+/** @brief Records the ring holds, a power of two. */
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 32
+#endif
+
+/** @brief Longest text line, without the line ending. */
+#define LOG_LINE_MAX 96
+
+/** @brief True if the message `id` is compiled in. */
+constexpr bool logEnabled(LogId id) { return kLogLevels[id] <= LOG_LEVEL; }
+
+/**
+ * @class DeferredLog
+ * @brief Bounded lock-free queue of log records and its drainer.
+ *
+ * Any number of tasks and callbacks may call `write()`; it never blocks, and a record that finds
+ * the ring full is dropped and counted. Exactly one task calls `drain()`, which reports the drops
+ * as a `LOG_DROPPED` message.
+ */
+class DeferredLog {
+    static_assert(LOG_RING_SIZE >= 2 && (LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+    public:
+        DeferredLog();
+
+        /**
+         * @brief Queues message `id` with its arguments. Use `LOG()` rather than calling this directly.
+         *
+         * @return false if the ring was full and the record was dropped.
+         */
+        template <typename... Args>
+        bool write(LogId id, Args... args) {
+            static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+            uint32_t words[LOG_MAX_ARGS + 1] = {toWord(args)...};
+            return push(id, words, sizeof...(Args));
+        }
+
+        /**
+         * @brief Prints queued records to `port` until the ring is empty or `port` has no room for the next one.
+         *
+         * `port` needs a TX buffer larger than one line (or one `FRAME_LOG` frame with `LOG_BINARY`).
+         *
+         * @return Bytes written.
+         */
+        size_t drain(HardwareSerial &port);
+
+        uint32_t dropped() const { return drops.load(std::memory_order_relaxed); } ///< Records dropped on a full ring.
+
+    private:
+        struct Slot {
+            std::atomic<uint32_t> sequence;  ///< Slot position when free, position + 1 once written.
+            LogRecord record;
+        };
+
+        template <typename T>
+        static uint32_t toWord(T value) {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Log arguments must be numbers");
+            if (std::is_floating_point<T>::value) {
+                float number = (float)value;
+                uint32_t word;
+                memcpy(&word, &number, sizeof(word));
+                return word;
+            }
+            return (uint32_t)value;
+        }
+
+        bool push(LogId id, const uint32_t *args, uint8_t argc);
+        bool pop(LogRecord &record);
+        bool next(LogRecord &record);
+        bool fill();
+
+        Slot slots[LOG_RING_SIZE];
+        std::atomic<uint32_t> head;     ///< Next position to claim, shared by the producers.
+        uint32_t tail;                  ///< Next position to read, owned by the drainer.
+        std::atomic<uint32_t> drops;
+        uint32_t reportedDrops;         ///< Drops already reported by the drainer.
+        uint8_t pending[FRAME_MAX_ENCODED + 1]; ///< Output that did not fit the port yet.
+        size_t pendingLength;
+        uint8_t frameSequence;
+};
+
+/** @brief The firmware's log. */
+extern DeferredLog deferredLog;
+
+/**
+ * @brief Logs catalog message `name` (without its `LOG_` prefix) with up to `LOG_MAX_ARGS` numeric arguments.
+ *
+ * Compiles to nothing when the message is above `LOG_LEVEL`.
+ */
+#define LOG(name, ...) \
+    do { \
+        if constexpr (logEnabled(LOG_##name)) { \
+            deferredLog.write(LOG_##name, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#endif // !DEFERRED_LOG_H
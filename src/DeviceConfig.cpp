@@ -0,0 +1,193 @@
+/**
+ * @file DeviceConfig.cpp
+ * @brief Validation of the runtime configuration and its NVS record.
+ */
+
+#include "DeviceConfig.h"
+
+#include <string.h>
+
+#include <Preferences.h>
+
+#include <ReportFilter.h>
+#include <Scheduler.h>
+#include <StreamCrc32.h>
+
+static_assert(CONFIG_MAX_PERIOD_MS <= SCHEDULER_MAX_PERIOD_MS, "A configured period must fit the scheduler's deadlines");
+
+namespace {
+
+const char kNamespace[] = "config";
+const char kKey[] = "device";
+
+bool validPeriod(uint32_t periodMs) {
+    return periodMs >= CONFIG_MIN_PERIOD_MS && periodMs <= CONFIG_MAX_PERIOD_MS;
+}
+
+bool validId(const char *id) {
+    size_t length = strnlen(id, sizeof(DeviceConfig::isaacId));
+    if (length != CONTROL_DEVICE_ID_LENGTH) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        char c = id[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool setConfigValue(DeviceConfig &config, uint8_t key, uint32_t value) {
+    switch (key) {
+        case CONFIG_DHT11_PERIOD: config.dht11PeriodMs = value; return true;
+        case CONFIG_PMS5003_PERIOD: config.pms5003PeriodMs = value; return true;
+        case CONFIG_MQ7_PERIOD: config.mq7PeriodMs = value; return true;
+        case CONFIG_SEND_PERIOD: config.sendPeriodMs = value; return true;
+        case CONFIG_BATCH_FLUSH: config.batchFlushMs = value; return true;
+        case CONFIG_BLE_PERIOD: config.blePeriodMs = value; return true;
+        default: break;
+    }
+    if (value > 0xFFFF) {
+        return false;
+    }
+    switch (key) {
+        case CONFIG_FAN_SETPOINT: config.fanSetpoint = (uint16_t)value; return true;
+        case CONFIG_FAN_MIN_DUTY: config.fanMinDuty = (uint16_t)value; return true;
+        case CONFIG_FAN_MAX_DUTY: config.fanMaxDuty = (uint16_t)value; return true;
+        default: break;
+    }
+    if (value > 0xFF) {
+        return false;
+    }
+    switch (key) {
+        case CONFIG_BATCH_SIZE: config.batchSize = (uint8_t)value; return true;
+        case CONFIG_REPORT_MODE: config.reportMode = (uint8_t)value; return true;
+        case CONFIG_FAN_MODE: config.fanMode = (uint8_t)value; return true;
+        default: return false;
+    }
+}
+
+bool validConfig(const DeviceConfig &config) {
+    return validPeriod(config.dht11PeriodMs) && config.dht11PeriodMs >= CONFIG_MIN_DHT11_PERIOD_MS &&
+           validPeriod(config.pms5003PeriodMs) &&
+           validPeriod(config.mq7PeriodMs) && validPeriod(config.sendPeriodMs) && validPeriod(config.batchFlushMs) &&
+           validPeriod(config.blePeriodMs) &&
+           config.batchSize > 0 && config.reportMode <= REPORT_DELTA && config.fanMode <= CONTROL_FAN_AUTO &&
+           config.fanSetpoint <= CONFIG_MAX_FAN_SETPOINT && config.fanMinDuty <= config.fanMaxDuty &&
+           config.fanMaxDuty <= CONFIG_MAX_DUTY && validId(config.isaacId);
+}
+
+ControlStatus applyControlToConfig(DeviceConfig &config, const ControlCommand &command, bool &save) {
+    save = false;
+    switch (command.opcode) {
+        case CONTROL_SET_PERIOD: {
+            uint8_t key;
+            switch (command.job) {
+                case CONTROL_JOB_DHT11: key = CONFIG_DHT11_PERIOD; break;
+                case CONTROL_JOB_PMS5003: key = CONFIG_PMS5003_PERIOD; break;
+                case CONTROL_JOB_MQ7: key = CONFIG_MQ7_PERIOD; break;
+                case CONTROL_JOB_SEND: key = CONFIG_SEND_PERIOD; break;
+                default: return CONTROL_OUT_OF_RANGE;
+            }
+            if (!setConfigValue(config, key, command.periodMs)) {
+                return CONTROL_OUT_OF_RANGE;
+            }
+            break;
+        }
+        case CONTROL_SET_REPORT_MODE:
+            config.reportMode = command.reportMode;
+            break;
+        case CONTROL_SET_BATCH:
+            if (command.batchSize) config.batchSize = command.batchSize;
+            if (command.batchFlushMs) config.batchFlushMs = command.batchFlushMs;
+            break;
+        case CONTROL_SET_FAN_MODE:
+            config.fanMode = command.fanMode;
+            break;
+        case CONTROL_SET_FAN_TARGET:
+            config.fanSetpoint = command.fanSetpoint;
+            config.fanMinDuty = command.fanMinDuty;
+            config.fanMaxDuty = command.fanMaxDuty;
+            break;
+        case CONTROL_SET_CONFIG:
+            for (uint8_t i = 0; i < command.configCount; i++) {
+                if (!setConfigValue(config, command.configKeys[i], command.configValues[i])) {
+                    return CONTROL_OUT_OF_RANGE;
+                }
+            }
+            save = command.configFlags & CONTROL_CONFIG_SAVE;
+            break;
+        case CONTROL_SET_DEVICE_ID:
+            memcpy(config.isaacId, command.deviceId, CONTROL_DEVICE_ID_LENGTH);
+            config.isaacId[CONTROL_DEVICE_ID_LENGTH] = '\0';
+            save = command.configFlags & CONTROL_CONFIG_SAVE;
+            break;
+        default:
+            return CONTROL_BAD_OPCODE;
+    }
+    return validConfig(config) ? CONTROL_OK : CONTROL_OUT_OF_RANGE;
+}
+
+ConfigStore::ConfigStore(const DeviceConfig &initial) : defaults(initial) {
+    defaults.version = CONFIG_VERSION;
+    defaults.length = sizeof(DeviceConfig);
+    cell.write(defaults);
+}
+
+ConfigSource ConfigStore::begin() {
+    uint8_t record[sizeof(DeviceConfig) + sizeof(uint32_t)];
+    Preferences nvs;
+    size_t length = 0;
+    if (nvs.begin(kNamespace, true)) {
+        length = nvs.getBytesLength(kKey);
+        if (length <= sizeof(record)) {
+            length = nvs.getBytes(kKey, record, sizeof(record));
+        } else {
+            length = 0;
+        }
+        nvs.end();
+    }
+
+    size_t fields = length > sizeof(uint32_t) ? length - sizeof(uint32_t) : 0;
+    uint32_t crc = 0;
+    memcpy(&crc, record + fields, fields > 0 ? sizeof(crc) : 0);
+
+    // Over the defaults, so the fields an older layout lacks keep their default values
+    DeviceConfig stored = defaults;
+    memcpy(&stored, record, fields < sizeof(stored) ? fields : sizeof(stored));
+    // The record must hold at least the header, say it is this long, and come from this layout or an older one
+    if (fields < offsetof(DeviceConfig, dht11PeriodMs) || StreamCrc32::compute(record, fields) != crc ||
+        stored.length != fields || stored.version > CONFIG_VERSION) {
+        cell.write(defaults);
+        return CONFIG_DEFAULTS;
+    }
+
+    ConfigSource source = stored.version == CONFIG_VERSION ? CONFIG_STORED : CONFIG_UPGRADED;
+    stored.version = CONFIG_VERSION;
+    stored.length = sizeof(DeviceConfig);
+    stored.isaacId[sizeof(stored.isaacId) - 1] = '\0';
+    if (!validConfig(stored)) {
+        cell.write(defaults);
+        return CONFIG_DEFAULTS;
+    }
+    cell.write(stored);
+    return source;
+}
+
+bool ConfigStore::save(const DeviceConfig &config) {
+    uint8_t record[sizeof(DeviceConfig) + sizeof(uint32_t)];
+    memcpy(record, &config, sizeof(DeviceConfig));
+    uint32_t crc = StreamCrc32::compute(record, sizeof(DeviceConfig));
+    memcpy(record + sizeof(DeviceConfig), &crc, sizeof(crc));
+
+    Preferences nvs;
+    if (!nvs.begin(kNamespace, false)) {
+        return false;
+    }
+    bool written = nvs.putBytes(kKey, record, sizeof(record)) == sizeof(record);
+    nvs.end();
+    return written;
+}
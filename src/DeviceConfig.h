@@ -0,0 +1,157 @@
+/**
+ * @file DeviceConfig.h
+ * @brief Versioned runtime configuration, kept in NVS and published to the jobs without locks.
+ *
+ * The settings that used to be compile-time constants of main.cpp (job periods, batching,
+ * report mode, fan control, ISAAC ID) form one `DeviceConfig` record. `ConfigStore::begin()`
+ * loads it from NVS once at boot; after that the jobs copy it out of a `SeqLock` on every use,
+ * and a change is published as a whole record, so a job never sees half of an update.
+ *
+ * The NVS record is the `DeviceConfig` bytes followed by their CRC32. Fields are only ever
+ * appended: a record of an older version is shorter, and its fields are laid over the defaults
+ * of the current one. A record from a newer firmware, or one that fails its CRC or validation,
+ * is ignored and the defaults are used.
+ */
+
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <CommandProtocol.h>
+#include <SeqLock.h>
+
+/** @brief Layout version of `DeviceConfig`; bump it when appending fields. */
+#define CONFIG_VERSION 2
+
+/** @brief Range of the job periods and batch flush age; the longest period fits `SCHEDULER_MAX_PERIOD_MS`. */
+#define CONFIG_MIN_PERIOD_MS 100
+#define CONFIG_MAX_PERIOD_MS 1800000
+
+/**
+ * @brief Shortest DHT11 period. The sensor needs a second between transfers, and the DHT driver answers
+ * reads less than 2 s apart from its cache, so a faster job would only feed repeats into the filter.
+ */
+#define CONFIG_MIN_DHT11_PERIOD_MS 2000
+
+/** @brief Largest duty cycle at the motor's 10-bit PWM resolution. */
+#define CONFIG_MAX_DUTY 1023
+
+/** @brief Highest fan setpoint, in 0.1 µg/m³ (the PMS5003's range). */
+#define CONFIG_MAX_FAN_SETPOINT 5000
+
+/**
+ * @struct DeviceConfig
+ * @brief Runtime configuration. Append new fields at the end and bump `CONFIG_VERSION`.
+ */
+struct DeviceConfig {
+    uint16_t version;       ///< `CONFIG_VERSION` of the layout.
+    uint16_t length;        ///< `sizeof(DeviceConfig)` of the layout.
+    uint32_t dht11PeriodMs;
+    uint32_t pms5003PeriodMs;   ///< While the PMS5003 is awake.
+    uint32_t mq7PeriodMs;       ///< Outside the MQ7's sampling window.
+    uint32_t sendPeriodMs;
+    uint32_t batchFlushMs;      ///< Maximum age of the oldest sample before a partial batch is sent.
+    uint8_t batchSize;          ///< Samples per batch frame (1-255).
+    uint8_t reportMode;         ///< A `ReportMode`.
+    uint8_t fanMode;            ///< A `ControlFanMode`.
+    uint8_t reserved;
+    uint16_t fanSetpoint;       ///< PM2.5 in 0.1 µg/m³.
+    uint16_t fanMinDuty;
+    uint16_t fanMaxDuty;
+    char isaacId[CONTROL_DEVICE_ID_LENGTH + 2]; ///< ISAAC ID as hex characters, NUL terminated.
+    // Version 2
+    uint32_t blePeriodMs;       ///< Snapshot period of the BLE stream.
+};
+
+/**
+ * @brief Keys of the numeric fields, as sent by `CONTROL_SET_CONFIG`.
+ */
+enum ConfigKey : uint8_t {
+    CONFIG_DHT11_PERIOD = 0x01,
+    CONFIG_PMS5003_PERIOD = 0x02,
+    CONFIG_MQ7_PERIOD = 0x03,
+    CONFIG_SEND_PERIOD = 0x04,
+    CONFIG_BATCH_SIZE = 0x05,
+    CONFIG_BATCH_FLUSH = 0x06,
+    CONFIG_REPORT_MODE = 0x07,
+    CONFIG_FAN_MODE = 0x08,
+    CONFIG_FAN_SETPOINT = 0x09,
+    CONFIG_FAN_MIN_DUTY = 0x0A,
+    CONFIG_FAN_MAX_DUTY = 0x0B,
+    CONFIG_BLE_PERIOD = 0x0C,
+};
+
+/**
+ * @brief Where `ConfigStore::begin()` took the configuration from.
+ */
+enum ConfigSource : uint8_t {
+    CONFIG_DEFAULTS = 0,    ///< No usable record in NVS.
+    CONFIG_STORED,          ///< The NVS record, of the current version.
+    CONFIG_UPGRADED,        ///< An NVS record of an older version, laid over the defaults.
+};
+
+/**
+ * @brief Sets one numeric field.
+ *
+ * @return false for an unknown key or a value that does not fit the field.
+ */
+bool setConfigValue(DeviceConfig &config, uint8_t key, uint32_t value);
+
+/**
+ * @brief Checks every field against the range the device accepts.
+ */
+bool validConfig(const DeviceConfig &config);
+
+/**
+ * @brief Applies a command that changes the configuration to `config`.
+ *
+ * Handles `CONTROL_SET_PERIOD`, `CONTROL_SET_REPORT_MODE`, `CONTROL_SET_BATCH`, `CONTROL_SET_FAN_MODE`,
+ * `CONTROL_SET_FAN_TARGET`, `CONTROL_SET_CONFIG` and `CONTROL_SET_DEVICE_ID`.
+ *
+ * @param save Set if the command asks for the configuration to be written to NVS.
+ * @return `CONTROL_OK` if `config` is valid afterwards, `CONTROL_OUT_OF_RANGE` if not or if a value does not
+ *         fit its field, or `CONTROL_BAD_OPCODE` for any other command.
+ */
+ControlStatus applyControlToConfig(DeviceConfig &config, const ControlCommand &command, bool &save);
+
+/**
+ * @class ConfigStore
+ * @brief The configuration in RAM and its NVS record.
+ *
+ * `begin()`, `publish()` and `save()` must be called from a single task (the command handler);
+ * `get()` can be called from any task.
+ */
+class ConfigStore {
+    public:
+        /**
+         * @param defaults Configuration used when NVS holds none. Its `version` and `length` are set here.
+         */
+        explicit ConfigStore(const DeviceConfig &defaults);
+
+        /** @brief Loads the NVS record and publishes it, or the defaults. */
+        ConfigSource begin();
+
+        /** @brief Copies out the current configuration. Never blocks a writer. */
+        DeviceConfig get() const {
+            DeviceConfig config;
+            cell.read(config);
+            return config;
+        }
+
+        /** @brief Number of configurations published since boot. */
+        uint32_t generation() const { return cell.version(); }
+
+        /** @brief Publishes a validated configuration to the readers. */
+        void publish(const DeviceConfig &config) { cell.write(config); }
+
+        /** @brief Writes a configuration to NVS, where the next boot loads it from. */
+        bool save(const DeviceConfig &config);
+
+    private:
+        DeviceConfig defaults;
+        SeqLock<DeviceConfig> cell;
+};
+
+#endif // !DEVICE_CONFIG_H
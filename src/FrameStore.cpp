@@ -0,0 +1,301 @@
+/**
+ * @file FrameStore.cpp
+ * @brief Implementation of the flash-backed store-and-forward log.
+ */
+
+#include "FrameStore.h"
+
+#include <StreamCrc32.h>
+
+namespace {
+
+const uint32_t kSegmentMagic = 0x31305155;   // "UQ01"
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t epoch;
+};
+
+const uint16_t kSegmentHeaderSize = sizeof(SegmentHeader);
+const uint16_t kRecordHeaderSize = 12;
+const uint8_t kStateAcknowledged = 0x00;
+
+static_assert(FRAME_STORE_SEGMENT_SIZE % 4 == 0 && FRAME_STORE_SEGMENT_SIZE <= 0xFFFF, "Segment offsets must fit 16 bits");
+static_assert(kSegmentHeaderSize + kRecordHeaderSize + FRAME_STORE_MAX_RECORD <= FRAME_STORE_SEGMENT_SIZE, "A record must fit a segment");
+
+uint16_t recordSize(size_t length) {
+    return (uint16_t)((kRecordHeaderSize + length + 3) & ~(size_t)3);
+}
+
+uint32_t recordCrc(uint8_t type, uint16_t length, uint32_t id, const uint8_t *data) {
+    uint8_t fields[7] = {
+        type, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8),
+        (uint8_t)(id & 0xFF), (uint8_t)(id >> 8), (uint8_t)(id >> 16), (uint8_t)(id >> 24),
+    };
+    StreamCrc32 crc;
+    crc.update(fields, sizeof(fields));
+    crc.update(data, length);
+    return crc.value();
+}
+
+} // namespace
+
+FrameStore::FrameStore(RetentionPolicy policy)
+    : appended(0), dropped(0), rejected(0), corrupt(0), erases(0),
+      flash(nullptr), policy(policy), segments(0), epoch(0), nextId(1), readId(1), sendId(1), lastSent(0) {
+    head = read = send = Cursor{0, kSegmentHeaderSize};
+}
+
+bool FrameStore::readHeader(const Cursor &at, RecordHeader &header) const {
+    uint8_t raw[kRecordHeaderSize];
+    if (esp_partition_read(flash, (size_t)at.segment * FRAME_STORE_SEGMENT_SIZE + at.offset, raw, sizeof(raw)) != ESP_OK) {
+        return false;
+    }
+    header.state = raw[0];
+    header.type = raw[1];
+    header.length = (uint16_t)(raw[2] | (raw[3] << 8));
+    header.id = (uint32_t)raw[4] | ((uint32_t)raw[5] << 8) | ((uint32_t)raw[6] << 16) | ((uint32_t)raw[7] << 24);
+    header.crc = (uint32_t)raw[8] | ((uint32_t)raw[9] << 8) | ((uint32_t)raw[10] << 16) | ((uint32_t)raw[11] << 24);
+    return true;
+}
+
+/**
+ * Moves `at` to the next record at or after it, skipping the unused tail of a segment.
+ * Returns false when `at` reached the append position.
+ */
+bool FrameStore::settle(Cursor &at) const {
+    for (uint32_t hops = 0; hops <= segments; hops++) {
+        if (at == head) {
+            return false;
+        }
+        RecordHeader header;
+        if (at.offset + kRecordHeaderSize <= FRAME_STORE_SEGMENT_SIZE && readHeader(at, header) &&
+            header.length <= FRAME_STORE_MAX_RECORD && at.offset + recordSize(header.length) <= FRAME_STORE_SEGMENT_SIZE) {
+            return true;
+        }
+        // End of this segment.
+        if (at.segment == head.segment) {
+            at = head;
+            return false;
+        }
+        at = Cursor{following(at.segment), kSegmentHeaderSize};
+    }
+    at = head;
+    return false;
+}
+
+void FrameStore::advance(Cursor &at, const RecordHeader &header) const {
+    at.offset = (uint16_t)(at.offset + recordSize(header.length));
+    settle(at);
+}
+
+uint32_t FrameStore::idAt(Cursor at) const {
+    RecordHeader header;
+    if (!settle(at) || !readHeader(at, header)) {
+        return nextId;
+    }
+    return header.id;
+}
+
+bool FrameStore::begin(const esp_partition_t *partition) {
+    flash = nullptr;
+    if (partition == nullptr || partition->size / FRAME_STORE_SEGMENT_SIZE < 2) {
+        return false;
+    }
+    flash = partition;
+    uint32_t count = partition->size / FRAME_STORE_SEGMENT_SIZE;
+    segments = (uint16_t)(count > 0xFFFF ? 0xFFFF : count);
+
+    // The newest segment holds the append position.
+    bool found = false;
+    uint16_t headSegment = 0;
+    for (uint16_t s = 0; s < segments; s++) {
+        SegmentHeader header;
+        if (esp_partition_read(flash, (size_t)s * FRAME_STORE_SEGMENT_SIZE, &header, sizeof(header)) == ESP_OK &&
+            header.magic == kSegmentMagic && (!found || (int32_t)(header.epoch - epoch) > 0)) {
+            headSegment = s;
+            epoch = header.epoch;
+            found = true;
+        }
+    }
+
+    nextId = 1;
+    if (!found) {
+        epoch = 0;
+        head = read = send = Cursor{(uint16_t)(segments - 1), FRAME_STORE_SEGMENT_SIZE};
+        readId = sendId = nextId;
+        if (!openSegment(0)) {
+            flash = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Segments are used round-robin, so the log is the run of consecutive epochs ending at the head.
+    uint16_t tail = headSegment;
+    uint32_t tailEpoch = epoch;
+    for (uint16_t i = 1; i < segments; i++) {
+        uint16_t s = (uint16_t)((headSegment + segments - i) % segments);
+        SegmentHeader header;
+        if (esp_partition_read(flash, (size_t)s * FRAME_STORE_SEGMENT_SIZE, &header, sizeof(header)) != ESP_OK ||
+            header.magic != kSegmentMagic || header.epoch != tailEpoch - 1) {
+            break;
+        }
+        tail = s;
+        tailEpoch = header.epoch;
+    }
+
+    // Treat the head segment as full: a record torn by the reset must never be appended to.
+    head = Cursor{headSegment, FRAME_STORE_SEGMENT_SIZE};
+
+    Cursor at = Cursor{tail, kSegmentHeaderSize};
+    Cursor unacknowledged = at;
+    bool any = false;
+    uint32_t maxId = 0;
+    RecordHeader header;
+    while (settle(at) && readHeader(at, header)) {
+        if (!any || (int32_t)(header.id - maxId) > 0) {
+            maxId = header.id;
+        }
+        any = true;
+        advance(at, header);
+        if (header.state == kStateAcknowledged) {
+            unacknowledged = at;
+        }
+    }
+
+    nextId = any ? maxId + 1 : 1;
+    settle(unacknowledged);
+    read = send = unacknowledged;
+    readId = sendId = idAt(read);
+
+    openSegment(following(headSegment));    // May be refused under RETAIN_OLDEST; append() retries.
+    return true;
+}
+
+/**
+ * Erases `segment` and makes it the head. If it still holds unacknowledged records the retention
+ * policy decides whether they are dropped or the new segment is refused.
+ */
+bool FrameStore::openSegment(uint16_t segment) {
+    if (read.segment == segment && read != head) {
+        if (policy == RETAIN_OLDEST) {
+            return false;
+        }
+        read = Cursor{following(segment), kSegmentHeaderSize};
+        settle(read);
+        uint32_t id = idAt(read);
+        dropped += id - readId;
+        readId = id;
+        if (send.segment == segment || (int32_t)(sendId - readId) < 0) {
+            send = read;
+            sendId = readId;
+        }
+    }
+
+    if (esp_partition_erase_range(flash, (size_t)segment * FRAME_STORE_SEGMENT_SIZE, FRAME_STORE_SEGMENT_SIZE) != ESP_OK) {
+        return false;
+    }
+    erases++;
+
+    SegmentHeader header = {kSegmentMagic, epoch + 1};
+    if (esp_partition_write(flash, (size_t)segment * FRAME_STORE_SEGMENT_SIZE, &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    epoch++;
+
+    Cursor previous = head;
+    head = Cursor{segment, kSegmentHeaderSize};
+    if (read == previous) read = head;
+    if (send == previous) send = head;
+    return true;
+}
+
+bool FrameStore::append(uint8_t type, const uint8_t *data, size_t length) {
+    if (flash == nullptr || length > FRAME_STORE_MAX_RECORD) {
+        rejected++;
+        return false;
+    }
+    uint16_t size = recordSize(length);
+    if (head.offset + size > FRAME_STORE_SEGMENT_SIZE && !openSegment(following(head.segment))) {
+        rejected++;
+        return false;
+    }
+
+    uint32_t crc = recordCrc(type, (uint16_t)length, nextId, data);
+    uint8_t header[kRecordHeaderSize] = {
+        0xFF, type, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8),
+        (uint8_t)(nextId & 0xFF), (uint8_t)(nextId >> 8), (uint8_t)(nextId >> 16), (uint8_t)(nextId >> 24),
+        (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24),
+    };
+
+    // Data first, header last: until the header is programmed the slot still reads as empty.
+    size_t address = (size_t)head.segment * FRAME_STORE_SEGMENT_SIZE + head.offset;
+    if ((length > 0 && esp_partition_write(flash, address + kRecordHeaderSize, data, length) != ESP_OK) ||
+        esp_partition_write(flash, address, header, sizeof(header)) != ESP_OK) {
+        head.offset = FRAME_STORE_SEGMENT_SIZE;   // Never reuse a partly programmed slot.
+        rejected++;
+        return false;
+    }
+
+    head.offset = (uint16_t)(head.offset + size);
+    nextId++;
+    appended++;
+    return true;
+}
+
+bool FrameStore::next(uint8_t &type, uint8_t *data, uint16_t &length, uint32_t &id, uint32_t &previous) {
+    if (flash == nullptr) {
+        return false;
+    }
+    RecordHeader header;
+    while (settle(send) && readHeader(send, header)) {
+        Cursor at = send;
+        bool ok = esp_partition_read(flash, (size_t)at.segment * FRAME_STORE_SEGMENT_SIZE + at.offset + kRecordHeaderSize,
+                                     data, header.length) == ESP_OK &&
+                  recordCrc(header.type, header.length, header.id, data) == header.crc;
+        advance(send, header);
+        sendId = idAt(send);
+
+        if (!ok) {
+            corrupt++;
+            if (read == at) {
+                read = send;    // Nothing in flight before it: skip it for good.
+                readId = sendId;
+            }
+            continue;
+        }
+        type = header.type;
+        length = header.length;
+        id = header.id;
+        previous = at == read ? 0 : lastSent;
+        lastSent = header.id;
+        return true;
+    }
+    sendId = nextId;
+    return false;
+}
+
+void FrameStore::acknowledge(uint32_t id) {
+    if (flash == nullptr) {
+        return;
+    }
+    Cursor last = read;
+    bool any = false;
+    RecordHeader header;
+    while (read != send && readHeader(read, header) && (int32_t)(header.id - id) <= 0) {
+        last = read;
+        any = true;
+        advance(read, header);
+    }
+    if (any) {
+        uint8_t state = kStateAcknowledged;
+        esp_partition_write(flash, (size_t)last.segment * FRAME_STORE_SEGMENT_SIZE + last.offset, &state, 1);
+        readId = idAt(read);
+    }
+}
+
+void FrameStore::rewind() {
+    send = read;
+    sendId = readId;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file FrameStore.h
+ * @brief Flash-backed store-and-forward log for the frames sent to the cloud-ESP.
+ *
+ * Every outgoing record is appended to a log in a dedicated data partition before it is sent,
+ * and stays there until the peer acknowledges it. If the cloud-ESP is unplugged, rebooting or
+ * not draining its RX buffer, records accumulate in flash and are replayed in order once the
+ * peer acknowledges again, including after a reset of this ESP.
+ *
+ * The partition is divided into 4 KB segments used round-robin, so every sector is erased once
+ * per pass over the partition. A segment starts with a header (magic, epoch) and holds records
+ * appended back to back:
+ *
+ *     | state (1) | type (1) | length u16 | id u32 | crc32 u32 | data (length) | pad to 4 |
+ *
+ * `id` increases by one per record; records dropped when the log is full or skipped as corrupt
+ * leave gaps in the ids sent, which `next()` reports. The CRC covers type, length, id and data.
+ * `state` is written as 0xFF and cleared to 0x00 in place when the record is acknowledged; since
+ * acknowledgements are cumulative only the last acknowledged record is marked. RAM use is a
+ * few cursors regardless of how much is queued.
+ */
+
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_partition.h>
+
+#include <SerialFrame.h>
+
+/** @brief Size of a log segment: one flash sector. */
+#define FRAME_STORE_SEGMENT_SIZE 4096
+
+/** @brief Largest record the log accepts: what a frame holds after the record header. */
+#define FRAME_STORE_MAX_RECORD (FRAME_MAX_PAYLOAD - FRAME_RECORD_HEADER)
+
+/**
+ * @brief What the log gives up when it is full.
+ */
+enum RetentionPolicy : uint8_t {
+    RETAIN_NEWEST, ///< Drop the oldest segment, unsent or not, to make room for new records.
+    RETAIN_OLDEST, ///< Reject new records until the peer has acknowledged enough to free a segment.
+};
+
+/**
+ * @class FrameStore
+ * @brief Append-only persistent queue with a send cursor and a cumulative acknowledgement cursor.
+ *
+ * Records between the acknowledgement cursor and the send cursor are in flight; `rewind()`
+ * moves the send cursor back so they are sent again. Not thread safe: one task owns the store.
+ */
+class FrameStore {
+    public:
+        explicit FrameStore(RetentionPolicy policy = RETAIN_NEWEST);
+
+        /**
+         * @brief Recovers the log from `partition`.
+         *
+         * Finds the newest segment, restores the record ids and the acknowledgement point and
+         * opens a fresh segment for new records, so a record torn by a reset is never appended to.
+         *
+         * @return false if the partition is missing or smaller than two segments.
+         */
+        bool begin(const esp_partition_t *partition);
+
+        /** @brief True once `begin()` succeeded. */
+        bool ready() const { return flash != nullptr; }
+
+        /**
+         * @brief Appends a record.
+         *
+         * @return false if the record is too large, the flash failed, or the log is full under `RETAIN_OLDEST`.
+         */
+        bool append(uint8_t type, const uint8_t *data, size_t length);
+
+        /**
+         * @brief Reads the record at the send cursor and moves the cursor past it.
+         *
+         * Records failing their CRC are skipped and counted in `corrupt`.
+         *
+         * @param data Output buffer of at least `FRAME_STORE_MAX_RECORD` bytes.
+         * @param previous Id of the record returned before this one, or 0 if every record before
+         *                 this one was acknowledged or lost: the `previous` of the record header.
+         * @return false if every stored record has been sent.
+         */
+        bool next(uint8_t &type, uint8_t *data, uint16_t &length, uint32_t &id, uint32_t &previous);
+
+        /**
+         * @brief Acknowledges every sent record up to and including `id`.
+         */
+        void acknowledge(uint32_t id);
+
+        /** @brief Moves the send cursor back to the oldest unacknowledged record. */
+        void rewind();
+
+        void setPolicy(RetentionPolicy retention) { policy = retention; }
+
+        uint32_t pending() const { return nextId - readId; }  ///< Records not yet acknowledged.
+        uint32_t inFlight() const { return sendId - readId; } ///< Records sent and not yet acknowledged.
+        uint32_t oldestId() const { return readId; }          ///< Id of the oldest unacknowledged record.
+
+        uint32_t appended; ///< Records appended since boot.
+        uint32_t dropped;  ///< Unacknowledged records lost to `RETAIN_NEWEST`.
+        uint32_t rejected; ///< Records refused under `RETAIN_OLDEST` or because of a flash error.
+        uint32_t corrupt;  ///< Records skipped because of a CRC mismatch.
+        uint32_t erases;   ///< Segments erased since boot.
+
+    private:
+        struct Cursor {
+            uint16_t segment;
+            uint16_t offset;
+            bool operator==(const Cursor &other) const { return segment == other.segment && offset == other.offset; }
+            bool operator!=(const Cursor &other) const { return !(*this == other); }
+        };
+
+        struct RecordHeader {
+            uint8_t state;
+            uint8_t type;
+            uint16_t length;
+            uint32_t id;
+            uint32_t crc;
+        };
+
+        bool readHeader(const Cursor &at, RecordHeader &header) const;
+        bool settle(Cursor &at) const;
+        void advance(Cursor &at, const RecordHeader &header) const;
+        uint32_t idAt(Cursor at) const;
+        bool openSegment(uint16_t segment);
+        uint16_t following(uint16_t segment) const { return (uint16_t)((segment + 1) % segments); }
+
+        const esp_partition_t *flash;
+        RetentionPolicy policy;
+        uint16_t segments;  ///< Number of segments in the partition.
+        uint32_t epoch;     ///< Epoch of the head segment.
+        Cursor head;        ///< Append position.
+        Cursor read;        ///< Oldest unacknowledged record.
+        Cursor send;        ///< Next record to send.
+        uint32_t nextId;    ///< Id of the next appended record.
+        uint32_t readId;    ///< Id at `read` (`nextId` when empty).
+        uint32_t sendId;    ///< Id at `send` (`nextId` when everything was sent).
+        uint32_t lastSent;  ///< Id of the record `next()` returned last.
+};
+
+#endif // !FRAME_STORE_H
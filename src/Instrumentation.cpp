@@ -0,0 +1,200 @@
+/**
+ * @file Instrumentation.cpp
+ * @brief Implementation of the section histograms and the telemetry payload.
+ */
+
+#include "Instrumentation.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+#define INSTR_RUN_TIME_STATS 1
+#else
+#define INSTR_RUN_TIME_STATS 0
+#endif
+
+namespace {
+
+/** @brief Tasks captured by one `uxTaskGetSystemState()` call. */
+const UBaseType_t kMaxSystemTasks = 32;
+
+uint8_t *putU16(uint8_t *out, uint32_t value) {
+    if (value > 0xFFFF) value = 0xFFFF;
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+    return out + 2;
+}
+
+uint8_t *putU32(uint8_t *out, uint32_t value) {
+    out = putU16(out, value & 0xFFFF);
+    return putU16(out, value >> 16);
+}
+
+uint32_t permille(uint32_t part, uint32_t whole) {
+    if (whole == 0) return TELEMETRY_UNKNOWN;
+    uint64_t value = (uint64_t)part * 1000 / whole;
+    return value > 1000 ? 1000 : (uint32_t)value;
+}
+
+} // namespace
+
+Instrumentation::Instrumentation()
+    : sectionCount(0), taskCount(0), cyclesPerUs(240), recordCycles(0), records(0),
+      lastMicros(0), lastBusyUs(0), lastTotalRunTime(0), lastIdleRunTime{0, 0} {}
+
+void Instrumentation::begin() {
+    cyclesPerUs = getCpuFrequencyMhz();
+    if (cyclesPerUs == 0) {
+        cyclesPerUs = 1;
+    }
+
+    // Time what a SectionTimer adds to the code it wraps
+    SectionHistogram scratch = {};
+    const uint32_t rounds = 32;
+    uint32_t start = esp_cpu_get_ccount();
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint32_t begin = esp_cpu_get_ccount();
+        add(scratch, esp_cpu_get_ccount() - begin, cyclesPerUs);
+    }
+    recordCycles = (esp_cpu_get_ccount() - start + rounds / 2) / rounds;
+
+    lastMicros = micros();
+}
+
+int Instrumentation::addSection(const char *name) {
+    if (sectionCount >= INSTR_MAX_SECTIONS) {
+        return -1;
+    }
+    SectionHistogram &histogram = sections[sectionCount];
+    memset(&histogram, 0, sizeof(histogram));
+    histogram.name = name;
+    return sectionCount++;
+}
+
+bool Instrumentation::watchTask(TaskHandle_t task) {
+    if (taskCount >= INSTR_MAX_TASKS) {
+        return false;
+    }
+    tasks[taskCount] = task;
+    taskRunTime[taskCount] = 0;
+    taskCount++;
+    return true;
+}
+
+void Instrumentation::add(SectionHistogram &histogram, uint32_t cycles, uint32_t cyclesPerUs) {
+    histogram.runs++;
+    if (cycles > histogram.maxCycles) {
+        histogram.maxCycles = cycles;
+    }
+    // Bucket b holds runs of [4^b, 4^(b+1)) microseconds
+    uint32_t us = cycles / cyclesPerUs;
+    uint32_t bucket = us == 0 ? 0 : (31 - __builtin_clz(us)) / 2;
+    histogram.buckets[bucket < INSTR_BUCKETS ? bucket : INSTR_BUCKETS - 1]++;
+}
+
+void Instrumentation::record(int section, uint32_t cycles) {
+    if (section < 0 || section >= sectionCount) {
+        return;
+    }
+    add(sections[section], cycles, cyclesPerUs);
+    records++;
+}
+
+void Instrumentation::reset() {
+    for (uint8_t i = 0; i < sectionCount; i++) {
+        const char *name = sections[i].name;
+        memset(&sections[i], 0, sizeof(sections[i]));
+        sections[i].name = name;
+    }
+}
+
+size_t Instrumentation::encodeTelemetry(uint32_t busyUs, const uint32_t *counters, uint8_t counterCount,
+                                        uint8_t *out, size_t capacity) {
+    uint32_t now = micros();
+    uint32_t elapsedUs = now - lastMicros;
+    uint32_t taskPermille[INSTR_MAX_TASKS];
+    uint32_t corePermille[2] = {TELEMETRY_UNKNOWN, TELEMETRY_UNKNOWN};
+    for (uint8_t i = 0; i < taskCount; i++) {
+        taskPermille[i] = TELEMETRY_UNKNOWN;
+    }
+
+#if INSTR_RUN_TIME_STATS
+    static TaskStatus_t system[kMaxSystemTasks];  // Only the scheduler's task encodes telemetry
+    uint32_t totalRunTime = 0;
+    UBaseType_t found = uxTaskGetSystemState(system, kMaxSystemTasks, &totalRunTime);
+    uint32_t totalDelta = totalRunTime - lastTotalRunTime;
+    for (UBaseType_t t = 0; t < found; t++) {
+        for (uint8_t i = 0; i < taskCount; i++) {
+            if (system[t].xHandle == tasks[i]) {
+                taskPermille[i] = permille(system[t].ulRunTimeCounter - taskRunTime[i], totalDelta);
+                taskRunTime[i] = system[t].ulRunTimeCounter;
+            }
+        }
+        for (int core = 0; core < 2; core++) {
+            if (system[t].xHandle == xTaskGetIdleTaskHandleForCPU(core)) {
+                uint32_t idle = permille(system[t].ulRunTimeCounter - lastIdleRunTime[core], totalDelta);
+                corePermille[core] = idle == TELEMETRY_UNKNOWN ? idle : 1000 - idle;
+                lastIdleRunTime[core] = system[t].ulRunTimeCounter;
+            }
+        }
+    }
+    lastTotalRunTime = totalRunTime;
+#endif
+
+    // Share of the loop's work spent timing sections
+    uint32_t busyDelta = busyUs - lastBusyUs;
+    uint64_t overheadCycles = (uint64_t)records * recordCycles;
+    uint32_t overheadPpm = busyDelta == 0 ? 0 : (uint32_t)(overheadCycles * 1000000 / ((uint64_t)busyDelta * cyclesPerUs));
+
+    uint8_t *p = out;
+    uint8_t *end = out + capacity;
+    size_t header = 1 + 4 + 2 * 4 + 1 + 4 * (size_t)counterCount;
+    if (capacity < header + 2 || counterCount > INSTR_MAX_COUNTERS) {
+        return 0;
+    }
+    *p++ = TELEMETRY_VERSION;
+    p = putU32(p, millis());
+    p = putU16(p, permille(busyDelta, elapsedUs));
+    p = putU16(p, corePermille[0]);
+    p = putU16(p, corePermille[1]);
+    p = putU16(p, overheadPpm);
+    *p++ = counterCount;
+    for (uint8_t i = 0; i < counterCount; i++) {
+        p = putU32(p, counters[i]);
+    }
+
+    const size_t sectionSize = 4 + 2 + 2 * INSTR_BUCKETS;
+    uint8_t *sectionCountAt = p++;
+    uint8_t written = 0;
+    for (uint8_t i = 0; i < sectionCount && (size_t)(end - p) >= sectionSize + 1; i++) {
+        const SectionHistogram &histogram = sections[i];
+        p = putU32(p, histogram.runs);
+        p = putU16(p, histogram.maxCycles / cyclesPerUs);
+        for (uint8_t b = 0; b < INSTR_BUCKETS; b++) {
+            p = putU16(p, histogram.buckets[b]);
+        }
+        written++;
+    }
+    *sectionCountAt = written;
+
+    const size_t taskSize = 4 + 2 + 2;
+    uint8_t *taskCountAt = p++;
+    written = 0;
+    for (uint8_t i = 0; i < taskCount && (size_t)(end - p) >= taskSize; i++) {
+        const char *name = pcTaskGetName(tasks[i]);
+        for (int c = 0; c < 4; c++) {
+            *p++ = (uint8_t)(*name ? *name++ : 0);
+        }
+        p = putU16(p, uxTaskGetStackHighWaterMark(tasks[i]));
+        p = putU16(p, taskPermille[i]);
+        written++;
+    }
+    *taskCountAt = written;
+
+    lastMicros = now;
+    lastBusyUs = busyUs;
+    records = 0;
+    cyclesPerUs = getCpuFrequencyMhz() > 0 ? getCpuFrequencyMhz() : 1;
+    return p - out;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file Instrumentation.h
+ * @brief Lightweight runtime instrumentation: section latency histograms, task stack and CPU use.
+ *
+ * A section is a named piece of code timed with the CPU cycle counter (`INSTRUMENT(section)` at the
+ * top of a scope). Each section keeps a run count, the longest run and a histogram of run times in
+ * `INSTR_BUCKETS` fixed buckets of powers of four microseconds: <4 us, <16 us, ..., >=16 ms.
+ * Recording a run costs two cycle-counter reads and a few integer operations.
+ *
+ * Watched tasks report their stack high-water mark and, when FreeRTOS run-time statistics are
+ * enabled in the SDK configuration, their share of CPU time and the load of each core.
+ *
+ * Everything is packed into a `FRAME_TELEMETRY` payload on request:
+ *
+ *     | version (1) | uptime ms u32 | loop busy permille u16 | core 0 load permille u16 | core 1 load permille u16 |
+ *     | overhead ppm u16 | counter count (1) | counters u32... |
+ *     | section count (1) | per section: runs u32 | max us u16 | INSTR_BUCKETS buckets u16 |
+ *     | task count (1) | per task: name (4) | free stack bytes u16 | CPU permille u16 |
+ *
+ * Rates are measured since the previous telemetry payload. The overhead is the time spent recording
+ * section runs, in parts per million of the time the scheduler spent running jobs. Permille values are 0xFFFF when unknown,
+ * and u16 counts and times saturate at 0xFFFF. Sections are identified by their registration order.
+ */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_cpu.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/** @brief Build with `-D INSTRUMENTATION=0` to compile every `INSTRUMENT()` out. */
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION 1
+#endif
+
+#define INSTR_MAX_SECTIONS 8    ///< Maximum number of sections.
+#define INSTR_BUCKETS 8         ///< Histogram buckets per section.
+#define INSTR_MAX_TASKS 4       ///< Maximum number of watched tasks.
+#define INSTR_MAX_COUNTERS 12   ///< Maximum number of counters in a telemetry payload.
+
+/** @brief Layout version written in the first telemetry byte. */
+#define TELEMETRY_VERSION 1
+
+/** @brief Sentinel for a permille value that could not be measured. */
+#define TELEMETRY_UNKNOWN 0xFFFF
+
+/**
+ * @struct SectionHistogram
+ * @brief Run-time statistics of one section.
+ */
+struct SectionHistogram {
+    const char *name;                   ///< Name given at registration.
+    uint32_t runs;                      ///< Recorded runs.
+    uint32_t maxCycles;                 ///< Longest run in CPU cycles.
+    uint32_t buckets[INSTR_BUCKETS];    ///< Runs per power-of-four microsecond bucket.
+};
+
+/**
+ * @class Instrumentation
+ * @brief Section histograms, watched tasks and telemetry encoding.
+ *
+ * `record()` is meant to be called from one task (the scheduler's); the counters are plain integers.
+ */
+class Instrumentation {
+    public:
+        Instrumentation();
+
+        /**
+         * @brief Measures the cost of recording a run, to report the instrumentation overhead.
+         */
+        void begin();
+
+        /**
+         * @brief Registers a section.
+         *
+         * @return The section index, or -1 if the table is full.
+         */
+        int addSection(const char *name);
+
+        /**
+         * @brief Watches the stack and CPU use of a task.
+         *
+         * @return false if `INSTR_MAX_TASKS` tasks are already watched.
+         */
+        bool watchTask(TaskHandle_t task);
+
+        /** @brief Records one run of `section` that took `cycles` CPU cycles. */
+        void record(int section, uint32_t cycles);
+
+        /** @brief Clears every histogram. */
+        void reset();
+
+        /** @brief Statistics of a section. */
+        const SectionHistogram &section(int index) const { return sections[index]; }
+
+        /**
+         * @brief Encodes the telemetry payload.
+         *
+         * Sections and tasks that do not fit `capacity` are left out.
+         *
+         * @param busyUs Microseconds the scheduler spent in jobs (wrapping counter), for the loop busy share.
+         * @param counters Counters to include, in an order known to the receiver.
+         * @param counterCount Number of counters (at most `INSTR_MAX_COUNTERS`).
+         * @param out Output buffer.
+         * @param capacity Size of `out`.
+         * @return Payload length.
+         */
+        size_t encodeTelemetry(uint32_t busyUs, const uint32_t *counters, uint8_t counterCount, uint8_t *out, size_t capacity);
+
+    private:
+        static void add(SectionHistogram &histogram, uint32_t cycles, uint32_t cyclesPerUs);
+
+        SectionHistogram sections[INSTR_MAX_SECTIONS];
+        uint8_t sectionCount;
+        TaskHandle_t tasks[INSTR_MAX_TASKS];
+        uint32_t taskRunTime[INSTR_MAX_TASKS];  ///< Run-time counter of each task at the last payload.
+        uint8_t taskCount;
+        uint32_t cyclesPerUs;       ///< CPU clock in MHz.
+        uint32_t recordCycles;      ///< Measured cost of one `record()` call and its cycle-counter reads.
+        uint32_t records;           ///< Runs recorded since the last payload.
+        uint32_t lastMicros;        ///< Time of the last payload.
+        uint32_t lastBusyUs;
+        uint32_t lastTotalRunTime;
+        uint32_t lastIdleRunTime[2];
+};
+
+/**
+ * @class SectionTimer
+ * @brief Records the run time of the enclosing scope into a section.
+ */
+class SectionTimer {
+    public:
+        SectionTimer(Instrumentation &instrumentation, int section)
+            : instrumentation(instrumentation), section(section), start(esp_cpu_get_ccount()) {}
+        ~SectionTimer() { instrumentation.record(section, esp_cpu_get_ccount() - start); }
+
+    private:
+        Instrumentation &instrumentation;
+        int section;
+        uint32_t start;
+};
+
+#if INSTRUMENTATION
+/** @brief Times the rest of the enclosing scope as `section` of the `instruments` global. */
+#define INSTRUMENT(section) SectionTimer sectionTimer_##section(instruments, section)
+#else
+#define INSTRUMENT(section)
+#endif
+
+#endif // !INSTRUMENTATION_H
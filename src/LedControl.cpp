@@ -7,6 +7,8 @@
  */
 
 #include "LedControl.h"
+#include "DeferredLog.h"
+#include "LedcFade.h"
 
 /**
  * @brief Constructs a LedControl object.
@@ -16,31 +18,38 @@
  */
 LedControl::LedControl() {}
 
+/**
+ * @brief Attaches the LED pins to their LEDC channels and turns the LED off.
+ * 
+ * The channels are 8-bit, so a color component is written as its duty unchanged.
+ */
+void LedControl::setpins() {
+    const uint8_t pins[3] = {redpin, greenpin, bluepin};
+    for (uint8_t i = 0; i < 3; i++) {
+        ledcSetup(LED_LEDC_CHANNEL + i, LED_PWM_FREQ, 8);   ///< 8-bit channel per color component.
+        ledcAttachPin(pins[i], LED_LEDC_CHANNEL + i);
+        ledcWrite(LED_LEDC_CHANNEL + i, 0);
+    }
+    LOG(LED_PINS_SET); ///< Output message indicating pin setup.
+}
+
 /**
  * @brief Changes the color of the RGB LED.
  * 
- * This method sets the color of the RGB LED by adjusting the PWM values for the red, green,
- * and blue color channels. The `analogWrite` function is used to control the brightness of
- * each color component.
+ * This method sets the color of the RGB LED by writing the red, green and blue brightness
+ * levels to their LEDC channels.
  * 
  * @param red The brightness level of the red color component (0-255).
  * @param green The brightness level of the green color component (0-255).
  * @param blue The brightness level of the blue color component (0-255).
  */
-void LedControl::setpins() {
-    pinMode(redpin, OUTPUT);   ///< Set the red color pin as an output.
-    pinMode(greenpin, OUTPUT); ///< Set the green color pin as an output.
-    pinMode(bluepin, OUTPUT);  ///< Set the blue color pin as an output.
-    Serial.println("LED pins set"); ///< Output message indicating pin setup.
-
-    analogWrite(redpin, 0);
-    analogWrite(greenpin, 0);
-    analogWrite(bluepin, 0);
+void LedControl::changecolor(uint8_t red, uint8_t green, uint8_t blue) {
+    fadecolor(red, green, blue, 0);
 }
 
-void LedControl::changecolor(uint8_t red, uint8_t green, uint8_t blue) {
-    analogWrite(redpin, red);   ///< Set the red color component brightness.
-    analogWrite(greenpin, green); ///< Set the green color component brightness.
-    analogWrite(bluepin, blue);  ///< Set the blue color component brightness.
-    Serial.println("LED color changed"); ///< Output message indicating color change.
+void LedControl::fadecolor(uint8_t red, uint8_t green, uint8_t blue, uint32_t ms) {
+    ledcFadeTo(LED_LEDC_CHANNEL, red, ms);       ///< Set the red color component brightness.
+    ledcFadeTo(LED_LEDC_CHANNEL + 1, green, ms); ///< Set the green color component brightness.
+    ledcFadeTo(LED_LEDC_CHANNEL + 2, blue, ms);  ///< Set the blue color component brightness.
+    LOG(LED_COLOR_CHANGED, red, green, blue); ///< Output message indicating color change.
 }
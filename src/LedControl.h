@@ -5,6 +5,7 @@
  * This header file defines the `LedControl` class, which manages the color of an RGB LED.
  * It includes the class declaration, member variables, and method declarations for controlling
  * the LED color by adjusting the brightness levels of its red, green, and blue components.
+ * Each component is driven by its own LEDC channel, so a color change can be a hardware fade.
  */
 
 #ifndef LED_CONTROL_H
@@ -13,6 +14,12 @@
 #include "stdint.h"
 #include "Arduino.h"
 
+/** @brief First of the three LEDC channels of the LED (red, green, blue), in the low-speed group. */
+#define LED_LEDC_CHANNEL 8
+
+/** @brief PWM frequency of the LED channels, Hz. */
+#define LED_PWM_FREQ 5000
+
 /**
  * @class LedControl
  * @brief A class for controlling the color of an RGB LED.
@@ -37,7 +44,7 @@ class LedControl {
          * 
          * This method sets the color of the RGB LED by adjusting the PWM values for the red,
          * green, and blue color channels. The brightness of each color component is set using
-         * the `analogWrite` function.
+         * its LEDC channel.
          * 
          * @param red The brightness level of the red color component (0-255).
          * @param green The brightness level of the green color component (0-255).
@@ -45,6 +52,16 @@ class LedControl {
          */
         void changecolor(uint8_t red, uint8_t green, uint8_t blue); ///< Change LED color.
 
+        /**
+         * @brief Fades the RGB LED to a color with the LEDC fade engine and returns at once.
+         * 
+         * @param red The brightness level of the red color component (0-255).
+         * @param green The brightness level of the green color component (0-255).
+         * @param blue The brightness level of the blue color component (0-255).
+         * @param ms Fade time; no other fade may be started on the LED before it has passed.
+         */
+        void fadecolor(uint8_t red, uint8_t green, uint8_t blue, uint32_t ms);
+
     private:
         uint8_t redpin = 5;   ///< GPIO pin number connected to the red color component.
         uint8_t greenpin = 18; ///< GPIO pin number connected to the green color component.
@@ -0,0 +1,34 @@
+/**
+ * @file LedcFade.cpp
+ * @brief LEDC hardware fades through the ESP-IDF fade service.
+ */
+
+#include "LedcFade.h"
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+
+namespace {
+
+bool installed = false;
+
+} // namespace
+
+bool ledcFadeBegin() {
+    installed = ledc_fade_func_install(0) == ESP_OK;
+    return installed;
+}
+
+void ledcFadeTo(uint8_t channel, uint32_t duty, uint32_t ms) {
+    if (ms == 0 || !installed) {
+        ledcWrite(channel, duty);
+        return;
+    }
+    // The Arduino core numbers the ESP32's high-speed channels 0-7 and its low-speed channels 8-15
+    ledc_mode_t mode = (ledc_mode_t)(channel / LEDC_CHANNEL_MAX);
+    ledc_channel_t hardwareChannel = (ledc_channel_t)(channel % LEDC_CHANNEL_MAX);
+    if (ledc_set_fade_with_time(mode, hardwareChannel, duty, (int)ms) != ESP_OK ||
+        ledc_fade_start(mode, hardwareChannel, LEDC_FADE_NO_WAIT) != ESP_OK) {
+        ledcWrite(channel, duty);
+    }
+}
@@ -0,0 +1,31 @@
+/**
+ * @file LedcFade.h
+ * @brief Duty transitions run by the LEDC hardware fade engine.
+ *
+ * A fade is started and left to the LEDC peripheral, which steps the duty on its own, so no task
+ * spends time on a ramp. The ESP-IDF fade service serialises fades per channel: starting a new fade
+ * while one is running blocks the caller until the running one ends, so callers wait for
+ * `ledcFadeTo()`'s fade time to pass before they start another on the same channel.
+ */
+
+#ifndef LEDC_FADE_H
+#define LEDC_FADE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Installs the fade service. Call once, before the first `ledcFadeTo()`.
+ *
+ * @return false if the service could not be installed; fades are then plain writes.
+ */
+bool ledcFadeBegin();
+
+/**
+ * @brief Moves an Arduino LEDC channel to `duty` in `ms` milliseconds without waiting.
+ *
+ * The channel must have been set up with `ledcSetup()` and `ledcAttachPin()`. With `ms` 0 the duty
+ * is written at once.
+ */
+void ledcFadeTo(uint8_t channel, uint32_t duty, uint32_t ms);
+
+#endif // !LEDC_FADE_H
@@ -0,0 +1,191 @@
+/**
+ * @file LogCatalog.cpp
+ * @brief Format strings of the log catalog, record formatting and the binary record codec.
+ *
+ * Nothing here depends on the Arduino core, so the host log decoder links this file as is.
+ */
+
+#include "LogCatalog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+#define LOG_CATALOG_FORMAT(name, level, format) format,
+const char *const kLogFormats[] = { LOG_MESSAGES(LOG_CATALOG_FORMAT) };
+#undef LOG_CATALOG_FORMAT
+
+const char kLevelLetters[] = "-EWID";
+
+/** @brief Longest conversion specification, e.g. `%-+#012.6f`. */
+const size_t kMaxSpec = 16;
+
+void putU16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+}
+
+void putU32(uint8_t *out, uint32_t value) {
+    putU16(out, (uint16_t)(value & 0xFFFF));
+    putU16(out + 2, (uint16_t)(value >> 16));
+}
+
+uint32_t getU32(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * @brief Appends printf output to a line, keeping track of the truncation.
+ */
+class LineWriter {
+    public:
+        LineWriter(char *out, size_t capacity) : out(out), capacity(capacity), length(0) {
+            if (capacity > 0) {
+                out[0] = '\0';
+            }
+        }
+
+        template <typename... Args>
+        void print(const char *format, Args... args) {
+            if (length + 1 >= capacity) {
+                return;
+            }
+            int written = snprintf(out + length, capacity - length, format, args...);
+            if (written > 0) {
+                length += (size_t)written < capacity - length ? (size_t)written : capacity - length - 1;
+            }
+        }
+
+        void put(char c) {
+            if (length + 1 < capacity) {
+                out[length++] = c;
+                out[length] = '\0';
+            }
+        }
+
+        size_t size() const { return length; }
+
+    private:
+        char *out;
+        size_t capacity;
+        size_t length;
+};
+
+} // namespace
+
+const char *logFormat(uint16_t id) {
+    return id < LOG_MESSAGE_COUNT ? kLogFormats[id] : NULL;
+}
+
+uint8_t logLevel(uint16_t id) {
+    return id < LOG_MESSAGE_COUNT ? kLogLevels[id] : LOG_LEVEL_NONE;
+}
+
+size_t formatLogRecord(const LogRecord &record, char *out, size_t capacity) {
+    LineWriter line(out, capacity);
+    line.print("%lu.%03lu %c ", (unsigned long)(record.time / 1000), (unsigned long)(record.time % 1000),
+               kLevelLetters[logLevel(record.id)]);
+
+    const char *format = logFormat(record.id);
+    if (!format) {
+        line.print("unknown message %u", (unsigned)record.id);
+        for (uint8_t i = 0; i < record.argc && i < LOG_MAX_ARGS; i++) {
+            line.print(" 0x%08lx", (unsigned long)record.args[i]);
+        }
+        return line.size();
+    }
+
+    uint8_t arg = 0;
+    while (*format) {
+        if (*format != '%') {
+            line.put(*format++);
+            continue;
+        }
+        if (format[1] == '%') {
+            line.put('%');
+            format += 2;
+            continue;
+        }
+
+        // Copy one conversion specification and print it with its argument
+        char spec[kMaxSpec];
+        size_t n = 0;
+        spec[n++] = *format++;
+        while (*format && strchr("-+ #0123456789.", *format) && n < kMaxSpec - 2) {
+            spec[n++] = *format++;
+        }
+        char conversion = *format;
+        if (!conversion) {
+            break;
+        }
+        format++;
+        uint32_t value = arg < record.argc && arg < LOG_MAX_ARGS ? record.args[arg] : 0;
+        arg++;
+
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                spec[n++] = 'l';
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                line.print(spec, (long)(int32_t)value);
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+                spec[n++] = 'l';
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                line.print(spec, (unsigned long)value);
+                break;
+            case 'c':
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                line.print(spec, (int)(char)value);
+                break;
+            case 'f':
+            case 'e':
+            case 'g': {
+                float number;
+                memcpy(&number, &value, sizeof(number));
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                line.print(spec, (double)number);
+                break;
+            }
+            default:
+                line.put('?');
+                break;
+        }
+    }
+    return line.size();
+}
+
+size_t encodeLogRecord(const LogRecord &record, uint8_t *out, size_t capacity) {
+    uint8_t argc = record.argc < LOG_MAX_ARGS ? record.argc : LOG_MAX_ARGS;
+    size_t length = 2 + 4 + 1 + 4 * (size_t)argc;
+    if (capacity < length) {
+        return 0;
+    }
+    putU16(out, record.id);
+    putU32(out + 2, record.time);
+    out[6] = argc;
+    for (uint8_t i = 0; i < argc; i++) {
+        putU32(out + 7 + 4 * i, record.args[i]);
+    }
+    return length;
+}
+
+size_t decodeLogRecord(const uint8_t *data, size_t length, LogRecord &record) {
+    if (length < 7 || data[6] > LOG_MAX_ARGS || length < 7 + 4 * (size_t)data[6]) {
+        return 0;
+    }
+    record.id = (uint16_t)(data[0] | (data[1] << 8));
+    record.time = getU32(data + 2);
+    record.argc = data[6];
+    for (uint8_t i = 0; i < record.argc; i++) {
+        record.args[i] = getU32(data + 7 + 4 * i);
+    }
+    return 7 + 4 * (size_t)record.argc;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file LogCatalog.h
+ * @brief Catalog of the firmware's log messages and the binary log record format.
+ *
+ * A log call site does not format anything: it stores the id of its message and up to
+ * `LOG_MAX_ARGS` raw 32-bit arguments. The format string is looked up when the record is
+ * printed, on the device by the log drainer or on a PC by `tools/logdecode.cpp`, which is
+ * built from this same catalog.
+ *
+ * Formats take `%d %i %u %x %X %c` (integers) and `%f %e %g` (floats), with the usual flags,
+ * width and precision, and `%%`. Strings cannot be logged.
+ *
+ * In a binary log dump every record is encoded as:
+ *
+ *     | id u16 | time ms u32 | argument count (1) | arguments u32... |
+ *
+ * Records are packed into `FRAME_LOG` frames (see SerialFrame.h). A dump can only be decoded
+ * with the catalog of the firmware that produced it.
+ */
+
+#ifndef LOG_CATALOG_H
+#define LOG_CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Log levels. A message is kept when its level is at most `LOG_LEVEL`. */
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+/** @brief Arguments per record. */
+#define LOG_MAX_ARGS 4
+
+/** @brief Largest encoded record. */
+#define LOG_RECORD_MAX_ENCODED (2 + 4 + 1 + 4 * LOG_MAX_ARGS)
+
+/**
+ * @brief Every log message: X(name, level, format).
+ *
+ * Append new messages at the end so the ids of older dumps stay valid.
+ */
+#define LOG_MESSAGES(X) \
+    X(DROPPED, LOG_LEVEL_WARN, "%u log records dropped") \
+    X(DHT11_READ_FAILED, LOG_LEVEL_WARN, "Failed to read from DHT sensor!") \
+    X(DHT11_READING, LOG_LEVEL_INFO, "DHT11 - Temperature: %.2f °C, Humidity: %.2f %%") \
+    X(PMS5003_READING, LOG_LEVEL_INFO, "PMS5003 - PM2.5: %u ug/m3") \
+    X(MQ7_READING, LOG_LEVEL_INFO, "MQ7 - CO: %.2f ppm (%u conversions)") \
+    X(MQ7_GAS_DETECTED, LOG_LEVEL_WARN, "Gas Detected") \
+    X(MQ7_ADC_UNAVAILABLE, LOG_LEVEL_ERROR, "MQ7 ADC unavailable") \
+    X(READING_SENT, LOG_LEVEL_DEBUG, "Reading sent: %u bytes, fields 0x%02x") \
+    X(COMMAND_APPLIED, LOG_LEVEL_INFO, "Command: RGB %u %u %u, duty cycle %u") \
+    X(COMMAND_PARSE_FAILED, LOG_LEVEL_WARN, "Failed to parse JSON") \
+    X(COMMAND_INVALID, LOG_LEVEL_WARN, "Invalid command received, discarding data") \
+    X(LED_PINS_SET, LOG_LEVEL_INFO, "LED pins set") \
+    X(LED_COLOR_CHANGED, LOG_LEVEL_DEBUG, "LED color changed to %u %u %u") \
+    X(MOTOR_SPEED_CHANGED, LOG_LEVEL_DEBUG, "Motor speed changed to %u") \
+    X(UPLINK_PENDING, LOG_LEVEL_INFO, "Uplink store: %u batches pending") \
+    X(UPLINK_UNAVAILABLE, LOG_LEVEL_WARN, "Uplink store unavailable, sending batches without acknowledgement") \
+    X(JOBS_STARTED, LOG_LEVEL_INFO, "Job creation and other processes started") \
+    X(CONTROL_REJECTED, LOG_LEVEL_WARN, "Command seq %u opcode 0x%02x rejected: status 0x%02x") \
+    X(FAN_MODE, LOG_LEVEL_INFO, "Fan control auto %u, PM2.5 setpoint %.1f ug/m3, duty %u-%u") \
+    X(BOOT_LINKS_UP, LOG_LEVEL_INFO, "Boot: links and actuators up at %u ms") \
+    X(BOOT_DHT11_SAMPLE, LOG_LEVEL_INFO, "Boot: first DHT11 sample at %u ms") \
+    X(BOOT_PMS5003_SAMPLE, LOG_LEVEL_INFO, "Boot: first PMS5003 sample at %u ms") \
+    X(BOOT_MQ7_SAMPLE, LOG_LEVEL_INFO, "Boot: first MQ7 sample at %u ms") \
+    X(BOOT_COMPLETE, LOG_LEVEL_INFO, "Boot: time to first sample DHT11 %u ms, PMS5003 %u ms, MQ7 %u ms") \
+    X(POWER_REPORT, LOG_LEVEL_INFO, "Power: %u mW average, %u uJ per reported sample, PMS5003 awake %u permille") \
+    X(POWER_LIGHT_SLEEP_UNAVAILABLE, LOG_LEVEL_WARN, "Light sleep not supported by this build, idling at %u MHz") \
+    X(CONFIG_LOADED, LOG_LEVEL_INFO, "Config: source %u (0 defaults, 1 stored, 2 upgraded), version %u") \
+    X(CONFIG_APPLIED, LOG_LEVEL_INFO, "Config: generation %u applied, saved %u") \
+    X(BLE_MTU_CHANGED, LOG_LEVEL_INFO, "BLE MTU %u, %u snapshots per notification") \
+    X(BLE_CHUNK_DROPPED, LOG_LEVEL_WARN, "BLE chunk dropped, %u so far") \
+    X(TRACE_DUMP, LOG_LEVEL_INFO, "Trace: dumping %u bytes, %u records overwritten, %u skipped during dumps") \
+    X(BLE_PROVISIONING, LOG_LEVEL_INFO, "Waiting for client connection to notify")
+
+#define LOG_CATALOG_ID(name, level, format) LOG_##name,
+#define LOG_CATALOG_LEVEL(name, level, format) level,
+
+/**
+ * @brief Message ids, `LOG_` followed by the catalog name.
+ */
+enum LogId : uint16_t {
+    LOG_MESSAGES(LOG_CATALOG_ID)
+    LOG_MESSAGE_COUNT
+};
+
+/** @brief Level of every message, indexed by id. */
+constexpr uint8_t kLogLevels[] = { LOG_MESSAGES(LOG_CATALOG_LEVEL) };
+
+/**
+ * @struct LogRecord
+ * @brief One logged message: its id, when it was logged and its raw arguments.
+ */
+struct LogRecord {
+    uint16_t id;                    ///< A `LogId`.
+    uint8_t argc;                   ///< Number of arguments.
+    uint32_t time;                  ///< `millis()` when the message was logged.
+    uint32_t args[LOG_MAX_ARGS];    ///< Integers as their two's complement, floats as their IEEE 754 bits.
+};
+
+/** @brief Format string of a message, or NULL for an unknown id. */
+const char *logFormat(uint16_t id);
+
+/** @brief Level of a message, or `LOG_LEVEL_NONE` for an unknown id. */
+uint8_t logLevel(uint16_t id);
+
+/**
+ * @brief Formats a record as one text line without the line ending.
+ *
+ * The line is `<seconds>.<milliseconds> <E|W|I|D> <message>`, truncated to `capacity - 1`
+ * characters. Missing arguments print as 0.
+ *
+ * @return Length of the line.
+ */
+size_t formatLogRecord(const LogRecord &record, char *out, size_t capacity);
+
+/**
+ * @brief Encodes a record in the binary dump format.
+ *
+ * @return Encoded length, or 0 if `capacity` is too small.
+ */
+size_t encodeLogRecord(const LogRecord &record, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Decodes one record from the binary dump format.
+ *
+ * @return Bytes consumed, or 0 if `data` does not start with a complete record.
+ */
+size_t decodeLogRecord(const uint8_t *data, size_t length, LogRecord &record);
+
+#endif // !LOG_CATALOG_H
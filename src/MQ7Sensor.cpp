@@ -1,37 +1,195 @@
 /**
  * @file MQ7Sensor.cpp
  * @brief Implementation of the MQ7Sensor class for interfacing with the MQ7 gas sensor.
- * 
- * This file contains the implementation of the `MQ7Sensor` class, which provides methods
- * for initializing and reading data from the MQ7 gas sensor.
+ *
+ * This file contains the implementation of the `MQ7Sensor` class, which drives the MQ7 heater
+ * cycle and measures the sensor output with the continuous ADC.
  */
 
 #include "MQ7Sensor.h"
 #include "Arduino.h" // Include necessary library for Arduino functions
 
+#include <math.h>
+
+#include <driver/adc.h>
+
+namespace {
+
+/** @brief GPIO of each ADC1 channel. */
+const uint8_t kAdc1Pins[8] = {36, 37, 38, 39, 32, 33, 34, 35};
+
+/** @brief Datasheet CO curve: ppm = a * (Rs / R0)^b. */
+const float kCurveA = 99.042f;
+const float kCurveB = -1.518f;
+
+const float kMaxPpm = 4000.0f;
+
+int8_t adc1Channel(uint8_t pin) {
+    for (int8_t i = 0; i < 8; i++) {
+        if (kAdc1Pins[i] == pin) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
 /**
  * @brief Constructs an MQ7Sensor object.
- * 
- * The constructor initializes the `MQ7Sensor` object by setting up the pin used for
- * interfacing with the MQ7 sensor. The pin is set as an input to read digital values
- * from the sensor.
- * 
- * @param pin The pin number to which the MQ7 sensor is connected.
+ *
+ * Nothing is configured until `begin()`, so the object can be a global.
+ *
+ * @param pin The ADC1 pin to which the MQ7 output is connected.
+ * @param heaterPin The pin driving the heater MOSFET.
+ */
+MQ7Sensor::MQ7Sensor(uint8_t pin, uint8_t heaterPin)
+    : gaspin(pin), heaterpin(heaterPin), channel(adc1Channel(pin)), adcReady(false), efuseCalibration(false),
+      heaterPhase(MQ7_HEATER_HIGH), phaseStart(0), sum(0), count(0), lastConversions(0), r0(MQ7_DEFAULT_R0_OHMS) {}
+
+bool MQ7Sensor::begin() {
+    ledcSetup(MQ7_HEATER_CHANNEL, MQ7_HEATER_FREQ, 8);
+    ledcAttachPin(heaterpin, MQ7_HEATER_CHANNEL);
+    setPhase(MQ7_HEATER_HIGH, millis());
+
+    if (channel < 0) {
+        return false;
+    }
+
+    // eFuse Vref or two-point values when the chip has them, the nominal 1100 mV otherwise
+    esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcCharacteristics);
+    efuseCalibration = source != ESP_ADC_CAL_VAL_DEFAULT_VREF;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = MQ7_ADC_POOL_BYTES;
+    init.conv_num_each_intr = 256;
+    init.adc1_chan_mask = BIT(channel);
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) {
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = (uint8_t)channel;
+    pattern.unit = 0;   // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;    // Required on the ESP32
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = MQ7_ADC_SAMPLE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+    if (adc_digi_controller_configure(&config) != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+    adcReady = true;
+    return true;
+}
+
+void MQ7Sensor::setPhase(MQ7HeaterPhase phase, uint32_t now) {
+    heaterPhase = phase;
+    phaseStart = now;
+    switch (phase) {
+        case MQ7_HEATER_HIGH:
+            ledcWrite(MQ7_HEATER_CHANNEL, MQ7_HEATER_HIGH_DUTY);
+            break;
+        case MQ7_HEATER_LOW:
+            ledcWrite(MQ7_HEATER_CHANNEL, MQ7_HEATER_LOW_DUTY);
+            break;
+        default:
+            // Same heater voltage; the ADC only runs during this window.
+            sum = 0;
+            count = 0;
+            if (adcReady) {
+                adc_digi_start();
+            }
+            break;
+    }
+}
+
+/**
+ * Adds the conversions buffered by the DMA to the running sum. When the pool filled up between two
+ * calls the driver dropped the newer conversions; the average is taken over those that were kept.
  */
-MQ7Sensor::MQ7Sensor(uint8_t pin) : gaspin(pin) {
-    pinMode(gaspin, INPUT); ///< Initialize the pin mode for the sensor as INPUT.
+void MQ7Sensor::drain() {
+    if (!adcReady) {
+        return;
+    }
+    uint8_t buffer[256];
+    uint32_t total = 0;
+    while (total < MQ7_ADC_POOL_BYTES) {
+        uint32_t length = 0;
+        esp_err_t result = adc_digi_read_bytes(buffer, sizeof(buffer), &length, 0);
+        if ((result != ESP_OK && result != ESP_ERR_INVALID_STATE) || length == 0) {
+            break;
+        }
+        for (uint32_t i = 0; i + 1 < length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            adc_digi_output_data_t conversion;
+            conversion.val = (uint16_t)(buffer[i] | (buffer[i + 1] << 8));
+            if (conversion.type1.channel == (uint8_t)channel) {
+                sum += conversion.type1.data;
+                count++;
+            }
+        }
+        total += length;
+    }
 }
 
 /**
- * @brief Reads gas concentration data from the MQ7 sensor.
- * 
- * This method retrieves the gas concentration value from the MQ7 sensor. It reads a
- * digital value from the specified sensor pin and returns it in a `MQ7Data` structure.
- * 
- * @return A `MQ7Data` structure containing the gas concentration reading.
+ * Turns the averaged conversions into a concentration: Rs from the load resistor divider,
+ * then the datasheet power law in Rs / R0.
  */
-MQ7Data MQ7Sensor::gasRead() {
-    MQ7Data data; ///< Structure to hold the gas concentration data.
-    data.gasValue = digitalRead(gaspin); ///< Read digital value from the sensor pin.
-    return data; ///< Return the data structure with the gas concentration reading.
+bool MQ7Sensor::measure(MQ7Data &out) {
+    lastConversions = count;
+    if (count == 0) {
+        return false;
+    }
+    uint32_t average = (sum + count / 2) / count;
+    uint32_t millivolts = esp_adc_cal_raw_to_voltage(average, &adcCharacteristics);
+    out.millivolts = (uint16_t)millivolts;
+
+    float output = millivolts * MQ7_DIVIDER_RATIO;
+    if (output <= 0.0f || output >= MQ7_SUPPLY_MV) {
+        out.ppm = output <= 0.0f ? 0.0f : kMaxPpm;
+    } else {
+        float rs = MQ7_LOAD_OHMS * (MQ7_SUPPLY_MV - output) / output;
+        out.ppm = kCurveA * powf(rs / r0, kCurveB);
+        if (out.ppm > kMaxPpm) {
+            out.ppm = kMaxPpm;
+        }
+    }
+    out.gasValue = (int)lroundf(out.ppm);
+    return true;
+}
+
+bool MQ7Sensor::update(MQ7Data &out) {
+    uint32_t now = millis();
+    uint32_t elapsed = now - phaseStart;
+    switch (heaterPhase) {
+        case MQ7_HEATER_HIGH:
+            if (elapsed >= MQ7_HEATER_HIGH_MS) {
+                setPhase(MQ7_HEATER_LOW, now);
+            }
+            return false;
+        case MQ7_HEATER_LOW:
+            if (elapsed >= MQ7_HEATER_LOW_MS - MQ7_SAMPLE_WINDOW_MS) {
+                setPhase(MQ7_HEATER_SAMPLING, now);
+            }
+            return false;
+        default:
+            drain();
+            if (elapsed < MQ7_SAMPLE_WINDOW_MS) {
+                return false;
+            }
+            if (adcReady) {
+                adc_digi_stop();
+            }
+            setPhase(MQ7_HEATER_HIGH, now);
+            return measure(out);
+    }
 }
@@ -1,10 +1,15 @@
 /**
  * @file MQ7Sensor.h
  * @brief Header file for the MQ7Sensor class.
- * 
+ *
  * This header file defines the `MQ7Sensor` class, which provides methods for interfacing
  * with the MQ7 gas sensor. It includes the class constructor and member functions
- * for reading gas concentration data.
+ * for driving the heater cycle and measuring the CO concentration.
+ *
+ * The MQ-7 only gives a meaningful reading after its heater has cleaned the element at 5 V for 60 s
+ * and then run at 1.4 V for 90 s. The heater is driven through a MOSFET by a LEDC PWM channel, and the
+ * output is measured at the end of the low phase by the ADC in continuous (DMA) mode. The conversions
+ * are averaged, converted to millivolts with the eFuse calibration and turned into a ppm estimate.
  */
 
 #ifndef MQ_7_SENSOR_H
@@ -12,49 +17,121 @@
 
 #include <cstdint> // For uint8_t
 
+#include <esp_adc_cal.h>
+
+/** @brief Heater phase durations. */
+#ifndef MQ7_HEATER_HIGH_MS
+#define MQ7_HEATER_HIGH_MS 60000
+#endif
+#ifndef MQ7_HEATER_LOW_MS
+#define MQ7_HEATER_LOW_MS 90000
+#endif
+
+/** @brief The output is sampled during the last MQ7_SAMPLE_WINDOW_MS of the low phase. */
+#ifndef MQ7_SAMPLE_WINDOW_MS
+#define MQ7_SAMPLE_WINDOW_MS 5000
+#endif
+
+/** @brief Heater PWM: LEDC channel, frequency and 8-bit duties giving the power of 5 V and 1.4 V from a 5 V supply. */
+#define MQ7_HEATER_CHANNEL 4
+#define MQ7_HEATER_FREQ 1000
+#define MQ7_HEATER_HIGH_DUTY 255
+#define MQ7_HEATER_LOW_DUTY 20
+
+/** @brief Continuous ADC sample rate (the ESP32 minimum) and DMA pool size. */
+#define MQ7_ADC_SAMPLE_HZ 20000
+#define MQ7_ADC_POOL_BYTES 4096
+
+/**
+ * @brief Measurement circuit: sensor supply, load resistor, and the divider between the module output and
+ * the ADC pin (output voltage = pin voltage * MQ7_DIVIDER_RATIO).
+ */
+#define MQ7_SUPPLY_MV 5000.0f
+#define MQ7_LOAD_OHMS 10000.0f
+#define MQ7_DIVIDER_RATIO 1.5f
+
+/** @brief Default sensor resistance at 100 ppm CO; calibrate per sensor with `setR0()`. */
+#define MQ7_DEFAULT_R0_OHMS 10000.0f
+
 /**
  * @struct MQ7Data
  * @brief Structure to hold MQ7 gas sensor data.
- * 
- * This structure contains the measurement data from the MQ7 gas sensor. Currently,
- * it holds the gas concentration value read from the sensor.
+ *
+ * This structure contains one measurement of the MQ7 gas sensor, taken at the end of a heater cycle.
  */
 struct MQ7Data {
-    int gasValue; ///< Gas concentration value read from the sensor.
+    int gasValue;           ///< CO concentration rounded to ppm, the value sent upstream.
+    float ppm;              ///< CO concentration estimate in ppm.
+    uint16_t millivolts;    ///< Calibrated average voltage at the ADC pin.
+};
+
+/**
+ * @brief Phase of the MQ-7 heater cycle.
+ */
+enum MQ7HeaterPhase : uint8_t {
+    MQ7_HEATER_HIGH,        ///< 5 V: the element is being cleaned.
+    MQ7_HEATER_LOW,         ///< 1.4 V: CO is being absorbed.
+    MQ7_HEATER_SAMPLING,    ///< End of the low phase: the ADC is converting.
 };
 
 /**
  * @class MQ7Sensor
  * @brief A class for interfacing with the MQ7 gas sensor.
- * 
- * The `MQ7Sensor` class provides methods to initialize the MQ7 sensor and read gas
- * concentration data from it. The class uses a digital pin to communicate with the sensor.
+ *
+ * The `MQ7Sensor` class drives the heater cycle and measures the CO concentration. `update()` never
+ * blocks: the conversions are made by the ADC DMA while the caller does other work.
  */
 class MQ7Sensor {
 public:
     /**
      * @brief Constructs an MQ7Sensor object.
-     * 
-     * The constructor initializes the `MQ7Sensor` object by setting up the pin used
-     * for interfacing with the MQ7 sensor. The pin is configured as an input to read
-     * digital values from the sensor.
-     * 
-     * @param pin The pin number to which the MQ7 sensor is connected.
+     *
+     * @param pin The ADC1 pin to which the MQ7 output is connected (GPIO 32-39).
+     * @param heaterPin The pin driving the heater MOSFET.
      */
-    MQ7Sensor(uint8_t pin); ///< Constructor declaration.
+    MQ7Sensor(uint8_t pin, uint8_t heaterPin);
 
     /**
-     * @brief Reads gas concentration data from the MQ7 sensor.
-     * 
-     * This method retrieves the gas concentration value from the MQ7 sensor. It reads
-     * a digital value from the specified sensor pin and returns it in an `MQ7Data` structure.
-     * 
-     * @return An `MQ7Data` structure containing the gas concentration reading.
+     * @brief Starts the heater cycle and sets up the continuous ADC and its calibration.
+     *
+     * @return false if the pin is not an ADC1 pin or the ADC driver could not be set up.
      */
-    MQ7Data gasRead(); ///< Member function declaration.
+    bool begin();
+
+    /**
+     * @brief Advances the heater cycle and collects the conversions made since the last call.
+     *
+     * Call it at least every second or two; the phase changes happen on the first call after they are due.
+     *
+     * @param out Receives the measurement when one completes.
+     * @return true once per heater cycle, when a measurement completed.
+     */
+    bool update(MQ7Data &out);
+
+    /** @brief Sets the sensor resistance at 100 ppm CO, in ohms. */
+    void setR0(float ohms) { r0 = ohms; }
+
+    MQ7HeaterPhase phase() const { return heaterPhase; }    ///< Current heater phase.
+    bool calibrated() const { return efuseCalibration; }    ///< True if the ADC calibration came from eFuse.
+    uint32_t conversions() const { return lastConversions; } ///< Conversions averaged into the last measurement.
 
 private:
+    void setPhase(MQ7HeaterPhase phase, uint32_t now);
+    void drain();
+    bool measure(MQ7Data &out);
+
     uint8_t gaspin; ///< Pin number used for interfacing with the MQ7 sensor.
+    uint8_t heaterpin;
+    int8_t channel;  ///< ADC1 channel of `gaspin`, or -1.
+    bool adcReady;
+    bool efuseCalibration;
+    esp_adc_cal_characteristics_t adcCharacteristics;
+    MQ7HeaterPhase heaterPhase;
+    uint32_t phaseStart;
+    uint32_t sum;
+    uint32_t count;
+    uint32_t lastConversions;
+    float r0;
 };
 
 #endif // MQ_7_SENSOR_H
@@ -0,0 +1,111 @@
+/**
+ * @file PMS5003Protocol.cpp
+ * @brief Implementation of the PMS5003 frame decoder and command encoder.
+ */
+
+#include "PMS5003Protocol.h"
+
+#include <string.h>
+
+namespace {
+
+const uint8_t kStart1 = 0x42;
+const uint8_t kStart2 = 0x4D;
+
+/** @brief Length field of a data frame: 13 data words and the checksum. */
+const uint16_t kDataLength = 28;
+
+uint16_t wordAt(const uint8_t *frame, size_t index) {
+    return (uint16_t)((frame[4 + 2 * index] << 8) | frame[5 + 2 * index]);
+}
+
+} // namespace
+
+size_t encodePms5003Command(uint8_t command, uint16_t data, uint8_t *out) {
+    out[0] = kStart1;
+    out[1] = kStart2;
+    out[2] = command;
+    out[3] = (uint8_t)(data >> 8);
+    out[4] = (uint8_t)(data & 0xFF);
+    uint16_t sum = 0;
+    for (int i = 0; i < 5; i++) {
+        sum += out[i];
+    }
+    out[5] = (uint8_t)(sum >> 8);
+    out[6] = (uint8_t)(sum & 0xFF);
+    return PMS5003_COMMAND_SIZE;
+}
+
+PMS5003Parser::PMS5003Parser() : frames(0), checksumErrors(0), framingErrors(0) {
+    memset(&current, 0, sizeof(current));
+    reset();
+}
+
+void PMS5003Parser::reset() {
+    size = 0;
+    expected = 0;
+    sum = 0;
+}
+
+bool PMS5003Parser::feed(uint8_t byte) {
+    // Header hunt: a mismatching second byte may itself start the next frame.
+    if (size == 1 && byte != kStart2) {
+        reset();
+    }
+    if (size == 0) {
+        if (byte == kStart1) {
+            buffer[size++] = byte;
+            sum = byte;
+        }
+        return false;
+    }
+
+    buffer[size++] = byte;
+    if (expected == 0 || size <= expected - 2) {
+        sum += byte;
+    }
+
+    if (size == 4) {
+        uint16_t length = (uint16_t)((buffer[2] << 8) | buffer[3]);
+        if (length < 2 || length + 4 > PMS5003_FRAME_SIZE) {
+            framingErrors++;
+            reset();
+            return false;
+        }
+        expected = (uint8_t)(length + 4);
+        return false;
+    }
+
+    if (size < 4 || size < expected) {
+        return false;
+    }
+
+    // Frame complete.
+    uint16_t received = (uint16_t)((buffer[expected - 2] << 8) | buffer[expected - 1]);
+    bool valid = received == sum;
+    bool dataFrame = expected - 4 == kDataLength;
+    reset();
+
+    if (!valid) {
+        checksumErrors++;
+        return false;
+    }
+    if (!dataFrame) {
+        return false;   // Command acknowledgement.
+    }
+
+    current.pm1_0_cf1 = wordAt(buffer, 0);
+    current.pm2_5_cf1 = wordAt(buffer, 1);
+    current.pm10_cf1 = wordAt(buffer, 2);
+    current.pm1_0 = wordAt(buffer, 3);
+    current.pm2_5 = wordAt(buffer, 4);
+    current.pm10 = wordAt(buffer, 5);
+    current.count0_3 = wordAt(buffer, 6);
+    current.count0_5 = wordAt(buffer, 7);
+    current.count1_0 = wordAt(buffer, 8);
+    current.count2_5 = wordAt(buffer, 9);
+    current.count5_0 = wordAt(buffer, 10);
+    current.count10 = wordAt(buffer, 11);
+    frames++;
+    return true;
+}
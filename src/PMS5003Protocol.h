@@ -0,0 +1,108 @@
+/**
+ * @file PMS5003Protocol.h
+ * @brief PMS5003 serial protocol: data frame decoder and command encoder.
+ *
+ * The sensor sends 32-byte frames at 9600 baud. All fields are big-endian:
+ *
+ *     | 0x42 0x4D | length (2) = 28 | 13 data words (26) | checksum (2) |
+ *
+ * The checksum is the 16-bit sum of every byte before it. The data words are, in order,
+ * PM1.0/PM2.5/PM10 under standard particle conditions (CF=1), PM1.0/PM2.5/PM10 under
+ * atmospheric conditions, the six particle-count bins and a reserved word. In passive mode
+ * the sensor acknowledges commands with a short frame of the same shape (length 4), which
+ * the decoder validates and ignores.
+ *
+ * Commands are 7-byte frames: `0x42 0x4D command dataH dataL checksumH checksumL`.
+ */
+
+#ifndef PMS_5003_PROTOCOL_H
+#define PMS_5003_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Size of a PMS5003 data frame in bytes. */
+#define PMS5003_FRAME_SIZE 32
+
+/** @brief Size of a PMS5003 command frame in bytes. */
+#define PMS5003_COMMAND_SIZE 7
+
+/**
+ * @brief PMS5003 command codes and their data values.
+ */
+enum PMS5003Command : uint8_t {
+    PMS5003_CMD_READ = 0xE2,  ///< Request one frame in passive mode (data 0).
+    PMS5003_CMD_MODE = 0xE1,  ///< Data 0: passive mode, 1: active mode.
+    PMS5003_CMD_SLEEP = 0xE4, ///< Data 0: sleep, 1: wake up.
+};
+
+/**
+ * @struct PMS5003Data
+ * @brief Structure to hold PMS5003 sensor data.
+ *
+ * This structure contains every measurement carried by one PMS5003 data frame.
+ * Concentrations are in µg/m³; particle counts are per 0.1 L of air.
+ */
+struct PMS5003Data {
+    uint16_t pm1_0;      ///< PM1.0 concentration, atmospheric environment.
+    uint16_t pm2_5;      ///< PM2.5 concentration, atmospheric environment.
+    uint16_t pm10;       ///< PM10 concentration, atmospheric environment.
+    uint16_t pm1_0_cf1;  ///< PM1.0 concentration, standard particle (CF=1).
+    uint16_t pm2_5_cf1;  ///< PM2.5 concentration, standard particle (CF=1).
+    uint16_t pm10_cf1;   ///< PM10 concentration, standard particle (CF=1).
+    uint16_t count0_3;   ///< Particles larger than 0.3 µm.
+    uint16_t count0_5;   ///< Particles larger than 0.5 µm.
+    uint16_t count1_0;   ///< Particles larger than 1.0 µm.
+    uint16_t count2_5;   ///< Particles larger than 2.5 µm.
+    uint16_t count5_0;   ///< Particles larger than 5.0 µm.
+    uint16_t count10;    ///< Particles larger than 10 µm.
+};
+
+/**
+ * @brief Encodes a command frame into `out`.
+ *
+ * @param command One of `PMS5003Command`.
+ * @param data Command argument.
+ * @param out Output buffer of at least `PMS5003_COMMAND_SIZE` bytes.
+ * @return Number of bytes written (`PMS5003_COMMAND_SIZE`).
+ */
+size_t encodePms5003Command(uint8_t command, uint16_t data, uint8_t *out);
+
+/**
+ * @class PMS5003Parser
+ * @brief Incremental PMS5003 frame decoder fed one byte at a time.
+ *
+ * The decoder hunts for the 0x42 0x4D header, checks the length field and accumulates the
+ * checksum as bytes arrive. On any error it drops the frame and resynchronises on the next header.
+ */
+class PMS5003Parser {
+    public:
+        PMS5003Parser();
+
+        /**
+         * @brief Feeds one received byte.
+         *
+         * @param byte The received byte.
+         * @return true if this byte completed a valid data frame, available through `data()`.
+         */
+        bool feed(uint8_t byte);
+
+        /** @brief Discards any partially received frame. */
+        void reset();
+
+        /** @brief Returns the last completed data frame. */
+        const PMS5003Data &data() const { return current; }
+
+        uint32_t frames;         ///< Valid data frames decoded.
+        uint32_t checksumErrors; ///< Frames dropped because of a checksum mismatch.
+        uint32_t framingErrors;  ///< Frames dropped because of an unexpected length field.
+
+    private:
+        uint8_t buffer[PMS5003_FRAME_SIZE]; ///< Bytes of the frame in progress.
+        uint8_t size;        ///< Number of bytes in `buffer`.
+        uint8_t expected;    ///< Total size of the frame in progress, known once the length field arrived.
+        uint16_t sum;        ///< Running checksum of the bytes before the checksum field.
+        PMS5003Data current; ///< Last completed data frame.
+};
+
+#endif // !PMS_5003_PROTOCOL_H
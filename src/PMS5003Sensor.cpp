@@ -9,14 +9,13 @@
 
 #include "PMS5003Sensor.h"
 #include "Arduino.h"
+#include "DeferredLog.h"
+#include "TraceRecorder.h"
 
 /**
  * @brief Constructs a PMS5003Sensor object.
- * 
- * The constructor initializes the `PMS5003Sensor` object and sets up the `PMS5003` instance
- * to use `Serial2` for communication. This sets up the necessary UART channel on the ESP32.
  */
-PMS5003Sensor::PMS5003Sensor() : pms(Serial2) {}
+PMS5003Sensor::PMS5003Sensor() {}
 
 /**
  * @brief Initializes the PMS5003 sensor.
@@ -26,25 +25,63 @@ PMS5003Sensor::PMS5003Sensor() : pms(Serial2) {}
  */
 void PMS5003Sensor::begin() {
     Serial2.begin(9600);    ///< Initialize UART2 with a baud rate of 9600.
-    pms.activeMode();       ///< Switch the PMS5003 sensor to active mode.
-    pms.wakeUp();           ///< Wake up the PMS5003 sensor.
+    activeMode();           ///< Switch the PMS5003 sensor to active mode.
+    wakeUp();               ///< Wake up the PMS5003 sensor.
 }
 
 /**
- * @brief Reads particulate matter data from the PMS5003 sensor.
+ * @brief Decodes the particulate matter frames received from the PMS5003 sensor.
  * 
- * This method retrieves data from the PMS5003 sensor. It reads the PM2.5 particulate matter
- * concentration from the sensor and stores it in a `PMS5003Data` structure. It also prints
- * the PM2.5 value to the serial monitor.
+ * Every byte available on `Serial2` is recorded in the trace and fed to the frame decoder. Nothing here waits for
+ * the sensor: an incomplete frame stays in the decoder until the next call.
  * 
- * @return A `PMS5003Data` structure containing the PM2.5 concentration reading.
+ * @param out Receives the latest decoded reading.
+ * @return true if at least one valid frame was decoded.
  */
-PMS5003Data PMS5003Sensor::readData() {
-    PMS5003Data pmsdata; ///< Structure to hold the PM2.5 data.
-    if (pms.readUntil(data)) {
-        pmsdata.pm2_5 = data.PM_AE_UG_2_5; ///< Store the PM2.5 reading.
-        Serial.println(pmsdata.pm2_5);     ///< Print the PM2.5 reading to the serial monitor.
+bool PMS5003Sensor::poll(PMS5003Data &out) {
+    bool updated = false;
+    uint8_t buffer[64];
+    int available;
+    while ((available = Serial2.available()) > 0) {
+        size_t length = Serial2.readBytes(buffer, available < (int)sizeof(buffer) ? available : sizeof(buffer));
+        TRACE(SERIAL2_RX, buffer, length);
+        for (size_t i = 0; i < length; i++) {
+            if (decoder.feed(buffer[i])) {
+                updated = true;
+            }
+        }
+    }
+
+    if (updated) {
+        out = decoder.data();
+        LOG(PMS5003_READING, out.pm2_5);     ///< Log the PM2.5 reading.
     }
+    return updated;
+}
+
+void PMS5003Sensor::sleep() {
+    sendCommand(PMS5003_CMD_SLEEP, 0);
+}
+
+void PMS5003Sensor::wakeUp() {
+    sendCommand(PMS5003_CMD_SLEEP, 1);
+}
+
+void PMS5003Sensor::activeMode() {
+    sendCommand(PMS5003_CMD_MODE, 1);
+}
+
+void PMS5003Sensor::passiveMode() {
+    sendCommand(PMS5003_CMD_MODE, 0);
+}
+
+void PMS5003Sensor::requestRead() {
+    sendCommand(PMS5003_CMD_READ, 0);
+}
 
-    return pmsdata; ///< Return the data structure with the PM2.5 reading.
+void PMS5003Sensor::sendCommand(uint8_t command, uint16_t data) {
+    uint8_t frame[PMS5003_COMMAND_SIZE];
+    size_t length = encodePms5003Command(command, data, frame);
+    TRACE(SERIAL2_TX, frame, length);
+    Serial2.write(frame, length);
 }
@@ -4,41 +4,26 @@
  * 
  * This header file defines the `PMS5003Sensor` class, which provides methods for interfacing
  * with the PMS5003 particulate matter sensor. The class includes functions for initializing
- * the sensor and reading data from it.
+ * the sensor, decoding its frames without blocking and sending it commands.
  */
 
 #ifndef PMS_5003_SENSOR_H
 #define PMS_5003_SENSOR_H
 
-#include "PMS.h"
-
-/**
- * @struct PMS5003Data
- * @brief Structure to hold PMS5003 sensor data.
- * 
- * This structure contains the measurement data from the PMS5003 sensor. Currently, it holds
- * the PM2.5 particulate matter concentration value.
- */
-struct PMS5003Data {
-    int pm2_5; ///< PM2.5 particulate matter concentration value.
-};
+#include <PMS5003Protocol.h>
 
 /**
  * @class PMS5003Sensor
  * @brief A class for interfacing with the PMS5003 particulate matter sensor.
  * 
- * The `PMS5003Sensor` class provides methods to initialize the PMS5003 sensor and read
- * particulate matter data from it. The class uses the `PMS` library to communicate with
- * the sensor via a serial interface.
+ * The `PMS5003Sensor` class owns `Serial2` and decodes the sensor's frames with a
+ * `PMS5003Parser`. `poll()` only consumes bytes already received by the UART, so the
+ * caller never waits on the sensor; it is meant to be called when the UART RX event fires.
  */
 class PMS5003Sensor {
     public:
         /**
          * @brief Constructs a PMS5003Sensor object.
-         * 
-         * The constructor initializes the `PMS5003Sensor` object and sets up the `PMS` instance
-         * for communication. This sets up the necessary configuration for interfacing with the
-         * PMS5003 sensor.
          */
         PMS5003Sensor(); ///< Constructor
 
@@ -51,19 +36,32 @@ class PMS5003Sensor {
         void begin(); ///< Initialize the PMS5003 sensor.
 
         /**
-         * @brief Reads data from the PMS5003 sensor.
+         * @brief Decodes the bytes received from the PMS5003 sensor so far.
          * 
-         * This method retrieves the PM2.5 particulate matter concentration from the PMS5003
-         * sensor. It returns the data in a `PMS5003Data` structure and prints the PM2.5 value
-         * to the serial monitor.
+         * Drains the `Serial2` RX buffer through the frame decoder and returns immediately.
+         * If one or more complete frames were decoded, the latest is stored in `out` and its
+         * PM2.5 value is printed to the serial monitor.
          * 
-         * @return A `PMS5003Data` structure containing the PM2.5 concentration reading.
+         * @param out Receives the latest decoded reading.
+         * @return true if at least one valid frame was decoded.
          */
-        PMS5003Data readData(); ///< Read data from the PMS5003 sensor.
+        bool poll(PMS5003Data &out); ///< Decode pending data from the PMS5003 sensor.
+
+        void sleep();       ///< Put the sensor to sleep (fan and laser off).
+        void wakeUp();      ///< Wake the sensor up; frames resume after the fan has spun up.
+        void activeMode();  ///< Let the sensor send frames continuously.
+        void passiveMode(); ///< Make the sensor send a frame only on `requestRead()`.
+        void requestRead(); ///< Request one frame in passive mode.
+
+        /**
+         * @brief Returns the frame decoder, which holds the frame and error counters.
+         */
+        const PMS5003Parser &parser() const { return decoder; }
 
     private:
-        PMS pms;       ///< PMS object for communication with the sensor.
-        PMS::DATA data; ///< Variable to hold the data read from the sensor.
+        void sendCommand(uint8_t command, uint16_t data);
+
+        PMS5003Parser decoder; ///< Frame decoder for the bytes received on `Serial2`.
 };
 
 #endif  //!PMS_5003_SENSOR_H
@@ -0,0 +1,154 @@
+/**
+ * @file PayloadSerializer.cpp
+ * @brief Implementation of the allocation-free JSON sensor document serializer.
+ */
+
+#include "PayloadSerializer.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+/** @brief Defines a key fragment together with its compile-time length. */
+#define FRAGMENT(name, text) const char name[] = text; const size_t name##Length = sizeof(name) - 1
+
+FRAGMENT(kEnvelope, "{\"database\":\"isaac_v1\",\"collection\":\"sensor_readings\",\"dataSource\":\"IsaacTest\",\"document\": {\"ISAAC ID\" : \"");
+FRAGMENT(kIdClose, "\"");
+FRAGMENT(kPm25, ",\"PM2.5\":");
+FRAGMENT(kTemperature, ",\"Temperature\":");
+FRAGMENT(kHumidity, ",\"Humidity\":");
+FRAGMENT(kSmoke, ",\"Smoke\":");
+FRAGMENT(kDelta, ",\"Delta\":true");
+FRAGMENT(kClose, "}}");
+
+#undef FRAGMENT
+
+} // namespace
+
+PayloadWriter::PayloadWriter(char *out, size_t capacity) : out(out), capacity(capacity), len(0), overflow(capacity == 0) {
+    if (capacity > 0) {
+        out[0] = '\0';
+    }
+}
+
+void PayloadWriter::append(const char *text, size_t length) {
+    if (overflow || len + length >= capacity) {
+        overflow = true;
+        return;
+    }
+    memcpy(out + len, text, length);
+    checksum.update(text, length);
+    len += length;
+    out[len] = '\0';
+}
+
+void PayloadWriter::append(char c) {
+    append(&c, 1);
+}
+
+void PayloadWriter::appendUInt(uint32_t value) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    append(digits + sizeof(digits) - n, n);
+}
+
+void PayloadWriter::appendInt(int32_t value) {
+    if (value < 0) {
+        append('-');
+        appendUInt(0u - (uint32_t)value);
+    } else {
+        appendUInt((uint32_t)value);
+    }
+}
+
+/*
+ * Mirrors dtostrf(value, 4, 2, buf), which String(float) uses: round half up by adding 0.005,
+ * then emit digits from the most significant one. The minimum width of 4 never pads here
+ * because two decimals plus the point already take four characters.
+ */
+void PayloadWriter::appendFixed2(float value) {
+    double number = value;
+    if (isnan(number)) {
+        append("nan", 3);
+        return;
+    }
+    if (isinf(number)) {
+        append("inf", 3);
+        return;
+    }
+    if (number < 0.0) {
+        append('-');
+        number = -number;
+    }
+
+    number += 1.0 / 200.0;
+
+    double tenpow = 1.0;
+    unsigned int digitcount = 1;
+    while (number >= 10.0 * tenpow) {
+        tenpow *= 10.0;
+        digitcount++;
+    }
+    number /= tenpow;
+
+    char digits[48];
+    size_t n = 0;
+    digitcount += 2;
+    while (digitcount-- > 0 && n < sizeof(digits) - 1) {
+        int8_t digit = (int8_t)number;
+        if (digit > 9) digit = 9;
+        digits[n++] = (char)('0' | digit);
+        if (digitcount == 2) {
+            digits[n++] = '.';
+        }
+        number -= digit;
+        number *= 10.0;
+    }
+    append(digits, n);
+}
+
+size_t serializeReadingJson(const SensorData &data, const char *isaacId, char *out, size_t capacity,
+                            size_t *documentLength, uint8_t fields) {
+    PayloadWriter writer(out, capacity);
+    writer.append(kEnvelope, kEnvelopeLength);
+    writer.append(isaacId, strlen(isaacId));
+    writer.append(kIdClose, kIdCloseLength);
+    if (fields & REPORT_PM2_5) {
+        writer.append(kPm25, kPm25Length);
+        writer.appendInt(data.pms5003.pm2_5);
+    }
+    if (fields & REPORT_TEMPERATURE) {
+        writer.append(kTemperature, kTemperatureLength);
+        writer.appendFixed2(data.dht11.temperature);
+    }
+    if (fields & REPORT_HUMIDITY) {
+        writer.append(kHumidity, kHumidityLength);
+        writer.appendFixed2(data.dht11.humidity);
+    }
+    if (fields & REPORT_SMOKE) {
+        writer.append(kSmoke, kSmokeLength);
+        writer.appendInt(data.mq7.gasValue);
+    }
+    if ((fields & REPORT_ALL_FIELDS) != REPORT_ALL_FIELDS) {
+        writer.append(kDelta, kDeltaLength);
+    }
+    writer.append(kClose, kCloseLength);
+    if (writer.overflowed()) {
+        return 0;
+    }
+
+    size_t docLength = writer.length();
+    if (documentLength != NULL) {
+        *documentLength = docLength;
+    }
+
+    writer.appendUInt(writer.crc());
+    writer.append('\n');
+
+    return writer.overflowed() ? 0 : writer.length();
+}
@@ -0,0 +1,71 @@
+/**
+ * @file PayloadSerializer.h
+ * @brief Allocation-free serializer for the JSON sensor document sent to the cloud-ESP.
+ *
+ * The serializer writes the whole line (envelope, ISAAC ID, readings, decimal CRC32 suffix and
+ * '\n') into a caller-provided buffer. Its output is byte-for-byte identical to the document
+ * previously built with `String` concatenation, including the two-decimal `String(float)`
+ * formatting of temperature and humidity.
+ */
+
+#ifndef PAYLOAD_SERIALIZER_H
+#define PAYLOAD_SERIALIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ReportFilter.h>
+#include <SensorSnapshot.h>
+#include <StreamCrc32.h>
+
+/** @brief Buffer size that always fits a serialized sensor document. */
+#define PAYLOAD_JSON_MAX 256
+
+/**
+ * @class PayloadWriter
+ * @brief Appends text to a fixed buffer, keeping it NUL terminated.
+ *
+ * Every appended byte is also fed to a running CRC-32, so the checksum of the text written so
+ * far is available without a second pass. Once the buffer is full further appends are dropped
+ * and `overflowed()` returns true.
+ */
+class PayloadWriter {
+    public:
+        PayloadWriter(char *out, size_t capacity);
+
+        void append(const char *text, size_t length);   ///< Appends `length` bytes of `text`.
+        void append(char c);                            ///< Appends one character.
+        void appendInt(int32_t value);                  ///< Same digits as `String(int)`.
+        void appendUInt(uint32_t value);                ///< Same digits as `String(uint32_t)`.
+        void appendFixed2(float value);                 ///< Same digits as `String(float)` (two decimals).
+
+        size_t length() const { return len; }           ///< Bytes written so far.
+        bool overflowed() const { return overflow; }    ///< True if an append did not fit.
+        uint32_t crc() const { return checksum.value(); } ///< CRC-32 of the bytes written so far.
+
+    private:
+        char *out;
+        size_t capacity;
+        size_t len;
+        bool overflow;
+        StreamCrc32 checksum;
+};
+
+/**
+ * @brief Serializes a reading into the legacy JSON line.
+ *
+ * A delta document carries only the fields in `fields` and is marked with `"Delta":true`;
+ * the fields it leaves out have not changed since they were last sent.
+ *
+ * @param data The sensor data to serialize.
+ * @param isaacId The ISAAC ID string.
+ * @param out Output buffer; `PAYLOAD_JSON_MAX` bytes are always enough.
+ * @param capacity Size of `out`.
+ * @param documentLength If not NULL, receives the length of the JSON document without the CRC suffix.
+ * @param fields `ReportField` mask of the fields to include; `REPORT_ALL_FIELDS` gives the full document.
+ * @return Length of the complete line (NUL terminated in `out`), or 0 if it does not fit.
+ */
+size_t serializeReadingJson(const SensorData &data, const char *isaacId, char *out, size_t capacity,
+                            size_t *documentLength = NULL, uint8_t fields = REPORT_ALL_FIELDS);
+
+#endif // !PAYLOAD_SERIALIZER_H
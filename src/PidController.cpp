@@ -0,0 +1,73 @@
+/**
+ * @file PidController.cpp
+ * @brief Implementation of the PID controller.
+ */
+
+#include "PidController.h"
+
+PidController::PidController(PidGains gains, float outputMin, float outputMax, bool reverse)
+    : gains(gains), minimum(outputMin), maximum(outputMax), reverseActing(reverse), target(0.0f),
+      integral(0.0f), lastMeasurement(0.0f), lastOutput(outputMin), lastTime(0), started(false) {}
+
+float PidController::clamp(float value) const {
+    return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+void PidController::setLimits(float outputMin, float outputMax) {
+    minimum = outputMin;
+    maximum = outputMax;
+    integral = clamp(integral);
+    lastOutput = clamp(lastOutput);
+}
+
+void PidController::reset(float output) {
+    // The proportional term is added back on the first update, so start the integral from the output alone
+    integral = clamp(output);
+    lastOutput = integral;
+    started = false;
+}
+
+float PidController::update(float measurement, uint32_t now) {
+    float error = reverseActing ? measurement - target : target - measurement;
+    float proportional = gains.kp * error;
+
+    float derivative = 0.0f;
+    float step = 0.0f;
+    if (started) {
+        step = (now - lastTime) / 1000.0f;
+        if (step > PID_MAX_STEP_S) {
+            step = PID_MAX_STEP_S;
+        }
+        if (step > 0.0f) {
+            // On the measurement: d(error)/dt without the setpoint steps
+            float slope = (measurement - lastMeasurement) / step;
+            derivative = gains.kd * (reverseActing ? slope : -slope);
+        }
+    } else {
+        // Bumpless start: the integral absorbs the proportional term of the first measurement
+        integral = clamp(integral - proportional);
+    }
+
+    float candidate = integral + gains.ki * error * step;
+    float output = proportional + candidate + derivative;
+    if (output > maximum) {
+        if (error < 0.0f || gains.ki == 0.0f) {
+            integral = candidate;   // The error unwinds the integral
+        }
+        output = maximum;
+    } else if (output < minimum) {
+        if (error > 0.0f || gains.ki == 0.0f) {
+            integral = candidate;
+        }
+        output = minimum;
+    } else {
+        integral = candidate;
+    }
+    integral = clamp(integral);
+
+    lastMeasurement = measurement;
+    lastTime = now;
+    lastOutput = output;
+    started = true;
+    return output;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file PidController.h
+ * @brief Discrete PID controller with output limits and anti-windup.
+ *
+ * The controller is stepped with each new measurement and its `millis()` time, so it follows the
+ * sensor's own rate. The derivative acts on the measurement rather than the error, so a setpoint
+ * change does not kick the output. The integral only accumulates while the output is inside its
+ * limits or the error drives it back inside, so a long saturation does not wind it up.
+ * With `kd` = 0 it is a PI controller.
+ */
+
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <stdint.h>
+
+/** @brief Longest step integrated, in seconds; a longer gap (sensor asleep) counts as this. */
+#define PID_MAX_STEP_S 5.0f
+
+/**
+ * @struct PidGains
+ * @brief Controller gains, in output units per measurement unit (and per second for `ki`, times seconds for `kd`).
+ */
+struct PidGains {
+    float kp;   ///< Proportional gain.
+    float ki;   ///< Integral gain.
+    float kd;   ///< Derivative gain.
+};
+
+/**
+ * @class PidController
+ * @brief PID controller stepped at the measurement rate. Not thread safe.
+ */
+class PidController {
+    public:
+        /**
+         * @param gains Controller gains.
+         * @param outputMin Lowest output.
+         * @param outputMax Highest output.
+         * @param reverse true when a larger output lowers the measurement, as a fan lowers PM2.5.
+         */
+        PidController(PidGains gains, float outputMin, float outputMax, bool reverse);
+
+        void setGains(PidGains newGains) { gains = newGains; }  ///< Sets the gains.
+        void setSetpoint(float value) { target = value; }      ///< Sets the setpoint.
+        float setpoint() const { return target; }               ///< Current setpoint.
+
+        /** @brief Sets the output limits; the integral is brought inside them. */
+        void setLimits(float outputMin, float outputMax);
+        float outputMin() const { return minimum; }     ///< Lowest output.
+        float outputMax() const { return maximum; }     ///< Highest output.
+
+        /**
+         * @brief Restarts the controller from `output`, for a bumpless switch from manual control.
+         */
+        void reset(float output);
+
+        /**
+         * @brief Takes a measurement and returns the new output.
+         *
+         * @param measurement Latest measurement.
+         * @param now `millis()` time of the measurement.
+         */
+        float update(float measurement, uint32_t now);
+
+        float output() const { return lastOutput; } ///< Last output.
+
+    private:
+        float clamp(float value) const;
+
+        PidGains gains;
+        float minimum;
+        float maximum;
+        bool reverseActing;
+        float target;
+        float integral;         ///< Integral term, in output units.
+        float lastMeasurement;
+        float lastOutput;
+        uint32_t lastTime;
+        bool started;           ///< A measurement has been taken since the last reset.
+};
+
+#endif // !PID_CONTROLLER_H
@@ -0,0 +1,146 @@
+/**
+ * @file PowerManager.cpp
+ * @brief Implementation of the duty cycle, the energy meter and the power manager.
+ */
+
+#include "PowerManager.h"
+
+#include <Arduino.h>
+
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#include <esp_pm.h>
+#endif
+
+SensorDutyCycle::SensorDutyCycle(uint32_t periodMs, uint8_t samples, uint32_t maxAwakeMs)
+    : period(periodMs), samplesPerWindow(samples), maxAwake(maxAwakeMs), isAwake(false), taken(0), windowStart(0) {}
+
+SensorDutyCycle::Action SensorDutyCycle::begin(uint32_t now) {
+    isAwake = true;
+    taken = 0;
+    windowStart = now;
+    return DUTY_WAKE;
+}
+
+SensorDutyCycle::Action SensorDutyCycle::update(uint32_t now) {
+    uint32_t sinceStart = now - windowStart;
+    if (isAwake) {
+        if (sinceStart >= maxAwake) {
+            isAwake = false;
+            return DUTY_SLEEP;
+        }
+        return DUTY_NONE;
+    }
+    if (sinceStart >= period) {
+        // Keep the windows on the period's grid, unless a whole period was missed
+        windowStart = sinceStart < 2 * period ? windowStart + period : now;
+        isAwake = true;
+        taken = 0;
+        return DUTY_WAKE;
+    }
+    return DUTY_NONE;
+}
+
+SensorDutyCycle::Action SensorDutyCycle::sampled(uint32_t now) {
+    (void)now;
+    if (!isAwake) {
+        return DUTY_NONE;
+    }
+    if (++taken >= samplesPerWindow) {
+        isAwake = false;
+        return DUTY_SLEEP;
+    }
+    return DUTY_NONE;
+}
+
+uint32_t SensorDutyCycle::untilNext(uint32_t now) const {
+    uint32_t sinceStart = now - windowStart;
+    uint32_t next = isAwake ? maxAwake : period;
+    return sinceStart >= next ? 0 : next - sinceStart;
+}
+
+EnergyMeter::EnergyMeter(const PowerModel &model)
+    : model(model), started(false), lastTime(0), lastBusy(0), chargeUaMs(0), elapsed(0), pmsAwakeMs(0), samples_(0) {}
+
+void EnergyMeter::update(uint32_t now, uint32_t busyUs, bool pmsAwake, bool heaterHigh, bool canSleep) {
+    if (!started) {
+        started = true;
+        lastTime = now;
+        lastBusy = busyUs;
+        return;
+    }
+    uint32_t interval = now - lastTime;
+    uint32_t busy = (busyUs - lastBusy) / 1000;
+    if (busy > interval) {
+        busy = interval;
+    }
+    uint32_t idleUa = canSleep ? model.cpuSleepUa : model.cpuIdleUa;
+    chargeUaMs += (uint64_t)model.cpuActiveUa * busy + (uint64_t)idleUa * (interval - busy);
+    chargeUaMs += (uint64_t)(pmsAwake ? model.pmsAwakeUa : model.pmsSleepUa) * interval;
+    chargeUaMs += (uint64_t)(heaterHigh ? model.heaterHighUa : model.heaterLowUa) * interval;
+    chargeUaMs += (uint64_t)model.baseUa * interval;
+    elapsed += interval;
+    if (pmsAwake) {
+        pmsAwakeMs += interval;
+    }
+    lastTime = now;
+    lastBusy += busy * 1000;
+}
+
+uint64_t EnergyMeter::microjoules() const {
+    // µA·ms × mV = pJ
+    return chargeUaMs * model.supplyMv / 1000000;
+}
+
+uint32_t EnergyMeter::averageMilliwatts() const {
+    return elapsed == 0 ? 0 : (uint32_t)(microjoules() / elapsed);
+}
+
+uint32_t EnergyMeter::microjoulesPerSample() const {
+    return samples_ == 0 ? 0 : (uint32_t)(microjoules() / samples_);
+}
+
+uint32_t EnergyMeter::pmsAwakePermille() const {
+    return elapsed == 0 ? 0 : (uint32_t)((uint64_t)pmsAwakeMs * 1000 / elapsed);
+}
+
+PowerManager::PowerManager() : sleepEnabled(false), current(0), lock(nullptr) {}
+
+bool PowerManager::begin(bool lightSleep) {
+    setCpuFrequencyMhz(POWER_MIN_MHZ);
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    if (lightSleep) {
+        esp_pm_lock_handle_t handle;
+        if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "holds", &handle) != ESP_OK) {
+            return false;
+        }
+        lock = handle;
+        if (current != 0) {
+            esp_pm_lock_acquire(handle);
+        }
+        esp_pm_config_esp32_t config = {};
+        config.max_freq_mhz = POWER_MIN_MHZ;
+        config.min_freq_mhz = POWER_MIN_MHZ;
+        config.light_sleep_enable = true;
+        sleepEnabled = esp_pm_configure(&config) == ESP_OK;
+    }
+#else
+    (void)lightSleep;
+#endif
+    return sleepEnabled;
+}
+
+void PowerManager::hold(uint8_t holds) {
+    bool wasHeld = current != 0;
+    current = holds;
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    if (lock != nullptr && wasHeld != (holds != 0)) {
+        if (holds != 0) {
+            esp_pm_lock_acquire((esp_pm_lock_handle_t)lock);
+        } else {
+            esp_pm_lock_release((esp_pm_lock_handle_t)lock);
+        }
+    }
+#else
+    (void)wasHeld;
+#endif
+}
@@ -0,0 +1,165 @@
+/**
+ * @file PowerManager.h
+ * @brief Sensor duty cycling, CPU clock and light-sleep control, and the energy estimate.
+ *
+ * With power saving on, the PMS5003 sleeps (fan and laser off) between measurement windows. A window
+ * wakes it, waits out the fan's settle time (the channel's warm-up in `BootSequence`), takes a few
+ * frames and puts it back to sleep. The CPU runs at a lower fixed clock, and idles in automatic
+ * light sleep when the build enables tickless idle. Light sleep stops the APB clock that the UARTs, the LEDC
+ * outputs and the ADC DMA run from, so it is held off while any of them is needed.
+ *
+ * The energy estimate integrates a current model of the board over the time each part spends in
+ * each state and divides it by the samples reported to the cloud. Its currents are datasheet
+ * figures at the 5 V input, not measurements; the motor, which has its own supply, is left out.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+
+/**
+ * @brief CPU clock with power saving on, MHz. 80 keeps the APB clock of the peripherals. The clock stays
+ * fixed rather than scaling on demand, so the cycle counts of `Instrumentation` keep their meaning.
+ */
+#ifndef POWER_MIN_MHZ
+#define POWER_MIN_MHZ 80
+#endif
+
+/**
+ * @struct PowerModel
+ * @brief Supply current of each part in each state, µA, and the supply voltage.
+ */
+struct PowerModel {
+    uint32_t supplyMv;      ///< Supply voltage the currents are drawn at, mV.
+    uint32_t cpuActiveUa;   ///< CPU running jobs.
+    uint32_t cpuIdleUa;     ///< CPU idle, clocked.
+    uint32_t cpuSleepUa;    ///< CPU in light sleep.
+    uint32_t pmsAwakeUa;    ///< PMS5003 fan and laser on.
+    uint32_t pmsSleepUa;    ///< PMS5003 asleep.
+    uint32_t heaterHighUa;  ///< MQ7 heater in its high phase.
+    uint32_t heaterLowUa;   ///< MQ7 heater in its low phase.
+    uint32_t baseUa;        ///< Everything else (DHT11, regulator, LED off).
+};
+
+/**
+ * @brief Parts that need the APB clock and keep the CPU out of light sleep.
+ */
+enum PowerHold : uint8_t {
+    POWER_HOLD_PMS5003 = 1 << 0,    ///< PMS5003 window: UART2 must receive.
+    POWER_HOLD_MQ7 = 1 << 1,        ///< MQ7 heater PWM and ADC DMA.
+    POWER_HOLD_MOTOR = 1 << 2,      ///< Motor PWM.
+};
+
+/**
+ * @class SensorDutyCycle
+ * @brief Measurement windows of a sensor that sleeps in between.
+ *
+ * A window opens every `periodMs` and closes once it has taken `samples` valid samples, or after
+ * `maxAwakeMs` if the sensor gives none.
+ */
+class SensorDutyCycle {
+    public:
+        /** @brief What the caller must do to the sensor. */
+        enum Action : uint8_t {
+            DUTY_NONE,  ///< Nothing.
+            DUTY_WAKE,  ///< Wake the sensor: a window opens.
+            DUTY_SLEEP, ///< Put the sensor to sleep: the window is over.
+        };
+
+        SensorDutyCycle(uint32_t periodMs, uint8_t samples, uint32_t maxAwakeMs);
+
+        /** @brief Opens the first window at `now`. */
+        Action begin(uint32_t now);
+
+        /** @brief Opens or times out a window at `now`. */
+        Action update(uint32_t now);
+
+        /** @brief Counts a valid sample of the open window. */
+        Action sampled(uint32_t now);
+
+        bool awake() const { return isAwake; }  ///< A window is open.
+
+        /** @brief Milliseconds from `now` to the next window or window timeout. */
+        uint32_t untilNext(uint32_t now) const;
+
+    private:
+        uint32_t period;
+        uint8_t samplesPerWindow;
+        uint32_t maxAwake;
+        bool isAwake;
+        uint8_t taken;          ///< Samples of the open window
+        uint32_t windowStart;   ///< `millis()` when the last window opened
+};
+
+/**
+ * @class EnergyMeter
+ * @brief Energy estimate from the time spent in each power state.
+ *
+ * `update()` charges the interval since its last call to the states given, so it must be called
+ * whenever a state changes and at least every few seconds for the CPU's busy share to be resolved.
+ */
+class EnergyMeter {
+    public:
+        explicit EnergyMeter(const PowerModel &model);
+
+        /**
+         * @param now `millis()` time.
+         * @param busyUs Scheduler busy time (wrapping), for the CPU's active share.
+         * @param pmsAwake The PMS5003 was awake over the interval.
+         * @param heaterHigh The MQ7 heater was in its high phase.
+         * @param canSleep The CPU could enter light sleep when idle.
+         */
+        void update(uint32_t now, uint32_t busyUs, bool pmsAwake, bool heaterHigh, bool canSleep);
+
+        /** @brief Counts samples reported to the cloud. */
+        void reported(uint32_t samples) { samples_ += samples; }
+
+        uint64_t microjoules() const;               ///< Energy since the first update.
+        uint32_t averageMilliwatts() const;         ///< Average power since the first update.
+        uint32_t microjoulesPerSample() const;      ///< Energy per reported sample, 0 before the first.
+        uint32_t pmsAwakePermille() const;          ///< Share of the time the PMS5003 was awake.
+        uint32_t elapsedMs() const { return elapsed; }  ///< Time covered.
+
+    private:
+        PowerModel model;
+        bool started;
+        uint32_t lastTime;
+        uint32_t lastBusy;
+        uint64_t chargeUaMs;    ///< Charge drawn, µA·ms
+        uint32_t elapsed;
+        uint32_t pmsAwakeMs;
+        uint32_t samples_;
+};
+
+/**
+ * @class PowerManager
+ * @brief CPU clock scaling and the light-sleep holds.
+ */
+class PowerManager {
+    public:
+        PowerManager();
+
+        /**
+         * @brief Sets the CPU clock to `POWER_MIN_MHZ` and, if asked and the build supports it, enables automatic light sleep.
+         *
+         * Call it before `Instrumentation::begin()`. Light sleep needs `CONFIG_PM_ENABLE` and
+         * `CONFIG_FREERTOS_USE_TICKLESS_IDLE`, which the stock Arduino core leaves off.
+         *
+         * @return true if light sleep is enabled.
+         */
+        bool begin(bool lightSleep);
+
+        /** @brief Sets the `PowerHold` bits now needed; light sleep is allowed when there are none. */
+        void hold(uint8_t holds);
+
+        bool lightSleep() const { return sleepEnabled; }                ///< Light sleep is enabled.
+        bool canSleep() const { return sleepEnabled && current == 0; }  ///< The CPU may light sleep now.
+
+    private:
+        bool sleepEnabled;
+        uint8_t current;    ///< Holds in force
+        void *lock;         ///< `esp_pm_lock_handle_t` of the holds
+};
+
+#endif // !POWER_MANAGER_H
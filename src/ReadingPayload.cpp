@@ -0,0 +1,136 @@
+/**
+ * @file ReadingPayload.cpp
+ * @brief Implementation of the binary sensor reading and batch encodings.
+ */
+
+#include "ReadingPayload.h"
+
+#include <math.h>
+
+namespace {
+
+uint8_t hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+/** @brief Converts a value to hundredths, saturating to the int16 range. */
+int16_t toFixed2(float value) {
+    if (isnan(value)) {
+        return READING_INVALID;
+    }
+    float scaled = roundf(value * 100.0f);
+    if (scaled > 32767.0f) return 32767;
+    if (scaled < -32767.0f) return -32767;
+    return (int16_t)scaled;
+}
+
+uint8_t *putU16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+    return out + 2;
+}
+
+uint8_t *putU32(uint8_t *out, uint32_t value) {
+    out = putU16(out, (uint16_t)(value & 0xFFFF));
+    return putU16(out, (uint16_t)(value >> 16));
+}
+
+uint8_t *putDeviceId(uint8_t *out, const char *deviceIdHex) {
+    for (int i = 0; i < READING_ID_LENGTH; i++) {
+        uint8_t hi = 0, lo = 0;
+        if (*deviceIdHex) hi = hexNibble(*deviceIdHex++);
+        if (*deviceIdHex) lo = hexNibble(*deviceIdHex++);
+        *out++ = (uint8_t)((hi << 4) | lo);
+    }
+    return out;
+}
+
+const size_t kBaseAt = 1 + READING_ID_LENGTH;
+const size_t kSentAt = kBaseAt + 4;
+const size_t kCountAt = kSentAt + 4;
+
+} // namespace
+
+size_t encodeSnapshot(const SensorData &data, uint8_t *out) {
+    uint8_t *p = out;
+    int pm2_5 = data.pms5003.pm2_5;
+    p = putU16(p, (uint16_t)(pm2_5 < 0 ? 0 : (pm2_5 > 0xFFFF ? 0xFFFF : pm2_5)));
+    p = putU16(p, (uint16_t)toFixed2(data.dht11.temperature));
+    p = putU16(p, (uint16_t)toFixed2(data.dht11.humidity));
+    p = putU16(p, (uint16_t)(int16_t)data.mq7.gasValue);
+
+    return p - out;
+}
+
+ReadingBatch::ReadingBatch(const char *deviceIdHex, uint8_t maxSamples) {
+    setMaxSamples(maxSamples);
+    payload[0] = BATCH_PAYLOAD_VERSION;
+    setDeviceId(deviceIdHex);
+    clear();
+}
+
+void ReadingBatch::setDeviceId(const char *deviceIdHex) {
+    putDeviceId(payload + 1, deviceIdHex);
+}
+
+void ReadingBatch::clear() {
+    size = BATCH_HEADER_SIZE;
+    count = 0;
+    base = 0;
+}
+
+void ReadingBatch::setMaxSamples(uint8_t samples) {
+    maxSamples = samples > 0 ? samples : 1;
+}
+
+/**
+ * Reserves a record and writes its channel and time offset. Returns NULL if the record does not
+ * fit; the batch is then unchanged.
+ */
+uint8_t *ReadingBatch::beginRecord(uint8_t channel, uint32_t time, size_t valueSize) {
+    if (full() || size + 3 + valueSize > sizeof(payload)) {
+        return nullptr;
+    }
+    uint32_t first = count == 0 ? time : base;
+    int32_t offset = (int32_t)(time - first);   // Signed: a sample may be marginally older than the first one.
+    uint32_t units = offset > 0 ? (uint32_t)offset / BATCH_TIME_UNIT_MS : 0;
+    if (units > 0xFFFF) {
+        return nullptr;
+    }
+
+    base = first;
+    count++;
+    uint8_t *p = payload + size;
+    size += 3 + valueSize;
+    *p++ = channel;
+    return putU16(p, (uint16_t)units);
+}
+
+void DHT11Channel::encode(const DHT11Data &data, uint8_t *out) {
+    out = putU16(out, (uint16_t)toFixed2(data.temperature));
+    putU16(out, (uint16_t)toFixed2(data.humidity));
+}
+
+void PMS5003Channel::encode(const PMS5003Data &data, uint8_t *out) {
+    const uint16_t values[12] = {
+        data.pm1_0, data.pm2_5, data.pm10,
+        data.pm1_0_cf1, data.pm2_5_cf1, data.pm10_cf1,
+        data.count0_3, data.count0_5, data.count1_0, data.count2_5, data.count5_0, data.count10,
+    };
+    for (int i = 0; i < 12; i++) {
+        out = putU16(out, values[i]);
+    }
+}
+
+void MQ7Channel::encode(const MQ7Data &data, uint8_t *out) {
+    putU16(out, (uint16_t)(int16_t)data.gasValue);
+}
+
+void ReadingBatch::seal(uint32_t now) {
+    putU32(payload + kBaseAt, base);
+    putU32(payload + kSentAt, now);
+    payload[kCountAt] = count;
+}
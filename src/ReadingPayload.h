@@ -0,0 +1,125 @@
+/**
+ * @file ReadingPayload.h
+ * @brief Binary encoding of the sensor readings carried in `FRAME_BATCH` frames and BLE notifications.
+ *
+ * All multi-byte fields are little-endian. Temperature and humidity are fixed point with two
+ * decimals (hundredths), matching the two decimals of the legacy JSON document. A reading
+ * that failed (NaN) is sent as `READING_INVALID`.
+ *
+ * A snapshot holds the latest value of every sensor; the BLE stream (BleStream.h) sends it with a
+ * time in front:
+ *
+ *     | PM2.5 u16 | temperature i16 | humidity i16 | CO ppm i16 |
+ *
+ * A `FRAME_BATCH` payload holds, after its record header (SerialFrame.h), individual timestamped
+ * samples of any sensor, oldest first:
+ *
+ *     | version (1) | ISAAC ID (9) | base u32 | sent u32 | count (1) | count records |
+ *
+ * `base` is the `millis()` time of the first sample and `sent` the time the batch was sealed;
+ * the peer dates a sample at `sent - base - offset` milliseconds before the frame arrived. Each
+ * record starts with its `SampleChannel` (SensorSnapshot.h) and its offset from `base` in `BATCH_TIME_UNIT_MS` units:
+ *
+ *     DHT11:   | 0x01 | offset u16 | temperature i16 | humidity i16 |
+ *     PMS5003: | 0x02 | offset u16 | PM1.0 PM2.5 PM10 u16 | CF=1 PM1.0 PM2.5 PM10 u16 | 6 count bins u16 |
+ *     MQ7:     | 0x03 | offset u16 | CO ppm i16 |
+ */
+
+#ifndef READING_PAYLOAD_H
+#define READING_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SensorSnapshot.h>
+#include <SerialFrame.h>
+
+/** @brief Length of the binary ISAAC ID (18 hex characters). */
+#define READING_ID_LENGTH 9
+
+/** @brief Size of an encoded snapshot. */
+#define SNAPSHOT_SIZE (4 * 2)
+
+/** @brief Sentinel for a fixed-point field whose reading is not available. */
+#define READING_INVALID ((int16_t)0x8000)
+
+/**
+ * @brief Encodes the latest value of every sensor into `out`.
+ *
+ * @param data The sensor data to encode.
+ * @param out Output buffer of at least `SNAPSHOT_SIZE` bytes.
+ * @return Number of bytes written (`SNAPSHOT_SIZE`).
+ */
+size_t encodeSnapshot(const SensorData &data, uint8_t *out);
+
+/** @brief Layout version written in the first byte of a batch payload. */
+#define BATCH_PAYLOAD_VERSION 1
+
+/** @brief Size of the batch payload header. */
+#define BATCH_HEADER_SIZE (1 + READING_ID_LENGTH + 4 + 4 + 1)
+
+/** @brief Largest batch: what a frame holds after the record header. */
+#define BATCH_MAX_PAYLOAD (FRAME_MAX_PAYLOAD - FRAME_RECORD_HEADER)
+
+/** @brief Resolution of the per-record time offset. */
+#define BATCH_TIME_UNIT_MS 10
+
+/**
+ * @class ReadingBatch
+ * @brief Accumulates timestamped samples into one `FRAME_BATCH` payload.
+ *
+ * Samples are encoded as they are added, so the batch needs no storage besides the payload
+ * itself. An `add` call fails without side effects when the sample does not fit (payload full,
+ * `maxSamples` reached or offset out of range); the caller then sends the batch and starts a new one.
+ */
+class ReadingBatch {
+    public:
+        /**
+         * @param deviceIdHex ISAAC ID as a hex string, copied into every batch header.
+         * @param maxSamples Upper bound on the samples per batch (at most 255).
+         */
+        ReadingBatch(const char *deviceIdHex, uint8_t maxSamples);
+
+        /** @brief Drops every sample and starts a new batch. */
+        void clear();
+
+        /** @brief Changes the number of samples that makes the batch full. */
+        void setMaxSamples(uint8_t maxSamples);
+
+        /** @brief Changes the ISAAC ID in the header, from the batch being filled on. */
+        void setDeviceId(const char *deviceIdHex);
+
+        /** @brief Adds a sample of `Channel` (see SensorSnapshot.h), encoded by the channel. */
+        template <typename Channel>
+        bool add(uint32_t time, const typename Channel::Data &data) {
+            uint8_t *p = beginRecord(Channel::id, time, Channel::recordSize);
+            if (!p) return false;
+            Channel::encode(data, p);
+            return true;
+        }
+
+        /**
+         * @brief Writes the sample count and the send time into the header.
+         *
+         * @param now Current `millis()` time.
+         */
+        void seal(uint32_t now);
+
+        bool empty() const { return count == 0; }          ///< True if no sample was added.
+        bool full() const { return count >= maxSamples; }  ///< True once `maxSamples` samples were added.
+        uint8_t samples() const { return count; }          ///< Number of samples in the batch.
+        uint32_t firstTime() const { return base; }        ///< Time of the first sample (valid when not empty).
+        const uint8_t *data() const { return payload; }    ///< Payload bytes.
+        size_t length() const { return size; }             ///< Payload length in bytes.
+
+    private:
+        uint8_t *beginRecord(uint8_t channel, uint32_t time, size_t valueSize);
+
+        uint8_t payload[BATCH_MAX_PAYLOAD];
+        size_t size;
+        uint8_t count;
+        uint8_t maxSamples;
+        uint32_t base;
+};
+
+#endif // !READING_PAYLOAD_H
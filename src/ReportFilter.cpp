@@ -0,0 +1,72 @@
+/**
+ * @file ReportFilter.cpp
+ * @brief Implementation of the report-by-exception filter.
+ */
+
+#include "ReportFilter.h"
+
+#include <math.h>
+
+ReportFilter::ReportFilter(uint32_t heartbeatMs) : reported(0), heartbeat(heartbeatMs) {
+    for (int i = 0; i < REPORT_FIELD_COUNT; i++) {
+        deadbands[i] = Deadband{0.0f, 0.0f};
+        last[i] = 0.0f;
+        lastTime[i] = 0;
+    }
+}
+
+void ReportFilter::setDeadband(uint8_t fields, Deadband deadband) {
+    for (int i = 0; i < REPORT_FIELD_COUNT; i++) {
+        if (fields & (1u << i)) {
+            deadbands[i] = deadband;
+        }
+    }
+}
+
+float ReportFilter::value(const SensorData &data, int field) {
+    switch (1u << field) {
+        case REPORT_PM2_5:       return (float)data.pms5003.pm2_5;
+        case REPORT_TEMPERATURE: return data.dht11.temperature;
+        case REPORT_HUMIDITY:    return data.dht11.humidity;
+        default:                 return (float)data.mq7.gasValue;
+    }
+}
+
+uint8_t ReportFilter::changes(const SensorData &data, uint8_t fields, uint32_t now) const {
+    uint8_t changed = 0;
+    for (int i = 0; i < REPORT_FIELD_COUNT; i++) {
+        uint8_t bit = (uint8_t)(1u << i);
+        if (!(fields & bit)) {
+            continue;
+        }
+        if (!(reported & bit) || now - lastTime[i] >= heartbeat) {
+            changed |= bit;
+            continue;
+        }
+        float current = value(data, i);
+        if (isnan(current) || isnan(last[i])) {
+            if (isnan(current) != isnan(last[i])) {
+                changed |= bit;
+            }
+            continue;
+        }
+        float band = fabsf(last[i]) * deadbands[i].relative;
+        if (band < deadbands[i].absolute) {
+            band = deadbands[i].absolute;
+        }
+        if (fabsf(current - last[i]) > band) {
+            changed |= bit;
+        }
+    }
+    return changed;
+}
+
+void ReportFilter::commit(const SensorData &data, uint8_t fields, uint32_t now) {
+    for (int i = 0; i < REPORT_FIELD_COUNT; i++) {
+        if (fields & (1u << i)) {
+            last[i] = value(data, i);
+            lastTime[i] = now;
+        }
+    }
+    reported |= fields;
+}
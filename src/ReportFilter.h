@@ -0,0 +1,88 @@
+/**
+ * @file ReportFilter.h
+ * @brief Report-by-exception filter deciding which readings are worth sending to the cloud-ESP.
+ *
+ * Each reported field (PM2.5, temperature, humidity, smoke) has a deadband made of an absolute
+ * and a relative part. A new value is reported when it moved further from the last reported
+ * value than the larger of the two, when it became valid or invalid (NaN), or when the field has
+ * not been reported for `heartbeatMs`. Quiet channels then cost nothing on the link except one
+ * heartbeat per interval.
+ */
+
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stdint.h>
+
+#include <SensorSnapshot.h>
+
+/** @brief Mask of every field (`ReportField`, in SensorSnapshot.h). */
+#define REPORT_ALL_FIELDS (REPORT_PM2_5 | REPORT_TEMPERATURE | REPORT_HUMIDITY | REPORT_SMOKE)
+
+/** @brief Number of reported fields. */
+#define REPORT_FIELD_COUNT 4
+
+/**
+ * @brief What is sent to the cloud-ESP.
+ */
+enum ReportMode : uint8_t {
+    REPORT_EVERY,   ///< Every reading, as before report-by-exception.
+    REPORT_FULL,    ///< Every field whenever any field changed or a heartbeat is due.
+    REPORT_DELTA,   ///< Only the fields that changed or whose heartbeat is due.
+};
+
+/**
+ * @struct Deadband
+ * @brief Change a field must exceed to be reported: the larger of `absolute` and `relative` times the last value.
+ */
+struct Deadband {
+    float absolute; ///< In the field's unit.
+    float relative; ///< Fraction of the last reported value, e.g. 0.1 for 10 %.
+};
+
+/**
+ * @class ReportFilter
+ * @brief Tracks the last reported value of every field and selects the fields to report.
+ *
+ * `changes()` only looks; `commit()` records what was actually sent, so a reading that could
+ * not be sent is reported again next time. Not thread safe: one task owns the filter.
+ */
+class ReportFilter {
+    public:
+        /**
+         * @param heartbeatMs Longest time a field goes unreported.
+         */
+        explicit ReportFilter(uint32_t heartbeatMs);
+
+        /** @brief Sets the deadband of the fields in `fields`. */
+        void setDeadband(uint8_t fields, Deadband deadband);
+
+        /** @brief Sets the heartbeat interval in milliseconds. */
+        void setHeartbeat(uint32_t heartbeatMs) { heartbeat = heartbeatMs; }
+
+        /**
+         * @brief Returns the fields of `data` among `fields` that should be reported at `now`.
+         *
+         * @param data Latest reading.
+         * @param fields Fields to consider, e.g. those of the channel that just produced a sample.
+         * @param now Current `millis()` time.
+         */
+        uint8_t changes(const SensorData &data, uint8_t fields, uint32_t now) const;
+
+        /** @brief Records that the fields in `fields` of `data` were reported at `now`. */
+        void commit(const SensorData &data, uint8_t fields, uint32_t now);
+
+        /** @brief Forgets every reported value, so the next reading of each field is reported. */
+        void reset() { reported = 0; }
+
+    private:
+        static float value(const SensorData &data, int field);
+
+        Deadband deadbands[REPORT_FIELD_COUNT];
+        float last[REPORT_FIELD_COUNT];     ///< Last reported value of each field.
+        uint32_t lastTime[REPORT_FIELD_COUNT]; ///< When each field was last reported.
+        uint8_t reported;                   ///< Fields reported at least once.
+        uint32_t heartbeat;
+};
+
+#endif // !REPORT_FILTER_H
@@ -0,0 +1,110 @@
+/**
+ * @file SampleRing.h
+ * @brief Fixed-capacity ring of timestamped samples between one sensor job and the sender.
+ *
+ * This header defines the `SampleRing` class template. Where a `SeqLock` only keeps the latest
+ * reading, a `SampleRing` keeps every reading until the sender has shipped it. Samples live in
+ * one contiguous array of `Capacity` slots; the producer and the consumer each own one index,
+ * so neither ever waits for the other.
+ */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @class SampleRing
+ * @brief Lock-free single-producer / single-consumer queue of timestamped samples.
+ *
+ * Exactly one task may call `push()`, and exactly one task may call `front()` and `pop()`.
+ * When the ring is full `push()` drops the new sample and counts it in `dropped()`, so the
+ * oldest unsent data is kept.
+ *
+ * @tparam T Trivially copyable sample value.
+ * @tparam Capacity Number of slots, a power of two.
+ */
+template <typename T, uint32_t Capacity>
+class SampleRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SampleRing requires a trivially copyable type");
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SampleRing capacity must be a power of two");
+
+public:
+    /**
+     * @struct Sample
+     * @brief One reading and the time it was taken.
+     */
+    struct Sample {
+        uint32_t time; ///< `millis()` when the reading was taken.
+        T value;       ///< The reading.
+    };
+
+    SampleRing() : head(0), tail(0), drops(0) {}
+
+    /**
+     * @brief Appends a sample. Never blocks. Producer only.
+     *
+     * @param time Time of the reading in milliseconds.
+     * @param value The reading.
+     * @return false if the ring was full and the sample was dropped.
+     */
+    bool push(uint32_t time, const T &value) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Capacity) {
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Sample &slot = slots[h & (Capacity - 1)];
+        slot.time = time;
+        slot.value = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the oldest sample, or NULL if the ring is empty. Consumer only.
+     *
+     * The sample stays valid until `pop()` is called.
+     */
+    const Sample *front() const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return nullptr;
+        }
+        return &slots[t & (Capacity - 1)];
+    }
+
+    /**
+     * @brief Releases the sample returned by `front()`. Consumer only.
+     */
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Returns the number of samples waiting to be consumed.
+     */
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the number of samples dropped because the ring was full.
+     */
+    uint32_t dropped() const {
+        return drops.load(std::memory_order_relaxed);
+    }
+
+    /** @brief Number of slots. */
+    static constexpr uint32_t capacity() { return Capacity; }
+
+private:
+    Sample slots[Capacity];         ///< Sample storage, indexed by the free-running counters modulo `Capacity`.
+    std::atomic<uint32_t> head;     ///< Total samples pushed, written by the producer.
+    std::atomic<uint32_t> tail;     ///< Total samples consumed, written by the consumer.
+    std::atomic<uint32_t> drops;    ///< Samples dropped on a full ring.
+};
+
+#endif // !SAMPLE_RING_H
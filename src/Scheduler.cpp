@@ -0,0 +1,118 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Implementation of the cooperative scheduler.
+ */
+
+#include "Scheduler.h"
+
+#include <Arduino.h>
+
+namespace {
+
+uint32_t clampPeriod(uint32_t periodMs) {
+    return periodMs > SCHEDULER_MAX_PERIOD_MS ? SCHEDULER_MAX_PERIOD_MS : periodMs;
+}
+
+} // namespace
+
+Scheduler::Scheduler() : count(0), busyUs(0), triggered(0), owner(nullptr) {}
+
+void Scheduler::begin() {
+    owner = xTaskGetCurrentTaskHandle();
+}
+
+int Scheduler::add(const char *name, JobFunction function, uint32_t periodMs, uint32_t firstDelayMs) {
+    if (count >= SCHEDULER_MAX_JOBS) {
+        return -1;
+    }
+    Job &job = table[count];
+    job.name = name;
+    job.function = function;
+    job.periodMs.store(clampPeriod(periodMs));
+    job.deadline = micros() + firstDelayMs * 1000;
+    job.idle = periodMs == 0;
+    job.stats = JobStats{0, 0, 0, 0};
+    return count++;
+}
+
+void Scheduler::setPeriod(int job, uint32_t periodMs) {
+    if (job >= 0 && job < count) {
+        table[job].periodMs.store(clampPeriod(periodMs));
+    }
+}
+
+uint32_t Scheduler::period(int job) const {
+    return job >= 0 && job < count ? table[job].periodMs.load() : 0;
+}
+
+void Scheduler::trigger(int job) {
+    if (job < 0 || job >= SCHEDULER_MAX_JOBS) {
+        return;
+    }
+    triggered.fetch_or(1u << job);
+    if (owner) {
+        xTaskNotifyGive(owner);
+    }
+}
+
+void Scheduler::run() {
+    uint32_t fired = triggered.exchange(0);
+
+    for (uint8_t i = 0; i < count; i++) {
+        Job &job = table[i];
+        uint32_t periodUs = job.periodMs.load() * 1000;
+        uint32_t start = micros();
+        if (periodUs == 0) {
+            job.deadline = start;   // In the past, so a period set before the sleep below does not delay the next pass
+            job.idle = true;
+        } else if (job.idle) {
+            // A period was set since the last pass: the first deadline is one period away
+            job.deadline = start + periodUs;
+            job.idle = false;
+        }
+        bool due = periodUs > 0 && (int32_t)(start - job.deadline) >= 0;
+        if (!due && !(fired & (1u << i))) {
+            continue;
+        }
+
+        if (due) {
+            uint32_t lateness = start - job.deadline;
+            if (lateness > job.stats.maxLateness) {
+                job.stats.maxLateness = lateness;
+            }
+            // Next deadline is one period after this one, not after this run.
+            job.deadline += periodUs;
+            while ((int32_t)(start - job.deadline) >= 0) {
+                job.deadline += periodUs;
+                job.stats.skipped++;
+            }
+        }
+
+        job.function();
+
+        uint32_t runtime = micros() - start;
+        busyUs += runtime;
+        if (runtime > job.stats.maxRuntime) {
+            job.stats.maxRuntime = runtime;
+        }
+        job.stats.runs++;
+    }
+
+    // Sleep until the earliest deadline; a trigger ends the sleep early.
+    int32_t wait = INT32_MAX;
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < count; i++) {
+        if (table[i].periodMs.load() == 0) {
+            continue;
+        }
+        int32_t remaining = (int32_t)(table[i].deadline - now);
+        if (remaining < wait) {
+            wait = remaining;
+        }
+    }
+    if (wait <= 0 || triggered.load() != 0) {
+        return;
+    }
+    TickType_t ticks = wait == INT32_MAX ? portMAX_DELAY : (TickType_t)(((uint32_t)wait + 999) / 1000 / portTICK_PERIOD_MS);
+    ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+}
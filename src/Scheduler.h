@@ -0,0 +1,111 @@
+/**
+ * @file Scheduler.h
+ * @brief Cooperative run-to-completion scheduler for the periodic and event-driven firmware jobs.
+ *
+ * All jobs run one after another on the task that calls `run()` (the Arduino loop task), so they
+ * share one stack instead of one FreeRTOS task and stack each. A job is a plain function that
+ * returns when its work is done. It runs when its absolute deadline passes, and also whenever
+ * another task or a driver callback `trigger()`s it. Deadlines advance by exactly one period per
+ * run, so the period does not drift by the time the job takes.
+ *
+ * Deadlines are `micros()` times, which wrap every 71.6 minutes, and are compared as signed
+ * differences; a period is therefore at most `SCHEDULER_MAX_PERIOD_MS`, and a longer one is clamped.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/** @brief Maximum number of jobs. */
+#define SCHEDULER_MAX_JOBS 10
+
+/** @brief Longest period: one that `micros()` deadlines compared as `int32_t` can hold. */
+#define SCHEDULER_MAX_PERIOD_MS (INT32_MAX / 1000)
+
+/** @brief A job: runs to completion and returns. */
+typedef void (*JobFunction)();
+
+/**
+ * @struct JobStats
+ * @brief Timing statistics of one job, in microseconds.
+ */
+struct JobStats {
+    uint32_t runs;          ///< Completed runs.
+    uint32_t skipped;       ///< Deadlines missed entirely because a run ended more than a period late.
+    uint32_t maxLateness;   ///< Longest delay between a deadline and the start of its run.
+    uint32_t maxRuntime;    ///< Longest run.
+};
+
+/**
+ * @class Scheduler
+ * @brief Single-stack executor with absolute deadlines and cross-task triggers.
+ */
+class Scheduler {
+    public:
+        Scheduler();
+
+        /**
+         * @brief Binds the scheduler to the calling task, which must be the one calling `run()`.
+         */
+        void begin();
+
+        /**
+         * @brief Adds a job.
+         *
+         * @param name Name used in reports.
+         * @param function Job body.
+         * @param periodMs Period in milliseconds (0: only when triggered), at most `SCHEDULER_MAX_PERIOD_MS`.
+         * @param firstDelayMs Delay before the first deadline, to stagger jobs.
+         * @return The job index, or -1 if the table is full.
+         */
+        int add(const char *name, JobFunction function, uint32_t periodMs, uint32_t firstDelayMs = 0);
+
+        /**
+         * @brief Changes the period of a job; takes effect from its next deadline. Safe from any task.
+         *
+         * When the job had no period, its first deadline is one period after the next pass of `run()`.
+         * A period above `SCHEDULER_MAX_PERIOD_MS` is clamped to it.
+         */
+        void setPeriod(int job, uint32_t periodMs);
+
+        /** @brief Returns the period of a job in milliseconds. */
+        uint32_t period(int job) const;
+
+        /**
+         * @brief Makes a job run as soon as the scheduler is free. Safe from any task or driver callback.
+         */
+        void trigger(int job);
+
+        /**
+         * @brief Runs every due or triggered job once, then sleeps until the next deadline or trigger.
+         */
+        void run();
+
+        uint8_t jobs() const { return count; }                       ///< Number of jobs.
+        const char *name(int job) const { return table[job].name; }   ///< Name of a job.
+        const JobStats &stats(int job) const { return table[job].stats; } ///< Timing statistics of a job.
+        uint32_t busy() const { return busyUs; }                      ///< Microseconds spent running jobs (wraps).
+
+    private:
+        struct Job {
+            const char *name;
+            JobFunction function;
+            std::atomic<uint32_t> periodMs;
+            uint32_t deadline;  ///< Next deadline, `micros()` time.
+            bool idle;          ///< Had no period on the last pass.
+            JobStats stats;
+        };
+
+        Job table[SCHEDULER_MAX_JOBS];
+        uint8_t count;
+        uint32_t busyUs;
+        std::atomic<uint32_t> triggered; ///< One bit per triggered job.
+        TaskHandle_t owner;              ///< Task running the jobs, woken by `trigger()`.
+};
+
+#endif // !SCHEDULER_H
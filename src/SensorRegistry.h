@@ -0,0 +1,214 @@
+/**
+ * @file SensorRegistry.h
+ * @brief Compile-time table of the sensor channels, from which the snapshot, sample rings and jobs are generated.
+ *
+ * This header defines the `SensorRegistry` class template. A channel is a struct of static members
+ * describing one sensor (see SensorSnapshot.h for the sensors of this board):
+ *
+ *     typedef DHT11Data Data;                                  // What the sensor publishes
+ *     static constexpr const char *name;                       // Job name
+ *     static constexpr uint8_t id;                             // SampleChannel of its batch records
+ *     static constexpr uint8_t fields;                         // ReportField mask it feeds
+ *     static constexpr Data SensorData::*member;               // Where it lives in a SensorData
+ *     static constexpr uint32_t DeviceConfig::*period;         // Its job period in the configuration
+ *     static constexpr uint32_t firstDelayMs;                  // Delay of its job's first run
+ *     static constexpr bool selfTimed;                         // Its job sets its own period on every run
+ *     static constexpr uint32_t history;                       // Capacity of its sample ring, a power of two
+ *     static constexpr size_t recordSize;                      // Bytes written by encode()
+ *     static void encode(const Data &data, uint8_t *out);      // Batch record value
+ *     static void sample();                                    // Its job
+ *     static inline int job;                                   // Its job id once scheduled
+ *
+ * Every loop over the channels is a fold expression over the parameter pack, so it is unrolled at
+ * compile time: no virtual call, function table or heap is involved, and adding a channel to the
+ * list is all it takes for the snapshot, rings and scheduling to cover it.
+ */
+
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tuple>
+#include <type_traits>
+
+#include <SampleRing.h>
+#include <SeqLock.h>
+
+/**
+ * @class SensorRegistry
+ * @brief The channels of `Channels`, in list order, and the containers generated from them.
+ *
+ * @tparam Record Struct holding one value of every channel (each channel's `member`).
+ * @tparam Channels Channel descriptions.
+ */
+template <typename Record, typename... Channels>
+class SensorRegistry {
+public:
+    /** @brief Number of channels. */
+    static constexpr size_t count = sizeof...(Channels);
+
+    /** @brief `ReportField` mask of every channel. */
+    static constexpr uint8_t fields = (0 | ... | Channels::fields);
+
+    /** @brief Position of `Channel` in the list. */
+    template <typename Channel>
+    static constexpr size_t indexOf() {
+        constexpr bool matches[] = {std::is_same<Channel, Channels>::value...};
+        for (size_t i = 0; i < count; i++) {
+            if (matches[i]) return i;
+        }
+        return count;
+    }
+
+    /** @brief Calls `f(Channel())` for every channel, in list order. */
+    template <typename F>
+    static void forEach(F &&f) {
+        (f(Channels()), ...);
+    }
+
+    /**
+     * @brief Adds every channel's job to `scheduler` and keeps its id in the channel's `job`.
+     *
+     * @param scheduler The scheduler, with `add(name, function, periodMs, firstDelayMs)`.
+     * @param config Configuration holding every channel's `period`.
+     */
+    template <typename Scheduler, typename Config>
+    static void schedule(Scheduler &scheduler, const Config &config) {
+        ((Channels::job = scheduler.add(Channels::name, Channels::sample, config.*Channels::period,
+                                        Channels::firstDelayMs)), ...);
+    }
+
+    /**
+     * @brief Sets the period of every channel's job whose period changed from `previous` to `next`.
+     *
+     * Self-timed jobs are left alone; they pick the new period up on their next run.
+     */
+    template <typename Scheduler, typename Config>
+    static void reschedule(Scheduler &scheduler, const Config &next, const Config &previous) {
+        ((!Channels::selfTimed && next.*Channels::period != previous.*Channels::period
+              ? (void)scheduler.setPeriod(Channels::job, next.*Channels::period)
+              : void()), ...);
+    }
+
+    /**
+     * @class Snapshot
+     * @brief One `SeqLock` per channel, each written by the channel's job only.
+     */
+    class Snapshot {
+    public:
+        /** @brief The cell of `Channel`. */
+        template <typename Channel>
+        SeqLock<typename Channel::Data> &channel() {
+            static_assert(indexOf<Channel>() < count, "Channel is not registered");
+            return std::get<indexOf<Channel>()>(cells);
+        }
+
+        template <typename Channel>
+        const SeqLock<typename Channel::Data> &channel() const {
+            static_assert(indexOf<Channel>() < count, "Channel is not registered");
+            return std::get<indexOf<Channel>()>(cells);
+        }
+
+        /** @brief Publishes a reading of `Channel`. */
+        template <typename Channel>
+        void publish(const typename Channel::Data &value) {
+            channel<Channel>().write(value);
+        }
+
+        /** @brief Returns true once every channel has been published at least once. */
+        bool ready() const {
+            return (... && (channel<Channels>().version() > 0));
+        }
+
+        /** @brief `ReportField` mask of the channels published at least once. */
+        uint8_t publishedFields() const {
+            return (0 | ... | (channel<Channels>().version() > 0 ? Channels::fields : 0));
+        }
+
+        /**
+         * @brief Copies the latest reading of every channel into `out`.
+         *
+         * Each channel is individually consistent; channels are independent of each other.
+         */
+        void read(Record &out) const {
+            (channel<Channels>().read(out.*Channels::member), ...);
+        }
+
+    private:
+        std::tuple<SeqLock<typename Channels::Data>...> cells;
+    };
+
+    /**
+     * @class History
+     * @brief One `SampleRing` per channel, merged in time order by the consumer.
+     *
+     * The producer of a ring is its channel's job (or whoever queues for it, on the same task),
+     * the consumer is the sender.
+     */
+    class History {
+    public:
+        /** @brief The ring of `Channel`. */
+        template <typename Channel>
+        SampleRing<typename Channel::Data, Channel::history> &ring() {
+            static_assert(indexOf<Channel>() < count, "Channel is not registered");
+            return std::get<indexOf<Channel>()>(rings);
+        }
+
+        template <typename Channel>
+        const SampleRing<typename Channel::Data, Channel::history> &ring() const {
+            static_assert(indexOf<Channel>() < count, "Channel is not registered");
+            return std::get<indexOf<Channel>()>(rings);
+        }
+
+        /** @brief Queues the sample of every channel feeding one of `fields`, taken from `data` at `now`. */
+        void queue(const Record &data, uint8_t fields, uint32_t now) {
+            ((fields & Channels::fields ? (void)ring<Channels>().push(now, data.*Channels::member) : void()), ...);
+        }
+
+        /**
+         * @brief Hands the oldest sample of any ring to `f(Channel(), time, value)`, then pops it.
+         *
+         * Times are compared as differences, so `millis()` wrap-around is harmless; on a tie the channel
+         * first in the list goes first.
+         *
+         * @return false if every ring is empty.
+         */
+        template <typename F>
+        bool takeOldest(F &&f) {
+            size_t oldest = count;
+            uint32_t oldestTime = 0;
+            size_t index = 0;
+            ((findOldest<Channels>(index++, oldest, oldestTime)), ...);
+            if (oldest == count) {
+                return false;
+            }
+            index = 0;
+            ((index++ == oldest ? take<Channels>(f) : void()), ...);
+            return true;
+        }
+
+    private:
+        template <typename Channel>
+        void findOldest(size_t index, size_t &oldest, uint32_t &oldestTime) const {
+            const auto *sample = ring<Channel>().front();
+            if (sample && (oldest == count || (int32_t)(sample->time - oldestTime) < 0)) {
+                oldest = index;
+                oldestTime = sample->time;
+            }
+        }
+
+        template <typename Channel, typename F>
+        void take(F &f) {
+            auto &channelRing = ring<Channel>();
+            const auto *sample = channelRing.front();
+            f(Channel(), sample->time, sample->value);
+            channelRing.pop();
+        }
+
+        std::tuple<SampleRing<typename Channels::Data, Channels::history>...> rings;
+    };
+};
+
+#endif // !SENSOR_REGISTRY_H
@@ -0,0 +1,181 @@
+/**
+ * @file SensorSnapshot.h
+ * @brief Shared sensor readings published by the sensor jobs and consumed by the sender.
+ *
+ * This header defines the `SensorData` structure, the sensor channels of the board and the
+ * `SensorSnapshot` class. Each sensor channel lives in its own `SeqLock`, written by exactly one
+ * sensor job, so sensor jobs never block or skip a sample and the sender always reads a consistent view.
+ *
+ * Adding a sensor takes its driver, a member in `SensorData` and a channel description appended to
+ * `Sensors`; the snapshot, the sample rings, the batch records and the job table follow from the list.
+ */
+
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+#include <DHT11Sensor.h>
+#include <PMS5003Sensor.h>
+#include <MQ7Sensor.h>
+#include <DeviceConfig.h>
+#include <SensorRegistry.h>
+#include <SeqLock.h>
+
+/**
+ * @brief Fields of a reading, as bits of a field mask.
+ */
+enum ReportField : uint8_t {
+    REPORT_PM2_5 = 0x01,        ///< PMS5003 PM2.5 (the PMS5003 channel).
+    REPORT_TEMPERATURE = 0x02,  ///< DHT11 temperature.
+    REPORT_HUMIDITY = 0x04,     ///< DHT11 humidity.
+    REPORT_SMOKE = 0x08,        ///< MQ7 CO ppm (the MQ7 channel).
+};
+
+/**
+ * @brief Sensor channel of a batch record (see ReadingPayload.h).
+ */
+enum SampleChannel : uint8_t {
+    CHANNEL_DHT11 = 0x01,   ///< Temperature and humidity.
+    CHANNEL_PMS5003 = 0x02, ///< Particulate matter.
+    CHANNEL_MQ7 = 0x03,     ///< CO (the legacy "Smoke" field).
+};
+
+/**
+ * @struct ReadingVariance
+ * @brief Variance of the recent raw samples behind the published readings.
+ *
+ * Each value is the sample variance over the window of the channel's `StreamFilter`, in the
+ * square of the reading's unit. It tells the receiver how noisy the filtered value is.
+ */
+struct ReadingVariance {
+    float temperature;  ///< DHT11 temperature, °C².
+    float humidity;     ///< DHT11 humidity, %².
+    float pm2_5;        ///< PMS5003 PM2.5, (µg/m³)².
+};
+
+/**
+ * @brief A structure to hold data from various sensors.
+ *
+ * This structure contains data from multiple sensors, including the DHT11 sensor,
+ * PMS5003 particulate matter sensor, and the MQ7 gas sensor. It provides a convenient
+ * way to manage and access the data from these sensors as a single unit.
+ */
+struct SensorData {
+    /**
+     * @brief Data from the DHT11 sensor.
+     *
+     * This member holds the temperature and humidity readings from the DHT11 sensor.
+     */
+    DHT11Data dht11;
+
+    /**
+     * @brief Data from the PMS5003 sensor.
+     *
+     * This member contains the particulate matter readings from the PMS5003 sensor,
+     * which measures different particle sizes in the air.
+     */
+    PMS5003Data pms5003;
+
+    /**
+     * @brief Data from the MQ7 gas sensor.
+     *
+     * This member stores the carbon monoxide concentration readings from the MQ7 sensor.
+     */
+    MQ7Data mq7;
+
+    /**
+     * @brief Variance of the filtered readings.
+     */
+    ReadingVariance variance;
+};
+
+/**
+ * @brief DHT11 channel: temperature and humidity, read every few seconds.
+ */
+struct DHT11Channel {
+    typedef DHT11Data Data;
+    static constexpr const char *name = "DHT11";
+    static constexpr uint8_t id = CHANNEL_DHT11;
+    static constexpr uint8_t fields = REPORT_TEMPERATURE | REPORT_HUMIDITY;
+    static constexpr Data SensorData::*member = &SensorData::dht11;
+    static constexpr uint32_t DeviceConfig::*period = &DeviceConfig::dht11PeriodMs;
+    static constexpr uint32_t firstDelayMs = DHT11_WARMUP_MS;
+    static constexpr bool selfTimed = false;
+    static constexpr uint32_t history = 16;     ///< A sample every 5 s.
+    static constexpr size_t recordSize = 4;
+    static void encode(const Data &data, uint8_t *out);
+    static void sample();
+    static inline int job = -1;
+};
+
+/**
+ * @brief PMS5003 channel: particulate matter, decoded from the frames the sensor sends about every second.
+ */
+struct PMS5003Channel {
+    typedef PMS5003Data Data;
+    static constexpr const char *name = "PMS5003";
+    static constexpr uint8_t id = CHANNEL_PMS5003;
+    static constexpr uint8_t fields = REPORT_PM2_5;
+    static constexpr Data SensorData::*member = &SensorData::pms5003;
+    static constexpr uint32_t DeviceConfig::*period = &DeviceConfig::pms5003PeriodMs;
+    static constexpr uint32_t firstDelayMs = 100;
+    static constexpr bool selfTimed = false;
+    static constexpr uint32_t history = 64;     ///< A sample about every second.
+    static constexpr size_t recordSize = 24;
+    static void encode(const Data &data, uint8_t *out);
+    static void sample();
+    static inline int job = -1;
+};
+
+/**
+ * @brief MQ7 channel: CO concentration, measured once per heater cycle.
+ */
+struct MQ7Channel {
+    typedef MQ7Data Data;
+    static constexpr const char *name = "MQ7";
+    static constexpr uint8_t id = CHANNEL_MQ7;
+    static constexpr uint8_t fields = REPORT_SMOKE;
+    static constexpr Data SensorData::*member = &SensorData::mq7;
+    static constexpr uint32_t DeviceConfig::*period = &DeviceConfig::mq7PeriodMs;
+    static constexpr uint32_t firstDelayMs = 200;
+    static constexpr bool selfTimed = true;     ///< Faster while the ADC samples.
+    static constexpr uint32_t history = 4;      ///< A sample every heater cycle (150 s).
+    static constexpr size_t recordSize = 2;
+    static void encode(const Data &data, uint8_t *out);
+    static void sample();
+    static inline int job = -1;
+};
+
+/**
+ * @brief The sensors of the board, in the order their jobs are added and ties between their samples are broken.
+ *
+ * `encode()` is defined in ReadingPayload.cpp, next to the rest of the batch encoding, and `sample()`, the
+ * channel's job, in main.cpp.
+ */
+typedef SensorRegistry<SensorData, DHT11Channel, PMS5003Channel, MQ7Channel> Sensors;
+
+/**
+ * @class SensorSnapshot
+ * @brief Lock-free publication point for the latest reading of every sensor.
+ *
+ * Writers: each channel's job owns its channel. DHT11Channel's and PMS5003Channel's jobs both write
+ * `variance`, which is safe because every job runs on the scheduler's task.
+ * Reader: SendToESPJob calls `read()`.
+ */
+class SensorSnapshot : public Sensors::Snapshot {
+    public:
+        SeqLock<ReadingVariance> variance; ///< Variance behind the latest DHT11 and PMS5003 readings.
+
+        /**
+         * @brief Copies the latest reading of every channel into `out`.
+         *
+         * Each channel is individually consistent; channels are independent of each other.
+         *
+         * @param out Destination of the copy.
+         */
+        void read(SensorData &out) const {
+            Sensors::Snapshot::read(out);
+            variance.read(out.variance);
+        }
+};
+
+#endif // !SENSOR_SNAPSHOT_H
@@ -0,0 +1,108 @@
+/**
+ * @file SeqLock.h
+ * @brief Single-writer sequence lock used to publish sensor readings without blocking.
+ *
+ * This header defines the `SeqLock` class template. A writer publishes a new value by
+ * bumping a sequence counter to an odd number, storing the value and bumping it back to
+ * an even number. Readers copy the value and retry if the counter changed in between, so
+ * a writer never waits for a reader and a reader never observes a half-written value.
+ */
+
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(ARDUINO)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+/** @brief Back-off used by readers that caught a writer mid-publish (lets a lower priority writer finish). */
+#define SEQLOCK_RELAX() vTaskDelay(1)
+#else
+#include <thread>
+#define SEQLOCK_RELAX() std::this_thread::yield()
+#endif
+
+/**
+ * @class SeqLock
+ * @brief Lock-free single-writer / multi-reader cell for a trivially copyable value.
+ *
+ * The value is stored as an array of 32-bit atomic words so that concurrent reads and
+ * writes are well defined. Exactly one task may call `write()`; any number of tasks may
+ * call `read()`.
+ *
+ * @tparam T Trivially copyable type to publish.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+public:
+    SeqLock() : seq(0) {
+        for (uint32_t i = 0; i < kWords; i++) {
+            words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Publishes a new value. Never blocks.
+     *
+     * @param value The value to publish.
+     */
+    void write(const T &value) {
+        uint32_t buf[kWords] = {0};
+        memcpy(buf, &value, sizeof(T));
+
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);          ///< Odd: publish in progress.
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint32_t i = 0; i < kWords; i++) {
+            words[i].store(buf[i], std::memory_order_relaxed);
+        }
+        seq.store(s + 2, std::memory_order_release);          ///< Even: value is consistent.
+    }
+
+    /**
+     * @brief Copies out the latest consistent value.
+     *
+     * @param out Destination of the copy.
+     * @return The number of values published so far (0 if nothing has been written yet).
+     */
+    uint32_t read(T &out) const {
+        uint32_t buf[kWords];
+        uint32_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            while (before & 1) {
+                SEQLOCK_RELAX();
+                before = seq.load(std::memory_order_acquire);
+            }
+            for (uint32_t i = 0; i < kWords; i++) {
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while (before != after);
+
+        memcpy(&out, buf, sizeof(T));
+        return before >> 1;
+    }
+
+    /**
+     * @brief Returns the number of values published so far.
+     */
+    uint32_t version() const {
+        return seq.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    static const uint32_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t); ///< Storage size in words.
+
+    std::atomic<uint32_t> seq;            ///< Sequence counter, odd while a write is in progress.
+    std::atomic<uint32_t> words[kWords];  ///< Value storage.
+};
+
+#endif // !SEQ_LOCK_H
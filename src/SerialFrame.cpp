@@ -0,0 +1,204 @@
+/**
+ * @file SerialFrame.cpp
+ * @brief Implementation of the COBS frame encoder and incremental decoder.
+ */
+
+#include "SerialFrame.h"
+
+namespace {
+
+/**
+ * @brief Streaming COBS encoder writing into a fixed buffer.
+ */
+class CobsWriter {
+    public:
+        CobsWriter(uint8_t *out, size_t capacity)
+            : out(out), capacity(capacity), codeIndex(0), pos(1), code(1), ok(capacity > 0) {}
+
+        void put(uint8_t byte) {
+            if (byte == 0) {
+                closeBlock();
+                return;
+            }
+            if (!reserve()) {
+                return;
+            }
+            out[pos++] = byte;
+            if (++code == 0xFF) {
+                closeBlock();
+            }
+        }
+
+        /** @brief Closes the last block, appends the delimiter and returns the encoded size (0 on overflow). */
+        size_t finish() {
+            if (!ok) {
+                return 0;
+            }
+            out[codeIndex] = code;
+            if (pos >= capacity) {
+                return 0;
+            }
+            out[pos++] = 0x00;
+            return pos;
+        }
+
+    private:
+        bool reserve() {
+            if (pos >= capacity) {
+                ok = false;
+            }
+            return ok;
+        }
+
+        void closeBlock() {
+            if (!ok) {
+                return;
+            }
+            out[codeIndex] = code;
+            codeIndex = pos;
+            code = 1;
+            if (reserve()) {
+                pos++;
+            }
+        }
+
+        uint8_t *out;
+        size_t capacity;
+        size_t codeIndex; ///< Position of the code byte of the open block.
+        size_t pos;       ///< Next write position.
+        uint8_t code;     ///< Code of the open block (data bytes + 1).
+        bool ok;
+};
+
+void putWithCrc(CobsWriter &writer, StreamCrc32 &crc, uint8_t byte) {
+    crc.update(byte);
+    writer.put(byte);
+}
+
+} // namespace
+
+size_t encodeFrame(uint8_t type, uint8_t seq, const uint8_t *payload, size_t length, uint8_t *out, size_t capacity) {
+    if (length > FRAME_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    CobsWriter writer(out, capacity);
+    StreamCrc32 crc;
+    putWithCrc(writer, crc, type);
+    putWithCrc(writer, crc, seq);
+    putWithCrc(writer, crc, (uint8_t)(length & 0xFF));
+    putWithCrc(writer, crc, (uint8_t)(length >> 8));
+    for (size_t i = 0; i < length; i++) {
+        putWithCrc(writer, crc, payload[i]);
+    }
+
+    uint32_t crcValue = crc.value();
+    for (int i = 0; i < 4; i++) {
+        writer.put((uint8_t)(crcValue >> (8 * i)));
+    }
+    return writer.finish();
+}
+
+void encodeRecordHeader(uint32_t id, uint32_t previous, uint8_t *out) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (uint8_t)(id >> (8 * i));
+        out[4 + i] = (uint8_t)(previous >> (8 * i));
+    }
+}
+
+bool decodeRecordHeader(const Frame &frame, uint32_t &id, uint32_t &previous) {
+    if (frame.length < FRAME_RECORD_HEADER) {
+        return false;
+    }
+    id = previous = 0;
+    for (int i = 0; i < 4; i++) {
+        id |= (uint32_t)frame.payload[i] << (8 * i);
+        previous |= (uint32_t)frame.payload[4 + i] << (8 * i);
+    }
+    return true;
+}
+
+FrameDecoder::FrameDecoder() : crcErrors(0), framingErrors(0) {
+    current.type = 0;
+    current.seq = 0;
+    current.length = 0;
+    current.payload = buffer + 4;
+    reset();
+}
+
+void FrameDecoder::reset() {
+    size = 0;
+    code = 0;
+    remaining = 0;
+    pendingZero = false;
+    overflow = false;
+    crc.reset();
+}
+
+/**
+ * Appends a decoded byte. The CRC trails the buffer by four bytes, so when the delimiter
+ * arrives it already covers everything except the received CRC field.
+ */
+bool FrameDecoder::push(uint8_t byte) {
+    if (size >= sizeof(buffer)) {
+        overflow = true;
+        return false;
+    }
+    buffer[size] = byte;
+    if (size >= 4) {
+        crc.update(buffer[size - 4]);
+    }
+    size++;
+    return true;
+}
+
+bool FrameDecoder::feed(uint8_t byte) {
+    if (byte == 0x00) {
+        // Delimiter: validate whatever was decoded since the previous one.
+        bool complete = !overflow && remaining == 0 && size > 0;
+        bool valid = false;
+        if (complete && size >= FRAME_OVERHEAD) {
+            uint16_t length = (uint16_t)(buffer[2] | (buffer[3] << 8));
+            if ((size_t)length + FRAME_OVERHEAD == size) {
+                size_t crcAt = size - 4;
+                uint32_t received = (uint32_t)buffer[crcAt] | ((uint32_t)buffer[crcAt + 1] << 8) |
+                                    ((uint32_t)buffer[crcAt + 2] << 16) | ((uint32_t)buffer[crcAt + 3] << 24);
+                if (crc.value() == received) {
+                    current.type = buffer[0];
+                    current.seq = buffer[1];
+                    current.length = length;
+                    current.payload = buffer + 4;
+                    valid = true;
+                } else {
+                    crcErrors++;
+                }
+            } else {
+                framingErrors++;
+            }
+        } else if (overflow || size > 0 || remaining != 0) {
+            framingErrors++;
+        }
+        reset();
+        return valid;
+    }
+
+    if (overflow) {
+        return false;
+    }
+
+    if (remaining == 0) {
+        // Code byte of a new block.
+        if (pendingZero && !push(0x00)) {
+            return false;
+        }
+        code = byte;
+        remaining = code - 1;
+        pendingZero = code != 0xFF;
+        return false;
+    }
+
+    if (push(byte)) {
+        remaining--;
+    }
+    return false;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file SerialFrame.h
+ * @brief Binary COBS framing for the Serial1 link between the sensor-ESP and the cloud-ESP.
+ *
+ * A frame carries a type byte, a sequence number, a little-endian payload length, the payload
+ * and a little-endian CRC32 over everything before it. The frame is COBS encoded and terminated
+ * by a single 0x00 byte, so a receiver can always resynchronise on the next zero byte.
+ *
+ * Wire layout before COBS encoding:
+ *
+ *     | type (1) | seq (1) | length (2) | payload (length) | crc32 (4) |
+ */
+
+#ifndef SERIAL_FRAME_H
+#define SERIAL_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <StreamCrc32.h>
+
+/** @brief Maximum payload length carried by one frame. */
+#define FRAME_MAX_PAYLOAD 240
+
+/** @brief Bytes added around the payload before COBS encoding (header + CRC). */
+#define FRAME_OVERHEAD 8
+
+/** @brief Worst-case encoded size of a frame, including COBS overhead and the delimiter. */
+#define FRAME_MAX_ENCODED (FRAME_MAX_PAYLOAD + FRAME_OVERHEAD + (FRAME_MAX_PAYLOAD + FRAME_OVERHEAD) / 254 + 2)
+
+/**
+ * @brief Frame types carried on the link.
+ */
+enum FrameType : uint8_t {
+    FRAME_READING = 0x01, ///< No longer sent (readings travel in `FRAME_BATCH`); reserved so the value is not reused.
+    FRAME_BATCH = 0x02,   ///< Sensor-ESP -> cloud-ESP: record header, then a batch of timestamped samples.
+    FRAME_TELEMETRY = 0x03, ///< Sensor-ESP -> cloud-ESP: instrumentation payload (see Instrumentation.h), seq of the request.
+    FRAME_LOG = 0x04,     ///< Sensor-ESP -> console: binary log records (see LogCatalog.h), with `LOG_BINARY`.
+    FRAME_CONTROL_ACK = 0x05, ///< Sensor-ESP -> cloud-ESP: acknowledgement of the `FRAME_CONTROL` frame with the same seq.
+    FRAME_TRACE = 0x06,   ///< Sensor-ESP -> console: part of a trace dump (see TraceRecorder.h).
+    FRAME_COMMAND = 0x10, ///< Cloud-ESP -> sensor-ESP: JSON command document.
+    FRAME_ACK = 0x11,     ///< Cloud-ESP -> sensor-ESP: u32, the record id of the last `FRAME_BATCH` delivered (cumulative).
+    FRAME_TELEMETRY_REQUEST = 0x12, ///< Cloud-ESP -> sensor-ESP: empty, asks for a `FRAME_TELEMETRY` frame.
+    FRAME_CONTROL = 0x13, ///< Cloud-ESP -> sensor-ESP: binary command (see CommandProtocol.h).
+};
+
+/**
+ * @brief Bytes of the record header that starts a `FRAME_BATCH` payload.
+ *
+ *     | record id u32 | previous u32 | batch (see ReadingPayload.h) |
+ *
+ * Record ids increase by one per batch, but skip the batches the sensor-ESP lost before sending
+ * them (see FrameStore.h). `previous` is the id of the batch sent just before this one, or 0 if
+ * every earlier batch was either acknowledged or lost. The cloud-ESP delivers a batch if its id is
+ * at least the one expected and `previous` was delivered (or is 0), then expects the id after it;
+ * any other batch is a repeat, or follows a lost frame, and is dropped. `FRAME_ACK` returns the id
+ * of the last batch delivered.
+ */
+#define FRAME_RECORD_HEADER 8
+
+/**
+ * @struct Frame
+ * @brief A decoded frame. `payload` points into the decoder's buffer and is valid until the next byte is fed.
+ */
+struct Frame {
+    uint8_t type;            ///< One of `FrameType`.
+    uint8_t seq;             ///< Sender's sequence number.
+    uint16_t length;         ///< Payload length in bytes.
+    const uint8_t *payload;  ///< Payload bytes.
+};
+
+/**
+ * @brief Encodes one frame into `out`.
+ *
+ * @param type Frame type.
+ * @param seq Sequence number.
+ * @param payload Payload bytes (may be NULL when `length` is 0).
+ * @param length Payload length, at most `FRAME_MAX_PAYLOAD`.
+ * @param out Output buffer.
+ * @param capacity Size of `out`; `FRAME_MAX_ENCODED` is always enough.
+ * @return Number of bytes written including the trailing 0x00, or 0 if the frame does not fit.
+ */
+size_t encodeFrame(uint8_t type, uint8_t seq, const uint8_t *payload, size_t length, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Writes the `FRAME_RECORD_HEADER` bytes of a record header into `out`.
+ */
+void encodeRecordHeader(uint32_t id, uint32_t previous, uint8_t *out);
+
+/**
+ * @brief Reads the record header of a `FRAME_BATCH` frame.
+ *
+ * @return false if the payload is too short to hold one.
+ */
+bool decodeRecordHeader(const Frame &frame, uint32_t &id, uint32_t &previous);
+
+/**
+ * @class FrameDecoder
+ * @brief Incremental COBS frame decoder fed one byte at a time.
+ *
+ * Bytes are decoded and checksummed as they arrive; a frame is validated (length and CRC)
+ * when its 0x00 delimiter is received. Corrupt or oversized frames are dropped and counted.
+ */
+class FrameDecoder {
+    public:
+        FrameDecoder();
+
+        /**
+         * @brief Feeds one received byte.
+         *
+         * @param byte The received byte.
+         * @return true if this byte completed a valid frame, available through `frame()`.
+         */
+        bool feed(uint8_t byte);
+
+        /**
+         * @brief Returns the last completed frame.
+         */
+        const Frame &frame() const { return current; }
+
+        uint32_t crcErrors;     ///< Frames dropped because of a CRC mismatch.
+        uint32_t framingErrors; ///< Frames dropped because of bad COBS, length or overflow.
+
+    private:
+        void reset();
+        bool push(uint8_t byte);
+
+        uint8_t buffer[FRAME_MAX_PAYLOAD + FRAME_OVERHEAD]; ///< Decoded bytes of the frame in progress.
+        size_t size;       ///< Number of decoded bytes in `buffer`.
+        uint8_t code;      ///< Current COBS block code (0 when a code byte is expected).
+        uint8_t remaining; ///< Data bytes left in the current COBS block.
+        bool pendingZero;  ///< A zero must be emitted if another block follows.
+        bool overflow;     ///< The frame in progress is being discarded.
+        StreamCrc32 crc;   ///< CRC of the decoded bytes except the last four (the received CRC).
+        Frame current;     ///< Last completed frame.
+};
+
+#endif // !SERIAL_FRAME_H
@@ -0,0 +1,98 @@
+/**
+ * @file StreamCrc32.cpp
+ * @brief Table-driven and ROM backends of the incremental CRC-32 engine.
+ */
+
+#include "StreamCrc32.h"
+
+#if defined(CRC32_USE_ROM)
+#include <esp_rom_crc.h>
+#endif
+
+#if CRC32_SLICES != 4 && CRC32_SLICES != 8
+#error "CRC32_SLICES must be 4 or 8"
+#endif
+
+namespace {
+
+const uint32_t kPolynomial = 0xEDB88320; ///< Reflected IEEE 802.3 polynomial.
+
+#if defined(CRC32_USE_ROM)
+const int kSlices = 1;
+#else
+const int kSlices = CRC32_SLICES;
+#endif
+
+/** @brief Slice-by-N lookup tables; `t[0]` is the classic byte-wise table. */
+struct Crc32Tables {
+    uint32_t t[kSlices][256];
+};
+
+constexpr Crc32Tables makeTables() {
+    Crc32Tables tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1u)));
+        }
+        tables.t[0][i] = crc;
+    }
+    for (int slice = 1; slice < kSlices; slice++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t prev = tables.t[slice - 1][i];
+            tables.t[slice][i] = (prev >> 8) ^ tables.t[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr Crc32Tables kTables = makeTables();
+
+inline uint32_t updateByte(uint32_t reg, uint8_t byte) {
+    return (reg >> 8) ^ kTables.t[0][(reg ^ byte) & 0xFF];
+}
+
+#if !defined(CRC32_USE_ROM)
+inline uint32_t load32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/** @brief Block update on the raw (non-inverted) register. */
+uint32_t updateBlock(uint32_t reg, const uint8_t *p, size_t length) {
+    const uint32_t (*t)[256] = kTables.t;
+#if CRC32_SLICES == 8
+    while (length >= 8) {
+        uint32_t one = load32(p) ^ reg;
+        uint32_t two = load32(p + 4);
+        reg = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        p += 8;
+        length -= 8;
+    }
+#endif
+    while (length >= 4) {
+        uint32_t one = load32(p) ^ reg;
+        reg = t[3][one & 0xFF] ^ t[2][(one >> 8) & 0xFF] ^ t[1][(one >> 16) & 0xFF] ^ t[0][one >> 24];
+        p += 4;
+        length -= 4;
+    }
+    while (length--) {
+        reg = updateByte(reg, *p++);
+    }
+    return reg;
+}
+#endif
+
+} // namespace
+
+void StreamCrc32::update(uint8_t byte) {
+    crc = ~updateByte(~crc, byte);
+}
+
+void StreamCrc32::update(const void *data, size_t length) {
+#if defined(CRC32_USE_ROM)
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)data, (uint32_t)length);
+#else
+    crc = ~updateBlock(~crc, (const uint8_t *)data, length);
+#endif
+}
@@ -0,0 +1,59 @@
+/**
+ * @file StreamCrc32.h
+ * @brief Incremental CRC-32 (IEEE 802.3, reflected, init/xorout 0xFFFFFFFF) engine.
+ *
+ * Bytes can be fed one at a time or in blocks while they are produced or received, so the
+ * checksum is ready as soon as the last byte is written and no second pass is needed.
+ *
+ * Backends, selected at build time:
+ * - default: slice-by-`CRC32_SLICES` lookup tables generated at compile time (8 or 4 slices,
+ *   8 KB or 4 KB of flash);
+ * - `-D CRC32_USE_ROM`: the ESP32 ROM `esp_rom_crc32_le` routine for block updates (no tables
+ *   for blocks, only the 1 KB single-byte table).
+ *
+ * Results are identical to the bakercp `CRC32` library previously used on the link.
+ */
+
+#ifndef STREAM_CRC32_H
+#define STREAM_CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Number of lookup tables used by the block update (4 or 8). */
+#ifndef CRC32_SLICES
+#define CRC32_SLICES 8
+#endif
+
+/**
+ * @class StreamCrc32
+ * @brief Running CRC-32 that can be read at any point without being reset.
+ */
+class StreamCrc32 {
+    public:
+        StreamCrc32() : crc(0) {}
+
+        /** @brief Restarts the checksum. */
+        void reset() { crc = 0; }
+
+        /** @brief Feeds one byte. */
+        void update(uint8_t byte);
+
+        /** @brief Feeds a block of bytes. */
+        void update(const void *data, size_t length);
+
+        /** @brief Returns the CRC-32 of all bytes fed since the last reset. */
+        uint32_t value() const { return crc; }
+
+        /** @brief Computes the CRC-32 of a buffer in one call. */
+        static uint32_t compute(const void *data, size_t length) {
+            StreamCrc32 crc;
+            crc.update(data, length);
+            return crc.value();
+        }
+
+    private:
+        uint32_t crc; ///< CRC of the bytes fed so far (final form, i.e. already inverted).
+};
+
+#endif // !STREAM_CRC32_H
@@ -0,0 +1,158 @@
+/**
+ * @file StreamFilter.h
+ * @brief Constant-memory streaming filter between the sensor drivers and the published readings.
+ *
+ * This header defines the `StreamFilter` class template. Every accepted sample updates, in O(Window):
+ * - a sliding-window median, which removes single-sample spikes;
+ * - the mean and variance of the same window (Welford's algorithm, with the oldest sample removed
+ *   as the newest one is added, and an exact recomputation once per pass over the window);
+ * - an exponentially weighted moving average of every sample.
+ *
+ * NaN samples (a failed DHT11 read) are rejected and counted instead of entering the window.
+ * All state lives in two arrays of `Window` samples; nothing is allocated.
+ */
+
+#ifndef STREAM_FILTER_H
+#define STREAM_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/**
+ * @class StreamFilter
+ * @brief Sliding-window median, windowed mean/variance and EWMA of one channel.
+ *
+ * Not thread safe: one task feeds and reads the filter.
+ *
+ * @tparam T Sample type, integral or floating point.
+ * @tparam Window Number of samples in the median and variance window (1-255).
+ */
+template <typename T, size_t Window>
+class StreamFilter {
+    static_assert(std::is_arithmetic<T>::value, "StreamFilter requires an arithmetic sample type");
+    static_assert(Window >= 1 && Window <= 255, "StreamFilter window must be 1-255 samples");
+
+public:
+    /**
+     * @param alpha EWMA weight of a new sample, in (0, 1].
+     */
+    explicit StreamFilter(float alpha = 0.25f) : alpha(alpha), rejects(0) {
+        reset();
+    }
+
+    /** @brief Empties the window and the averages. The rejected count is kept. */
+    void reset() {
+        head = 0;
+        count = 0;
+        average = 0.0f;
+        m2 = 0.0f;
+        smoothed = 0.0f;
+        samples = 0;
+    }
+
+    /**
+     * @brief Adds a sample.
+     *
+     * @return false if the sample was NaN and was rejected.
+     */
+    bool update(T sample) {
+        if (std::is_floating_point<T>::value && sample != sample) {
+            rejects++;
+            return false;
+        }
+        float x = (float)sample;
+
+        if (count == Window) {
+            // Drop the oldest sample from the sorted window and from the running moments.
+            T oldest = ring[head];
+            removeSorted(oldest);
+            float y = (float)oldest;
+            float delta = y - average;
+            average -= delta / (float)(count - 1 > 0 ? count - 1 : 1);
+            m2 -= delta * (y - average);
+            count--;
+            if (count == 0) {
+                average = 0.0f;
+                m2 = 0.0f;
+            }
+        }
+
+        ring[head] = sample;
+        head = (uint8_t)((head + 1) % Window);
+        insertSorted(sample);
+        count++;
+
+        if (head == 0 && count == Window) {
+            recompute();    // Once per pass over the window, so rounding in the removals cannot accumulate.
+        } else {
+            float delta = x - average;
+            average += delta / (float)count;
+            m2 += delta * (x - average);
+            if (m2 < 0.0f) {
+                m2 = 0.0f;
+            }
+        }
+
+        smoothed = samples == 0 ? x : smoothed + alpha * (x - smoothed);
+        samples++;
+        return true;
+    }
+
+    /** @brief Median of the window (the lower middle sample for an even count); 0 when empty. */
+    T median() const { return count > 0 ? sorted[(count - 1) / 2] : (T)0; }
+
+    float mean() const { return average; }                                       ///< Mean of the window.
+    float variance() const { return count > 1 ? m2 / (float)(count - 1) : 0.0f; } ///< Sample variance of the window.
+    float ewma() const { return smoothed; }                                      ///< Exponentially weighted moving average.
+    size_t size() const { return count; }                                       ///< Samples in the window.
+    bool empty() const { return count == 0; }                                    ///< True before the first accepted sample.
+    uint32_t rejected() const { return rejects; }                                ///< NaN samples rejected.
+
+private:
+    void recompute() {
+        float sum = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            sum += (float)ring[i];
+        }
+        average = sum / (float)count;
+        m2 = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            float delta = (float)ring[i] - average;
+            m2 += delta * delta;
+        }
+    }
+
+    void insertSorted(T sample) {
+        uint8_t i = count;
+        // count < Window on every call; the explicit bound lets the compiler see it too (Window = 1)
+        while (i > 0 && i < Window && sorted[i - 1] > sample) {
+            sorted[i] = sorted[i - 1];
+            i--;
+        }
+        sorted[i] = sample;
+    }
+
+    void removeSorted(T sample) {
+        uint8_t i = 0;
+        while (i < count - 1 && sorted[i] != sample) {
+            i++;
+        }
+        for (; i < count - 1; i++) {
+            sorted[i] = sorted[i + 1];
+        }
+    }
+
+    T ring[Window];     ///< Window in arrival order; `head` is the oldest once full.
+    T sorted[Window];   ///< The same samples in ascending order.
+    uint8_t head;
+    uint8_t count;
+    float alpha;
+    float average;      ///< Welford running mean of the window.
+    float m2;           ///< Welford sum of squared deviations of the window.
+    float smoothed;     ///< EWMA state.
+    uint32_t samples;   ///< Samples accepted since the last reset.
+    uint32_t rejects;
+};
+
+#endif // !STREAM_FILTER_H
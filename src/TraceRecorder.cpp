@@ -0,0 +1,142 @@
+/**
+ * @file TraceRecorder.cpp
+ * @brief Implementation of the trace ring and its dumper.
+ *
+ * Ring positions run freely and are masked on access. Overwriting the oldest record folds its
+ * delta into `baseTime`, so the remaining records still add up to absolute times.
+ */
+
+#include "TraceRecorder.h"
+
+#include <Arduino.h>
+
+#if TRACE_CAPTURE
+TraceRecorder traceRecorder;
+#endif
+
+namespace {
+
+void putWord(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+} // namespace
+
+TraceRecorder::TraceRecorder()
+    : head(0), tail(0), baseTime(0), lastTime(0), dropped(0), paused(0), dumpActive(false), headerSent(false),
+      dumpPosition(0), frameSequence(0) {}
+
+void TraceRecorder::record(TraceSource source, const void *data, size_t length) {
+    if (dumpActive) {
+        paused++;
+        return;
+    }
+    const uint8_t *bytes = (const uint8_t *)data;
+    while (length > 0) {
+        uint8_t chunk = length > TRACE_MAX_RECORD ? TRACE_MAX_RECORD : (uint8_t)length;
+        append(source, bytes, chunk);
+        bytes += chunk;
+        length -= chunk;
+    }
+}
+
+void TraceRecorder::append(TraceSource source, const uint8_t *data, uint8_t length) {
+    uint32_t now = micros();
+    uint32_t delta = now - lastTime;
+    lastTime = now;
+
+    uint8_t header[7];
+    size_t size = 0;
+    header[size++] = source;
+    do {
+        header[size++] = (uint8_t)((delta & 0x7F) | (delta > 0x7F ? 0x80 : 0));
+        delta >>= 7;
+    } while (delta > 0);
+    header[size++] = length;
+
+    while (TRACE_RING_BYTES - (head - tail) < size + length) {
+        dropOldest();
+    }
+    put(header, size);
+    put(data, length);
+}
+
+void TraceRecorder::dropOldest() {
+    uint32_t position = tail + 1;
+    uint32_t delta = 0;
+    uint8_t byte;
+    int shift = 0;
+    do {
+        byte = at(position++);
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    baseTime += delta;
+    tail = position + 1 + at(position);
+    dropped++;
+}
+
+void TraceRecorder::put(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        ring[(head + i) & (TRACE_RING_BYTES - 1)] = data[i];
+    }
+    head += length;
+}
+
+bool TraceRecorder::startDump() {
+    if (dumpActive) {
+        return false;
+    }
+    dumpActive = true;
+    headerSent = false;
+    dumpPosition = tail;
+    return true;
+}
+
+size_t TraceRecorder::dump(HardwareSerial &port) {
+    size_t written = 0;
+    while (dumpActive) {
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        size_t length;
+        if (!headerSent) {
+            payload[0] = TRACE_DUMP_HEADER;
+            payload[1] = TRACE_VERSION;
+            putWord(payload + 2, head - tail);
+            putWord(payload + 6, baseTime);
+            putWord(payload + 10, dropped);
+            putWord(payload + 14, paused);
+            length = TRACE_HEADER_LENGTH;
+        } else {
+            size_t remaining = head - dumpPosition;
+            length = remaining < FRAME_MAX_PAYLOAD - 1 ? remaining + 1 : FRAME_MAX_PAYLOAD;
+            payload[0] = TRACE_DUMP_DATA;
+            for (size_t i = 1; i < length; i++) {
+                payload[i] = at(dumpPosition + i - 1);
+            }
+        }
+
+        // A leading delimiter too, so a frame that follows a text log line decodes
+        uint8_t frame[FRAME_MAX_ENCODED + 1];
+        frame[0] = 0;
+        size_t frameLength = encodeFrame(FRAME_TRACE, frameSequence, payload, length, frame + 1, sizeof(frame) - 1) + 1;
+        if ((size_t)port.availableForWrite() < frameLength) {
+            break;
+        }
+        port.write(frame, frameLength);
+        written += frameLength;
+        frameSequence++;
+
+        if (!headerSent) {
+            headerSent = true;
+        } else {
+            dumpPosition += length - 1;
+        }
+        if (dumpPosition == head) {
+            dumpActive = false;
+        }
+    }
+    return written;
+}
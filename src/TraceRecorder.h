@@ -0,0 +1,151 @@
+/**
+ * @file TraceRecorder.h
+ * @brief Compact RAM trace of the raw UART traffic and driver readings, dumped over the console.
+ *
+ * Every byte received or sent on Serial1 (cloud-ESP) and Serial2 (PMS5003), and every raw DHT11 and
+ * MQ7 reading, is appended to a ring as a record:
+ *
+ *     | source (1) | time delta (varint, µs) | length (1) | payload (length) |
+ *
+ * The delta is taken from the previous record's `micros()`, so a record of a few bytes costs
+ * three or four bytes of overhead and the ring holds minutes of field traffic. Once the ring is
+ * full, the oldest records are overwritten. `TRACE()` and `TRACE_VALUES()` compile to nothing with
+ * `TRACE_CAPTURE=0`.
+ *
+ * Typing `trace` on the console dumps the ring in `FRAME_TRACE` frames, paced by the console's TX
+ * buffer like the deferred log; `tools/tracereplay.cpp` reassembles a dump from a console capture
+ * and feeds it back through the firmware's parsers at full speed. Dump layout, after the frame's
+ * first byte (`TRACE_DUMP_HEADER` or `TRACE_DUMP_DATA`):
+ *
+ *     header: | version (1) | bytes (4) | base time (4, µs) | overwritten (4) | skipped (4) |
+ *     data:   | the next ring bytes, from the oldest record on |
+ *
+ * The first record's delta counts from the base time; `skipped` counts the records lost to earlier
+ * dumps. Numbers are little endian.
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include <HardwareSerial.h>
+#include <SerialFrame.h>
+
+/** @brief 1 to record the trace; 0 compiles the recorder and its call sites out. */
+#ifndef TRACE_CAPTURE
+#define TRACE_CAPTURE 1
+#endif
+
+/** @brief Bytes of the ring, a power of two. */
+#ifndef TRACE_RING_BYTES
+#define TRACE_RING_BYTES 16384
+#endif
+
+/** @brief Longest record payload; longer writes are split into several records. */
+#define TRACE_MAX_RECORD 255
+
+/** @brief Version of the dump layout. */
+#define TRACE_VERSION 1
+
+/** @brief Bytes of a dump header payload, its first byte included. */
+#define TRACE_HEADER_LENGTH 18
+
+/** @brief Source of a trace record. */
+enum TraceSource : uint8_t {
+    TRACE_SERIAL1_RX = 1, ///< Bytes received from the cloud-ESP.
+    TRACE_SERIAL1_TX = 2, ///< Bytes sent to the cloud-ESP.
+    TRACE_SERIAL2_RX = 3, ///< Bytes received from the PMS5003.
+    TRACE_SERIAL2_TX = 4, ///< Commands sent to the PMS5003.
+    TRACE_DHT11 = 5,      ///< Raw DHT11 read: float temperature, float humidity (NaN on a failed read).
+    TRACE_MQ7 = 6,        ///< MQ7 measurement: uint16 millivolts, float ppm.
+};
+
+/** @brief First payload byte of a `FRAME_TRACE` frame. */
+enum TraceDumpPart : uint8_t {
+    TRACE_DUMP_HEADER = 0,
+    TRACE_DUMP_DATA = 1,
+};
+
+/**
+ * @class TraceRecorder
+ * @brief Ring of trace records and its console dumper.
+ *
+ * Every call site runs on the loop task, as does the Log job that dumps the ring, so the recorder
+ * takes no lock. Records arriving while a dump is in progress are skipped and counted, so the dump
+ * is a consistent snapshot.
+ */
+class TraceRecorder {
+    static_assert(TRACE_RING_BYTES >= 256 && (TRACE_RING_BYTES & (TRACE_RING_BYTES - 1)) == 0,
+                  "TRACE_RING_BYTES must be a power of two");
+
+    public:
+        TraceRecorder();
+
+        /** @brief Appends `length` bytes from `source`, timestamped now. Use `TRACE()` rather than calling this directly. */
+        void record(TraceSource source, const void *data, size_t length);
+
+        /** @brief Appends the raw bytes of `values`, in order, as one record. Use `TRACE_VALUES()`. */
+        template <typename... Values>
+        void recordValues(TraceSource source, Values... values) {
+            static_assert((std::is_arithmetic<Values>::value && ...), "Trace values must be numbers");
+            uint8_t payload[(sizeof(Values) + ...)];
+            size_t offset = 0;
+            ((memcpy(payload + offset, &values, sizeof(values)), offset += sizeof(values)), ...);
+            record(source, payload, sizeof(payload));
+        }
+
+        /** @brief Starts a dump of the ring as it is now. @return false if one is already in progress. */
+        bool startDump();
+
+        /**
+         * @brief Writes the next frames of the dump to `port`, as many as it takes without blocking.
+         *
+         * Recording resumes once the last frame has been written.
+         *
+         * @return Bytes written.
+         */
+        size_t dump(HardwareSerial &port);
+
+        bool dumping() const { return dumpActive; }         ///< True while a dump is in progress.
+        size_t size() const { return head - tail; }         ///< Bytes of records in the ring.
+        uint32_t overwritten() const { return dropped; }    ///< Records overwritten on a full ring.
+        uint32_t skipped() const { return paused; }         ///< Records skipped during dumps.
+
+    private:
+        void append(TraceSource source, const uint8_t *data, uint8_t length);
+        void dropOldest();
+        void put(const uint8_t *data, size_t length);
+        uint8_t at(uint32_t position) const { return ring[position & (TRACE_RING_BYTES - 1)]; }
+
+        uint8_t ring[TRACE_RING_BYTES];
+        uint32_t head;          ///< Position of the next byte to write; positions are free running.
+        uint32_t tail;          ///< Position of the oldest record.
+        uint32_t baseTime;      ///< Time the oldest record's delta counts from.
+        uint32_t lastTime;      ///< Time of the newest record.
+        uint32_t dropped;
+        uint32_t paused;
+        bool dumpActive;
+        bool headerSent;
+        uint32_t dumpPosition;  ///< Next ring position to dump.
+        uint8_t frameSequence;
+};
+
+#if TRACE_CAPTURE
+/** @brief The firmware's trace. */
+extern TraceRecorder traceRecorder;
+
+/** @brief Records `length` bytes at `data` from `TRACE_<source>`. */
+#define TRACE(source, data, length) traceRecorder.record(TRACE_##source, data, length)
+
+/** @brief Records numeric values from `TRACE_<source>`. */
+#define TRACE_VALUES(source, ...) traceRecorder.recordValues(TRACE_##source, __VA_ARGS__)
+#else
+#define TRACE(source, data, length) do { (void)(data); (void)(length); } while (0)
+#define TRACE_VALUES(source, ...) do { } while (0)
+#endif
+
+#endif // !TRACE_RECORDER_H
@@ -13,9 +13,11 @@
  */
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include <Preferences.h> 
-#include <CRC32.h>
+#include <StreamCrc32.h>
+#include <esp_partition.h>
+
+#include <atomic>
 
 #include <DHT11Sensor.h>
 #include <PMS5003Sensor.h>
@@ -23,11 +25,119 @@
 #include <LedControl.h>
 #include <BLDC.h> 
 #include <BLE.h>
+#include <SensorSnapshot.h>
+#include <StreamFilter.h>
+#include <SerialFrame.h>
+#include <FrameStore.h>
+#include <Scheduler.h>
+#include <ReportFilter.h>
+#include <ReadingPayload.h>
+#include <PayloadSerializer.h>
+#include <CommandParser.h>
+#include <CommandProtocol.h>
+#include <Instrumentation.h>
+#include <DeferredLog.h>
+#include <TraceRecorder.h>
+#include <PidController.h>
+#include <Actuators.h>
+#include <BootSequence.h>
+#include <PowerManager.h>
+#include <DeviceConfig.h>
 
 //MAC address = C0:49:EF:D3:43:5C
 
 Preferences preferences;  ///< To write network credentials permanently in ESP32's File system
 
+/**
+ * @brief Serial1 link protocol.
+ * 
+ * 1 (default): binary COBS frames with a type byte, sequence number and CRC32 in both directions.
+ * 0: legacy JSON text lines terminated by a decimal CRC32 and '\n'.
+ */
+#ifndef LINK_FRAMED
+#define LINK_FRAMED 1
+#endif
+
+/**
+ * @brief Defaults of the runtime configuration (see `config`).
+ * 
+ * The ISAAC ID, job periods, batching, report mode and fan control below are only used until a configuration
+ * is saved to NVS; after that the device boots with the saved one.
+ */
+#define ISAAC_ID "ec03f332a7b0400000"   ///< Device identifier reported with every reading
+
+/**
+ * @brief Batching of the samples sent with `LINK_FRAMED`.
+ * 
+ * A batch frame is sent as soon as it holds BATCH_SIZE samples, or when its oldest sample is BATCH_FLUSH_MS old.
+ * Both can be changed at runtime through `config`.
+ */
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 8
+#endif
+#ifndef BATCH_FLUSH_MS
+#define BATCH_FLUSH_MS 60000
+#endif
+
+/**
+ * @brief Store-and-forward of the batch frames sent with `LINK_FRAMED`.
+ * 
+ * Batches are queued in the "uplinkq" flash partition and sent with their record id (see `FRAME_RECORD_HEADER`). Up to
+ * LINK_WINDOW of them are in flight; the cloud-ESP acknowledges them with cumulative `FRAME_ACK` frames. Without an
+ * acknowledgement for LINK_ACK_TIMEOUT_MS the unacknowledged frames are sent again, and the timeout doubles up to
+ * LINK_ACK_TIMEOUT_MAX_MS while the peer stays silent. LINK_RETENTION decides what is lost when the partition is full.
+ */
+#ifndef LINK_WINDOW
+#define LINK_WINDOW 4
+#endif
+#ifndef LINK_ACK_TIMEOUT_MS
+#define LINK_ACK_TIMEOUT_MS 2000
+#endif
+#ifndef LINK_ACK_TIMEOUT_MAX_MS
+#define LINK_ACK_TIMEOUT_MAX_MS 60000
+#endif
+#ifndef LINK_RETENTION
+#define LINK_RETENTION RETAIN_NEWEST
+#endif
+
+/**
+ * @brief Report-by-exception of the readings sent to the cloud-ESP.
+ * 
+ * REPORT_MODE selects what is sent (see `ReportMode`) and can be changed at runtime through `config`:
+ * - REPORT_EVERY: every reading, as without report-by-exception.
+ * - REPORT_FULL: complete readings, only when a field moved beyond its deadband or a heartbeat is due.
+ * - REPORT_DELTA: only the channels that moved beyond their deadband or whose heartbeat is due.
+ * 
+ * The deadbands are { absolute, relative } pairs: a field is reported when it moved by more than the larger of the
+ * two since it was last reported. Every field is reported at least every REPORT_HEARTBEAT_MS.
+ * The legacy JSON peer expects every key, so the JSON link defaults to complete documents.
+ */
+#ifndef REPORT_MODE
+#if LINK_FRAMED
+#define REPORT_MODE REPORT_DELTA
+#else
+#define REPORT_MODE REPORT_FULL
+#endif
+#endif
+#ifndef REPORT_HEARTBEAT_MS
+#define REPORT_HEARTBEAT_MS 600000
+#endif
+#define PM2_5_DEADBAND { 2.0f, 0.10f }      ///< ug/m3, or 10 % at high concentrations
+#define TEMPERATURE_DEADBAND { 0.5f, 0.0f } ///< °C; the DHT11 resolution is 1 °C
+#define HUMIDITY_DEADBAND { 2.0f, 0.0f }    ///< %RH
+#define SMOKE_DEADBAND { 2.0f, 0.10f }      ///< MQ7 CO ppm
+
+#define UPLINK_PARTITION_LABEL "uplinkq"   ///< Data partition of the store-and-forward log (see partitions.csv)
+#define UPLINK_PARTITION_SUBTYPE 0x40
+
+#if LINK_FRAMED
+uint32_t txRecordId = 1;    ///< Record id of the next batch sent to the cloud-ESP without the store
+FrameDecoder rxDecoder;     ///< Decoder for frames received from the cloud-ESP
+CommandParser commandParser(false);   ///< Parser for the JSON document carried by a FRAME_COMMAND frame
+#else
+CommandParser commandParser(true);    ///< Parser for legacy command lines (JSON, decimal CRC32, '\n')
+#endif
+
 
 //DHT11 setup
 #define DHTPIN 15
@@ -36,50 +146,57 @@ DHT11Sensor dht11(DHTPIN, DHTTYPE);   ///< Create an object of custom class DHT1
 
 //MQ7 setup
 #define MQ7 33
-MQ7Sensor mq7(MQ7);   ///< Create an object of custom class MQ7Sensor
+#define MQ7_HEATER 32
+#define MQ7_ALARM_PPM 50   ///< CO concentration reported as "Gas Detected"
+MQ7Sensor mq7(MQ7, MQ7_HEATER);   ///< Create an object of custom class MQ7Sensor
 
 //PMS5003 object 
 PMS5003Sensor pms5003;  ///< Create an object of custom class PMS5003Sensor
 
 
 /**
- * @brief A structure to hold data from various sensors.
+ * @brief Latest readings of all sensors.
  * 
- * This structure contains data from multiple sensors, including the DHT11 sensor,
- * PMS5003 particulate matter sensor, and the MQ7 gas sensor. It provides a convenient
- * way to manage and access the data from these sensors as a single unit.
+ * Each sensor job publishes into its own channel of this snapshot without blocking, and
+ * SendToESPJob reads a consistent copy of every channel when it builds a payload.
  */
-struct SensorData {
-    /**
-     * @brief Data from the DHT11 sensor.
-     * 
-     * This member holds the temperature and humidity readings from the DHT11 sensor.
-     */
-    DHT11Data dht11;
-
-    /**
-     * @brief Data from the PMS5003 sensor.
-     * 
-     * This member contains the particulate matter readings from the PMS5003 sensor,
-     * which measures different particle sizes in the air.
-     */
-    PMS5003Data pms5003;
-
-    /**
-     * @brief Data from the MQ7 gas sensor.
-     * 
-     * This member stores the carbon monoxide concentration readings from the MQ7 sensor.
-     */
-    MQ7Data mq7;
-};
+SensorSnapshot sensorSnapshot;
 
 /**
- * @brief A variable to hold sensor data readings.
+ * @brief Filtering between the sensor drivers and `sensorSnapshot`.
  * 
- * This variable is an instance of the SensorData structure and is used to store and manage
- * the data from the DHT11, PMS5003, and MQ7 sensors.
+ * The published value of each channel is the median of its last few valid samples, which removes single-sample
+ * spikes and failed (NaN) DHT11 reads; the variance of the same samples is published in `sensorSnapshot.variance`.
+ * The windows span about 15 s of DHT11 samples and 5 s of PMS5003 samples.
  */
-SensorData sensorData;
+#define DHT11_FILTER_WINDOW 3
+#define PMS5003_FILTER_WINDOW 5
+StreamFilter<float, DHT11_FILTER_WINDOW> temperatureFilter;
+StreamFilter<float, DHT11_FILTER_WINDOW> humidityFilter;
+StreamFilter<uint16_t, PMS5003_FILTER_WINDOW> pm1_0Filter;
+StreamFilter<uint16_t, PMS5003_FILTER_WINDOW> pm2_5Filter;
+StreamFilter<uint16_t, PMS5003_FILTER_WINDOW> pm10Filter;
+ReadingVariance readingVariance = {0.0f, 0.0f, 0.0f};   ///< Last published `sensorSnapshot.variance`
+
+#if LINK_FRAMED
+/**
+ * @brief Every reading not yet sent to the cloud-ESP, one ring per sensor.
+ * 
+ * Each sensor job pushes every reading into its ring and SendToESPJob drains them into batch frames.
+ * The capacities (each channel's `history`) cover more than one BATCH_FLUSH_MS period at the sensors' sample rates.
+ */
+Sensors::History sensorHistory;
+
+ReadingBatch readingBatch(ISAAC_ID, BATCH_SIZE);   ///< Batch being filled by SendToESPJob
+
+FrameStore uplinkStore(LINK_RETENTION);      ///< Batches not yet acknowledged by the cloud-ESP, owned by SendToESPJob
+std::atomic<uint32_t> peerAck(0);            ///< Record id carried by the latest FRAME_ACK
+uint32_t peerAckSeen = 0;                    ///< Last `peerAck` value handled by SendToESPJob
+uint32_t ackWaitStart = 0;                   ///< When the oldest in-flight frame was sent or last progress was made
+uint32_t ackTimeoutMs = LINK_ACK_TIMEOUT_MS; ///< Current retransmission timeout
+#endif
+
+ReportFilter reportFilter(REPORT_HEARTBEAT_MS);   ///< Last reported value of every field, owned by the jobs
 
 
 
@@ -140,137 +257,499 @@ BLDC motor(PWMPin);
  */
 uint16_t dutycycle;
 
+/**
+ * @brief Mailbox between the command handlers and the LED and motor.
+ * 
+ * `ledcolor` and `dutycycle` are the wanted state; posting it hands it to ActuatorJob, which fades the
+ * hardware to the newest state posted.
+ */
+Actuators actuators(led, motor);
+
+/**
+ * @brief Default job periods in milliseconds; DHT11, PMS5003, MQ7 and SendToESP can be changed at runtime through `config`.
+ * 
+ * The PMS5003 job and ReceiveFromESPJob are triggered by their UART's RX event; their period only bounds
+ * the delay after a missed event. SendToESPJob is also triggered by every acknowledgement from the cloud-ESP.
+ */
+#ifndef DHT11_PERIOD_MS
+#define DHT11_PERIOD_MS 5000
+#endif
+#ifndef PMS5003_PERIOD_MS
+#define PMS5003_PERIOD_MS 2000
+#endif
+#ifndef MQ7_PERIOD_MS
+#define MQ7_PERIOD_MS 2000
+#endif
+#define MQ7_SAMPLING_PERIOD_MS 100   ///< MQ7 job period while the ADC samples (the DMA pool holds ~100 ms)
+#if LINK_FRAMED
+#define SEND_PERIOD_MS 1000
+#else
+#define SEND_PERIOD_MS 60000
+#endif
+#define RECEIVE_PERIOD_MS 1000
+#ifndef BLE_STREAM_PERIOD_MS
+#define BLE_STREAM_PERIOD_MS 1000   ///< Snapshot period of the BLE stream
+#endif
+#define LOG_PERIOD_MS 100    ///< LogJob period; the console TX buffer holds about a second of output at 9600 baud
+
+/**
+ * @brief Warm-up of each sensor before its samples are valid, in milliseconds.
+ * 
+ * The DHT11 must not be read within a second of power-up (DHT11_WARMUP_MS, in DHT11Sensor.h). The PMS5003 needs
+ * 30 s after waking for its fan to give a stable flow (datasheet). The MQ7 has none here: its first reading already
+ * ends a full heater cycle.
+ */
+#ifndef PMS5003_WARMUP_MS
+#define PMS5003_WARMUP_MS 30000
+#endif
+
+/**
+ * @brief Power saving: PMS5003 measurement windows and a lower CPU clock; POWER_LIGHT_SLEEP adds automatic light sleep.
+ * 
+ * The PMS5003 wakes every PMS5003_WINDOW_PERIOD_MS, settles for PMS5003_WARMUP_MS, and sleeps again after
+ * a full median window of frames, so its fan and laser run about 35 s in every 3 minutes.
+ */
+#ifndef POWER_SAVE
+#define POWER_SAVE 0
+#endif
+#ifndef POWER_LIGHT_SLEEP
+#define POWER_LIGHT_SLEEP 0
+#endif
+#ifndef PMS5003_WINDOW_PERIOD_MS
+#define PMS5003_WINDOW_PERIOD_MS 180000
+#endif
+#define PMS5003_WINDOW_SAMPLES PMS5003_FILTER_WINDOW
+#define PMS5003_WINDOW_TIMEOUT_MS (PMS5003_WARMUP_MS + 15000)   ///< Window closed without its frames
+#ifndef POWER_REPORT_MS
+#define POWER_REPORT_MS 600000  ///< Period of the power log line
+#endif
+
+/** @brief Largest duty cycle at the motor's 10-bit PWM resolution. */
+#define MOTOR_MAX_DUTY CONFIG_MAX_DUTY
+
+/**
+ * @brief Local fan control: PM2.5 setpoint (µg/m³), duty limits and gains of `fanController`.
+ * 
+ * With FAN_AUTO 1 the fan starts under local control instead of waiting for `CONTROL_SET_FAN_MODE`.
+ * The gains were tuned against the native build's room model (30 m³, 250 m³/h purifier): from 60 µg/m³
+ * it reaches the setpoint in about 30 minutes without overshoot, and leaves a saturation at once.
+ */
+#ifndef FAN_AUTO
+#define FAN_AUTO 0
+#endif
+#ifndef FAN_SETPOINT
+#define FAN_SETPOINT 12.0f
+#endif
+#define FAN_MIN_DUTY 0
+#define FAN_MAX_DUTY MOTOR_MAX_DUTY
+#define FAN_KP 100.0f   ///< Duty per µg/m³
+#define FAN_KI 0.2f     ///< Duty per µg/m³ and second
+#define FAN_KD 0.0f
+
+/**
+ * @brief PI controller driving the motor duty cycle from the filtered PM2.5 while `fanAuto` is set.
+ * 
+ * It is reverse acting: the duty cycle rises while the PM2.5 is above the setpoint. The cloud only
+ * changes its mode, setpoint and limits; a command setting the duty cycle returns the fan to manual control.
+ */
+PidController fanController({FAN_KP, FAN_KI, FAN_KD}, FAN_MIN_DUTY, FAN_MAX_DUTY, true);
+bool fanAuto = false;       ///< `fanController` sets the duty cycle; follows the configuration's fan mode
+
+/**
+ * @brief Runtime configuration, loaded from NVS at boot.
+ * 
+ * The jobs copy it out on every use, without locking. It is only changed by `applyConfig()`, from the
+ * commands of the cloud-ESP, which publishes a whole new configuration at once.
+ */
+ConfigStore config({
+  CONFIG_VERSION, sizeof(DeviceConfig),
+  DHT11_PERIOD_MS, PMS5003_PERIOD_MS, MQ7_PERIOD_MS, SEND_PERIOD_MS,
+  BATCH_FLUSH_MS, BATCH_SIZE, REPORT_MODE, FAN_AUTO ? CONTROL_FAN_AUTO : CONTROL_FAN_MANUAL, 0,
+  (uint16_t)(FAN_SETPOINT * 10.0f), FAN_MIN_DUTY, FAN_MAX_DUTY,
+  ISAAC_ID,
+  BLE_STREAM_PERIOD_MS,
+});
 
 /**
- * @brief Task handles for managing RTOS tasks.
+ * @brief Cooperative scheduler running every job on the Arduino loop task.
  * 
- * These handles are used to manage and control tasks within the RTOS. 
- * They allow operations such as starting, stopping, suspending, and resuming tasks.
+ * The sensor, sending and receiving work used to run in five FreeRTOS tasks with 2-4 KB stacks each.
+ * As run-to-completion jobs they share the loop task's stack, and their deadlines are absolute.
  */
-///< Core 0
-TaskHandle_t TaskDHT11Handle;
-TaskHandle_t TaskPMS5003Handle;
-TaskHandle_t TaskMQ7Handle;
-TaskHandle_t TaskSendToESPHandle;
+Scheduler scheduler;
+
+int SendToESPJob;       ///< Job sending readings to the cloud-ESP
+int ReceiveFromESPJob;  ///< Job handling what the cloud-ESP sent
+int LogJob;             ///< Job printing the deferred log
+int ActuatorJob = -1;   ///< Job fading the LED and motor to the posted state
+int BootJob;            ///< One-shot job running the boot work that no channel waits for
+int BleStreamJob;       ///< Job streaming snapshots to a BLE client
+
+/**
+ * @brief Readiness of every sensor channel since reset, and the boot trace.
+ */
+BootSequence bootSequence;
+
+/**
+ * @brief Supply current of the board's parts, at the 5 V input, from their datasheets.
+ * 
+ * ESP32 without radio: 20-31 mA at 80 MHz and 30-68 mA at 240 MHz (the upper figure while running jobs),
+ * 0.8 mA in light sleep. PMS5003: at most 100 mA active, 200 µA asleep. MQ7: 33 Ω heater at 5 V, on a PWM
+ * duty in its low phase. The rest (DHT11, regulator, LED off): a few mA.
+ */
+const PowerModel powerModel = {
+  5000,
+  POWER_SAVE ? 31000u : 68000u, POWER_SAVE ? 20000u : 30000u, 800,
+  100000, 200,
+  150000, 150000u * MQ7_HEATER_LOW_DUTY / 255,
+  5000,
+};
+
+PowerManager power;                 ///< CPU clock and light-sleep holds
+EnergyMeter energy(powerModel);     ///< Energy estimate, per reported sample
+SensorDutyCycle pmsWindows(PMS5003_WINDOW_PERIOD_MS, PMS5003_WINDOW_SAMPLES, PMS5003_WINDOW_TIMEOUT_MS);
+uint32_t lastPowerReport = 0;       ///< When the power log line was last written
 
-///< Core 1
-TaskHandle_t TaskReceiveFromESPHandle;
 TaskHandle_t TaskHandleWiFiCredentials;
 
 /**
- * @brief Semaphore handles for synchronizing tasks.
+ * @brief Latency histograms of the sections below, and stack and CPU use of the loop task.
  * 
- * These handles are used to manage semaphores in the RTOS, allowing tasks
- * to synchronize their execution and manage shared resources safely.
+ * Sent to the cloud-ESP as a `FRAME_TELEMETRY` frame when it sends a `FRAME_TELEMETRY_REQUEST`.
  */
-//Semaphore handles for synchronization
-SemaphoreHandle_t xSendSemaphore;
-SemaphoreHandle_t xStartSemaphore;
-SemaphoreHandle_t xSendMutex;
+Instrumentation instruments;
+
+int DHT11Section;       ///< DHT11 driver read
+int PMS5003Section;     ///< PMS5003 frame decoding
+int MQ7Section;         ///< MQ7 heater cycle and ADC drain
+int BatchSection;       ///< Draining the rings into a batch
+int StoreSection;       ///< Appending a batch to the flash log
+int UartTxSection;      ///< Writing a frame or document to Serial1
+int JsonSection;        ///< Serializing a JSON reading
 
 
+/**
+ * @brief Records a channel's published sample in the boot trace; logs the time of its first one.
+ */
+void traceSample(BootChannel channel){
+  uint32_t now = millis();
+  if (!bootSequence.published(channel, now)) {
+    return;
+  }
+  switch (channel) {
+    case BOOT_DHT11:   LOG(BOOT_DHT11_SAMPLE, now); break;
+    case BOOT_PMS5003: LOG(BOOT_PMS5003_SAMPLE, now); break;
+    case BOOT_MQ7:     LOG(BOOT_MQ7_SAMPLE, now); break;
+    default: break;
+  }
+  if (bootSequence.complete()) {
+    LOG(BOOT_COMPLETE, bootSequence.firstSampleTime(BOOT_DHT11), bootSequence.firstSampleTime(BOOT_PMS5003),
+        bootSequence.firstSampleTime(BOOT_MQ7));
+  }
+}
 
-/* The parameter 'pvParameters' is a pointer to void, allowing any type of data to be passed to the task.
-This provides flexibility, as the task function can cast 'pvParameters' to the appropriate type as needed.
-For example, it can be used to pass a structure containing configuration data or a simple integer value.
-When creating the task, this parameter can be specified by the caller to customize the task's behavior or 
-provide it with the necessary context information. */
+#if LINK_FRAMED
 
 /**
- * @brief Task for collecting data from the DHT11 sensor.
+ * @brief Queues the reading a sensor job just published, if report-by-exception lets it through.
  * 
- * This FreeRTOS task reads temperature and humidity data from the DHT11 sensor
- * and outputs the values to the serial monitor. It uses a semaphore to manage
- * access to shared resources, ensuring data integrity and task synchronization.
+ * In REPORT_FULL mode a change of any field queues the latest sample of every channel, all stamped with the
+ * current time. In REPORT_DELTA mode only the sensor's own channel is queued; a DHT11 record carries both
+ * temperature and humidity, so both count as reported.
  * 
- * @param pvParameters Pointer to the task parameters (unused in this task).
+ * @param fields Fields of the sensor that published.
+ */
+void reportSample(uint8_t fields){
+  uint32_t now = millis();
+  SensorData latest;
+  sensorSnapshot.read(latest);
+
+  ReportMode mode = (ReportMode)config.get().reportMode;
+  if (mode == REPORT_EVERY) {
+    sensorHistory.queue(latest, fields, now);
+    return;
+  }
+  if (mode == REPORT_FULL) {
+    fields = sensorSnapshot.publishedFields();   // Every channel streaming so far
+  }
+
+  if (!reportFilter.changes(latest, fields, now)) {
+    return;
+  }
+  sensorHistory.queue(latest, fields, now);
+  reportFilter.commit(latest, fields, now);
+}
+#endif
+
+
+/**
+ * @brief Job collecting data from the DHT11 sensor.
  * 
- * The task runs indefinitely, attempting to read the DHT11 sensor every 5 seconds.
- * If the mutex `xSendMutex` is available, it reads the sensor data and stores it
- * in the `sensorData` structure. The task then releases the semaphore and mutex.
- * If the sensor data is invalid, an error message is printed.
- */
-
-void TaskDHT11(void *pvParameters) {
-  Serial.print("TaskDHT11 running on core ");
-  Serial.println(xPortGetCoreID());
-  while (1) {
-    //Check if the mutex is not taken by the display task
-    if(xSemaphoreTake(xSendMutex,0) == pdTRUE){
-      sensorData.dht11 = dht11.readDHT11();
-      xSemaphoreGive(xSendSemaphore);
-      xSemaphoreGive(xSendMutex);
-      if (isnan(sensorData.dht11.temperature) || isnan(sensorData.dht11.humidity)) {
-        Serial.println("Failed to read from DHT sensor!");
-      } else {
-        Serial.print("DHT11 - Temperature: ");
-        Serial.print(sensorData.dht11.temperature);
-        Serial.print(" °C, Humidity: ");
-        Serial.print(sensorData.dht11.humidity);
-        Serial.println(" %");
-      }
-    }
-    vTaskDelay(5000 / portTICK_PERIOD_MS); // Delay for 5 seconds
+ * This job reads temperature and humidity data from the DHT11 sensor
+ * and outputs the values to the serial monitor.
+ * 
+ * It runs every DHT11_PERIOD_MS (5 seconds), filters the reading and publishes the filtered value into the `dht11`
+ * channel of `sensorSnapshot`. Publishing never blocks. If the sensor data is invalid,
+ * an error message is printed and nothing is published, so the previous value stands.
+ */
+void DHT11Channel::sample() {
+  if (!bootSequence.ready(BOOT_DHT11, millis())) {
+    return;
+  }
+  DHT11Data raw;
+  {
+    INSTRUMENT(DHT11Section);
+    raw = dht11.readDHT11();
+  }
+  TRACE_VALUES(DHT11, raw.temperature, raw.humidity);
+  if (isnan(raw.temperature) || isnan(raw.humidity)) {
+    temperatureFilter.update(NAN);  // Counted as rejected
+    LOG(DHT11_READ_FAILED);
+    return;
   }
+  temperatureFilter.update(raw.temperature);
+  humidityFilter.update(raw.humidity);
+
+  DHT11Data reading;
+  reading.temperature = temperatureFilter.median();
+  reading.humidity = humidityFilter.median();
+  readingVariance.temperature = temperatureFilter.variance();
+  readingVariance.humidity = humidityFilter.variance();
+  sensorSnapshot.variance.write(readingVariance);
+  sensorSnapshot.publish<DHT11Channel>(reading);
+  traceSample(BOOT_DHT11);
+#if LINK_FRAMED
+  reportSample(REPORT_TEMPERATURE | REPORT_HUMIDITY);
+#endif
+  LOG(DHT11_READING, reading.temperature, reading.humidity);
 }
 
 /**
- * @brief Task for collecting data from the PMS5003 sensor.
+ * @brief Serial2 RX event callback.
  * 
- * This FreeRTOS task reads particulate matter data from the PMS5003 sensor
- * and stores the readings in the `sensorData` structure. It uses a semaphore 
- * to manage access to shared resources, ensuring data integrity and task 
- * synchronization.
+ * Runs in the UART driver's event task when the PMS5003 has sent data (the line goes idle at the end
+ * of every frame) and triggers the PMS5003 job.
+ */
+void onSerial2Receive(){
+  scheduler.trigger(PMS5003Channel::job);
+}
+
+/**
+ * @brief Posts `ledcolor` and `dutycycle` to the actuator mailbox and returns.
+ */
+void postActuators(){
+  ActuatorCommand targets = {ledcolor.red, ledcolor.green, ledcolor.blue, dutycycle,
+                             COMMAND_RED | COMMAND_GREEN | COMMAND_BLUE | COMMAND_DUTY};
+  actuators.post(targets);
+  scheduler.trigger(ActuatorJob);
+}
+
+/**
+ * @brief One-shot job starting BLE provisioning when no WiFi credentials are stored.
  * 
- * @param pvParameters Pointer to the task parameters (unused in this task).
+ * It runs once, after the first pass of the other jobs, so starting the BLE stack does not hold up the
+ * links or the sensors' warm-up.
+ */
+void startProvisioning(){
+  if (!preferences.isKey("SSID") && !preferences.isKey("Password")) {
+    setupBLE();
+    LOG(BLE_PROVISIONING);
+
+    // Core 1 Task: Handles WiFi credentials retrieval
+    //xTaskCreatePinnedToCore(WiFiCredentials, "WiFiCredentials", 4096, NULL, 2, &TaskHandleWiFiCredentials, 1);
+  } else {
+    //connect_to_WIFI();
+  }
+}
+
+/**
+ * @brief Longest a snapshot waits for others to share its BLE notification, in milliseconds.
+ */
+#define BLE_NOTIFY_MAX_DELAY_MS 1000
+
+BleNotifier bleNotifier;    ///< Snapshots not yet notified, owned by BleStreamJob
+
+/**
+ * @brief Job streaming sensor snapshots to a subscribed BLE client.
  * 
- * The task runs indefinitely, attempting to read the PMS5003 sensor every 2 seconds.
- * If the mutex `xSendMutex` is available, it reads the sensor data and stores it
- * in the `sensorData` structure. The task then releases the semaphore and mutex.
+ * Every BLE stream period it queues the latest snapshot. The queue is notified once BLE_NOTIFY_MAX_DELAY_MS worth
+ * of snapshots are waiting, so a fast stream goes out in few MTU-sized notifications and a slow one without delay.
+ * Nothing is queued while no client is subscribed.
  */
+void streamToBle(){
+  GattLink &link = bleStreamLink();
+  if (!link.subscribed()) {
+    bleNotifier.clear();
+    return;
+  }
+  SensorData latest;
+  sensorSnapshot.read(latest);
+  bleNotifier.push(millis(), latest);
 
-void TaskPMS5003(void *pvParameters) {
-  Serial.print("TaskPMS5003 running on core ");
-  Serial.println(xPortGetCoreID());
-  Serial.println(" ");
-  while (1) {
-    if(xSemaphoreTake(xSendMutex,0) == pdTRUE){
-      sensorData.pms5003 = pms5003.readData();
-      xSemaphoreGive(xSendSemaphore);
-      xSemaphoreGive(xSendMutex);
-    }
-    vTaskDelay(2000 / portTICK_PERIOD_MS); // Delay for 2 seconds
+  uint32_t batch = BLE_NOTIFY_MAX_DELAY_MS / config.get().blePeriodMs;
+  bleNotifier.flush(link, batch > 255 ? 255 : (uint8_t)batch);
+}
+
+/**
+ * @brief Job applying the newest posted actuator state.
+ * 
+ * Triggered by every post. While a change waits for a running fade, the job's period is set
+ * to the time left, and it goes back to running on triggers only once the hardware has caught up.
+ */
+void applyActuators(){
+  scheduler.setPeriod(ActuatorJob, actuators.apply(millis()));
+}
+
+/**
+ * @brief Switches the fan between manual and local control.
+ * 
+ * Local control starts from the current duty cycle, so the switch does not jolt the motor.
+ */
+void setFanMode(bool automatic){
+  if (automatic && !fanAuto) {
+    fanController.reset(dutycycle);
   }
+  fanAuto = automatic;
+  LOG(FAN_MODE, fanAuto, fanController.setpoint(), (uint16_t)fanController.outputMin(), (uint16_t)fanController.outputMax());
 }
 
+/**
+ * @brief Steps `fanController` with a filtered PM2.5 reading and applies its duty cycle, under local control.
+ * 
+ * @param pm2_5 Filtered PM2.5, µg/m³.
+ * @param now When it was read.
+ */
+void controlFan(float pm2_5, uint32_t now){
+  if (!fanAuto) {
+    return;
+  }
+  uint16_t duty = (uint16_t)lroundf(fanController.update(pm2_5, now));
+  if (duty != dutycycle) {
+    dutycycle = duty;
+    postActuators();
+  }
+}
 
 /**
- * @brief Task for monitoring gas levels using the MQ7 sensor.
+ * @brief Job collecting data from the PMS5003 sensor.
  * 
- * This FreeRTOS task monitors gas levels from the MQ7 gas sensor. It periodically
- * updates the `sensorData` structure with the gas sensor readings and checks if 
- * the gas value exceeds a certain threshold. If gas is detected, it outputs a 
- * message to the serial monitor. The task uses a semaphore to signal other tasks 
- * when new data is available.
+ * This job decodes the particulate matter frames sent by the PMS5003 sensor
+ * and publishes the readings into the `pms5003` channel of `sensorSnapshot`.
  * 
- * @param pvParameters Pointer to the task parameters (unused in this task).
+ * It is triggered by the Serial2 RX event callback and decodes whatever has been received,
+ * so it never waits on the sensor. In active mode the sensor sends a frame about every second
+ * and each valid frame is published, with the atmospheric PM1.0, PM2.5 and PM10 replaced by
+ * their filtered values. Under local fan control the filtered PM2.5 also steps `fanController`.
+ * With POWER_SAVE the job also opens and closes the PMS5003's measurement windows, and charges the
+ * energy estimate.
+ */
+/**
+ * @brief Charges the time since the last call to the energy estimate and updates the light-sleep holds.
  * 
- * The task runs indefinitely, checking the MQ7 sensor every 2 seconds. Currently, 
- * the sensor data is set to a fixed value for demonstration purposes. The task 
- * signals that new sensor data is available by giving the `xSendSemaphore` semaphore.
- * If the gas value is equal to 1, indicating gas detection, a message is printed to 
- * the serial monitor.
+ * Called before any power state changes, so the elapsed interval is charged to the states it was spent in.
  */
+void updatePower(uint32_t now){
+  bool pmsAwake = !POWER_SAVE || pmsWindows.awake();
+  energy.update(now, scheduler.busy(), pmsAwake, mq7.phase() == MQ7_HEATER_HIGH, power.canSleep());
+
+  uint8_t holds = POWER_HOLD_MQ7;   // The heater PWM never stops
+  if (pmsAwake) holds |= POWER_HOLD_PMS5003;
+  if (dutycycle != 0) holds |= POWER_HOLD_MOTOR;
+  power.hold(holds);
+
+  if (now - lastPowerReport >= POWER_REPORT_MS) {
+    lastPowerReport = now;
+    LOG(POWER_REPORT, energy.averageMilliwatts(), energy.microjoulesPerSample(), energy.pmsAwakePermille());
+  }
+}
 
-void TaskMQ7(void *pvParameters) {
-  while (1) {
-    //sensorData.mq7 = mq7.gasRead();
-    sensorData.mq7.gasValue = 0;
-    xSemaphoreGive(xSendSemaphore);
-    if(sensorData.mq7.gasValue == 1){
-      Serial.println("Gas Detected");
-    }
-    vTaskDelay(2000 / portTICK_PERIOD_MS); // Delay for 2 seconds
+#if POWER_SAVE
+/**
+ * @brief Applies a transition of the PMS5003 measurement windows.
+ */
+void stepPmsWindow(SensorDutyCycle::Action action, uint32_t now){
+  if (action == SensorDutyCycle::DUTY_WAKE) {
+    pms5003.wakeUp();
+    bootSequence.warmUp(BOOT_PMS5003, now, PMS5003_WARMUP_MS);
+  } else if (action == SensorDutyCycle::DUTY_SLEEP) {
+    pms5003.sleep();
+  }
+}
+#endif
+
+void PMS5003Channel::sample() {
+  uint32_t now = millis();
+  updatePower(now);
+#if POWER_SAVE
+  stepPmsWindow(pmsWindows.update(now), now);
+#endif
+
+  PMS5003Data reading;
+  bool decoded;
+  {
+    INSTRUMENT(PMS5003Section);
+    decoded = pms5003.poll(reading);
+  }
+  // Frames sent while the fan spins up are decoded, so the stream stays in sync, and dropped
+  if (decoded && bootSequence.ready(BOOT_PMS5003, now)) {
+    pm1_0Filter.update(reading.pm1_0);
+    pm2_5Filter.update(reading.pm2_5);
+    pm10Filter.update(reading.pm10);
+    reading.pm1_0 = pm1_0Filter.median();
+    reading.pm2_5 = pm2_5Filter.median();
+    reading.pm10 = pm10Filter.median();
+    readingVariance.pm2_5 = pm2_5Filter.variance();
+    sensorSnapshot.variance.write(readingVariance);
+    sensorSnapshot.publish<PMS5003Channel>(reading);
+    traceSample(BOOT_PMS5003);
+    controlFan(reading.pm2_5, now);
+#if LINK_FRAMED
+    reportSample(REPORT_PM2_5);
+#endif
+#if POWER_SAVE
+    stepPmsWindow(pmsWindows.sampled(now), now);
+#endif
+  }
+#if POWER_SAVE
+  // Asleep, the job only has to run again when the next window opens
+  uint32_t wait = pmsWindows.untilNext(now);
+  scheduler.setPeriod(PMS5003Channel::job, pmsWindows.awake() ? config.get().pms5003PeriodMs : (wait > 0 ? wait : 1));
+#endif
+}
+
+
+/**
+ * @brief Job monitoring gas levels using the MQ7 sensor.
+ * 
+ * This job monitors gas levels from the MQ7 gas sensor. It publishes the gas sensor
+ * readings into the `mq7` channel of `sensorSnapshot` and checks if the gas value
+ * exceeds a certain threshold. If gas is detected, it outputs a message to the serial monitor.
+ * 
+ * The job runs every MQ7_PERIOD_MS (2 seconds) and advances the sensor's heater cycle; the ADC DMA
+ * does the conversions in between, and the job runs every MQ7_SAMPLING_PERIOD_MS to collect them. A reading is published once per 150 s heater cycle. If the CO
+ * concentration reaches MQ7_ALARM_PPM, a message is printed to the serial monitor.
+ */
+void MQ7Channel::sample() {
+  MQ7Data reading;
+  bool measured;
+  {
+    INSTRUMENT(MQ7Section);
+    measured = mq7.update(reading);
+  }
+  // Collect the DMA pool before it fills while the ADC runs
+  scheduler.setPeriod(MQ7Channel::job, mq7.phase() == MQ7_HEATER_SAMPLING ? MQ7_SAMPLING_PERIOD_MS : config.get().mq7PeriodMs);
+  if (!measured) {
+    return;
+  }
+  TRACE_VALUES(MQ7, reading.millivolts, reading.ppm);
+  sensorSnapshot.publish<MQ7Channel>(reading);
+  traceSample(BOOT_MQ7);
+#if LINK_FRAMED
+  reportSample(REPORT_SMOKE);
+#endif
+  LOG(MQ7_READING, reading.ppm, mq7.conversions());
+  if(reading.gasValue >= MQ7_ALARM_PPM){
+    LOG(MQ7_GAS_DETECTED);
   }
 }
 
@@ -291,154 +770,468 @@ void TaskMQ7(void *pvParameters) {
  */
 
 /**
- * @brief TaskSendToESP function sends sensor data to the cloud-ESP periodically.
+ * @brief Sends `length` bytes to the cloud-ESP, recording them in the trace.
+ */
+void writeToESP(const uint8_t *data, size_t length){
+  TRACE(SERIAL1_TX, data, length);
+  Serial1.write(data, length);
+}
+
+#if LINK_FRAMED
+/**
+ * @brief Seals the current batch, sends it to the cloud-ESP as a `FRAME_BATCH` frame and starts a new batch.
+ */
+void sendBatch(){
+  readingBatch.seal(millis());
+  if (uplinkStore.ready()) {
+    // Queued in flash; forwardStored() sends it
+    INSTRUMENT(StoreSection);
+    uplinkStore.append(FRAME_BATCH, readingBatch.data(), readingBatch.length());
+  } else {
+    // Never sent again, so the peer may take it whatever it missed before
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    encodeRecordHeader(txRecordId, 0, payload);
+    memcpy(payload + FRAME_RECORD_HEADER, readingBatch.data(), readingBatch.length());
+    uint8_t frame[FRAME_MAX_ENCODED];
+    size_t frameLength = encodeFrame(FRAME_BATCH, (uint8_t)txRecordId++, payload, FRAME_RECORD_HEADER + readingBatch.length(), frame, sizeof(frame));
+
+    // Send data to the cloud-ESP
+    INSTRUMENT(UartTxSection);
+    writeToESP(frame, frameLength);
+  }
+  readingBatch.clear();
+}
+
+/**
+ * @brief Handles the latest acknowledgement and sends queued frames while the window has room.
+ * 
+ * Every frame carries its record id and the id of the frame sent before it, so the cloud-ESP follows the gaps that
+ * dropped and corrupt records leave in the ids, and acknowledges with full record ids.
+ */
+void forwardStored(){
+  uint32_t acked = peerAck.load();
+  if (acked != peerAckSeen) {
+    peerAckSeen = acked;
+    if (acked - uplinkStore.oldestId() < uplinkStore.inFlight()) {
+      uplinkStore.acknowledge(acked);
+      ackWaitStart = millis();
+      ackTimeoutMs = LINK_ACK_TIMEOUT_MS;
+    }
+  }
+
+  if (uplinkStore.inFlight() > 0 && millis() - ackWaitStart >= ackTimeoutMs) {
+    // Go back and resend everything unacknowledged; back off while the peer stays silent
+    uplinkStore.rewind();
+    ackTimeoutMs = ackTimeoutMs * 2 > LINK_ACK_TIMEOUT_MAX_MS ? LINK_ACK_TIMEOUT_MAX_MS : ackTimeoutMs * 2;
+  }
+
+  uint8_t payload[FRAME_MAX_PAYLOAD];
+  uint8_t type;
+  uint16_t length;
+  uint32_t id, previous;
+  while (uplinkStore.inFlight() < LINK_WINDOW && uplinkStore.next(type, payload + FRAME_RECORD_HEADER, length, id, previous)) {
+    if (previous == 0) {
+      // Nothing else in flight
+      ackWaitStart = millis();
+    }
+    encodeRecordHeader(id, previous, payload);
+    uint8_t frame[FRAME_MAX_ENCODED];
+    size_t frameLength = encodeFrame(type, (uint8_t)id, payload, FRAME_RECORD_HEADER + length, frame, sizeof(frame));
+
+    // Send data to the cloud-ESP
+    INSTRUMENT(UartTxSection);
+    writeToESP(frame, frameLength);
+  }
+}
+
+/**
+ * @brief Moves the oldest pending sample of any sensor into the current batch.
+ * 
+ * The rings are merged by timestamp so that a batch is in time order. When the sample does not fit,
+ * the batch is sent first and the sample starts the next one.
+ * 
+ * @return false if every ring is empty.
+ */
+bool batchOldestSample(){
+  bool taken = sensorHistory.takeOldest([](auto channel, uint32_t time, const auto &value) {
+    typedef decltype(channel) Channel;
+    for (int attempt = 0; attempt < 2; attempt++) {
+      if (readingBatch.add<Channel>(time, value)) {
+        energy.reported(1);
+        break;
+      }
+      if (readingBatch.empty()) {
+        break;    // A sample that does not fit an empty batch is dropped
+      }
+      sendBatch();
+    }
+  });
+
+  if (taken && readingBatch.full()) {
+    sendBatch();
+  }
+  return taken;
+}
+#endif
+
+/**
+ * @brief Job sending sensor data to the cloud-ESP.
+ * 
+ * With `LINK_FRAMED` every reading queued by the sensor jobs is sent (see `reportSample()`). Every SEND_PERIOD_MS (1 second) the job
+ * drains the sample rings into binary `FRAME_BATCH` frames of `batchSize` samples; a partial batch is sent once
+ * its oldest sample is `batchFlushMs` old. Batches go through the flash store-and-forward log and are sent
+ * until the cloud-ESP acknowledges them; an acknowledgement triggers the job to keep the window full.
  * 
- * This function is a task that runs indefinitely and sends sensor data to the cloud-ESP every 30 seconds.
- * It takes the sensor data, constructs a JSON payload, and sends it to the cloud-ESP using the Serial1 interface.
- * Before sending the data, it acquires multiple semaphores to ensure exclusive access to the sensor data and to stop other sensor tasks.
- * After sending the data, it releases the acquired semaphores.
+ * Otherwise the job checks the latest reading of every sensor every SEND_PERIOD_MS (60 seconds) and sends it
+ * as the legacy JSON line, unless report-by-exception finds nothing worth sending; in REPORT_DELTA mode the
+ * document only carries the changed fields. The sensor data is copied out of `sensorSnapshot` and serialized
+ * into a stack buffer without any heap allocation. The legacy peer takes a document missing a field for a delta,
+ * so nothing is sent until every sensor has published once.
+ * writeToESP() sends the payload as a series of bytes to the cloud-ESP; the console only logs its length.
+ * The job also keeps the energy estimate current while the PMS5003 job sleeps between windows.
+ */
+void sendToESP(){
+  updatePower(millis());
+  DeviceConfig cfg = config.get();
+#if LINK_FRAMED
+  readingBatch.setMaxSamples(cfg.batchSize);
+  {
+    INSTRUMENT(BatchSection);
+    while (batchOldestSample()) {
+    }
+  }
+  if (!readingBatch.empty() && millis() - readingBatch.firstTime() >= cfg.batchFlushMs) {
+    sendBatch();
+  }
+  if (uplinkStore.ready()) {
+    forwardStored();
+  }
+#else
+  uint8_t published = sensorSnapshot.publishedFields();
+  if (published == REPORT_ALL_FIELDS) {
+      SensorData sensorData;
+      sensorSnapshot.read(sensorData);
+
+      uint32_t now = millis();
+      ReportMode mode = (ReportMode)cfg.reportMode;
+      uint8_t fields = published;
+      if (mode != REPORT_EVERY) {
+        fields = reportFilter.changes(sensorData, published, now);
+        if (!fields) {
+          return;
+        }
+        if (mode == REPORT_FULL) {
+          fields = published;
+        }
+      }
+
+      char jsonPayload[PAYLOAD_JSON_MAX];
+      size_t payloadLength;
+      {
+        INSTRUMENT(JsonSection);
+        payloadLength = serializeReadingJson(sensorData, cfg.isaacId, jsonPayload, sizeof(jsonPayload), NULL, fields);
+      }
+      reportFilter.commit(sensorData, fields, now);
+
+      LOG(READING_SENT, payloadLength, fields);
+      energy.reported(((fields & (REPORT_TEMPERATURE | REPORT_HUMIDITY)) != 0) + ((fields & REPORT_PM2_5) != 0) +
+                      ((fields & REPORT_SMOKE) != 0));
+
+      // Send data to the cloud-ESP
+      INSTRUMENT(UartTxSection);
+      writeToESP((const uint8_t*)jsonPayload, payloadLength);
+  }
+#endif
+}
+
+/**
+ * @brief Validates a new runtime configuration, publishes it, and applies what the jobs do not read on every run.
  * 
- * Serial.write() sends the string as a series of bytes to sensor-ESP32.
+ * An invalid configuration changes nothing, so the values of one command are applied together or not at all.
+ * Called from ReceiveFromESPJob only, the configuration's single writer.
  * 
- * @param pvParameters A pointer to task parameters (not used in this function).
+ * @param next The new configuration, a modified copy of `config.get()`.
+ * @param save Also write it to NVS for the next boot.
+ * @return `CONTROL_OK`, `CONTROL_OUT_OF_RANGE` if `next` is invalid, or `CONTROL_UNAVAILABLE` if it was applied
+ *         but could not be saved.
  */
-void TaskSendToESP(void *pvParameters){
-  while(1){
-      if (xSemaphoreTake(xSendSemaphore, portMAX_DELAY) == pdTRUE &&
-          xSemaphoreTake(xSendSemaphore, portMAX_DELAY) == pdTRUE &&
-          xSemaphoreTake(xSendSemaphore, portMAX_DELAY) == pdTRUE) {
+ControlStatus applyConfig(const DeviceConfig &next, bool save){
+  if (!validConfig(next)) {
+    return CONTROL_OUT_OF_RANGE;
+  }
+  DeviceConfig previous = config.get();
+  config.publish(next);
+
+  Sensors::reschedule(scheduler, next, previous);
+  if (next.sendPeriodMs != previous.sendPeriodMs) scheduler.setPeriod(SendToESPJob, next.sendPeriodMs);
+  if (next.blePeriodMs != previous.blePeriodMs) scheduler.setPeriod(BleStreamJob, next.blePeriodMs);
+#if LINK_FRAMED
+  if (strcmp(next.isaacId, previous.isaacId) != 0) readingBatch.setDeviceId(next.isaacId);
+#endif
+  if (next.fanMode != previous.fanMode || next.fanSetpoint != previous.fanSetpoint ||
+      next.fanMinDuty != previous.fanMinDuty || next.fanMaxDuty != previous.fanMaxDuty) {
+    fanController.setSetpoint(next.fanSetpoint / 10.0f);
+    fanController.setLimits(next.fanMinDuty, next.fanMaxDuty);
+    setFanMode(next.fanMode == CONTROL_FAN_AUTO);   // Logs the new target
+  }
 
-          // Attempt to take the mutex to stop sensor tasks
-          if (xSemaphoreTake(xSendMutex, portMAX_DELAY) == pdTRUE) {
-          // All sensor data is ready and access is exclusive
-            String jsonPayload;
-            jsonPayload+="{\"database\":\"isaac_v1\",\"collection\":\"sensor_readings\",\"dataSource\":\"IsaacTest\",\"document\": {";
-            //jsonPayload+="\"Timestamp\":" + timestamp + ",";
-            jsonPayload += "\"ISAAC ID\" : \"ec03f332a7b0400000\",";
-            jsonPayload += "\"PM2.5\":" + String(sensorData.pms5003.pm2_5) + ",";
-            jsonPayload += "\"Temperature\":" + String(sensorData.dht11.temperature) + ",";
-            jsonPayload += "\"Humidity\":" + String(sensorData.dht11.humidity) + ",";
-            jsonPayload += "\"Smoke\":" + String(sensorData.mq7.gasValue);
-            jsonPayload += "}}";   
-            Serial.println(jsonPayload);
+  bool saved = save && config.save(next);
+  LOG(CONFIG_APPLIED, config.generation(), saved);
+  return save && !saved ? CONTROL_UNAVAILABLE : CONTROL_OK;
+}
 
-            // Calculate CRC32
-            CRC32 crc;
-            crc.update((uint8_t*)jsonPayload.c_str(), jsonPayload.length());
-            uint32_t crcValue = crc.finalize();
+/**
+ * @brief Applies a command received from the cloud-ESP.
+ * 
+ * The command carries the LED color values (RED, GREEN, BLUE) and the motor duty cycle (DutyCycle).
+ * Only the actuators in `fields` are changed. A JSON command applies every field, and a value
+ * missing from it is applied as 0; a binary command only applies the fields it carries.
+ * Setting the duty cycle ends local fan control. The new state is posted to the actuator mailbox,
+ * so the caller goes back to parsing while ActuatorJob fades the hardware.
+ * 
+ * @param command The parsed command.
+ * @param fields `CommandField` bits of the values to apply.
+ */
+void applyCommand(const ActuatorCommand &command, uint8_t fields = COMMAND_RED | COMMAND_GREEN | COMMAND_BLUE | COMMAND_DUTY){
+  if (fields & COMMAND_RED) ledcolor.red = command.red;
+  if (fields & COMMAND_GREEN) ledcolor.green = command.green;
+  if (fields & COMMAND_BLUE) ledcolor.blue = command.blue;
+  if (fields & COMMAND_DUTY) {
+    if (fanAuto) {
+      DeviceConfig next = config.get();
+      next.fanMode = CONTROL_FAN_MANUAL;
+      applyConfig(next, false);
+    }
+    dutycycle = command.dutyCycle;
+  }
 
-            // Append CRC32 to the JSON payload
-            jsonPayload +=String(crcValue) + "\n";
+  LOG(COMMAND_APPLIED, ledcolor.red, ledcolor.green, ledcolor.blue, dutycycle);
 
-            Serial.println(jsonPayload.c_str());
-            
-            // Send data to the cloud-ESP
-            Serial1.write(jsonPayload.c_str());
-              
+  if (fields) postActuators();
+}
 
-            // Release the semaphores
-            xSemaphoreGive(xSendSemaphore);
-            xSemaphoreGive(xSendSemaphore);
-            xSemaphoreGive(xSendSemaphore);
-            xSemaphoreGive(xSendMutex);
-          }
+#if LINK_FRAMED
+/**
+ * @brief Sends a `FRAME_TELEMETRY` frame answering the telemetry request `seq`.
+ * 
+ * The counters, in this order: samples dropped on a full DHT11, PMS5003 and MQ7 ring, DHT11 reads rejected as NaN,
+ * PMS5003 frames dropped (checksum, framing), link frames dropped (CRC, framing), batches dropped and refused by
+ * the uplink store, job deadlines skipped by the scheduler, and the estimated energy per reported sample in µJ.
+ */
+void sendTelemetry(uint8_t seq){
+  uint32_t skipped = 0;
+  for (int job = 0; job < scheduler.jobs(); job++) {
+    skipped += scheduler.stats(job).skipped;
+  }
+  const uint32_t counters[] = {
+    sensorHistory.ring<DHT11Channel>().dropped(), sensorHistory.ring<PMS5003Channel>().dropped(),
+    sensorHistory.ring<MQ7Channel>().dropped(),
+    temperatureFilter.rejected(),
+    pms5003.parser().checksumErrors, pms5003.parser().framingErrors,
+    rxDecoder.crcErrors, rxDecoder.framingErrors,
+    uplinkStore.dropped, uplinkStore.rejected,
+    skipped,
+    energy.microjoulesPerSample(),
+  };
+
+  uint8_t payload[FRAME_MAX_PAYLOAD];
+  size_t payloadLength = instruments.encodeTelemetry(scheduler.busy(), counters, sizeof(counters) / sizeof(counters[0]),
+                                                     payload, sizeof(payload));
+  uint8_t frame[FRAME_MAX_ENCODED];
+  size_t frameLength = encodeFrame(FRAME_TELEMETRY, seq, payload, payloadLength, frame, sizeof(frame));
+  writeToESP(frame, frameLength);
+}
+#endif
+
+#if LINK_FRAMED
+int16_t lastControlSeq = -1;    ///< Seq of the last applied `FRAME_CONTROL` command, -1 before the first
+uint32_t lastControlTime = 0;   ///< When it was applied
+
+/**
+ * @brief Applies a decoded binary command.
+ * 
+ * @return `CONTROL_OK`, or `CONTROL_OUT_OF_RANGE` if an argument is outside what the device accepts.
+ */
+ControlStatus applyControl(const ControlCommand &command, uint8_t seq){
+  switch (command.opcode) {
+    case CONTROL_SET_LED:
+    case CONTROL_SET_DUTY:
+      if ((command.actuators.present & COMMAND_DUTY) && command.actuators.dutyCycle > MOTOR_MAX_DUTY) {
+        return CONTROL_OUT_OF_RANGE;
       }
-      vTaskDelay(60000/portTICK_PERIOD_MS); ///< Send data every 30 seconds
+      applyCommand(command.actuators, command.actuators.present);
+      return CONTROL_OK;
+    case CONTROL_REQUEST_TELEMETRY:
+      sendTelemetry(seq);
+      return CONTROL_OK;
+    default:
+      break;
+  }
+
+  // The rest change the runtime configuration, which is validated as a whole
+  DeviceConfig next = config.get();
+  bool save = false;
+  ControlStatus status = applyControlToConfig(next, command, save);
+  if (status != CONTROL_OK) {
+    return status;
+  }
+  return applyConfig(next, save);
+}
+
+/**
+ * @brief Handles a `FRAME_CONTROL` frame and answers it with a `FRAME_CONTROL_ACK` frame of the same seq.
+ * 
+ * A command repeating the seq of the last applied one is a retransmission: it is acknowledged with
+ * `CONTROL_DUPLICATE` and the original apply time, and not applied again.
+ */
+void handleControl(const Frame &frame){
+  ControlCommand command;
+  ControlAck ack;
+  ack.status = decodeControl(frame.payload, frame.length, command);
+  ack.opcode = command.opcode;
+  if (ack.status == CONTROL_OK && frame.seq == lastControlSeq) {
+    ack.status = CONTROL_DUPLICATE;
+    ack.applyTime = lastControlTime;
+  } else {
+    if (ack.status == CONTROL_OK) {
+      ack.status = applyControl(command, frame.seq);
     }
+    ack.applyTime = millis();
+    // CONTROL_UNAVAILABLE from applyConfig() means applied but not saved: a retransmission must not apply it again
+    if (ack.status == CONTROL_OK || ack.status == CONTROL_UNAVAILABLE) {
+      lastControlSeq = frame.seq;
+      lastControlTime = ack.applyTime;
+    }
+  }
+  if (ack.status >= CONTROL_BAD_VERSION) {
+    LOG(CONTROL_REJECTED, frame.seq, ack.opcode, ack.status);
+  }
+
+  uint8_t payload[CONTROL_ACK_LENGTH];
+  uint8_t out[FRAME_MAX_ENCODED];
+  size_t frameLength = encodeFrame(FRAME_CONTROL_ACK, frame.seq, payload, encodeControlAck(ack, payload), out, sizeof(out));
+  writeToESP(out, frameLength);
 }
+#endif
 
+#if TRACE_CAPTURE
+char consoleLine[16];       ///< Console line being typed
+size_t consoleLength = 0;
 
-void controlLed(){
-  led.changecolor(ledcolor.red, ledcolor.green, ledcolor.blue);
+/**
+ * @brief Reads the lines typed on the console; `trace` starts a dump of the trace recorder.
+ */
+void readConsole(){
+  while(Serial.available() > 0){
+    char c = (char)Serial.read();
+    if(c != '\r' && c != '\n'){
+      if(consoleLength < sizeof(consoleLine) - 1){
+        consoleLine[consoleLength] = c;
+      }
+      consoleLength++;
+      continue;
+    }
+    if(consoleLength < sizeof(consoleLine)){
+      consoleLine[consoleLength] = '\0';
+      if(strcmp(consoleLine, "trace") == 0 && traceRecorder.startDump()){
+        LOG(TRACE_DUMP, traceRecorder.size(), traceRecorder.overwritten(), traceRecorder.skipped());
+      }
+    }
+    consoleLength = 0;
+  }
 }
+#endif
 
-void motorControlTask(){
-  motor.speedcontrol(dutycycle);
+/**
+ * @brief Job printing the deferred log on the console.
+ * 
+ * Added last, so it runs after every other job that is due. It only writes what the console's TX buffer
+ * can take without blocking and leaves the rest for its next run. It also reads the console: the line
+ * `trace` starts a dump of the trace recorder, sent in between the log's output.
+ */
+void printLog(){
+#if TRACE_CAPTURE
+  readConsole();
+  traceRecorder.dump(Serial);
+#endif
+  deferredLog.drain(Serial);
 }
 
 /**
- * @brief This task is responsible for receiving data from the ESP module via Serial1 communication.
- * It reads the incoming data, parses it as JSON, and performs actions based on the received parameters.
- * The received parameters include LED color values (RED, GREEN, BLUE) and duty cycle (DUTYCYCLE).
- * After parsing the JSON, it calls the controlLed() function to control the LED based on the received parameters.
- * It also calls the motorControlTask() function to perform motor control operations.
- * 
- * @param pvParameters Pointer to task parameters (not used in this task).
- **/
-void TaskReceiveFromESP(void *pvParameters){
-  while(1){
-    // Get the number of bytes available to read
-    //Serial.println("Receiving data from ESP32, if any...");
-    if(Serial1.available() > 0){
-      int incomingByte = Serial1.peek();  // Peek the next incoming byte w/o removing it from serial buffer
-      if(incomingByte != -1){
-        String action_params = Serial1.readStringUntil('\n');
-        
-        // Check for start and end markers
-        if(action_params.startsWith("{")){
-          Serial.println("Received valid data: " + action_params);
-
-          // Extract relevant data from the received JSON string
-          Serial.println("Extracting relevant data");
-          String receivedJsonPaylaod = action_params.substring(0, action_params.lastIndexOf('}') + 1);
-          Serial.println(receivedJsonPaylaod);
-
-          // Extract CRC from the received string
-          String crcString = action_params.substring(action_params.lastIndexOf('}') + 1);
-          Serial.println(crcString);
-
-          int id_index = receivedJsonPaylaod.lastIndexOf(',');
-          
-          receivedJsonPaylaod.remove(id_index);
-
-          if(receivedJsonPaylaod.indexOf('}') == -1){
-            
-            receivedJsonPaylaod += '}';
-          }
-
-          Serial.println(receivedJsonPaylaod);
-          //uint32_t crcValue = strtoul(crcString.c_str(), NULL, 10);
-          uint32_t crcValue = 0;
-          // Calculate CRC32 of the received JSON string
-          CRC32 crc;
-          //crc.update((uint8_t*)action_params.c_str(), action_params.length() - 9);
-          //uint32_t calculatedCRC = crc.finalize();
-          uint32_t calculatedCRC = 0;
-
-          // Check if the received CRC matches the calculated CRC
-          if (crcValue == calculatedCRC) {
-            Serial.println("CRC32 match");
-            StaticJsonDocument<512> doc;
-            DeserializationError error = deserializeJson(doc, receivedJsonPaylaod);
-            if (!error) {
-              ledcolor.red = doc["RED"].as<uint8_t>();
-              ledcolor.green = doc["GREEN"].as<uint8_t>();
-              ledcolor.blue = doc["BLUE"].as<uint8_t>();
-              dutycycle = doc["DutyCycle"].as<uint16_t>();
-
-              Serial.println(String(ledcolor.red) + " " + String(ledcolor.green) + " " + String(ledcolor.blue) + " " + String(dutycycle));
-
-              controlLed();
-              motorControlTask();
-            }
-            else {
-              Serial.println("Executing default action");
-              Serial.println("Failed to parse JSON");
-            }
-          }
-          else {
-            Serial.println(String(crcValue) + " " + String(calculatedCRC));
-            Serial.println("CRC32 mismatch");
-            Serial.println("Discarding data");
-            continue;
-          }
-        }
-        else{
-          Serial.println("Invalid data received");
-        }
+ * @brief Serial1 RX event callback.
+ * 
+ * Runs in the UART driver's event task whenever the RX FIFO reaches its threshold or the line goes idle,
+ * and triggers ReceiveFromESPJob.
+ */
+void onSerial1Receive(){
+  scheduler.trigger(ReceiveFromESPJob);
+}
+
+/**
+ * @brief Feeds one byte received from the cloud-ESP to the command parser.
+ * 
+ * With `LINK_FRAMED` the byte goes through the COBS frame decoder first; every valid `FRAME_CONTROL`
+ * frame is a binary command, and the payload of every valid `FRAME_COMMAND` frame is parsed as one JSON document. Otherwise the byte goes straight to the line parser,
+ * which checks the decimal CRC32 that follows the document.
+ * 
+ * @param byte The received byte.
+ */
+void receiveByte(uint8_t byte){
+#if LINK_FRAMED
+  if(rxDecoder.feed(byte)){
+    const Frame &frame = rxDecoder.frame();
+    if(frame.type == FRAME_ACK && frame.length >= 4){
+      peerAck.store((uint32_t)frame.payload[0] | ((uint32_t)frame.payload[1] << 8) |
+                    ((uint32_t)frame.payload[2] << 16) | ((uint32_t)frame.payload[3] << 24));
+      scheduler.trigger(SendToESPJob);
+    }
+    else if(frame.type == FRAME_TELEMETRY_REQUEST){
+      sendTelemetry(frame.seq);
+    }
+    else if(frame.type == FRAME_CONTROL){
+      handleControl(frame);
+    }
+    else if(frame.type == FRAME_COMMAND){
+      if(commandParser.parse(frame.payload, frame.length)){
+        applyCommand(commandParser.command());
+      }
+      else {
+        LOG(COMMAND_PARSE_FAILED);
       }
     }
-    vTaskDelay(100/portTICK_PERIOD_MS);
+  }
+#else
+  switch(commandParser.feed(byte)){
+    case CommandParser::PARSE_COMMAND:
+      applyCommand(commandParser.command());
+      break;
+    case CommandParser::PARSE_ERROR:
+      LOG(COMMAND_INVALID);
+      break;
+    default:
+      break;
+  }
+#endif
+}
+
+/**
+ * @brief Job receiving data from the ESP module via Serial1 communication.
+ * 
+ * The job is triggered by the Serial1 RX event callback and drains every available byte through
+ * `receiveByte()`. Commands are parsed incrementally as the bytes arrive, without intermediate copies, and applied
+ * as soon as their last byte has been received.
+ * The received parameters include LED color values (RED, GREEN, BLUE) and duty cycle (DUTYCYCLE).
+ * They are posted to the actuator mailbox; ActuatorJob applies them after the received bytes have been handled.
+ */
+void receiveFromESP(){
+  uint8_t buffer[64];
+  int available;
+  while((available = Serial1.available()) > 0){
+    size_t length = Serial1.readBytes(buffer, available < (int)sizeof(buffer) ? available : sizeof(buffer));
+    TRACE(SERIAL1_RX, buffer, length);
+    for(size_t i = 0; i < length; i++){
+      receiveByte(buffer[i]);
+    }
   }
 }
 
@@ -457,8 +1250,7 @@ void TaskReceiveFromESP(void *pvParameters){
  * @param pvParameters Pointer to the task parameters (unused in this task).
  * 
  * @note The task continuously checks for connection status and processes new data 
- *       only when it is available. It uses the `newData` flag to detect incoming 
- *       credentials and the `receivedData` string to hold the data.
+ *       only when it is available. `takeBleMessage()` copies out each message the client wrote.
  * 
  * @warning Ensure that BLE setup and WiFi connection logic are correctly implemented 
  *          to handle various error scenarios and credential formats.
@@ -468,9 +1260,9 @@ void TaskReceiveFromESP(void *pvParameters){
 void WiFiCredentials(void* pvParameters) {
   String ssid = "";
   String password = "";
+  char receivedData[BLE_MAX_MESSAGE + 1];
   while(WiFi.status() != WL_CONNECTED){
-    if (newData) {
-      newData = false;
+    if (takeBleMessage(receivedData, sizeof(receivedData)) > 0) {
       Serial.println("Received WiFi credentials");
       Serial.println(receivedData);
       // Assuming the format is "SSID:password"
@@ -498,7 +1290,7 @@ void WiFiCredentials(void* pvParameters) {
 */
 
 /**
- * @brief Initializes the system and sets up tasks for sensor data handling and communication.
+ * @brief Initializes the system and sets up the jobs for sensor data handling and communication.
  * 
  * This function is called once during the startup of the ESP32. It performs the following operations:
  * - Initializes serial communication at a baud rate of 9600.
@@ -508,69 +1300,120 @@ void WiFiCredentials(void* pvParameters) {
  *   and creates a task to handle WiFi credentials retrieval.
  * - If WiFi credentials are found, it connects to the WiFi network.
  * - Once connected to WiFi, it sets up the MQTT client with the server address and port.
- * - Creates semaphores and a mutex for task synchronization.
- * - Creates FreeRTOS tasks for sensor data collection, data sending, and data reception.
- * 
- * @note Tasks are pinned to specific cores as follows:
- * - Core 0: Tasks for sensor data collection (DHT11, PMS5003, MQ7) and sending data to the server.
- * - Core 1: Task for receiving data from the server and handling WiFi credentials.
+ * - Adds the jobs for sensor data collection, data sending, and data reception to the scheduler,
+ *   which runs them all on the loop task.
  * 
  * @warning Ensure that the MQTT server address, port, and BLE setup are correctly configured 
  *          for your specific use case.
  */
 void setup() {
+#if POWER_SAVE
+  // Before anything measures time in CPU cycles
+  if (!power.begin(POWER_LIGHT_SLEEP) && POWER_LIGHT_SLEEP) {
+    LOG(POWER_LIGHT_SLEEP_UNAVAILABLE, getCpuFrequencyMhz());
+  }
+#endif
+
+  // Stage 1: links and actuators, so the cloud-ESP is served from the first pass of the jobs
+  // Room for the deferred log's output, so printing it never blocks
+  Serial.setTxBufferSize(1024);
   Serial.begin(9600);
+  // Room for a full window of frames, so sending never stalls the other jobs on the UART
+  Serial1.setTxBufferSize(1024);
   Serial1.begin(9600, SERIAL_8E1, 25,26); // RX, TX
   led.setpins();
   motor.motor_init();
+  dutycycle = 1020;   // What motor_init() wrote, so local fan control starts from it
+  actuators.begin({ledcolor.red, ledcolor.green, ledcolor.blue, dutycycle,
+                   COMMAND_RED | COMMAND_GREEN | COMMAND_BLUE | COMMAND_DUTY});
   Serial1.flush();
 
   // WiFi credentials stored in Flash memory permanently
   //preferences.begin("credentials", false);  //false for R/W operations; true for read-only
-  delay(20000);
 
-  // Initialize the sensors
+  // The configuration every job runs with
+  ConfigSource configSource = config.begin();
+  DeviceConfig cfg = config.get();
+  LOG(CONFIG_LOADED, configSource, cfg.version);
+#if LINK_FRAMED
+  readingBatch.setDeviceId(cfg.isaacId);
+#endif
+  fanController.setSetpoint(cfg.fanSetpoint / 10.0f);
+  fanController.setLimits(cfg.fanMinDuty, cfg.fanMaxDuty);
+  setFanMode(cfg.fanMode == CONTROL_FAN_AUTO);
+
+#if LINK_FRAMED
+  // Recover the batches that were not acknowledged before the last reset
+  const esp_partition_t *uplinkPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+      (esp_partition_subtype_t)UPLINK_PARTITION_SUBTYPE, UPLINK_PARTITION_LABEL);
+  if (uplinkStore.begin(uplinkPartition)) {
+    LOG(UPLINK_PENDING, uplinkStore.pending());
+  } else {
+    LOG(UPLINK_UNAVAILABLE);
+  }
+#endif
+
+  reportFilter.setDeadband(REPORT_PM2_5, PM2_5_DEADBAND);
+  reportFilter.setDeadband(REPORT_TEMPERATURE, TEMPERATURE_DEADBAND);
+  reportFilter.setDeadband(REPORT_HUMIDITY, HUMIDITY_DEADBAND);
+  reportFilter.setDeadband(REPORT_SMOKE, SMOKE_DEADBAND);
+
+  instruments.begin();
+  instruments.watchTask(xTaskGetCurrentTaskHandle());
+  DHT11Section = instruments.addSection("DHT11");
+  PMS5003Section = instruments.addSection("PMS5003");
+  MQ7Section = instruments.addSection("MQ7");
+  BatchSection = instruments.addSection("Batch");
+  StoreSection = instruments.addSection("Store");
+  UartTxSection = instruments.addSection("Uart1Tx");
+  JsonSection = instruments.addSection("JSON");
+
+  // Jobs run on this (the loop) task; stagger their first deadlines
+  scheduler.begin();
+  Sensors::schedule(scheduler, cfg);
+  SendToESPJob = scheduler.add("SendToESP", sendToESP, cfg.sendPeriodMs, 300);
+  ReceiveFromESPJob = scheduler.add("ReceiveFromESP", receiveFromESP, RECEIVE_PERIOD_MS, 400);
+  LogJob = scheduler.add("Log", printLog, LOG_PERIOD_MS, 500);
+  ActuatorJob = scheduler.add("Actuators", applyActuators, 0);
+  BootJob = scheduler.add("Boot", startProvisioning, 0);
+  BleStreamJob = scheduler.add("BleStream", streamToBle, cfg.blePeriodMs, 600);
+
+  // Trigger ReceiveFromESPJob on every received byte or after one idle symbol instead of polling
+  Serial1.setRxFIFOFull(1);
+  Serial1.setRxTimeout(1);
+  Serial1.onReceive(onSerial1Receive);
+  bootSequence.linksUp(millis());
+  LOG(BOOT_LINKS_UP, bootSequence.linksUpTime());
+
+  // Stage 2: the sensors warm up while the jobs run, and each channel streams from its first valid sample
+  uint32_t now = millis();
   dht11.init();
+  bootSequence.warmUp(BOOT_DHT11, now, DHT11_WARMUP_MS);
   pms5003.begin();
-
-
-  if (!preferences.isKey("SSID") && !preferences.isKey("Password")) {
-    setupBLE();
-    Serial.println("Waiting for client connection to notify");
-
-    // Core 1 Task: Handles WiFi credentials retrieval
-    //xTaskCreatePinnedToCore(WiFiCredentials, "WiFiCredentials", 4096, NULL, 2, &TaskHandleWiFiCredentials, 1);
-  } else {
-    //connect_to_WIFI();
+  bootSequence.warmUp(BOOT_PMS5003, now, PMS5003_WARMUP_MS);
+#if POWER_SAVE
+  pmsWindows.begin(now);  // pms5003.begin() woke it: the first window is open
+#endif
+  if (!mq7.begin()) {
+    LOG(MQ7_ADC_UNAVAILABLE);
   }
+  bootSequence.warmUp(BOOT_MQ7, now, 0);   // MQ7Channel::sample() publishes at the end of the first heater cycle
 
-  Serial.println("Task Creation and other processes started");
-
-  // Create semaphore
-  xSendSemaphore = xSemaphoreCreateCounting(3, 0);
-
-  // Create a mutex
-  xSendMutex = xSemaphoreCreateMutex();
+  // Trigger the PMS5003 job when the PMS5003 has sent a frame
+  Serial2.onReceive(onSerial2Receive);
 
-  // Create tasks
-  //(Function to implement the task, Name of the task, Stack size, Task input parameter, Priority of the task, Task handle, Core ID);
-  
-  // Core 0 Tasks: Sensor data collection and sending
-  xTaskCreatePinnedToCore(TaskDHT11, "TaskDHT11", 2048, NULL, 1, &TaskDHT11Handle, 0);
-  xTaskCreatePinnedToCore(TaskPMS5003, "TaskPMS5003", 2048, NULL, 1, &TaskPMS5003Handle, 0);
-  xTaskCreatePinnedToCore(TaskMQ7, "TaskMQ7", 2048, NULL, 1, &TaskMQ7Handle, 0);
-  xTaskCreatePinnedToCore(TaskSendToESP, "TaskSendToESP", 4096, NULL, 2, &TaskSendToESPHandle, 0);
+  // Stage 3: what no channel waits for, after the first pass of the jobs
+  scheduler.trigger(BootJob);
 
-  // Core 1 Task: Receives data from the server
-  
-  xTaskCreatePinnedToCore(TaskReceiveFromESP, "TaskReceiveFromESP", 4096 , NULL, 1, &TaskReceiveFromESPHandle, 1);
+  LOG(JOBS_STARTED);
 }
 
 
 
 
+/**
+ * @brief Runs the due and triggered jobs, then sleeps until the next deadline or trigger.
+ */
 void loop(){
-
-  //Do nothing here
-
+  scheduler.run();
 }
\ No newline at end of file
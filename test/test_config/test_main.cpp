@@ -0,0 +1,312 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of the runtime configuration (ConfigStore) and of its commands.
+ *
+ * The NVS record is written and loaded through the shim's in-memory `Preferences`, which each test
+ * starts empty. A record is also written by hand, to stand for an older firmware or a damaged one.
+ *
+ *     pio test -e native -f test_config
+ */
+
+#include <unity.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include <Preferences.h>
+
+#include <CommandProtocol.h>
+#include <DeviceConfig.h>
+#include <StreamCrc32.h>
+
+namespace {
+
+const DeviceConfig kDefaults = {
+    0, 0, 5000, 2000, 2000, 1000, 60000, 8, 2, 0, 0, 120, 0, 1023, "ec03f332a7b0400000", 1000,
+};
+
+/** @brief Stores `length` bytes of `config` and their CRC32 as the NVS record. */
+void writeRecord(const DeviceConfig &config, size_t length) {
+    uint8_t record[sizeof(DeviceConfig) + sizeof(uint32_t)];
+    memcpy(record, &config, length);
+    uint32_t crc = StreamCrc32::compute(record, length);
+    memcpy(record + length, &crc, sizeof(crc));
+    Preferences nvs;
+    TEST_ASSERT_TRUE(nvs.begin("config"));
+    TEST_ASSERT_EQUAL(length + sizeof(crc), nvs.putBytes("device", record, length + sizeof(crc)));
+    nvs.end();
+}
+
+} // namespace
+
+void setUp(void) {
+    Preferences nvs;
+    nvs.begin("config");
+    nvs.clear();
+    nvs.end();
+}
+
+void tearDown(void) {}
+
+/** Without a record the defaults are published, stamped with the current layout. */
+void test_defaults_without_record(void) {
+    ConfigStore store(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_DEFAULTS, store.begin());
+    DeviceConfig config = store.get();
+    TEST_ASSERT_EQUAL_UINT16(CONFIG_VERSION, config.version);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(DeviceConfig), config.length);
+    TEST_ASSERT_TRUE(validConfig(config));
+}
+
+/** A saved configuration is what the next boot loads. */
+void test_nvs_round_trip(void) {
+    ConfigStore store(kDefaults);
+    store.begin();
+    DeviceConfig config = store.get();
+    TEST_ASSERT_TRUE(setConfigValue(config, CONFIG_SEND_PERIOD, 30000));
+    TEST_ASSERT_TRUE(setConfigValue(config, CONFIG_BATCH_SIZE, 16));
+    TEST_ASSERT_TRUE(setConfigValue(config, CONFIG_BLE_PERIOD, 250));
+    TEST_ASSERT_TRUE(validConfig(config));
+    uint32_t generation = store.generation();
+    store.publish(config);
+    TEST_ASSERT_TRUE(store.generation() != generation);
+    TEST_ASSERT_TRUE(store.save(config));
+
+    ConfigStore reboot(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_STORED, reboot.begin());
+    DeviceConfig loaded = reboot.get();
+    TEST_ASSERT_EQUAL_MEMORY(&config, &loaded, sizeof(DeviceConfig));
+}
+
+/** A shorter record of an older layout keeps its fields, and the fields it lacks take the defaults. */
+void test_upgrade_from_shorter_record(void) {
+    DeviceConfig old = kDefaults;
+    old.version = 1;
+    old.length = offsetof(DeviceConfig, blePeriodMs);
+    old.dht11PeriodMs = 7000;
+    old.batchSize = 4;
+    old.blePeriodMs = 0;    // Not part of the record
+    writeRecord(old, old.length);
+
+    ConfigStore store(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_UPGRADED, store.begin());
+    DeviceConfig config = store.get();
+    TEST_ASSERT_EQUAL_UINT16(CONFIG_VERSION, config.version);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(DeviceConfig), config.length);
+    TEST_ASSERT_EQUAL_UINT32(7000, config.dht11PeriodMs);
+    TEST_ASSERT_EQUAL_UINT8(4, config.batchSize);
+    TEST_ASSERT_EQUAL_UINT32(kDefaults.blePeriodMs, config.blePeriodMs);
+}
+
+/** A record whose bytes do not match their CRC, or that lies about its length or version, is ignored. */
+void test_damaged_record_is_ignored(void) {
+    DeviceConfig config = kDefaults;
+    config.version = CONFIG_VERSION;
+    config.length = sizeof(DeviceConfig);
+    config.sendPeriodMs = 30000;
+    writeRecord(config, sizeof(DeviceConfig));
+    uint8_t record[sizeof(DeviceConfig) + sizeof(uint32_t)];
+    Preferences nvs;
+    nvs.begin("config");
+    nvs.getBytes("device", record, sizeof(record));
+    record[offsetof(DeviceConfig, sendPeriodMs)] ^= 0x01;
+    nvs.putBytes("device", record, sizeof(record));
+    nvs.end();
+    ConfigStore corrupt(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_DEFAULTS, corrupt.begin());
+    TEST_ASSERT_EQUAL_UINT32(kDefaults.sendPeriodMs, corrupt.get().sendPeriodMs);
+
+    DeviceConfig newer = config;
+    newer.version = CONFIG_VERSION + 1;
+    writeRecord(newer, sizeof(DeviceConfig));
+    ConfigStore future(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_DEFAULTS, future.begin());
+
+    DeviceConfig truncated = config;
+    writeRecord(truncated, offsetof(DeviceConfig, blePeriodMs));
+    ConfigStore cut(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_DEFAULTS, cut.begin());
+}
+
+/** A record with a value out of range is ignored even when its CRC holds. */
+void test_invalid_record_is_ignored(void) {
+    ConfigStore store(kDefaults);
+    store.begin();
+    DeviceConfig config = store.get();
+    config.fanMinDuty = 1000;
+    config.fanMaxDuty = 500;
+    TEST_ASSERT_FALSE(validConfig(config));
+    TEST_ASSERT_TRUE(store.save(config));
+
+    ConfigStore reboot(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_DEFAULTS, reboot.begin());
+    TEST_ASSERT_EQUAL_UINT16(kDefaults.fanMaxDuty, reboot.get().fanMaxDuty);
+}
+
+/** A record saved with a period the scheduler cannot run, by an earlier firmware, is not loaded. */
+void test_record_with_too_long_period_is_ignored(void) {
+    DeviceConfig config = ConfigStore(kDefaults).get();
+    config.pms5003PeriodMs = 3600000;
+    writeRecord(config, sizeof(DeviceConfig));
+
+    ConfigStore store(kDefaults);
+    TEST_ASSERT_EQUAL(CONFIG_DEFAULTS, store.begin());
+    TEST_ASSERT_EQUAL_UINT32(kDefaults.pms5003PeriodMs, store.get().pms5003PeriodMs);
+}
+
+/** Every field has a range, and a value that does not fit its field is refused before it is checked. */
+void test_validation(void) {
+    DeviceConfig base = ConfigStore(kDefaults).get();
+    struct {
+        uint8_t key;
+        uint32_t value;
+        bool set;
+        bool valid;
+    } cases[] = {
+        {CONFIG_MQ7_PERIOD, CONFIG_MIN_PERIOD_MS, true, true},
+        {CONFIG_MQ7_PERIOD, CONFIG_MIN_PERIOD_MS - 1, true, false},
+        {CONFIG_DHT11_PERIOD, CONFIG_MIN_DHT11_PERIOD_MS, true, true},
+        {CONFIG_DHT11_PERIOD, CONFIG_MIN_DHT11_PERIOD_MS - 1, true, false},
+        {CONFIG_DHT11_PERIOD, CONFIG_MIN_PERIOD_MS, true, false},     // Faster than the sensor answers
+        {CONFIG_SEND_PERIOD, CONFIG_MAX_PERIOD_MS, true, true},
+        {CONFIG_SEND_PERIOD, CONFIG_MAX_PERIOD_MS + 1, true, false},
+        {CONFIG_BLE_PERIOD, 1800000, true, true},
+        {CONFIG_MQ7_PERIOD, 3600000, true, false},     // Beyond what the scheduler's deadlines hold
+        {CONFIG_BLE_PERIOD, 0, true, false},
+        {CONFIG_BATCH_SIZE, 0, true, false},
+        {CONFIG_BATCH_SIZE, 255, true, true},
+        {CONFIG_BATCH_SIZE, 256, false, false},
+        {CONFIG_REPORT_MODE, 0xFF, true, false},
+        {CONFIG_FAN_MODE, CONTROL_FAN_AUTO, true, true},
+        {CONFIG_FAN_MODE, CONTROL_FAN_AUTO + 1, true, false},
+        {CONFIG_FAN_SETPOINT, CONFIG_MAX_FAN_SETPOINT + 1, true, false},
+        {CONFIG_FAN_MAX_DUTY, CONFIG_MAX_DUTY + 1, true, false},
+        {CONFIG_FAN_MAX_DUTY, 0x10000, false, false},
+        {0x7F, 1, false, false},
+    };
+    for (const auto &c : cases) {
+        DeviceConfig config = base;
+        TEST_ASSERT_EQUAL(c.set, setConfigValue(config, c.key, c.value));
+        TEST_ASSERT_EQUAL(c.valid, c.set && validConfig(config));
+    }
+
+    DeviceConfig config = base;
+    strcpy(config.isaacId, "ec03f332a7b04000");   // Two characters short
+    TEST_ASSERT_FALSE(validConfig(config));
+    strcpy(config.isaacId, "ec03f332a7b040000g");
+    TEST_ASSERT_FALSE(validConfig(config));
+    strcpy(config.isaacId, "EC03F332A7B0400001");
+    TEST_ASSERT_TRUE(validConfig(config));
+}
+
+/** A `CONTROL_SET_PERIOD` beyond what the scheduler can run is refused as out of range. */
+void test_set_period_range(void) {
+    const DeviceConfig base = ConfigStore(kDefaults).get();
+    struct {
+        uint8_t job;
+        uint32_t periodMs;
+        ControlStatus status;
+    } cases[] = {
+        {CONTROL_JOB_SEND, CONFIG_MAX_PERIOD_MS, CONTROL_OK},
+        {CONTROL_JOB_SEND, CONFIG_MAX_PERIOD_MS + 1, CONTROL_OUT_OF_RANGE},
+        {CONTROL_JOB_PMS5003, 3600000, CONTROL_OUT_OF_RANGE},
+        {CONTROL_JOB_MQ7, 0xFFFFFFFF, CONTROL_OUT_OF_RANGE},
+        {CONTROL_JOB_MQ7, CONFIG_MIN_PERIOD_MS - 1, CONTROL_OUT_OF_RANGE},
+        {CONTROL_JOB_DHT11, CONFIG_MIN_DHT11_PERIOD_MS - 1, CONTROL_OUT_OF_RANGE},
+        {0x7F, 5000, CONTROL_OUT_OF_RANGE},
+    };
+    for (const auto &c : cases) {
+        ControlCommand sent;
+        memset(&sent, 0, sizeof(sent));
+        sent.opcode = CONTROL_SET_PERIOD;
+        sent.job = c.job;
+        sent.periodMs = c.periodMs;
+        uint8_t payload[CONTROL_MAX_PAYLOAD];
+        ControlCommand received;
+        TEST_ASSERT_EQUAL(CONTROL_OK, decodeControl(payload, encodeControl(sent, payload, sizeof(payload)), received));
+
+        DeviceConfig config = base;
+        bool save = true;
+        TEST_ASSERT_EQUAL(c.status, applyControlToConfig(config, received, save));
+        TEST_ASSERT_FALSE(save);
+        if (c.status == CONTROL_OK) {
+            TEST_ASSERT_EQUAL_UINT32(c.periodMs, config.sendPeriodMs);
+        }
+    }
+
+    // Only configuration commands are handled, and only SET_CONFIG and SET_DEVICE_ID ask to be saved
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    DeviceConfig config = base;
+    bool save = false;
+    command.opcode = CONTROL_SET_LED;
+    TEST_ASSERT_EQUAL(CONTROL_BAD_OPCODE, applyControlToConfig(config, command, save));
+    command.opcode = CONTROL_SET_CONFIG;
+    command.configFlags = CONTROL_CONFIG_SAVE;
+    command.configCount = 1;
+    command.configKeys[0] = CONFIG_BATCH_SIZE;
+    command.configValues[0] = 32;
+    TEST_ASSERT_EQUAL(CONTROL_OK, applyControlToConfig(config, command, save));
+    TEST_ASSERT_TRUE(save);
+    TEST_ASSERT_EQUAL_UINT8(32, config.batchSize);
+}
+
+/** `CONTROL_SET_CONFIG` and `CONTROL_SET_DEVICE_ID` decode to the pairs and the ID they were encoded with. */
+void test_command_encode_decode(void) {
+    ControlCommand sent;
+    memset(&sent, 0, sizeof(sent));
+    sent.opcode = CONTROL_SET_CONFIG;
+    sent.configFlags = CONTROL_CONFIG_SAVE;
+    sent.configCount = CONTROL_MAX_CONFIG_ITEMS;
+    for (uint8_t i = 0; i < CONTROL_MAX_CONFIG_ITEMS; i++) {
+        sent.configKeys[i] = (uint8_t)(CONFIG_DHT11_PERIOD + i);
+        sent.configValues[i] = 0x01020300u + 1000u * i;
+    }
+    uint8_t payload[CONTROL_MAX_PAYLOAD + 5];
+    size_t length = encodeControl(sent, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL(CONTROL_MAX_PAYLOAD, length);
+    ControlCommand received;
+    TEST_ASSERT_EQUAL(CONTROL_OK, decodeControl(payload, length, received));
+    TEST_ASSERT_EQUAL_UINT8(CONTROL_SET_CONFIG, received.opcode);
+    TEST_ASSERT_EQUAL_UINT8(CONTROL_CONFIG_SAVE, received.configFlags);
+    TEST_ASSERT_EQUAL_UINT8(CONTROL_MAX_CONFIG_ITEMS, received.configCount);
+    for (uint8_t i = 0; i < CONTROL_MAX_CONFIG_ITEMS; i++) {
+        TEST_ASSERT_EQUAL_UINT8(sent.configKeys[i], received.configKeys[i]);
+        TEST_ASSERT_EQUAL_UINT32(sent.configValues[i], received.configValues[i]);
+    }
+
+    // No pair, a pair cut short, and more pairs than a command holds
+    TEST_ASSERT_EQUAL(CONTROL_BAD_LENGTH, decodeControl(payload, 3, received));
+    TEST_ASSERT_EQUAL(CONTROL_BAD_LENGTH, decodeControl(payload, 7, received));
+    memcpy(payload + length, payload + 3, 5);
+    TEST_ASSERT_EQUAL(CONTROL_BAD_LENGTH, decodeControl(payload, length + 5, received));
+    sent.configCount = 0;
+    TEST_ASSERT_EQUAL(0, encodeControl(sent, payload, sizeof(payload)));
+
+    memset(&sent, 0, sizeof(sent));
+    sent.opcode = CONTROL_SET_DEVICE_ID;
+    strcpy(sent.deviceId, "0123456789abcdef01");
+    length = encodeControl(sent, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL(3 + CONTROL_DEVICE_ID_LENGTH, length);
+    TEST_ASSERT_EQUAL(CONTROL_OK, decodeControl(payload, length, received));
+    TEST_ASSERT_EQUAL_UINT8(CONTROL_SET_DEVICE_ID, received.opcode);
+    TEST_ASSERT_EQUAL_UINT8(0, received.configFlags);
+    TEST_ASSERT_EQUAL_STRING(sent.deviceId, received.deviceId);
+    TEST_ASSERT_EQUAL(CONTROL_BAD_LENGTH, decodeControl(payload, length - 1, received));
+    strcpy(sent.deviceId, "0123");
+    TEST_ASSERT_EQUAL(0, encodeControl(sent, payload, sizeof(payload)));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_defaults_without_record);
+    RUN_TEST(test_nvs_round_trip);
+    RUN_TEST(test_upgrade_from_shorter_record);
+    RUN_TEST(test_damaged_record_is_ignored);
+    RUN_TEST(test_invalid_record_is_ignored);
+    RUN_TEST(test_record_with_too_long_period_is_ignored);
+    RUN_TEST(test_validation);
+    RUN_TEST(test_command_encode_decode);
+    RUN_TEST(test_set_period_range);
+    return UNITY_END();
+}
@@ -0,0 +1,302 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of the store-and-forward log (FrameStore) on the native flash shim.
+ *
+ * The log lives in a four-segment "uplinkq" partition of a temporary partition table, so it wraps
+ * around and overflows quickly. A reset is a new `FrameStore` recovering the same partition.
+ *
+ *     pio test -e native -f test_frame_store
+ */
+
+#include <unity.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <FrameStore.h>
+
+namespace {
+
+const uint32_t kSegments = 4;
+const int kSteps = 200000;
+const uint32_t kWindow = 4;   ///< Frames in flight, as LINK_WINDOW.
+
+char flashDir[] = "/tmp/test_frame_store.XXXXXX";
+const esp_partition_t *partition = nullptr;
+
+/** @brief The cloud-ESP's go-back-N receiver (see `FRAME_RECORD_HEADER`). */
+struct Peer {
+    uint32_t expected = 1;
+    std::vector<uint32_t> delivered;
+
+    void receive(uint32_t id, uint32_t previous) {
+        if (id >= expected && previous < expected) {
+            delivered.push_back(id);
+            expected = id + 1;
+        }
+    }
+};
+
+/**
+ * One pass of the sender as `forwardStored()` runs it: fill the window, take the peer's
+ * acknowledgement, and go back to the oldest unacknowledged record as if its timeout had expired.
+ */
+void pump(FrameStore &store, Peer &peer, bool online) {
+    uint8_t type;
+    uint8_t data[FRAME_STORE_MAX_RECORD];
+    uint16_t length;
+    uint32_t id, previous;
+    while (store.inFlight() < kWindow && store.next(type, data, length, id, previous)) {
+        if (online) {
+            peer.receive(id, previous);
+        }
+    }
+    uint32_t acked = peer.expected - 1;
+    if (online && acked - store.oldestId() < store.inFlight()) {
+        store.acknowledge(acked);
+    }
+    store.rewind();
+}
+
+std::vector<uint8_t> randomRecord(std::mt19937 &rng) {
+    std::vector<uint8_t> data(std::uniform_int_distribution<size_t>(0, FRAME_STORE_MAX_RECORD)(rng));
+    for (uint8_t &byte : data) byte = (uint8_t)rng();
+    return data;
+}
+
+/** @brief Id the next appended record gets. */
+uint32_t nextId(const FrameStore &store) {
+    return store.oldestId() + store.pending();
+}
+
+} // namespace
+
+void setUp(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, esp_partition_erase_range(partition, 0, partition->size));
+}
+
+void tearDown(void) {}
+
+/**
+ * Random appends, sends, acknowledgements, rewinds and resets: records come out in id order with
+ * their content, an acknowledged record never comes back, and every record is either sent or
+ * counted as dropped.
+ */
+void test_random_operations_and_resets(void) {
+    std::mt19937 rng(9);
+    std::map<uint32_t, std::vector<uint8_t>> content;
+    std::unique_ptr<FrameStore> store(new FrameStore(RETAIN_NEWEST));
+    TEST_ASSERT_TRUE(store->begin(partition));
+
+    uint32_t acked = 0;        // Highest id acknowledged
+    uint32_t lastSent = 0;     // Id next() returned last in this pass, 0 after a rewind
+    uint32_t dropped = 0;
+    unsigned resets = 0, sent = 0;
+    for (int step = 0; step < kSteps; step++) {
+        int action = std::uniform_int_distribution<int>(0, 99)(rng);
+        if (action < 40) {
+            std::vector<uint8_t> data = randomRecord(rng);
+            uint32_t id = nextId(*store);
+            TEST_ASSERT_TRUE(store->append(FRAME_BATCH, data.data(), data.size()));
+            content[id] = data;
+        } else if (action < 75) {
+            uint8_t type;
+            uint8_t data[FRAME_STORE_MAX_RECORD];
+            uint16_t length;
+            uint32_t id, previous;
+            if (store->next(type, data, length, id, previous)) {
+                TEST_ASSERT_TRUE(content.count(id) == 1);
+                TEST_ASSERT_EQUAL(FRAME_BATCH, type);
+                TEST_ASSERT_EQUAL(content[id].size(), length);
+                if (length > 0) {
+                    TEST_ASSERT_EQUAL_MEMORY(content[id].data(), data, length);
+                }
+                TEST_ASSERT_GREATER_THAN(acked, id);
+                TEST_ASSERT_GREATER_THAN(lastSent, id);
+                if (previous == 0) {
+                    // Everything before it was acknowledged or dropped
+                    TEST_ASSERT_EQUAL_UINT32(store->oldestId(), id);
+                } else {
+                    TEST_ASSERT_EQUAL_UINT32(lastSent, previous);
+                }
+                lastSent = id;
+                sent++;
+            }
+        } else if (action < 95) {
+            if (store->inFlight() > 0) {
+                acked = store->oldestId() + std::uniform_int_distribution<uint32_t>(0, store->inFlight() - 1)(rng);
+                store->acknowledge(acked);
+                if (lastSent <= acked) {
+                    lastSent = 0;
+                }
+            }
+        } else if (action < 99) {
+            store->rewind();
+            lastSent = 0;
+        } else {
+            uint32_t next = nextId(*store);
+            dropped += store->dropped;
+            store.reset(new FrameStore(RETAIN_NEWEST));
+            TEST_ASSERT_TRUE(store->begin(partition));
+            TEST_ASSERT_EQUAL_UINT32(next, nextId(*store));
+            TEST_ASSERT_GREATER_THAN(acked, store->oldestId());
+            lastSent = 0;
+            resets++;
+        }
+    }
+
+    // Whatever is still queued comes out in one pass
+    uint32_t pending = store->pending();
+    uint32_t first = store->oldestId();
+    store->rewind();
+    uint8_t type;
+    uint8_t data[FRAME_STORE_MAX_RECORD];
+    uint16_t length;
+    uint32_t id = 0, previous, count = 0;
+    while (store->next(type, data, length, id, previous)) {
+        count++;
+    }
+    dropped += store->dropped;
+    printf("%d steps, %u resets, %zu appended, %u sent, %u dropped\n", kSteps, resets, content.size(), sent, dropped);
+    TEST_ASSERT_EQUAL_UINT32(pending, count);
+    TEST_ASSERT_EQUAL_UINT32(nextId(*store) - first, count);
+    TEST_ASSERT_GREATER_THAN(1000, resets);
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    store->acknowledge(id);
+    TEST_ASSERT_EQUAL_UINT32(0, store->pending());
+    TEST_ASSERT_EQUAL_UINT32(0, store->corrupt);
+}
+
+/** A record whose bytes changed in flash is skipped, and the next record reports the gap. */
+void test_corrupt_record_is_skipped(void) {
+    FrameStore store;
+    TEST_ASSERT_TRUE(store.begin(partition));
+    uint8_t record[16];
+    memset(record, 0xA5, sizeof(record));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(store.append(FRAME_BATCH, record, sizeof(record)));
+    }
+    // The second record's first data byte: after the segment header, the first record and its own header
+    const uint8_t zero = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_partition_write(partition, 8 + (12 + 16) + 12, &zero, 1));
+
+    uint8_t type;
+    uint8_t data[FRAME_STORE_MAX_RECORD];
+    uint16_t length;
+    uint32_t id, previous;
+    TEST_ASSERT_TRUE(store.next(type, data, length, id, previous));
+    TEST_ASSERT_EQUAL_UINT32(1, id);
+    TEST_ASSERT_EQUAL_UINT32(0, previous);
+    TEST_ASSERT_TRUE(store.next(type, data, length, id, previous));
+    TEST_ASSERT_EQUAL_UINT32(3, id);
+    TEST_ASSERT_EQUAL_UINT32(1, previous);
+    TEST_ASSERT_FALSE(store.next(type, data, length, id, previous));
+    TEST_ASSERT_EQUAL_UINT32(1, store.corrupt);
+
+    store.acknowledge(3);
+    TEST_ASSERT_EQUAL_UINT32(0, store.pending());
+}
+
+/**
+ * The peer is unplugged while the log overflows and drops its oldest records: once it is back, it
+ * gets every record that was kept, across the gap, and nothing stays queued.
+ */
+void test_link_recovers_after_overflow(void) {
+    FrameStore store(RETAIN_NEWEST);
+    TEST_ASSERT_TRUE(store.begin(partition));
+    Peer peer;
+    uint8_t record[200];
+    memset(record, 0x5A, sizeof(record));
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(store.append(FRAME_BATCH, record, sizeof(record)));
+        pump(store, peer, true);
+    }
+    TEST_ASSERT_EQUAL(5, peer.delivered.size());
+    TEST_ASSERT_EQUAL_UINT32(0, store.pending());
+
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(store.append(FRAME_BATCH, record, sizeof(record)));
+        pump(store, peer, false);
+    }
+    TEST_ASSERT_GREATER_THAN(0, store.dropped);
+
+    for (int i = 0; i < 200; i++) {
+        pump(store, peer, true);
+    }
+    printf("105 appended, %u dropped during the outage, %zu delivered, %u queued\n", store.dropped,
+           peer.delivered.size(), store.pending());
+    TEST_ASSERT_EQUAL(105 - store.dropped, peer.delivered.size());
+    TEST_ASSERT_EQUAL_UINT32(0, store.pending());
+    TEST_ASSERT_EQUAL_UINT32(105, peer.delivered.back());
+}
+
+/** Under RETAIN_OLDEST a full log refuses new records rather than dropping unacknowledged ones. */
+void test_retain_oldest_rejects_when_full(void) {
+    FrameStore store(RETAIN_OLDEST);
+    TEST_ASSERT_TRUE(store.begin(partition));
+    uint8_t record[200];
+    memset(record, 0x3C, sizeof(record));
+    uint32_t accepted = 0;
+    while (store.append(FRAME_BATCH, record, sizeof(record))) {
+        accepted++;
+    }
+    TEST_ASSERT_GREATER_THAN(0, accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, store.dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, store.rejected);
+    TEST_ASSERT_EQUAL_UINT32(accepted, store.pending());
+
+    // Acknowledging the first segment's records frees room again
+    Peer peer;
+    for (int i = 0; i < 20; i++) {
+        pump(store, peer, true);
+    }
+    TEST_ASSERT_TRUE(store.append(FRAME_BATCH, record, sizeof(record)));
+}
+
+int main() {
+    // A small partition table of our own, in a fresh directory that also holds the flash image
+    if (!mkdtemp(flashDir)) {
+        return 1;
+    }
+    std::string table = std::string(flashDir) + "/partitions.csv";
+    FILE *csv = fopen(table.c_str(), "w");
+    if (!csv) {
+        return 1;
+    }
+    fprintf(csv, "uplinkq, data, 0x40, 0x310000, 0x%X,\n", (unsigned)(kSegments * FRAME_STORE_SEGMENT_SIZE));
+    fclose(csv);
+    setenv("HAL_PARTITIONS", table.c_str(), 1);
+    setenv("HAL_FLASH_DIR", flashDir, 1);
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)0x40, "uplinkq");
+    if (!partition) {
+        return 1;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_random_operations_and_resets);
+    RUN_TEST(test_corrupt_record_is_skipped);
+    RUN_TEST(test_link_recovers_after_overflow);
+    RUN_TEST(test_retain_oldest_rejects_when_full);
+    int failures = UNITY_END();
+
+    if (DIR *entries = opendir(flashDir)) {
+        while (struct dirent *entry = readdir(entries)) {
+            if (entry->d_name[0] != '.') {
+                unlink((std::string(flashDir) + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(entries);
+    }
+    rmdir(flashDir);
+    return failures;
+}
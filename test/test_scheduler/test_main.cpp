@@ -0,0 +1,135 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of the cooperative scheduler's deadlines, in the shim's virtual time.
+ *
+ * The test thread is the loop task and calls `run()` until enough device time has passed; with
+ * nothing else to run, the clock jumps from one deadline to the next, so hours pass at once.
+ * `micros()` wraps every 71.6 minutes, so a long run also crosses the wrap.
+ *
+ *     pio test -e native -f test_scheduler
+ */
+
+#include <unity.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <Scheduler.h>
+#include <VirtualTime.h>
+
+namespace {
+
+const uint64_t kHourUs = 3600ull * 1000000;
+
+std::vector<uint64_t> runs;     ///< Device times of the recorded job's runs.
+
+void record() {
+    runs.push_back(hal::deviceTimeUs());
+}
+
+void idle() {}
+
+/** @brief Calls `run()` for `us` of device time. */
+void runFor(Scheduler &scheduler, uint64_t us) {
+    uint64_t end = hal::deviceTimeUs() + us;
+    while (hal::deviceTimeUs() < end) {
+        scheduler.run();
+    }
+}
+
+/** @brief Checks that consecutive runs are one period apart, within the 1 ms tick of the sleep. */
+void assertPeriodic(uint32_t periodMs) {
+    for (size_t i = 1; i < runs.size(); i++) {
+        uint64_t interval = runs[i] - runs[i - 1];
+        TEST_ASSERT_TRUE(interval + 1000 >= periodMs * 1000ull);
+        TEST_ASSERT_TRUE(interval <= periodMs * 1000ull + 1000);
+    }
+}
+
+} // namespace
+
+void setUp(void) {
+    runs.clear();
+}
+
+void tearDown(void) {}
+
+/** The longest period runs once per period across `micros()` wraps, and misses no deadline. */
+void test_longest_period(void) {
+    Scheduler scheduler;
+    scheduler.begin();
+    int job = scheduler.add("Long", record, SCHEDULER_MAX_PERIOD_MS);
+    runFor(scheduler, 4 * kHourUs);
+
+    // First run at once, then one per period
+    TEST_ASSERT_EQUAL(4 * kHourUs / (SCHEDULER_MAX_PERIOD_MS * 1000ull) + 1, runs.size());
+    assertPeriodic(SCHEDULER_MAX_PERIOD_MS);
+    TEST_ASSERT_EQUAL_UINT32(runs.size(), scheduler.stats(job).runs);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats(job).skipped);
+}
+
+/** A period the deadlines cannot hold is clamped instead of making the job run early. */
+void test_period_above_limit_is_clamped(void) {
+    Scheduler scheduler;
+    scheduler.begin();
+    int job = scheduler.add("Hourly", record, 0);
+    scheduler.add("Tick", idle, 60000);
+    scheduler.setPeriod(job, 3600000);
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_MAX_PERIOD_MS, scheduler.period(job));
+    runFor(scheduler, 4 * kHourUs);
+
+    TEST_ASSERT_TRUE(runs.size() <= 4 * kHourUs / (SCHEDULER_MAX_PERIOD_MS * 1000ull) + 1);
+    assertPeriodic(SCHEDULER_MAX_PERIOD_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats(job).skipped);
+}
+
+/** A job later than a whole period counts the deadlines it missed, and keeps its phase. */
+void test_missed_deadlines_are_counted(void) {
+    Scheduler scheduler;
+    scheduler.begin();
+    int job = scheduler.add("Fast", record, 100);
+    scheduler.run();
+    hal::busyUs(350000);    // The loop task is held up for 3.5 periods
+    scheduler.run();
+    TEST_ASSERT_EQUAL(2, runs.size());
+    TEST_ASSERT_EQUAL_UINT32(3, scheduler.stats(job).skipped);
+    runFor(scheduler, 1000000);
+    TEST_ASSERT_EQUAL_UINT32(3, scheduler.stats(job).skipped);
+    for (size_t i = 2; i < runs.size(); i++) {
+        TEST_ASSERT_TRUE((runs[i] - runs[0]) % 100000 < 1000);
+    }
+}
+
+/** A job given a period by its own run, as ActuatorJob is, next runs one period later, not at once. */
+void test_period_set_later_starts_one_period_away(void) {
+    Scheduler scheduler;
+    scheduler.begin();
+    static Scheduler *current;
+    static int job;
+    current = &scheduler;
+    job = scheduler.add("Fade", [] {
+        record();
+        current->setPeriod(job, runs.size() < 3 ? 200 : 0);
+    }, 0);
+    scheduler.add("Tick", idle, 30);
+    runFor(scheduler, 100000);
+    TEST_ASSERT_EQUAL(0, runs.size());
+
+    scheduler.trigger(job);
+    runFor(scheduler, 2000000);
+    TEST_ASSERT_EQUAL(3, runs.size());
+    assertPeriodic(200);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.period(job));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats(job).skipped);
+}
+
+int main() {
+    hal::startVirtualTime();
+    UNITY_BEGIN();
+    RUN_TEST(test_longest_period);
+    RUN_TEST(test_period_above_limit_is_clamped);
+    RUN_TEST(test_missed_deadlines_are_counted);
+    RUN_TEST(test_period_set_later_starts_one_period_away);
+    return UNITY_END();
+}
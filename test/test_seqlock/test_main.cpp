@@ -0,0 +1,244 @@
+/**
+ * @file test_main.cpp
+ * @brief Host stress tests of the sensor snapshot (SeqLock) and of the sample rings (SampleRing).
+ *
+ * Writer threads publish values whose fields all derive from one counter, while reader threads
+ * copy them out as fast as they can: a copy whose fields disagree is a torn read. A value is never
+ * lost silently either: a snapshot reader's version never goes backwards, and every sample pushed
+ * into a ring is either received, in order, or counted as dropped.
+ *
+ *     pio test -e native -f test_seqlock
+ */
+
+#include <unity.h>
+
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <SampleRing.h>
+#include <SensorSnapshot.h>
+#include <SeqLock.h>
+
+namespace {
+
+const uint32_t kWrites = 2000000;   ///< Values published by each writer.
+const int kReaders = 3;
+
+/** @brief A value larger than a cache line, so a torn copy has room to show. */
+struct Wide {
+    uint32_t counter;
+    uint32_t words[14];
+    uint32_t check;
+};
+
+Wide makeWide(uint32_t counter) {
+    Wide value;
+    value.counter = counter;
+    value.check = counter;
+    for (uint32_t i = 0; i < 14; i++) {
+        value.words[i] = counter * (i + 1);
+        value.check ^= value.words[i];
+    }
+    return value;
+}
+
+bool intact(const Wide &value) {
+    uint32_t check = value.counter;
+    for (uint32_t i = 0; i < 14; i++) {
+        if (value.words[i] != value.counter * (i + 1)) {
+            return false;
+        }
+        check ^= value.words[i];
+    }
+    return check == value.check;
+}
+
+/** @brief Reader counts shared by a test's threads. */
+struct Counts {
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> torn{0};
+    std::atomic<uint64_t> regressions{0};   ///< Reads older than one the same reader had already seen.
+};
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_seqlock_reads_never_tear(void) {
+    SeqLock<Wide> cell;
+    std::atomic<bool> done(false);
+    Counts counts;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; r++) {
+        readers.emplace_back([&] {
+            uint32_t lastVersion = 0;
+            uint64_t reads = 0, torn = 0, regressions = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                Wide value;
+                uint32_t version = cell.read(value);
+                reads++;
+                if (version > 0 && (!intact(value) || value.counter != version)) {
+                    torn++;
+                }
+                if (version < lastVersion) {
+                    regressions++;
+                }
+                lastVersion = version;
+            }
+            counts.reads += reads;
+            counts.torn += torn;
+            counts.regressions += regressions;
+        });
+    }
+
+    for (uint32_t i = 1; i <= kWrites; i++) {
+        cell.write(makeWide(i));
+    }
+    done = true;
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+
+    Wide last;
+    printf("seqlock: %u writes, %llu reads, %llu torn, %llu out of order\n", (unsigned)kWrites,
+           (unsigned long long)counts.reads.load(), (unsigned long long)counts.torn.load(),
+           (unsigned long long)counts.regressions.load());
+    TEST_ASSERT_EQUAL_UINT32(kWrites, cell.read(last));
+    TEST_ASSERT_TRUE(intact(last));
+    TEST_ASSERT_GREATER_THAN(0, counts.reads.load());
+    TEST_ASSERT_EQUAL(0, counts.torn.load());
+    TEST_ASSERT_EQUAL(0, counts.regressions.load());
+}
+
+/** One writer thread per channel, as each channel's job owns its cell, and readers copying the whole snapshot. */
+void test_snapshot_channels_are_consistent(void) {
+    static SensorSnapshot snapshot;
+    std::atomic<int> writing(3);
+    Counts counts;
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        for (uint32_t i = 1; i <= kWrites; i++) {
+            float value = (float)(i & 0xFFFFF);
+            snapshot.publish<DHT11Channel>(DHT11Data{value, value});
+        }
+        writing--;
+    });
+    threads.emplace_back([&] {
+        for (uint32_t i = 1; i <= kWrites; i++) {
+            uint16_t v = (uint16_t)i;
+            snapshot.publish<PMS5003Channel>(PMS5003Data{v, v, v, v, v, v, v, v, v, v, v, v});
+        }
+        writing--;
+    });
+    threads.emplace_back([&] {
+        for (uint32_t i = 1; i <= kWrites; i++) {
+            snapshot.publish<MQ7Channel>(MQ7Data{(int)i, (float)(i & 0xFFFFF), (uint16_t)i});
+        }
+        writing--;
+    });
+    for (int r = 0; r < kReaders; r++) {
+        threads.emplace_back([&] {
+            uint64_t reads = 0, torn = 0;
+            while (writing.load(std::memory_order_relaxed) > 0) {
+                SensorData data;
+                snapshot.read(data);
+                reads++;
+                const PMS5003Data &p = data.pms5003;
+                torn += data.dht11.temperature != data.dht11.humidity;
+                torn += p.pm1_0 != p.pm2_5 || p.pm2_5 != p.pm10 || p.pm10 != p.pm1_0_cf1 || p.pm1_0_cf1 != p.pm2_5_cf1 ||
+                        p.pm2_5_cf1 != p.pm10_cf1 || p.pm10_cf1 != p.count0_3 || p.count0_3 != p.count0_5 ||
+                        p.count0_5 != p.count1_0 || p.count1_0 != p.count2_5 || p.count2_5 != p.count5_0 ||
+                        p.count5_0 != p.count10;
+                torn += (uint16_t)data.mq7.gasValue != data.mq7.millivolts ||
+                        data.mq7.ppm != (float)(data.mq7.gasValue & 0xFFFFF);
+            }
+            counts.reads += reads;
+            counts.torn += torn;
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    printf("snapshot: 3 x %u writes, %llu reads, %llu torn\n", (unsigned)kWrites,
+           (unsigned long long)counts.reads.load(), (unsigned long long)counts.torn.load());
+    TEST_ASSERT_TRUE(snapshot.ready());
+    TEST_ASSERT_EQUAL_UINT32(kWrites, snapshot.channel<DHT11Channel>().version());
+    TEST_ASSERT_EQUAL_UINT32(kWrites, snapshot.channel<PMS5003Channel>().version());
+    TEST_ASSERT_EQUAL_UINT32(kWrites, snapshot.channel<MQ7Channel>().version());
+    TEST_ASSERT_EQUAL(0, counts.torn.load());
+}
+
+/**
+ * Runs a producer and a consumer over a ring. A `paced` producer waits while the ring is full, so
+ * nothing may be dropped; otherwise it outruns the consumer and the ring overflows. Either way
+ * every sample must be received, in order, or counted as dropped.
+ */
+void stressRing(bool paced) {
+    std::unique_ptr<SampleRing<Wide, 64>> owner(new SampleRing<Wide, 64>());
+    SampleRing<Wide, 64> &ring = *owner;
+    std::atomic<bool> done(false);
+    uint64_t received = 0, torn = 0, disordered = 0;
+
+    std::thread consumer([&] {
+        uint32_t last = 0;
+        for (;;) {
+            const SampleRing<Wide, 64>::Sample *sample = ring.front();
+            if (!sample) {
+                if (done.load(std::memory_order_acquire) && !ring.front()) {
+                    break;
+                }
+                continue;
+            }
+            torn += !intact(sample->value) || sample->time != sample->value.counter;
+            disordered += sample->time <= last;
+            last = sample->time;
+            ring.pop();
+            received++;
+        }
+    });
+    for (uint32_t i = 1; i <= kWrites; i++) {
+        while (paced && ring.size() >= ring.capacity()) {
+            std::this_thread::yield();
+        }
+        ring.push(i, makeWide(i));
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    printf("ring (%s): %u pushed, %llu received, %u dropped, %llu torn, %llu out of order\n",
+           paced ? "paced" : "overrun", (unsigned)kWrites, (unsigned long long)received, (unsigned)ring.dropped(),
+           (unsigned long long)torn, (unsigned long long)disordered);
+    TEST_ASSERT_EQUAL(kWrites, received + ring.dropped());
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_EQUAL(0, disordered);
+    if (paced) {
+        TEST_ASSERT_EQUAL(0, ring.dropped());
+    } else {
+        TEST_ASSERT_GREATER_THAN(0, ring.dropped());
+    }
+}
+
+void test_ring_keeps_every_sample(void) {
+    stressRing(true);
+}
+
+void test_ring_counts_every_drop(void) {
+    stressRing(false);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_seqlock_reads_never_tear);
+    RUN_TEST(test_snapshot_channels_are_consistent);
+    RUN_TEST(test_ring_keeps_every_sample);
+    RUN_TEST(test_ring_counts_every_drop);
+    return UNITY_END();
+}
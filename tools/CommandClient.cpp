@@ -0,0 +1,123 @@
+/**
+ * @file CommandClient.cpp
+ * @brief Implementation of the host-side command client.
+ */
+
+#include "CommandClient.h"
+
+#include <string.h>
+
+size_t CommandClient::encode(const ControlCommand &command, uint8_t *frame, size_t capacity) {
+    uint8_t payload[CONTROL_MAX_PAYLOAD];
+    size_t length = encodeControl(command, payload, sizeof(payload));
+    if (length == 0) {
+        return 0;
+    }
+    return encodeFrame(FRAME_CONTROL, nextSeq++, payload, length, frame, capacity);
+}
+
+size_t CommandClient::setLed(int red, int green, int blue, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_LED;
+    if (red >= 0) { command.actuators.red = (uint8_t)red; command.actuators.present |= COMMAND_RED; }
+    if (green >= 0) { command.actuators.green = (uint8_t)green; command.actuators.present |= COMMAND_GREEN; }
+    if (blue >= 0) { command.actuators.blue = (uint8_t)blue; command.actuators.present |= COMMAND_BLUE; }
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setDuty(uint16_t dutyCycle, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_DUTY;
+    command.actuators.dutyCycle = dutyCycle;
+    command.actuators.present = COMMAND_DUTY;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setPeriod(ControlJob job, uint32_t periodMs, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_PERIOD;
+    command.job = job;
+    command.periodMs = periodMs;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::requestTelemetry(uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_REQUEST_TELEMETRY;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setReportMode(uint8_t mode, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_REPORT_MODE;
+    command.reportMode = mode;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setBatch(uint8_t samples, uint32_t flushMs, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_BATCH;
+    command.batchSize = samples;
+    command.batchFlushMs = flushMs;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setFanMode(ControlFanMode mode, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_FAN_MODE;
+    command.fanMode = mode;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setFanTarget(float setpoint, uint16_t minDuty, uint16_t maxDuty, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_FAN_TARGET;
+    command.fanSetpoint = (uint16_t)(setpoint * 10.0f + 0.5f);
+    command.fanMinDuty = minDuty;
+    command.fanMaxDuty = maxDuty;
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setConfig(const uint8_t *keys, const uint32_t *values, uint8_t count, bool save, uint8_t *frame,
+                                size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    if (count > CONTROL_MAX_CONFIG_ITEMS) {
+        return 0;
+    }
+    command.opcode = CONTROL_SET_CONFIG;
+    command.configFlags = save ? CONTROL_CONFIG_SAVE : 0;
+    command.configCount = count;
+    memcpy(command.configKeys, keys, count);
+    memcpy(command.configValues, values, count * sizeof(values[0]));
+    return encode(command, frame, capacity);
+}
+
+size_t CommandClient::setDeviceId(const char *id, bool save, uint8_t *frame, size_t capacity) {
+    ControlCommand command;
+    memset(&command, 0, sizeof(command));
+    command.opcode = CONTROL_SET_DEVICE_ID;
+    command.configFlags = save ? CONTROL_CONFIG_SAVE : 0;
+    strncpy(command.deviceId, id, CONTROL_DEVICE_ID_LENGTH);
+    return encode(command, frame, capacity);
+}
+
+CommandClient::Event CommandClient::feed(uint8_t byte) {
+    if (!decoder.feed(byte)) {
+        return CLIENT_NONE;
+    }
+    const Frame &received = decoder.frame();
+    if (received.type == FRAME_CONTROL_ACK && decodeControlAck(received.payload, received.length, lastAck)) {
+        lastAckSeq = received.seq;
+        return CLIENT_ACK;
+    }
+    return CLIENT_FRAME;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file CommandClient.h
+ * @brief Host-side library sending binary commands to the sensor-ESP and reading their acknowledgements.
+ *
+ * Builds `FRAME_CONTROL` frames with consecutive sequence numbers and decodes the frames coming back
+ * from the device. It only produces and consumes bytes; the caller owns the serial port. Link it with
+ * `src/CommandProtocol.cpp`, `src/SerialFrame.cpp` and `src/StreamCrc32.cpp`, with `-Isrc`.
+ */
+
+#ifndef COMMAND_CLIENT_H
+#define COMMAND_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <CommandProtocol.h>
+#include <SerialFrame.h>
+
+/**
+ * @class CommandClient
+ * @brief Encoder of commands and decoder of the device's answers.
+ *
+ * Every `encode` call takes the next sequence number; `FRAME_MAX_ENCODED` bytes are always enough
+ * for the frame. To retransmit a command, send the same frame bytes again.
+ */
+class CommandClient {
+    public:
+        /** @brief What the last fed byte completed. */
+        enum Event {
+            CLIENT_NONE,    ///< Nothing yet.
+            CLIENT_ACK,     ///< An acknowledgement, see `ack()` and `ackSeq()`.
+            CLIENT_FRAME,   ///< Another frame (telemetry, batches...), see `frame()`.
+        };
+
+        explicit CommandClient(uint8_t firstSeq = 0) : nextSeq(firstSeq), lastAck{}, lastAckSeq(0) {}
+
+        /** @brief Encodes `command` as the next frame. @return Frame length, 0 on error. */
+        size_t encode(const ControlCommand &command, uint8_t *frame, size_t capacity);
+
+        /** @brief Sets the LED channels; a negative value leaves a channel unchanged. */
+        size_t setLed(int red, int green, int blue, uint8_t *frame, size_t capacity);
+        size_t setDuty(uint16_t dutyCycle, uint8_t *frame, size_t capacity);
+        size_t setPeriod(ControlJob job, uint32_t periodMs, uint8_t *frame, size_t capacity);
+        size_t requestTelemetry(uint8_t *frame, size_t capacity);
+        size_t setReportMode(uint8_t mode, uint8_t *frame, size_t capacity);
+        /** @brief Sets the batch size and flush age; 0 leaves a value unchanged. */
+        size_t setBatch(uint8_t samples, uint32_t flushMs, uint8_t *frame, size_t capacity);
+        size_t setFanMode(ControlFanMode mode, uint8_t *frame, size_t capacity);
+        /** @brief Sets the local fan control's PM2.5 setpoint (µg/m³) and duty limits. */
+        size_t setFanTarget(float setpoint, uint16_t minDuty, uint16_t maxDuty, uint8_t *frame, size_t capacity);
+        /**
+         * @brief Sets up to `CONTROL_MAX_CONFIG_ITEMS` configuration values (`ConfigKey`s of the device) at once.
+         *
+         * @param save Also write the resulting configuration to the device's NVS.
+         */
+        size_t setConfig(const uint8_t *keys, const uint32_t *values, uint8_t count, bool save, uint8_t *frame,
+                         size_t capacity);
+        /** @brief Sets the ISAAC ID (`CONTROL_DEVICE_ID_LENGTH` hex characters). */
+        size_t setDeviceId(const char *id, bool save, uint8_t *frame, size_t capacity);
+
+        /** @brief Seq the last encoded frame used. */
+        uint8_t lastSeq() const { return (uint8_t)(nextSeq - 1); }
+
+        /** @brief Feeds one byte received from the device. */
+        Event feed(uint8_t byte);
+
+        const ControlAck &ack() const { return lastAck; }   ///< Last acknowledgement.
+        uint8_t ackSeq() const { return lastAckSeq; }       ///< Seq of the command it acknowledges.
+        const Frame &frame() const { return decoder.frame(); } ///< Last decoded frame.
+
+        uint32_t errors() const { return decoder.crcErrors + decoder.framingErrors; } ///< Frames dropped by the decoder.
+
+    private:
+        uint8_t nextSeq;
+        FrameDecoder decoder;
+        ControlAck lastAck;
+        uint8_t lastAckSeq;
+};
+
+#endif // !COMMAND_CLIENT_H
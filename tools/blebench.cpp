@@ -0,0 +1,216 @@
+/**
+ * @file blebench.cpp
+ * @brief Notify throughput and write reassembly of the BLE stream, against a fake central.
+ *
+ * The fake central is a `GattLink` modelling the link layer: every connection interval it takes
+ * up to `kPacketsPerEvent` link-layer packets from the device's TX queue, as many as fit in the
+ * interval at 1 Mbit/s. A notification is one ATT PDU (3 bytes of header) in an L2CAP PDU
+ * (4 bytes), fragmented into packets of 27 bytes, or 251 with data length extension, which is
+ * assumed whenever the MTU was raised. The queue holds `kTxQueue` notifications; `notify()` fails
+ * while it is full, as the stack does when it runs out of buffers.
+ *
+ * Throughput is measured with the device streaming as fast as the link takes it, either packing
+ * as many snapshots as the MTU allows into each notification or one per notification. Reassembly
+ * is checked by writing random messages in random chunk sizes, losing and swapping chunks at random.
+ *
+ *     g++ -std=gnu++17 -Isrc -Ilib/NativeHal/src tools/blebench.cpp src/BleStream.cpp src/ReadingPayload.cpp -o blebench
+ *     blebench [seconds] [messages]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <BleStream.h>
+
+namespace {
+
+const int kPacketsPerEvent = 6;     ///< What common phones send per connection event.
+const size_t kTxQueue = 10;         ///< Notifications the device's stack buffers.
+const int kL2capHeader = 4;
+const int kPacketOverheadUs = 14 * 8 + 150 + 80 + 150;  ///< Preamble, header, MIC, CRC, IFS and the empty ack.
+
+/**
+ * @class FakeCentral
+ * @brief A subscribed central behind a link-layer model.
+ */
+class FakeCentral : public GattLink {
+    public:
+        FakeCentral(uint16_t mtu, double intervalMs)
+            : linkMtu(mtu), intervalUs(intervalMs * 1000), packetPayload(mtu > BLE_DEFAULT_MTU ? 251 : 27) {}
+
+        uint16_t mtu() const override { return linkMtu; }
+        bool subscribed() const override { return true; }
+
+        bool notify(const uint8_t *data, size_t length) override {
+            if (queue.size() >= kTxQueue || length > (size_t)(linkMtu - BLE_ATT_OVERHEAD) || data[0] != BLE_NOTIFY_VERSION ||
+                length != BLE_NOTIFY_HEADER + (size_t)data[1] * BLE_RECORD_SIZE) {
+                return false;
+            }
+            queue.push_back(Pending{(int)length + BLE_ATT_OVERHEAD + kL2capHeader, (int)length, data[1]});
+            return true;
+        }
+
+        /** @brief Runs one connection event. */
+        void connectionEvent() {
+            double airtime = 0;
+            for (int packets = 0; packets < kPacketsPerEvent && !queue.empty(); packets++) {
+                Pending &front = queue.front();
+                int fragment = front.remaining < packetPayload ? front.remaining : packetPayload;
+                double cost = fragment * 8 + kPacketOverheadUs;
+                if (airtime + cost > intervalUs) {
+                    break;
+                }
+                airtime += cost;
+                front.remaining -= fragment;
+                if (front.remaining == 0) {
+                    records += front.records;
+                    bytes += front.value;
+                    notifications++;
+                    queue.pop_front();
+                }
+            }
+        }
+
+        uint64_t records = 0;       ///< Snapshots received.
+        uint64_t bytes = 0;         ///< Notification value bytes received.
+        uint64_t notifications = 0;
+
+    private:
+        struct Pending {
+            int remaining;          ///< Bytes not yet sent over the air.
+            int value;
+            uint8_t records;
+        };
+
+        const uint16_t linkMtu;
+        const double intervalUs;
+        const int packetPayload;
+        std::deque<Pending> queue;
+};
+
+/** @brief Streams as fast as the link takes it for `seconds`; `batch` snapshots at a time. */
+void measure(uint16_t mtu, double intervalMs, bool batched, double seconds) {
+    FakeCentral central(mtu, intervalMs);
+    BleNotifier notifier;
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    uint8_t batch = batched ? bleRecordsPerNotification(mtu) : 1;
+
+    long events = (long)(seconds * 1000 / intervalMs);
+    for (long event = 0; event < events; event++) {
+        uint32_t now = (uint32_t)(event * intervalMs);
+        for (;;) {
+            if (notifier.pending() == 0) {
+                for (uint8_t i = 0; i < batch; i++) {
+                    notifier.push(now, data);
+                }
+            }
+            if (notifier.flush(central, batch) == 0) {
+                break;
+            }
+        }
+        central.connectionEvent();
+    }
+    printf("%5u %8.1f %8s %10.0f %10.0f %10.0f\n", mtu, intervalMs, batched ? "batched" : "single",
+           central.records / seconds, central.bytes / seconds, central.notifications / seconds);
+}
+
+/** @brief Writes `messages` random messages in chunks, faulting each chunk with probability `faultRate`. */
+void reassemble(uint16_t mtu, double faultRate, long messages, std::mt19937 &rng) {
+    BleReassembler reassembler;
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    long intact = 0, lost = 0, corrupted = 0, truncated = 0;
+    uint8_t sequence = 0;
+    const int maxData = mtu - BLE_ATT_OVERHEAD - 1;
+
+    for (long m = 0; m < messages; m++) {
+        std::vector<uint8_t> message(std::uniform_int_distribution<int>(1, BLE_MAX_MESSAGE)(rng));
+        for (uint8_t &b : message) b = (uint8_t)byte(rng);
+        int minData = (int)(message.size() + BLE_CHUNK_INDEX) / (BLE_CHUNK_INDEX + 1);
+        int dataSize = std::uniform_int_distribution<int>(minData, maxData > minData ? maxData : minData)(rng);
+
+        std::vector<std::vector<uint8_t>> chunks;
+        for (size_t at = 0; at < message.size(); at += dataSize) {
+            size_t n = message.size() - at < (size_t)dataSize ? message.size() - at : dataSize;
+            std::vector<uint8_t> chunk;
+            chunk.reserve(n + 1);
+            chunk.push_back((uint8_t)(chunks.size() | sequence));
+            chunk.insert(chunk.end(), message.begin() + at, message.begin() + at + n);
+            chunks.push_back(chunk);
+        }
+        chunks.back()[0] |= BLE_CHUNK_FINAL;
+        sequence = (sequence + (BLE_CHUNK_INDEX + 1)) & BLE_CHUNK_SEQUENCE;
+
+        // Faults: a chunk is lost, or swapped with the next one
+        std::vector<std::vector<uint8_t>> sent;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            double roll = chance(rng);
+            if (roll < faultRate / 2) {
+                continue;
+            }
+            if (roll < faultRate && i + 1 < chunks.size()) {
+                sent.push_back(chunks[i + 1]);
+                sent.push_back(chunks[i]);
+                i++;
+                continue;
+            }
+            sent.push_back(chunks[i]);
+        }
+
+        bool delivered = false;
+        for (const std::vector<uint8_t> &chunk : sent) {
+            if (reassembler.write(chunk.data(), chunk.size()) == BleReassembler::BLE_MESSAGE_COMPLETE) {
+                uint8_t out[BLE_MAX_MESSAGE];
+                size_t length = reassembler.take(out, sizeof(out));
+                delivered = true;
+                if (length == message.size() && memcmp(out, message.data(), length) == 0) {
+                    intact++;
+                } else if (length < message.size() && memcmp(out, message.data(), length) == 0) {
+                    truncated++;
+                } else {
+                    corrupted++;
+                }
+            }
+        }
+        if (!delivered) {
+            lost++;
+        }
+    }
+    printf("%5u %6.0f%% %9ld %9ld %9ld %9ld %9u\n", mtu, faultRate * 100, intact, lost, truncated, corrupted,
+           reassembler.dropped());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 60;
+    long messages = argc > 2 ? atol(argv[2]) : 100000;
+    const uint16_t mtus[] = {BLE_DEFAULT_MTU, 185, 247};
+    const double intervals[] = {7.5, 15, 30};
+
+    printf("notify throughput, %.0f s per run\n", seconds);
+    printf("%5s %8s %8s %10s %10s %10s\n", "mtu", "ci ms", "mode", "records/s", "bytes/s", "notify/s");
+    for (uint16_t mtu : mtus) {
+        for (double interval : intervals) {
+            measure(mtu, interval, true, seconds);
+            measure(mtu, interval, false, seconds);
+        }
+    }
+
+    printf("\nreassembly, %ld messages per run\n", messages);
+    printf("%5s %7s %9s %9s %9s %9s %9s\n", "mtu", "faults", "intact", "lost", "truncated", "corrupted", "dropped");
+    std::mt19937 rng(22);
+    const double faults[] = {0, 0.01, 0.05, 0.2};
+    for (uint16_t mtu : mtus) {
+        for (double rate : faults) {
+            reassemble(mtu, rate, messages, rng);
+        }
+    }
+    return 0;
+}
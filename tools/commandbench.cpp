@@ -0,0 +1,192 @@
+/**
+ * @file commandbench.cpp
+ * @brief Round-trip latency benchmark of the binary command protocol.
+ *
+ * Sends `CONTROL_SET_DUTY` commands to the sensor-ESP through a serial port and times each one
+ * from the first byte written to its acknowledgement: first one command at a time, then with up to
+ * `window` commands in flight. A command not acknowledged within a second is sent again with the
+ * same seq, which the device acknowledges as a duplicate without applying it twice.
+ *
+ *     g++ -std=gnu++17 -Isrc -Itools tools/commandbench.cpp tools/CommandClient.cpp \
+ *         src/CommandProtocol.cpp src/SerialFrame.cpp src/StreamCrc32.cpp -o commandbench
+ *     commandbench /dev/ttyUSB0 [commands] [window]
+ *
+ * The native firmware exposes its Serial1 on a pseudo-terminal when run with `HAL_SERIAL1_PTY=1`.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <CommandClient.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int kRetryMs = 1000;
+const int kMaxRetries = 5;
+
+/** @brief Opens the port at 9600 baud, 8E1, raw, like the device's Serial1. */
+int openPort(const char *path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios mode;
+    if (tcgetattr(fd, &mode) == 0) {
+        cfmakeraw(&mode);
+        cfsetispeed(&mode, B9600);
+        cfsetospeed(&mode, B9600);
+        mode.c_cflag |= PARENB | CLOCAL | CREAD;
+        mode.c_cflag &= ~(PARODD | CSTOPB);
+        tcsetattr(fd, TCSANOW, &mode);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+bool writeAll(int fd, const uint8_t *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno != EINTR) {
+            return false;
+        }
+        if (n > 0) {
+            data += n;
+            length -= (size_t)n;
+        }
+    }
+    return true;
+}
+
+struct InFlight {
+    uint8_t seq;
+    uint8_t frame[FRAME_MAX_ENCODED];
+    size_t length;
+    Clock::time_point sent;     ///< First transmission, for the round-trip time.
+    Clock::time_point lastSent; ///< Latest transmission, for the retry timer.
+    int retries;
+};
+
+struct Result {
+    std::vector<double> rttMs;
+    unsigned duplicates;
+    unsigned nacks;
+    unsigned lost;
+    double seconds;
+};
+
+/** @brief Sends `count` commands with at most `window` unacknowledged. */
+Result run(int fd, CommandClient &client, int count, int window) {
+    Result result = {{}, 0, 0, 0, 0.0};
+    std::vector<InFlight> inFlight;
+    int sent = 0;
+    Clock::time_point start = Clock::now();
+
+    while (sent < count || !inFlight.empty()) {
+        while (sent < count && (int)inFlight.size() < window) {
+            InFlight command;
+            command.length = client.setDuty((uint16_t)(sent % 1024), command.frame, sizeof(command.frame));
+            command.seq = client.lastSeq();
+            command.sent = command.lastSent = Clock::now();
+            command.retries = 0;
+            if (!writeAll(fd, command.frame, command.length)) {
+                perror("write");
+                return result;
+            }
+            inFlight.push_back(command);
+            sent++;
+        }
+
+        struct pollfd ready = {fd, POLLIN, 0};
+        if (poll(&ready, 1, 10) > 0) {
+            uint8_t buffer[256];
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < n; i++) {
+                if (client.feed(buffer[i]) != CommandClient::CLIENT_ACK) {
+                    continue;
+                }
+                Clock::time_point now = Clock::now();
+                for (size_t k = 0; k < inFlight.size(); k++) {
+                    if (inFlight[k].seq != client.ackSeq()) {
+                        continue;
+                    }
+                    result.rttMs.push_back(std::chrono::duration<double, std::milli>(now - inFlight[k].sent).count());
+                    if (client.ack().status == CONTROL_DUPLICATE) result.duplicates++;
+                    if (client.ack().status >= CONTROL_BAD_VERSION) result.nacks++;
+                    inFlight.erase(inFlight.begin() + k);
+                    break;
+                }
+            }
+        }
+
+        Clock::time_point now = Clock::now();
+        for (size_t k = 0; k < inFlight.size();) {
+            InFlight &command = inFlight[k];
+            if (now - command.lastSent < std::chrono::milliseconds(kRetryMs)) {
+                k++;
+            } else if (command.retries >= kMaxRetries) {
+                result.lost++;
+                inFlight.erase(inFlight.begin() + k);
+            } else {
+                command.retries++;
+                command.lastSent = now;
+                writeAll(fd, command.frame, command.length);
+                k++;
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+void report(const char *name, Result &result) {
+    std::vector<double> &rtt = result.rttMs;
+    std::sort(rtt.begin(), rtt.end());
+    if (rtt.empty()) {
+        printf("%-16s no acknowledgements, %u lost\n", name, result.lost);
+        return;
+    }
+    double sum = 0.0;
+    for (double value : rtt) sum += value;
+    printf("%-16s %4zu acked  rtt ms min %.2f  median %.2f  mean %.2f  p99 %.2f  max %.2f  %.1f commands/s"
+           "  (%u duplicate, %u nack, %u lost)\n",
+           name, rtt.size(), rtt.front(), rtt[rtt.size() / 2], sum / rtt.size(), rtt[(rtt.size() * 99) / 100],
+           rtt.back(), rtt.size() / result.seconds, result.duplicates, result.nacks, result.lost);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <serial port> [commands] [window]\n", argv[0]);
+        return 2;
+    }
+    int count = argc > 2 ? atoi(argv[2]) : 200;
+    int window = argc > 3 ? atoi(argv[3]) : 8;
+    int fd = openPort(argv[1]);
+    if (fd < 0) {
+        return 1;
+    }
+
+    CommandClient client((uint8_t)(Clock::now().time_since_epoch().count() & 0xFF));
+    Result single = run(fd, client, count, 1);
+    report("stop-and-wait", single);
+    Result pipelined = run(fd, client, count, window);
+    char name[32];
+    snprintf(name, sizeof(name), "window %d", window);
+    report(name, pipelined);
+    fprintf(stderr, "%u frames dropped by the decoder\n", client.errors());
+    close(fd);
+    return single.lost + pipelined.lost ? 1 : 0;
+}
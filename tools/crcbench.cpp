@@ -0,0 +1,133 @@
+/**
+ * @file crcbench.cpp
+ * @brief Agreement and throughput of `StreamCrc32` against the bakercp `CRC32` library it replaced.
+ *
+ * The bakercp library's algorithm, a 16-entry table walked a nibble at a time, is reproduced here
+ * next to a bitwise reference. Random buffers are checksummed by all three, `StreamCrc32` being fed
+ * in one block, byte by byte and in random pieces as the serializer and the frame decoder feed it;
+ * every result must agree. Throughput is then measured on a 4 KB buffer and on 80-byte messages,
+ * the size of a legacy JSON line. Build it again with `-DCRC32_SLICES=4` for the smaller tables:
+ *
+ *     g++ -std=gnu++17 -O2 -Isrc tools/crcbench.cpp src/StreamCrc32.cpp -o crcbench
+ *     crcbench [buffers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <StreamCrc32.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+uint32_t bitwiseCrc32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/** @brief The bakercp `CRC32` library's update loop: two lookups in a 16-entry table per byte. */
+uint32_t nibbleCrc32(const uint8_t *data, size_t length) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    uint32_t state = ~0u;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t index = (uint8_t)(state ^ data[i]);
+        state = table[index & 0x0F] ^ (state >> 4);
+        index = (uint8_t)(state ^ (data[i] >> 4));
+        state = table[index & 0x0F] ^ (state >> 4);
+    }
+    return ~state;
+}
+
+uint32_t streamBlock(const uint8_t *data, size_t length) {
+    return StreamCrc32::compute(data, length);
+}
+
+uint32_t streamBytes(const uint8_t *data, size_t length) {
+    StreamCrc32 crc;
+    for (size_t i = 0; i < length; i++) {
+        crc.update(data[i]);
+    }
+    return crc.value();
+}
+
+volatile uint32_t sink;
+
+/** @brief MB/s of `crc` over `data` in `chunk`-byte messages. */
+double throughput(uint32_t (*crc)(const uint8_t *, size_t), const std::vector<uint8_t> &data, size_t chunk) {
+    const size_t target = 64 << 20;
+    size_t done = 0;
+    uint32_t result = 0;
+    Clock::time_point start = Clock::now();
+    while (done < target) {
+        for (size_t at = 0; at + chunk <= data.size(); at += chunk) {
+            result ^= crc(data.data() + at, chunk);
+            done += chunk;
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    sink = result;
+    return done / seconds / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    long buffers = argc > 1 ? atol(argv[1]) : 20000;
+
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    printf("check value: bitwise %08x, bakercp %08x, StreamCrc32 %08x (expected cbf43926)\n",
+           (unsigned)bitwiseCrc32(check, 9), (unsigned)nibbleCrc32(check, 9), (unsigned)streamBlock(check, 9));
+
+    std::mt19937 rng(4);
+    long mismatches = 0;
+    for (long b = 0; b < buffers; b++) {
+        std::vector<uint8_t> data(std::uniform_int_distribution<size_t>(0, 4096)(rng));
+        for (uint8_t &byte : data) byte = (uint8_t)rng();
+        uint32_t expected = bitwiseCrc32(data.data(), data.size());
+
+        StreamCrc32 pieces;
+        size_t at = 0;
+        while (at < data.size()) {
+            size_t n = std::uniform_int_distribution<size_t>(0, data.size() - at)(rng);
+            pieces.update(data.data() + at, n);
+            at += n;
+        }
+        mismatches += nibbleCrc32(data.data(), data.size()) != expected;
+        mismatches += streamBlock(data.data(), data.size()) != expected;
+        mismatches += streamBytes(data.data(), data.size()) != expected;
+        mismatches += pieces.value() != expected;
+    }
+    printf("%ld random buffers of 0-4096 bytes, %ld mismatches\n\n", buffers, mismatches);
+
+    std::vector<uint8_t> data(4096);
+    for (uint8_t &byte : data) byte = (uint8_t)rng();
+    printf("MB/s, CRC32_SLICES=%d %12s %12s\n", CRC32_SLICES, "4 KB", "80 B");
+    struct {
+        const char *name;
+        uint32_t (*crc)(const uint8_t *, size_t);
+    } engines[] = {
+        {"bitwise", bitwiseCrc32},
+        {"bakercp (nibble table)", nibbleCrc32},
+        {"StreamCrc32 byte by byte", streamBytes},
+        {"StreamCrc32 blocks", streamBlock},
+    };
+    for (const auto &engine : engines) {
+        printf("%-26s %12.0f %12.0f\n", engine.name, throughput(engine.crc, data, data.size()),
+               throughput(engine.crc, data, 80));
+    }
+    return mismatches == 0 ? 0 : 1;
+}
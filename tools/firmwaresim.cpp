@@ -0,0 +1,399 @@
+/**
+ * @file firmwaresim.cpp
+ * @brief Runs the whole firmware in virtual time against scripted sensors and a simulated cloud-ESP.
+ *
+ * The firmware and the native shim are linked in unchanged; `setup()` runs, then `loop()` until
+ * the requested device time has passed, on the shim's virtual clock (see VirtualTime.h), so a
+ * day of device time takes seconds and two runs with the same seed are identical. Meanwhile:
+ *
+ * - The room model feeds the PMS5003 and the fan cleans the room. Its indoor source peaks twice a
+ *   day, for cooking, and the MQ7 sees CO rise with it; the DHT11 follows a daily cycle.
+ * - A cloud-ESP on Serial1 acknowledges batches go-back-N style after `kAckLatencyMs`, losing
+ *   `kAckLossPercent` of its acknowledgements, asks for telemetry every `kTelemetryPeriodS` and
+ *   sends a control command every `kCommandPeriodS`, the first one switching the fan to auto.
+ * - The cloud-ESP is unplugged for `kOutageHours` from `kOutageStartH` on the first day. The uplink
+ *   store is cut down to `kStoreSegments` segments, so it overflows and drops its oldest batches.
+ * - The console is counted, not printed.
+ *
+ * The report lists every scheduler job (runs, skipped deadlines, worst lateness and run time),
+ * every task as the virtual scheduler saw it (wake-ups, preemptions, ready latency) and the frames
+ * exchanged both ways. Then come the problems found: a periodic job that never ran, missed
+ * deadlines or started more than a period late, a task blocked with no timeout for longer than
+ * `kStuckS`, the loop task calling `loop()` `kMaxSpins` times without time passing, a deadlock,
+ * batches neither delivered nor counted as dropped, or more than `kMaxQueuedAtEnd` batches still
+ * queued at the end. The exit status is 1 if there was any, 2 on a deadlock.
+ *
+ * The uplink store lives in a fresh directory, with its own partition table, unless `HAL_FLASH_DIR`
+ * is set:
+ *
+ *     g++ -std=gnu++17 -O2 -pthread -DARDUINO=10819 -Isrc -Ilib/NativeHal/src -Itools tools/firmwaresim.cpp tools/CommandClient.cpp \
+ *         $(find src lib/NativeHal/src -name '*.cpp' ! -name NativeMain.cpp) -o firmwaresim
+ *     firmwaresim [days] [seed]
+ */
+
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <NativeHal.h>
+#include <RoomModel.h>
+#include <VirtualTime.h>
+
+#include <CommandClient.h>
+#include <FrameStore.h>
+#include <Scheduler.h>
+
+/** @brief As in main.cpp; build with the same value as the firmware under test. */
+#ifndef LINK_FRAMED
+#define LINK_FRAMED 1
+#endif
+
+extern Scheduler scheduler;
+#if LINK_FRAMED
+extern FrameStore uplinkStore;
+#endif
+
+namespace {
+
+const uint32_t kLineBaud = 9600;
+const uint32_t kBitsPerByte = 11;         ///< 8E1 with its start bit
+const uint32_t kAckLatencyMs = 40;
+const uint32_t kAckLossPercent = 2;
+const uint32_t kTelemetryPeriodS = 600;
+const uint32_t kCommandPeriodS = 3600;
+const uint32_t kScriptPeriodS = 60;
+const uint64_t kStuckS = 60;
+const uint32_t kMaxSpins = 100000;
+const uint8_t kMq7Pin = 33;
+const uint8_t kFanChannel = 0;
+const uint32_t kFanFullDuty = 1023;
+const double kOutageStartH = 2;
+const double kOutageHours = 12;
+const uint32_t kStoreSegments = 2;
+const uint32_t kMaxQueuedAtEnd = 8;
+
+const char *const kFrameNames[] = {"", "reading", "batch", "telemetry", "log", "control ack"};
+
+double hours(uint64_t us) { return us / 3.6e9; }
+
+/**
+ * @class CloudPeer
+ * @brief The cloud-ESP end of Serial1.
+ */
+class CloudPeer {
+    public:
+        explicit CloudPeer(uint32_t seed) : rng(seed) {}
+
+        /** @brief Takes what the firmware wrote to Serial1; runs on the firmware's task. */
+        void receive(const uint8_t *data, size_t length) {
+            if (!online) {
+                bytesLost += length;
+                return;
+            }
+            bytesIn += length;
+            for (size_t i = 0; i < length; i++) {
+                switch (client.feed(data[i])) {
+                    case CommandClient::CLIENT_ACK: acknowledged(); break;
+                    case CommandClient::CLIENT_FRAME: received(client.frame()); break;
+                    default: break;
+                }
+            }
+        }
+
+        void requestTelemetry() {
+            if (!online) {
+                return;
+            }
+            uint8_t frame[FRAME_MAX_ENCODED];
+            send(frame, encodeFrame(FRAME_TELEMETRY_REQUEST, txSeq++, nullptr, 0, frame, sizeof(frame)));
+            telemetryRequests++;
+        }
+
+        /** @brief Sends the next command of a fixed rotation. */
+        void sendCommand() {
+            if (!online) {
+                return;
+            }
+            uint8_t frame[FRAME_MAX_ENCODED];
+            size_t length = 0;
+            switch (commandsSent % 4) {
+                case 0: length = client.setFanMode(CONTROL_FAN_AUTO, frame, sizeof(frame)); break;
+                case 1: length = client.setFanTarget(10.0f, 100, 1023, frame, sizeof(frame)); break;
+                case 2: length = client.setPeriod(CONTROL_JOB_DHT11, 10000, frame, sizeof(frame)); break;
+                default: length = client.setPeriod(CONTROL_JOB_DHT11, 5000, frame, sizeof(frame)); break;
+            }
+            pending[client.lastSeq()] = hal::deviceTimeUs();
+            commandsSent++;
+            send(frame, length);
+        }
+
+        /** @brief Unplugs the peer, or plugs it back: unplugged, it neither hears nor sends anything. */
+        void setOnline(bool plugged) { online = plugged; }
+
+        void report() const {
+            printf("\nserial1: %llu bytes in, %llu bytes out, %u decoder errors, %llu bytes lost unplugged\n", bytesIn,
+                   bytesOut, client.errors(), bytesLost);
+            for (const auto &type : frames) {
+                const char *name = type.first < sizeof(kFrameNames) / sizeof(kFrameNames[0]) ? kFrameNames[type.first] : "other";
+                printf("  device -> peer  %-12s %10llu\n", name, type.second);
+            }
+            printf("  batches in order %llu, out of order or repeated %llu\n", inOrder, outOfOrder);
+            printf("  peer -> device  ack          %10llu (%llu lost on purpose)\n", acksSent, acksLost);
+            printf("  peer -> device  telemetry?   %10llu\n", telemetryRequests);
+            printf("  peer -> device  command      %10llu, %llu acknowledged, %llu rejected, round trip max %.1f ms\n",
+                   commandsSent, commandsAcked, commandsRejected, maxRoundTripUs / 1000.0);
+        }
+
+        unsigned long long commandsSent = 0;
+        unsigned long long commandsAcked = 0;
+        unsigned long long inOrder = 0;     ///< Batches delivered: received in order, once each.
+
+    private:
+        /** @brief Writes to the device, which has the bytes once they crossed the line. */
+        void send(const uint8_t *frame, size_t length) {
+            bytesOut += length;
+            uint32_t lineMs = (uint32_t)((length * kBitsPerByte * 1000 + kLineBaud - 1) / kLineBaud);
+            std::vector<uint8_t> bytes(frame, frame + length);
+            hal::addEvent(lineMs, 0, [bytes] { Serial1.inject(bytes.data(), bytes.size()); });
+        }
+
+        void received(const Frame &frame) {
+            frames[frame.type]++;
+            if (frame.type != FRAME_BATCH) {
+                return;
+            }
+            // Go-back-N receiver: delivers a batch that follows the last one delivered, across the ids the
+            // device lost, and acknowledges the last one delivered
+            uint32_t id, previous;
+            if (decodeRecordHeader(frame, id, previous) && id >= expected && previous < expected) {
+                expected = id + 1;
+                inOrder++;
+            } else {
+                outOfOrder++;
+            }
+            if (std::uniform_int_distribution<uint32_t>(0, 99)(rng) < kAckLossPercent) {
+                acksLost++;
+                return;
+            }
+            uint32_t last = expected - 1;
+            hal::addEvent(kAckLatencyMs, 0, [this, last] {
+                if (!online) {
+                    return;
+                }
+                uint8_t ack[4] = {(uint8_t)last, (uint8_t)(last >> 8), (uint8_t)(last >> 16), (uint8_t)(last >> 24)};
+                uint8_t frame[FRAME_MAX_ENCODED];
+                send(frame, encodeFrame(FRAME_ACK, txSeq++, ack, sizeof(ack), frame, sizeof(frame)));
+                acksSent++;
+            });
+        }
+
+        void acknowledged() {
+            auto sent = pending.find(client.ackSeq());
+            if (sent == pending.end()) {
+                return;
+            }
+            uint64_t roundTrip = hal::deviceTimeUs() - sent->second;
+            maxRoundTripUs = roundTrip > maxRoundTripUs ? roundTrip : maxRoundTripUs;
+            pending.erase(sent);
+            commandsAcked++;
+            if (client.ack().status >= 0x80) {
+                commandsRejected++;
+            }
+        }
+
+        std::mt19937 rng;
+        CommandClient client;
+        uint8_t txSeq = 0;
+        uint32_t expected = 1;      ///< Record id the next batch delivered must have at least.
+        std::map<uint8_t, uint64_t> pending;    ///< Device time each unacknowledged command was sent at.
+        std::map<uint8_t, unsigned long long> frames;
+        bool online = true;
+        unsigned long long bytesIn = 0, bytesOut = 0, bytesLost = 0;
+        unsigned long long outOfOrder = 0;
+        unsigned long long acksSent = 0, acksLost = 0;
+        unsigned long long telemetryRequests = 0;
+        unsigned long long commandsRejected = 0;
+        uint64_t maxRoundTripUs = 0;
+};
+
+/** @brief Sets the room, DHT11 and MQ7 for the time of day. */
+void script() {
+    double hour = fmod(hours(hal::deviceTimeUs()), 24.0);
+    bool cooking = (hour >= 7.0 && hour < 7.5) || (hour >= 19.0 && hour < 20.0);
+    hal::setRoomSource(cooking ? 4000.0f : 300.0f);
+    double day = sin((hour - 9.0) / 24.0 * 2 * M_PI);
+    hal::setDhtReading((float)(21.0 + 3.0 * day), (float)(50.0 - 10.0 * day));
+    hal::setAnalogInput(kMq7Pin, cooking ? 1400 : 450);
+}
+
+unsigned long long consoleBytes = 0;
+std::vector<const char *> problems;
+
+void printJobs() {
+    printf("%-16s %10s %8s %14s %14s %10s\n", "job", "runs", "skipped", "max late ms", "max run ms", "period ms");
+    for (int i = 0; i < scheduler.jobs(); i++) {
+        const JobStats &stats = scheduler.stats(i);
+        printf("%-16s %10u %8u %14.3f %14.3f %10u\n", scheduler.name(i), stats.runs, stats.skipped,
+               stats.maxLateness / 1000.0, stats.maxRuntime / 1000.0, scheduler.period(i));
+    }
+}
+
+void printTasks() {
+    printf("\n%-16s %4s %10s %11s %16s %16s %10s\n", "task", "prio", "wakeups", "preemptions", "max ready ms",
+           "mean ready ms", "busy s");
+    for (const hal::TaskStats &task : hal::taskStats()) {
+        printf("%-16s %4u %10llu %11llu %16.3f %16.3f %10.3f\n", task.name.c_str(), (unsigned)task.priority,
+               (unsigned long long)task.wakeups, (unsigned long long)task.preemptions, task.maxReadyLatencyUs / 1000.0,
+               task.wakeups ? task.readyLatencyUs / 1000.0 / task.wakeups : 0.0, task.busyUs / 1e6);
+    }
+}
+
+/** @brief Adds the problems the job and task statistics show. */
+void findProblems() {
+    static char lines[SCHEDULER_MAX_JOBS * 2 + 16][128];
+    size_t line = 0;
+    auto add = [&line](const char *format, auto... args) {
+        if (line < sizeof(lines) / sizeof(lines[0])) {
+            snprintf(lines[line], sizeof(lines[line]), format, args...);
+            problems.push_back(lines[line++]);
+        }
+    };
+    for (int i = 0; i < scheduler.jobs(); i++) {
+        const JobStats &stats = scheduler.stats(i);
+        uint32_t period = scheduler.period(i);
+        if (period > 0 && stats.runs == 0) {
+            add("job %s never ran", scheduler.name(i));
+        }
+        if (stats.skipped > 0) {
+            add("job %s skipped %u deadlines", scheduler.name(i), stats.skipped);
+        } else if (period > 0 && stats.maxLateness > period * 1000) {
+            add("job %s started %.1f ms late, more than its period", scheduler.name(i), stats.maxLateness / 1000.0);
+        }
+    }
+    uint64_t now = hal::deviceTimeUs();
+    for (const hal::TaskStats &task : hal::taskStats()) {
+        if (task.waitingFor && task.forever && now - task.blockedSinceUs > kStuckS * 1000000) {
+            add("task %s blocked on %s %p with no timeout for %.1f s", task.name.c_str(), task.waitingFor, task.object,
+                (now - task.blockedSinceUs) / 1e6);
+        }
+    }
+}
+
+/** @brief Deletes `dir` and the flash images in it. */
+void removeFlashDir(const char *dir) {
+    if (DIR *entries = opendir(dir)) {
+        while (struct dirent *entry = readdir(entries)) {
+            if (entry->d_name[0] != '.') {
+                unlink((std::string(dir) + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(entries);
+    }
+    rmdir(dir);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    double days = argc > 1 ? atof(argv[1]) : 1;
+    uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 24;
+    uint64_t endUs = (uint64_t)(days * 86400e6);
+
+    static char flashDir[] = "/tmp/firmwaresim.XXXXXX";
+    static bool ownFlash = mkdtemp(flashDir) != nullptr;
+    if (ownFlash) {
+        if (!getenv("HAL_FLASH_DIR")) {
+            setenv("HAL_FLASH_DIR", flashDir, 1);
+        }
+        std::string table = std::string(flashDir) + "/partitions.csv";
+        if (FILE *csv = !getenv("HAL_PARTITIONS") ? fopen(table.c_str(), "w") : nullptr) {
+            fprintf(csv, "uplinkq, data, 0x40, 0x310000, 0x%X,\n", (unsigned)(kStoreSegments * FRAME_STORE_SEGMENT_SIZE));
+            fclose(csv);
+            setenv("HAL_PARTITIONS", table.c_str(), 1);
+        }
+    }
+
+    hal::startVirtualTime();
+    static CloudPeer peer(seed);
+    Serial.setTxSink([](const uint8_t *data, size_t length) { (void)data; consoleBytes += length; });
+    Serial1.setTxSink([](const uint8_t *data, size_t length) { peer.receive(data, length); });
+    hal::startPms5003();
+    hal::startRoomModel(hal::defaultRoom(), kFanChannel, kFanFullDuty, 1.0f);
+    script();
+    hal::addEvent(kScriptPeriodS * 1000, kScriptPeriodS * 1000, script);
+    hal::addEvent(kTelemetryPeriodS * 1000, kTelemetryPeriodS * 1000, [] { peer.requestTelemetry(); });
+    hal::addEvent(60000, kCommandPeriodS * 1000, [] { peer.sendCommand(); });
+    hal::addEvent((uint32_t)(kOutageStartH * 3600000), 0, [] { peer.setOnline(false); });
+    hal::addEvent((uint32_t)((kOutageStartH + kOutageHours) * 3600000), 0, [] { peer.setOnline(true); });
+    hal::onDeadlock([] {
+        printJobs();
+        printTasks();
+        peer.report();
+        fflush(stdout);
+        if (ownFlash) {
+            removeFlashDir(flashDir);
+        }
+    });
+
+    auto wallStart = std::chrono::steady_clock::now();
+    setup();
+    uint64_t lastUs = hal::deviceTimeUs();
+    uint32_t spins = 0;
+    while (hal::deviceTimeUs() < endUs) {
+        loop();
+        if (hal::deviceTimeUs() != lastUs) {
+            lastUs = hal::deviceTimeUs();
+            spins = 0;
+        } else if (++spins >= kMaxSpins) {
+            problems.push_back("loopTask keeps running loop() without letting device time pass");
+            break;
+        }
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("%.2f h of device time, seed %u\n\n", hours(hal::deviceTimeUs()), seed);
+    printJobs();
+    printTasks();
+    peer.report();
+    hal::RoomModel room = hal::roomState();
+    printf("\nroom PM2.5 %.1f ug/m3, fan duty %u, console %llu bytes\n", room.concentration,
+           (unsigned)hal::ledcDuty(kFanChannel), consoleBytes);
+#if LINK_FRAMED
+    printf("uplink: %u batches appended, %llu delivered, %u dropped, %u corrupt, %u still queued\n",
+           uplinkStore.appended, peer.inOrder, uplinkStore.dropped, uplinkStore.corrupt, uplinkStore.pending());
+#endif
+    fprintf(stderr, "%.1f s of wall time, %.0fx device speed\n", wall, hours(hal::deviceTimeUs()) * 3600 / wall);
+
+    findProblems();
+    if (peer.commandsAcked < peer.commandsSent) {
+        problems.push_back("commands left unacknowledged");
+    }
+#if LINK_FRAMED
+    // A batch the peer never got must still be queued or counted as lost
+    if (peer.inOrder + uplinkStore.dropped + uplinkStore.corrupt + uplinkStore.pending() < uplinkStore.appended) {
+        problems.push_back("batches lost without being counted as dropped");
+    }
+    if (uplinkStore.pending() > kMaxQueuedAtEnd) {
+        problems.push_back("batches left queued for the peer");
+    }
+#endif
+    printf("\n%zu problems\n", problems.size());
+    for (const char *problem : problems) {
+        printf("  %s\n", problem);
+    }
+    fflush(stdout);
+    if (ownFlash) {
+        removeFlashDir(flashDir);
+    }
+    // The firmware's tasks never return; leave without running the destructors under them
+    _Exit(problems.empty() ? 0 : 1);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file logdecode.cpp
+ * @brief Host decoder for binary log dumps of firmware built with `LOG_BINARY=1`.
+ *
+ * Reads a capture of the console (a file, or standard input), finds the `FRAME_LOG` frames in it
+ * and prints every record as a text line, exactly as the firmware would have printed it. Other
+ * bytes, such as boot messages, are skipped. Build it from the same tree as the firmware, since
+ * the message ids are positions in `LOG_MESSAGES`:
+ *
+ *     g++ -std=gnu++17 -Isrc tools/logdecode.cpp src/LogCatalog.cpp src/SerialFrame.cpp src/StreamCrc32.cpp -o logdecode
+ *     logdecode console.bin
+ */
+
+#include <stdio.h>
+
+#include <LogCatalog.h>
+#include <SerialFrame.h>
+
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    if (argc > 1) {
+        in = fopen(argv[1], "rb");
+        if (!in) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    FrameDecoder decoder;
+    unsigned long records = 0;
+    unsigned long truncated = 0;
+    int expected = -1;
+    unsigned long missing = 0;
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (!decoder.feed((uint8_t)c)) {
+            continue;
+        }
+        const Frame &frame = decoder.frame();
+        if (frame.type != FRAME_LOG) {
+            continue;
+        }
+        if (expected >= 0 && frame.seq != (uint8_t)expected) {
+            missing += (uint8_t)(frame.seq - expected);
+        }
+        expected = (uint8_t)(frame.seq + 1);
+
+        size_t offset = 0;
+        while (offset < frame.length) {
+            LogRecord record;
+            size_t used = decodeLogRecord(frame.payload + offset, frame.length - offset, record);
+            if (used == 0) {
+                truncated++;
+                break;
+            }
+            offset += used;
+
+            char line[256];
+            formatLogRecord(record, line, sizeof(line));
+            puts(line);
+            records++;
+        }
+    }
+
+    fprintf(stderr, "%lu records, %lu frames missing, %lu blocks skipped (plain text or corrupt frames), %lu truncated frames\n",
+            records, missing, (unsigned long)(decoder.crcErrors + decoder.framingErrors), truncated);
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file parserbench.cpp
+ * @brief Throughput of the incremental command parser, in bytes/s, on both links.
+ *
+ * Random actuator commands, some with unknown keys and nested values the parser has to skip, are
+ * fed as the device receives them:
+ *
+ * - line mode: the legacy stream of JSON lines with their decimal CRC32, byte by byte into `feed()`,
+ *   with one line in 50 corrupted, which must be rejected;
+ * - document mode: the payload of each `FRAME_COMMAND` frame into `parse()`;
+ * - framed: the encoded frames byte by byte through `FrameDecoder`, then `parse()`, as `receiveByte()`
+ *   does.
+ *
+ * Every valid command must come out with the values it was generated with.
+ *
+ *     g++ -std=gnu++17 -O2 -Isrc tools/parserbench.cpp src/CommandParser.cpp src/SerialFrame.cpp \
+ *         src/StreamCrc32.cpp -o parserbench
+ *     parserbench [commands]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CommandParser.h>
+#include <SerialFrame.h>
+#include <StreamCrc32.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int kPasses = 20;
+
+struct Sample {
+    std::string document;
+    ActuatorCommand command;
+};
+
+Sample randomCommand(std::mt19937 &rng) {
+    Sample sample;
+    memset(&sample.command, 0, sizeof(sample.command));
+    std::uniform_int_distribution<int> chance(0, 9);
+    std::string &d = sample.document;
+    d = "{";
+    auto key = [&](const char *name, int value, uint8_t bit) {
+        if (chance(rng) < 2) return;
+        if (d.size() > 1) d += ",";
+        d += "\"" + std::string(name) + "\":" + std::to_string(value);
+        sample.command.present |= bit;
+    };
+    sample.command.red = (uint8_t)rng();
+    sample.command.green = (uint8_t)rng();
+    sample.command.blue = (uint8_t)rng();
+    sample.command.dutyCycle = (uint16_t)std::uniform_int_distribution<int>(0, 1023)(rng);
+    key("RED", sample.command.red, COMMAND_RED);
+    if (chance(rng) == 0) {
+        d += std::string(d.size() > 1 ? "," : "") + "\"Note\":{\"text\":\"a, b} c\",\"list\":[1,[2,3]]}";
+    }
+    key("GREEN", sample.command.green, COMMAND_GREEN);
+    key("BLUE", sample.command.blue, COMMAND_BLUE);
+    key("DutyCycle", sample.command.dutyCycle, COMMAND_DUTY);
+    d += "}";
+    if (!(sample.command.present & COMMAND_RED)) sample.command.red = 0;
+    if (!(sample.command.present & COMMAND_GREEN)) sample.command.green = 0;
+    if (!(sample.command.present & COMMAND_BLUE)) sample.command.blue = 0;
+    if (!(sample.command.present & COMMAND_DUTY)) sample.command.dutyCycle = 0;
+    return sample;
+}
+
+bool same(const ActuatorCommand &a, const ActuatorCommand &b) {
+    return a.present == b.present && a.red == b.red && a.green == b.green && a.blue == b.blue &&
+           a.dutyCycle == b.dutyCycle;
+}
+
+void report(const char *mode, size_t bytes, double seconds, long commands, long errors, long wrong) {
+    printf("%-10s %10.1f MB/s %10.0f ns/command %8ld commands %6ld rejected %4ld wrong\n", mode,
+           bytes * kPasses / seconds / 1e6, seconds * 1e9 / (commands + errors) / kPasses, commands, errors, wrong);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    long count = argc > 1 ? atol(argv[1]) : 100000;
+    std::mt19937 rng(6);
+    std::vector<Sample> samples;
+    for (long i = 0; i < count; i++) {
+        samples.push_back(randomCommand(rng));
+    }
+
+    // Legacy lines; every 50th has a digit of its document changed after the CRC was computed
+    std::string lines;
+    std::vector<bool> corrupt;
+    for (size_t i = 0; i < samples.size(); i++) {
+        std::string line = samples[i].document;
+        uint32_t crc = StreamCrc32::compute(line.data(), line.size());
+        corrupt.push_back(i % 50 == 49 && line.find_first_of("0123456789") != std::string::npos);
+        if (corrupt.back()) {
+            size_t at = line.find_first_of("0123456789");
+            line[at] = line[at] == '9' ? '8' : line[at] + 1;
+        }
+        lines += line + std::to_string(crc) + "\n";
+    }
+
+    std::vector<uint8_t> frames;
+    for (size_t i = 0; i < samples.size(); i++) {
+        uint8_t frame[FRAME_MAX_ENCODED];
+        const std::string &d = samples[i].document;
+        size_t length =
+            encodeFrame(FRAME_COMMAND, (uint8_t)i, (const uint8_t *)d.data(), d.size(), frame, sizeof(frame));
+        frames.insert(frames.end(), frame, frame + length);
+    }
+
+    long commands = 0, errors = 0, wrong = 0;
+    Clock::time_point start = Clock::now();
+    for (int pass = 0; pass < kPasses; pass++) {
+        CommandParser parser(true);
+        size_t next = 0;
+        commands = errors = wrong = 0;
+        for (char c : lines) {
+            CommandParser::Result result = parser.feed((uint8_t)c);
+            if (result == CommandParser::PARSE_COMMAND) {
+                commands++;
+                wrong += corrupt[next] || !same(parser.command(), samples[next].command);
+                next++;
+            } else if (result == CommandParser::PARSE_ERROR) {
+                errors++;
+                wrong += !corrupt[next];
+                next++;
+            }
+        }
+    }
+    report("line", lines.size(), std::chrono::duration<double>(Clock::now() - start).count(), commands, errors, wrong);
+
+    size_t documentBytes = 0;
+    for (const Sample &sample : samples) {
+        documentBytes += sample.document.size();
+    }
+    start = Clock::now();
+    for (int pass = 0; pass < kPasses; pass++) {
+        CommandParser parser(false);
+        commands = errors = wrong = 0;
+        for (const Sample &sample : samples) {
+            if (parser.parse((const uint8_t *)sample.document.data(), sample.document.size())) {
+                commands++;
+                wrong += !same(parser.command(), sample.command);
+            } else {
+                errors++;
+                wrong++;
+            }
+        }
+    }
+    report("document", documentBytes, std::chrono::duration<double>(Clock::now() - start).count(), commands, errors,
+           wrong);
+
+    start = Clock::now();
+    for (int pass = 0; pass < kPasses; pass++) {
+        FrameDecoder decoder;
+        CommandParser parser(false);
+        commands = errors = wrong = 0;
+        for (uint8_t byte : frames) {
+            if (!decoder.feed(byte)) {
+                continue;
+            }
+            const Frame &frame = decoder.frame();
+            if (parser.parse(frame.payload, frame.length)) {
+                commands++;
+                wrong += !same(parser.command(), samples[commands + errors - 1].command);
+            } else {
+                errors++;
+                wrong++;
+            }
+        }
+    }
+    report("framed", frames.size(), std::chrono::duration<double>(Clock::now() - start).count(), commands, errors,
+           wrong);
+    return wrong == 0 ? 0 : 1;
+}
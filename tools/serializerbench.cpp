@@ -0,0 +1,139 @@
+/**
+ * @file serializerbench.cpp
+ * @brief Output check, heap allocations and speed of the JSON reading serializer.
+ *
+ * `serializeReadingJson()` is run against the `String` concatenation it replaced, rebuilt here with
+ * the native HAL's `String` and a bitwise CRC-32, on random readings that include NaN, infinities
+ * and negative values. Every line must be byte-for-byte identical. Allocations are counted by
+ * replacing the global `operator new`; the native `String` wraps `std::string`, whose short-string
+ * buffer spares it some of the allocations Arduino's `String` makes, so its count is a lower bound.
+ *
+ *     g++ -std=gnu++17 -O2 -DARDUINO=10819 -Isrc -Ilib/NativeHal/src tools/serializerbench.cpp \
+ *         src/PayloadSerializer.cpp src/StreamCrc32.cpp lib/NativeHal/src/WString.cpp -o serializerbench
+ *     serializerbench [readings]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <new>
+#include <random>
+#include <vector>
+
+#include <PayloadSerializer.h>
+#include <WString.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char kIsaacId[] = "ec03f332a7b0400000";
+
+unsigned long long allocations = 0;
+
+uint32_t bitwiseCrc32(const char *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint8_t)data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/** @brief The line as the firmware built it before the serializer, `String` by `String`. */
+String legacyLine(const SensorData &data, const char *isaacId) {
+    String json;
+    json += "{\"database\":\"isaac_v1\",\"collection\":\"sensor_readings\",\"dataSource\":\"IsaacTest\",\"document\": {";
+    json += "\"ISAAC ID\" : \"" + String(isaacId) + "\",";
+    json += "\"PM2.5\":" + String(data.pms5003.pm2_5) + ",";
+    json += "\"Temperature\":" + String(data.dht11.temperature) + ",";
+    json += "\"Humidity\":" + String(data.dht11.humidity) + ",";
+    json += "\"Smoke\":" + String(data.mq7.gasValue);
+    json += "}}";
+    uint32_t crc = bitwiseCrc32(json.c_str(), json.length());
+    json += String((unsigned long)crc) + "\n";
+    return json;
+}
+
+float randomFloat(std::mt19937 &rng) {
+    std::uniform_int_distribution<int> kind(0, 99);
+    int k = kind(rng);
+    if (k == 0) return NAN;
+    if (k == 1) return INFINITY;
+    if (k == 2) return -INFINITY;
+    if (k < 10) return std::uniform_real_distribution<float>(-1e6f, 1e6f)(rng);
+    return std::uniform_real_distribution<float>(-40.0f, 100.0f)(rng);
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+int main(int argc, char **argv) {
+    long readings = argc > 1 ? atol(argv[1]) : 300000;
+
+    std::mt19937 rng(3);
+    std::vector<SensorData> data(readings);
+    for (SensorData &d : data) {
+        memset(&d, 0, sizeof(d));
+        d.pms5003.pm2_5 = (uint16_t)rng();
+        d.dht11.temperature = randomFloat(rng);
+        d.dht11.humidity = randomFloat(rng);
+        d.mq7.gasValue = std::uniform_int_distribution<int>(-1000, 100000)(rng);
+    }
+
+    long mismatches = 0;
+    for (const SensorData &d : data) {
+        char line[PAYLOAD_JSON_MAX];
+        size_t length = serializeReadingJson(d, kIsaacId, line, sizeof(line));
+        String expected = legacyLine(d, kIsaacId);
+        if (length != expected.length() || memcmp(line, expected.c_str(), length) != 0) {
+            if (mismatches++ < 5) {
+                printf("mismatch:\n  %s  %s", expected.c_str(), line);
+            }
+        }
+    }
+    printf("%ld readings, %ld mismatches against the String concatenation\n\n", readings, mismatches);
+
+    printf("%-22s %14s %12s\n", "", "allocs/message", "ns/message");
+    unsigned long long before = allocations;
+    size_t total = 0;
+    Clock::time_point start = Clock::now();
+    for (const SensorData &d : data) {
+        total += legacyLine(d, kIsaacId).length();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-22s %14.2f %12.1f\n", "String concatenation", (double)(allocations - before) / readings,
+           seconds * 1e9 / readings);
+
+    before = allocations;
+    start = Clock::now();
+    for (const SensorData &d : data) {
+        char line[PAYLOAD_JSON_MAX];
+        total += serializeReadingJson(d, kIsaacId, line, sizeof(line));
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-22s %14.2f %12.1f\n", "serializeReadingJson", (double)(allocations - before) / readings,
+           seconds * 1e9 / readings);
+    fprintf(stderr, "%zu bytes\n", total);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file storebench.cpp
+ * @brief Append, replay and recovery speed of the store-and-forward log on the native flash shim.
+ *
+ * The log gets a partition the size of "uplinkq" in partitions.csv, in a temporary directory. For
+ * each record size, records are appended until the log is about to wrap, then replayed as
+ * `forwardStored()` does with every frame acknowledged (`next()` and `acknowledge()` per record),
+ * and the log is recovered by a new store (`begin()`) both full and after the replay. Every record
+ * replayed is checked against what was appended.
+ *
+ * The shim reads and writes a file, so these are host numbers, not ESP32 flash timings; they show
+ * the cost of the store's own bookkeeping and catch regressions in it.
+ *
+ *     g++ -std=gnu++17 -O2 -Isrc -Ilib/NativeHal/src tools/storebench.cpp src/FrameStore.cpp src/StreamCrc32.cpp \
+ *         lib/NativeHal/src/EspPartition.cpp -o storebench
+ *     storebench
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <FrameStore.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint32_t kPartitionSize = 0xE0000;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void fill(uint8_t *data, size_t length, uint32_t id) {
+    for (size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(id * 31 + i);
+    }
+}
+
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/storebench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    std::string table = std::string(dir) + "/partitions.csv";
+    if (FILE *csv = fopen(table.c_str(), "w")) {
+        fprintf(csv, "uplinkq, data, 0x40, 0x310000, 0x%X,\n", (unsigned)kPartitionSize);
+        fclose(csv);
+    }
+    setenv("HAL_PARTITIONS", table.c_str(), 1);
+    setenv("HAL_FLASH_DIR", dir, 1);
+    const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)0x40, "uplinkq");
+    if (!partition) {
+        fprintf(stderr, "no partition\n");
+        return 1;
+    }
+
+    printf("%8s %8s %14s %14s %14s %14s %12s\n", "bytes", "records", "append rec/ms", "replay rec/ms",
+           "append MB/s", "begin full ms", "begin ms");
+    const size_t sizes[] = {32, 80, 160, FRAME_STORE_MAX_RECORD};
+    long mismatches = 0;
+    for (size_t size : sizes) {
+        esp_partition_erase_range(partition, 0, partition->size);
+        std::unique_ptr<FrameStore> store(new FrameStore(RETAIN_OLDEST));
+        store->begin(partition);
+
+        // Up to the last free segment, so neither policy has anything to give up; a segment starts with
+        // an 8-byte header and a record takes a 12-byte header plus its data, padded to 4
+        uint32_t perSegment = (FRAME_STORE_SEGMENT_SIZE - 8) / ((12 + size + 3) & ~(size_t)3);
+        uint32_t records = perSegment * (kPartitionSize / FRAME_STORE_SEGMENT_SIZE - 2);
+        uint8_t data[FRAME_STORE_MAX_RECORD];
+        Clock::time_point start = Clock::now();
+        for (uint32_t i = 0; i < records; i++) {
+            fill(data, size, i + 1);
+            if (!store->append(FRAME_BATCH, data, size)) {
+                fprintf(stderr, "append %u refused\n", (unsigned)i);
+                return 1;
+            }
+        }
+        double appendMs = elapsedMs(start);
+
+        start = Clock::now();
+        store.reset(new FrameStore(RETAIN_OLDEST));
+        store->begin(partition);
+        double beginFullMs = elapsedMs(start);
+
+        start = Clock::now();
+        uint8_t type;
+        uint8_t expected[FRAME_STORE_MAX_RECORD];
+        uint16_t length;
+        uint32_t id, previous, replayed = 0;
+        while (store->next(type, data, length, id, previous)) {
+            fill(expected, size, id);
+            mismatches += length != size || memcmp(data, expected, size) != 0 || id != replayed + 1;
+            store->acknowledge(id);
+            replayed++;
+        }
+        double replayMs = elapsedMs(start);
+        mismatches += replayed != records || store->pending() != 0;
+
+        start = Clock::now();
+        store.reset(new FrameStore(RETAIN_OLDEST));
+        store->begin(partition);
+        double beginMs = elapsedMs(start);
+        mismatches += store->pending() != 0;
+
+        printf("%8zu %8u %14.1f %14.1f %14.1f %14.2f %12.2f\n", size, (unsigned)records, records / appendMs,
+               replayed / replayMs, records * size / appendMs / 1e3, beginFullMs, beginMs);
+    }
+    printf("%ld mismatches\n", mismatches);
+
+    if (DIR *entries = opendir(dir)) {
+        while (struct dirent *entry = readdir(entries)) {
+            if (entry->d_name[0] != '.') {
+                unlink((std::string(dir) + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(entries);
+    }
+    rmdir(dir);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,436 @@
+/**
+ * @file tracereplay.cpp
+ * @brief Host replay of a trace dumped by the firmware (see TraceRecorder.h).
+ *
+ * Reads a capture of the console (a file, or standard input), reassembles the last complete trace
+ * dump in it, skipping the log output around the `FRAME_TRACE` frames, and summarises it. The
+ * trace is then fed through the firmware's own code at full speed, `repeat` times:
+ *
+ * - Serial1 RX: the frame decoder, then `decodeControl()` or the JSON command parser per frame; a
+ *   trace holding no frame was taken from a `LINK_FRAMED=0` build and goes through the line parser.
+ * - Serial2 RX: the PMS5003 frame parser.
+ * - Send: the DHT11 and MQ7 readings and the decoded PMS5003 frames, in time order, packed into
+ *   `FRAME_BATCH` frames as the firmware batches them.
+ * - Serial1 TX: the frames the device sent, through the frame decoder.
+ *
+ * Counts and errors are those of the device's parsers on the same bytes, so a parser change is
+ * checked against field traffic by comparing them, and its cost by comparing the times. `-p` prints
+ * every record first. Bytes are those parsed, or for the send stage those of the frames built. Build
+ * it from the same tree as the firmware under test:
+ *
+ *     g++ -std=gnu++17 -O2 -DARDUINO=10819 -Isrc -Ilib/NativeHal/src tools/tracereplay.cpp src/CommandParser.cpp \
+ *         src/CommandProtocol.cpp src/PMS5003Protocol.cpp src/ReadingPayload.cpp src/SerialFrame.cpp \
+ *         src/StreamCrc32.cpp -o tracereplay
+ *     tracereplay [-p] [-n repeat] console.bin
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <CommandParser.h>
+#include <CommandProtocol.h>
+#include <PMS5003Protocol.h>
+#include <ReadingPayload.h>
+#include <SensorSnapshot.h>
+#include <SerialFrame.h>
+#include <TraceRecorder.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint8_t kBatchSize = 8;                         ///< The firmware's default `BATCH_SIZE`.
+const char kDeviceId[] = "ec03f332a7b0400000";        ///< Same length as the firmware's id.
+const char *const kSourceNames[] = {"?", "serial1-rx", "serial1-tx", "serial2-rx", "serial2-tx", "dht11", "mq7"};
+const int kSources = sizeof(kSourceNames) / sizeof(kSourceNames[0]);
+
+struct Record {
+    uint64_t time;      ///< Device time in µs, `micros()` wrap-arounds unfolded.
+    uint8_t source;
+    std::vector<uint8_t> data;
+};
+
+/** @brief A sample of the send path, with its `millis()` time. */
+struct Sample {
+    uint32_t time;
+    uint8_t channel;
+    DHT11Data dht11;
+    PMS5003Data pms5003;
+    MQ7Data mq7;
+};
+
+/** @brief What one replay stage did per pass, and how long all passes took. */
+struct Stage {
+    const char *name;
+    uint64_t items;
+    uint64_t errors;
+    uint64_t bytes;
+    double seconds;
+};
+
+volatile uint32_t sink;   ///< Keeps the results of every pass alive.
+
+uint32_t getWord(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+template <typename T>
+T getValue(const std::vector<uint8_t> &data, size_t offset) {
+    T value;
+    memcpy(&value, data.data() + offset, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Finds the last complete dump in a console capture.
+ *
+ * @return false if there is none; `header` then holds the last header seen, if any.
+ */
+bool extractDump(FILE *in, std::vector<uint8_t> &dump, uint8_t header[TRACE_HEADER_LENGTH], unsigned &dumps) {
+    FrameDecoder decoder;
+    std::vector<uint8_t> current;
+    uint8_t currentHeader[TRACE_HEADER_LENGTH];
+    bool assembling = false;
+    bool found = false;
+    uint8_t expected = 0;
+    dumps = 0;
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (!decoder.feed((uint8_t)c)) {
+            continue;
+        }
+        const Frame &frame = decoder.frame();
+        if (frame.type != FRAME_TRACE || frame.length == 0) {
+            continue;
+        }
+        if (frame.payload[0] == TRACE_DUMP_HEADER && frame.length >= TRACE_HEADER_LENGTH) {
+            memcpy(currentHeader, frame.payload, TRACE_HEADER_LENGTH);
+            current.clear();
+            assembling = currentHeader[1] == TRACE_VERSION;
+            if (!assembling) {
+                fprintf(stderr, "dump version %u, this tool reads version %u\n", currentHeader[1], TRACE_VERSION);
+            }
+        } else if (frame.payload[0] == TRACE_DUMP_DATA && assembling) {
+            if (frame.seq != expected) {
+                fprintf(stderr, "dump frames missing, dump dropped\n");
+                assembling = false;
+                continue;
+            }
+            current.insert(current.end(), frame.payload + 1, frame.payload + frame.length);
+        } else {
+            continue;
+        }
+        expected = (uint8_t)(frame.seq + 1);
+        if (assembling && current.size() >= getWord(currentHeader + 2)) {
+            dump = current;
+            memcpy(header, currentHeader, TRACE_HEADER_LENGTH);
+            assembling = false;
+            found = true;
+            dumps++;
+        }
+    }
+    return found;
+}
+
+/** @brief Splits the dump into records; false if it ends in the middle of one. */
+bool parseRecords(const std::vector<uint8_t> &dump, uint32_t baseTime, std::vector<Record> &records) {
+    uint64_t time = baseTime;
+    size_t at = 0;
+    while (at < dump.size()) {
+        Record record;
+        record.source = dump[at++];
+        uint32_t delta = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            if (at >= dump.size() || shift > 28) {
+                return false;
+            }
+            byte = dump[at++];
+            delta |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (at >= dump.size() || at + 1 + dump[at] > dump.size()) {
+            return false;
+        }
+        size_t length = dump[at++];
+        time += delta;
+        record.time = time;
+        record.data.assign(dump.begin() + at, dump.begin() + at + length);
+        at += length;
+        records.push_back(record);
+    }
+    return true;
+}
+
+void printRecord(const Record &record, uint64_t start) {
+    printf("%12.6f  %-10s %4zu  ", (record.time - start) / 1e6,
+           kSourceNames[record.source < kSources ? record.source : 0], record.data.size());
+    if (record.source == TRACE_DHT11 && record.data.size() == 8) {
+        printf("%.1f C %.1f %%RH\n", getValue<float>(record.data, 0), getValue<float>(record.data, 4));
+    } else if (record.source == TRACE_MQ7 && record.data.size() == 6) {
+        printf("%u mV %.2f ppm\n", getValue<uint16_t>(record.data, 0), getValue<float>(record.data, 2));
+    } else {
+        size_t shown = record.data.size() < 24 ? record.data.size() : 24;
+        for (size_t i = 0; i < shown; i++) {
+            printf("%02x ", record.data[i]);
+        }
+        puts(shown < record.data.size() ? "..." : "");
+    }
+}
+
+/** @brief Runs `pass` `repeat` times and times it; the counts are those of the last pass. */
+template <typename Pass>
+Stage measure(const char *name, int repeat, Pass pass) {
+    Stage stage = {name, 0, 0, 0, 0};
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < repeat; i++) {
+        stage.items = stage.errors = stage.bytes = 0;
+        pass(stage);
+    }
+    stage.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return stage;
+}
+
+/** @brief Serial1 RX as `receiveByte()` parses it. */
+void replayReceive(const std::vector<const Record *> &rx, bool framed, Stage &stage) {
+    if (!framed) {
+        CommandParser lines(true);
+        for (const Record *record : rx) {
+            for (uint8_t byte : record->data) {
+                CommandParser::Result result = lines.feed(byte);
+                stage.items += result == CommandParser::PARSE_COMMAND;
+                stage.errors += result == CommandParser::PARSE_ERROR;
+            }
+            stage.bytes += record->data.size();
+        }
+        return;
+    }
+    FrameDecoder decoder;
+    CommandParser json(false);
+    for (const Record *record : rx) {
+        for (uint8_t byte : record->data) {
+            if (!decoder.feed(byte)) {
+                continue;
+            }
+            const Frame &frame = decoder.frame();
+            stage.items++;
+            if (frame.type == FRAME_CONTROL) {
+                ControlCommand command;
+                stage.errors += decodeControl(frame.payload, frame.length, command) >= CONTROL_BAD_VERSION;
+            } else if (frame.type == FRAME_COMMAND) {
+                stage.errors += !json.parse(frame.payload, frame.length);
+            } else if (frame.type == FRAME_ACK && frame.length >= 4) {
+                sink = (uint32_t)frame.payload[0] | ((uint32_t)frame.payload[1] << 8) |
+                       ((uint32_t)frame.payload[2] << 16) | ((uint32_t)frame.payload[3] << 24);
+            }
+        }
+        stage.bytes += record->data.size();
+    }
+    stage.errors += decoder.crcErrors + decoder.framingErrors;
+}
+
+/** @brief Serial2 RX as `PMS5003Sensor::poll()` parses it; the frames go to `samples` when given. */
+void replayPms5003(const std::vector<const Record *> &rx, Stage &stage, std::vector<Sample> *samples) {
+    PMS5003Parser parser;
+    for (const Record *record : rx) {
+        for (uint8_t byte : record->data) {
+            if (parser.feed(byte) && samples) {
+                Sample sample = {};
+                sample.time = (uint32_t)(record->time / 1000);
+                sample.channel = CHANNEL_PMS5003;
+                sample.pms5003 = parser.data();
+                samples->push_back(sample);
+            }
+        }
+        stage.bytes += record->data.size();
+    }
+    sink = parser.data().pm2_5;
+    stage.items = parser.frames;
+    stage.errors = parser.checksumErrors + parser.framingErrors;
+}
+
+/** @brief Packs `samples` into batch frames, sending a batch when it is full as `sendBatch()` does. */
+void replaySend(const std::vector<Sample> &samples, Stage &stage) {
+    ReadingBatch batch(kDeviceId, kBatchSize);
+    uint32_t id = 1;
+    auto send = [&](uint32_t now) {
+        batch.seal(now);
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        encodeRecordHeader(id, id - 1, payload);
+        memcpy(payload + FRAME_RECORD_HEADER, batch.data(), batch.length());
+        uint8_t frame[FRAME_MAX_ENCODED];
+        stage.bytes += encodeFrame(FRAME_BATCH, (uint8_t)id++, payload, FRAME_RECORD_HEADER + batch.length(), frame,
+                                   sizeof(frame));
+        sink = frame[0];
+        batch.clear();
+    };
+    for (const Sample &sample : samples) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool added = sample.channel == CHANNEL_DHT11     ? batch.add<DHT11Channel>(sample.time, sample.dht11)
+                         : sample.channel == CHANNEL_PMS5003 ? batch.add<PMS5003Channel>(sample.time, sample.pms5003)
+                                                            : batch.add<MQ7Channel>(sample.time, sample.mq7);
+            if (added) {
+                stage.items++;
+                break;
+            }
+            if (batch.empty()) {
+                stage.errors++;
+                break;
+            }
+            send(sample.time);
+        }
+        if (batch.full()) {
+            send(sample.time);
+        }
+    }
+    if (!batch.empty()) {
+        send(samples.back().time);
+    }
+}
+
+/** @brief The frames the device sent on Serial1, through the frame decoder. */
+void replayTransmit(const std::vector<const Record *> &tx, Stage &stage) {
+    FrameDecoder decoder;
+    for (const Record *record : tx) {
+        for (uint8_t byte : record->data) {
+            if (decoder.feed(byte)) {
+                stage.items++;
+                sink = decoder.frame().type;
+            }
+        }
+        stage.bytes += record->data.size();
+    }
+    stage.errors = decoder.crcErrors + decoder.framingErrors;
+}
+
+void printStage(const Stage &stage, int repeat) {
+    double nsPerPass = stage.seconds * 1e9 / repeat;
+    printf("%-12s %9llu %7llu %10llu %10.1f %10.1f %9.1f\n", stage.name, (unsigned long long)stage.items,
+           (unsigned long long)stage.errors, (unsigned long long)stage.bytes,
+           stage.items ? nsPerPass / stage.items : 0.0, stage.bytes ? nsPerPass / stage.bytes : 0.0,
+           nsPerPass > 0 ? stage.bytes * 1e3 / nsPerPass : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bool print = false;
+    int repeat = 100;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0) {
+            print = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (repeat < 1) {
+        repeat = 1;
+    }
+
+    FILE *in = stdin;
+    if (path) {
+        in = fopen(path, "rb");
+        if (!in) {
+            perror(path);
+            return 1;
+        }
+    }
+    std::vector<uint8_t> dump;
+    uint8_t header[TRACE_HEADER_LENGTH];
+    unsigned dumps;
+    bool found = extractDump(in, dump, header, dumps);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (!found) {
+        fprintf(stderr, "no complete trace dump found\n");
+        return 1;
+    }
+
+    std::vector<Record> records;
+    if (!parseRecords(dump, getWord(header + 6), records)) {
+        fprintf(stderr, "trace truncated after %zu records\n", records.size());
+        return 1;
+    }
+    uint64_t start = records.empty() ? getWord(header + 6) : records.front().time;
+    uint64_t end = records.empty() ? start : records.back().time;
+    printf("trace: last of %u dumps, %zu bytes, %zu records over %.3f s, %u overwritten, %u skipped during dumps\n",
+           dumps, dump.size(), records.size(), (end - start) / 1e6, getWord(header + 10), getWord(header + 14));
+
+    std::vector<const Record *> bySource[kSources];
+    uint64_t bytes[kSources] = {};
+    std::vector<Sample> samples;
+    for (const Record &record : records) {
+        uint8_t source = record.source < kSources ? record.source : 0;
+        bySource[source].push_back(&record);
+        bytes[source] += record.data.size();
+        if (print) {
+            printRecord(record, start);
+        }
+    }
+    printf("\n%-12s %9s %10s\n", "source", "records", "bytes");
+    for (int source = 1; source < kSources; source++) {
+        printf("%-12s %9zu %10llu\n", kSourceNames[source], bySource[source].size(), (unsigned long long)bytes[source]);
+    }
+    if (!bySource[0].empty()) {
+        printf("%-12s %9zu %10llu\n", "unknown", bySource[0].size(), (unsigned long long)bytes[0]);
+    }
+
+    // The send path's input: the readings, and the PMS5003 frames as the parser decodes them
+    Stage pmsFrames = {};
+    replayPms5003(bySource[TRACE_SERIAL2_RX], pmsFrames, &samples);
+    for (const Record &record : records) {
+        Sample sample = {};
+        sample.time = (uint32_t)(record.time / 1000);
+        if (record.source == TRACE_DHT11 && record.data.size() == 8) {
+            sample.channel = CHANNEL_DHT11;
+            sample.dht11.temperature = getValue<float>(record.data, 0);
+            sample.dht11.humidity = getValue<float>(record.data, 4);
+            if (isnan(sample.dht11.temperature) || isnan(sample.dht11.humidity)) {
+                continue;   // The firmware publishes nothing on a failed read
+            }
+        } else if (record.source == TRACE_MQ7 && record.data.size() == 6) {
+            sample.channel = CHANNEL_MQ7;
+            sample.mq7.millivolts = getValue<uint16_t>(record.data, 0);
+            sample.mq7.ppm = getValue<float>(record.data, 2);
+            sample.mq7.gasValue = (int)lroundf(sample.mq7.ppm);
+        } else {
+            continue;
+        }
+        samples.push_back(sample);
+    }
+    std::stable_sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) { return a.time < b.time; });
+
+    // A framed link carries at least the cloud-ESP's acknowledgements
+    bool framed = bySource[TRACE_SERIAL1_RX].empty();
+    FrameDecoder probe;
+    for (const Record *record : bySource[TRACE_SERIAL1_RX]) {
+        for (uint8_t byte : record->data) {
+            framed = probe.feed(byte) || framed;
+        }
+    }
+
+    Stage stages[] = {
+        measure(framed ? "rx frames" : "rx lines", repeat,
+                [&](Stage &stage) { replayReceive(bySource[TRACE_SERIAL1_RX], framed, stage); }),
+        measure("pms5003", repeat, [&](Stage &stage) { replayPms5003(bySource[TRACE_SERIAL2_RX], stage, nullptr); }),
+        measure("send", repeat, [&](Stage &stage) { replaySend(samples, stage); }),
+        measure("tx frames", repeat, [&](Stage &stage) { replayTransmit(bySource[TRACE_SERIAL1_TX], stage); }),
+    };
+    printf("\nreplay, %d passes\n%-12s %9s %7s %10s %10s %10s %9s\n", repeat, "stage", "items", "errors", "bytes",
+           "ns/item", "ns/byte", "MB/s");
+    for (const Stage &stage : stages) {
+        printStage(stage, repeat);
+    }
+    return 0;
+}